@@ -0,0 +1,125 @@
+#include "AdaptiveAutoSave.h"
+
+#include <algorithm>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+	constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+	void Mix(uint64_t& hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= kFnvPrime;
+		}
+	}
+
+	wstring Seconds(chrono::seconds value)
+	{
+		return to_wstring(value.count()) + L" s";
+	}
+}
+
+uint64_t SaveFolderFingerprint(const TreeScan& scan)
+{
+	uint64_t hash = kFnvOffset;
+	for (const auto& entry : scan.entries)
+	{
+		string path = entry.relativePath.generic_u8string();
+		Mix(hash, path.data(), path.size() + 1); // With the terminator, so "ab"+"c" differs from "a"+"bc"
+		int type = static_cast<int>(entry.type);
+		uint64_t size = entry.size;
+		int64_t mtime = entry.mtime.time_since_epoch().count();
+		Mix(hash, &type, sizeof(type));
+		Mix(hash, &size, sizeof(size));
+		Mix(hash, &mtime, sizeof(mtime));
+	}
+	return hash;
+}
+
+AdaptiveAutoSave::AdaptiveAutoSave(const AdaptiveAutoSaveOptions& options, Clock::time_point start, uint64_t fingerprint)
+	: m_options(options), m_lastSeen(fingerprint), m_backedUp(fingerprint), m_lastBackup(start)
+{
+	m_options.floor = max(m_options.floor, chrono::seconds(1));
+	m_options.maximum = max(m_options.maximum, m_options.floor);
+	m_delay = m_options.floor;
+	m_nextFixedBackup = start + m_options.maximum;
+}
+
+AutoSaveDecision AdaptiveAutoSave::Check(Clock::time_point now, uint64_t fingerprint, uint64_t folderBytes)
+{
+	m_stats.checks++;
+	// What a fixed schedule at the maximum interval would have written by now
+	while (now >= m_nextFixedBackup)
+	{
+		m_stats.fixedScheduleBackups++;
+		m_stats.fixedScheduleBytes += folderBytes;
+		m_nextFixedBackup += m_options.maximum;
+	}
+
+	bool changed = fingerprint != m_lastSeen;
+	bool pending = fingerprint != m_backedUp;
+	m_lastSeen = fingerprint;
+	if (changed && !m_inBurst)
+	{
+		// A new burst: learn how far apart they start (weighted 1/4 toward the newest)
+		if (m_seenBurst)
+		{
+			auto gap = chrono::duration_cast<chrono::seconds>(now - m_burstStart);
+			m_learnedGap = m_learnedGap.count() == 0 ? gap : (m_learnedGap * 3 + gap) / 4;
+		}
+		m_burstStart = now;
+		m_seenBurst = true;
+	}
+	m_inBurst = changed;
+	if (pending && !m_hasPending) m_pendingSince = now;
+	m_hasPending = pending;
+
+	AutoSaveDecision decision;
+	if (pending && !changed && now - m_lastBackup >= m_options.floor)
+	{
+		decision.action = AutoSaveAction::Backup;
+		decision.reason = L"changes settled";
+	}
+	else if (pending && now - m_pendingSince >= m_options.maximum)
+	{
+		decision.action = AutoSaveAction::Backup;
+		decision.reason = L"still changing after " + Seconds(m_options.maximum);
+	}
+
+	if (decision.action == AutoSaveAction::Backup)
+	{
+		m_backedUp = fingerprint;
+		m_lastBackup = now;
+		m_stats.backups++;
+		m_stats.bytesBackedUp += folderBytes;
+		// Still being written: whatever comes next is unsaved from now on
+		m_hasPending = changed;
+		m_pendingSince = now;
+	}
+
+	if (pending && decision.action == AutoSaveAction::Wait)
+	{
+		m_delay = m_options.floor; // Watch the burst until it settles
+		if (decision.reason.empty()) decision.reason = L"save changing";
+	}
+	else if (changed)
+	{
+		m_delay = m_options.floor;
+	}
+	else
+	{
+		// Idle: back off, but keep checking a few times per usual gap, so two saves never look like one burst
+		m_delay = min(m_delay * 2, m_options.maximum);
+		if (m_learnedGap.count() > 0) m_delay = min(m_delay, max(m_learnedGap / 4, m_options.floor));
+		if (decision.reason.empty()) decision.reason = L"idle";
+	}
+	decision.nextCheck = clamp(m_delay, m_options.floor, m_options.maximum);
+	return decision;
+}
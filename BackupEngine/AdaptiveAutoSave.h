@@ -0,0 +1,94 @@
+#pragma once
+
+// Adaptive auto-save scheduling. A fixed interval backs up an idle save over and over and can
+// leave a busy session unprotected for most of the interval. In adaptive mode the save folder is
+// checked instead, and a backup is made only when it changed:
+//
+//   - while the game is writing, the folder is checked every `floor` seconds, and the backup is
+//     made at the first check that finds the burst settled (no change since the last check);
+//   - a folder that never settles is still backed up once it has been changing for `maximum`;
+//   - while nothing changes, checks back off toward `maximum`, but no further than a quarter of
+//     the usual gap between bursts seen so far, so the next burst is noticed soon;
+//   - two backups are never less than `floor` apart.
+//
+// The policy only sees fingerprints and times, so it can be tested without a clock.
+
+#include "BackupOperations.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct AdaptiveAutoSaveOptions
+{
+	std::chrono::seconds floor{ 60 };   // Shortest time between backups, and between checks
+	std::chrono::seconds maximum{ 600 }; // Longest time between checks; the fixed schedule compared against
+};
+
+enum class AutoSaveAction
+{
+	Wait,
+	Backup
+};
+
+struct AutoSaveDecision
+{
+	AutoSaveAction action = AutoSaveAction::Wait;
+	std::chrono::seconds nextCheck{ 0 };
+	std::wstring reason; // For the decision log
+};
+
+struct AdaptiveAutoSaveStats
+{
+	uint64_t checks = 0;
+	uint64_t backups = 0;
+	uint64_t bytesBackedUp = 0;        // Save-folder size at each backup made
+	uint64_t fixedScheduleBackups = 0; // Backups a fixed `maximum` interval would have made by now
+	uint64_t fixedScheduleBytes = 0;
+
+	// Negative when the game wrote often enough to need more backups than the fixed schedule
+	int64_t BytesSaved() const { return static_cast<int64_t>(fixedScheduleBytes) - static_cast<int64_t>(bytesBackedUp); }
+};
+
+/**
+ * @brief Changes whenever a file or folder of the scan is added, removed, resized or rewritten
+ * (FNV-1a over paths, sizes and modification times).
+ */
+uint64_t SaveFolderFingerprint(const TreeScan& scan);
+
+class AdaptiveAutoSave
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Starts from the folder as it is at `start`, taken as already backed up.
+	 */
+	AdaptiveAutoSave(const AdaptiveAutoSaveOptions& options, Clock::time_point start, uint64_t fingerprint);
+
+	/**
+	 * @brief One check of the save folder: its fingerprint and size at `now`. Returns whether to
+	 * back up now (the policy then counts the folder as backed up) and when to check next.
+	 */
+	AutoSaveDecision Check(Clock::time_point now, uint64_t fingerprint, uint64_t folderBytes);
+
+	const AdaptiveAutoSaveStats& Stats() const { return m_stats; }
+
+	// Smoothed time between the starts of two bursts of writes; zero until two were seen
+	std::chrono::seconds LearnedGap() const { return m_learnedGap; }
+
+private:
+	AdaptiveAutoSaveOptions m_options;
+	AdaptiveAutoSaveStats m_stats;
+	uint64_t m_lastSeen;
+	uint64_t m_backedUp;
+	Clock::time_point m_lastBackup;
+	Clock::time_point m_pendingSince{}; // First check that saw changes not backed up yet
+	bool m_hasPending = false;
+	Clock::time_point m_nextFixedBackup;
+	Clock::time_point m_burstStart{};
+	bool m_inBurst = false;
+	bool m_seenBurst = false;
+	std::chrono::seconds m_delay;
+	std::chrono::seconds m_learnedGap{ 0 };
+};
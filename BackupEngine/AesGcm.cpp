@@ -0,0 +1,428 @@
+#include "AesGcm.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GSBM_AES_X86 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define GSBM_AESNI_TARGET
+#else
+#include <cpuid.h>
+#define GSBM_AESNI_TARGET __attribute__((target("aes,pclmul,ssse3")))
+#endif
+#endif
+
+using namespace std;
+
+namespace
+{
+	struct AesTables
+	{
+		uint8_t sbox[256];
+		uint32_t te[4][256]; // SubBytes + MixColumns per input byte position
+	};
+
+	uint8_t Rotl8(uint8_t x, int shift)
+	{
+		return static_cast<uint8_t>((x << shift) | (x >> (8 - shift)));
+	}
+
+	uint8_t Times2(uint8_t x)
+	{
+		return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+	}
+
+	uint32_t Rotr32(uint32_t x, int shift)
+	{
+		return (x >> shift) | (x << (32 - shift));
+	}
+
+	// Built once from the field arithmetic rather than typed in, so there is no table to get wrong
+	const AesTables& GetAesTables()
+	{
+		static const AesTables tables = []
+			{
+				AesTables t{};
+				uint8_t p = 1, q = 1;
+				do
+				{
+					p = static_cast<uint8_t>(p ^ Times2(p));              // p * 3
+					q = static_cast<uint8_t>(q ^ (q << 1));               // q / 3
+					q = static_cast<uint8_t>(q ^ (q << 2));
+					q = static_cast<uint8_t>(q ^ (q << 4));
+					if (q & 0x80) q ^= 0x09;
+					t.sbox[p] = static_cast<uint8_t>(q ^ Rotl8(q, 1) ^ Rotl8(q, 2) ^ Rotl8(q, 3) ^ Rotl8(q, 4) ^ 0x63);
+				} while (p != 1);
+				t.sbox[0] = 0x63;
+
+				for (int i = 0; i < 256; ++i)
+				{
+					uint8_t s = t.sbox[i];
+					uint8_t s2 = Times2(s);
+					uint8_t s3 = static_cast<uint8_t>(s2 ^ s);
+					uint32_t word = (static_cast<uint32_t>(s2) << 24) | (static_cast<uint32_t>(s) << 16) | (static_cast<uint32_t>(s) << 8) | s3;
+					for (int r = 0; r < 4; ++r) t.te[r][i] = Rotr32(word, 8 * r);
+				}
+				return t;
+			}();
+		return tables;
+	}
+
+	uint32_t LoadBe32(const uint8_t* p)
+	{
+		return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+	}
+
+	void StoreBe32(uint8_t* p, uint32_t v)
+	{
+		p[0] = static_cast<uint8_t>(v >> 24);
+		p[1] = static_cast<uint8_t>(v >> 16);
+		p[2] = static_cast<uint8_t>(v >> 8);
+		p[3] = static_cast<uint8_t>(v);
+	}
+
+	uint64_t LoadBe64(const uint8_t* p)
+	{
+		return (static_cast<uint64_t>(LoadBe32(p)) << 32) | LoadBe32(p + 4);
+	}
+
+	void StoreBe64(uint8_t* p, uint64_t v)
+	{
+		StoreBe32(p, static_cast<uint32_t>(v >> 32));
+		StoreBe32(p + 4, static_cast<uint32_t>(v));
+	}
+
+	// Reduction constants for the 4-bit GHASH tables (Shoup's method)
+	const uint64_t kLast4[16] = {
+		0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+		0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0 };
+
+#if GSBM_AES_X86
+	// GF(2^128) multiply of byte-reflected operands (Intel carry-less multiplication white paper)
+	GSBM_AESNI_TARGET __m128i GfMul(__m128i a, __m128i b)
+	{
+		__m128i t3 = _mm_clmulepi64_si128(a, b, 0x00);
+		__m128i t4 = _mm_clmulepi64_si128(a, b, 0x10);
+		__m128i t5 = _mm_clmulepi64_si128(a, b, 0x01);
+		__m128i t6 = _mm_clmulepi64_si128(a, b, 0x11);
+		t4 = _mm_xor_si128(t4, t5);
+		t5 = _mm_slli_si128(t4, 8);
+		t4 = _mm_srli_si128(t4, 8);
+		t3 = _mm_xor_si128(t3, t5);
+		t6 = _mm_xor_si128(t6, t4);
+
+		// Shift the 256-bit product left by one (the operands are bit-reflected)
+		__m128i t7 = _mm_srli_epi32(t3, 31);
+		__m128i t8 = _mm_srli_epi32(t6, 31);
+		t3 = _mm_slli_epi32(t3, 1);
+		t6 = _mm_slli_epi32(t6, 1);
+		__m128i t9 = _mm_srli_si128(t7, 12);
+		t8 = _mm_slli_si128(t8, 4);
+		t7 = _mm_slli_si128(t7, 4);
+		t3 = _mm_or_si128(t3, t7);
+		t6 = _mm_or_si128(t6, t8);
+		t6 = _mm_or_si128(t6, t9);
+
+		// Reduce modulo x^128 + x^7 + x^2 + x + 1
+		t7 = _mm_slli_epi32(t3, 31);
+		t8 = _mm_slli_epi32(t3, 30);
+		t9 = _mm_slli_epi32(t3, 25);
+		t7 = _mm_xor_si128(t7, t8);
+		t7 = _mm_xor_si128(t7, t9);
+		t8 = _mm_srli_si128(t7, 4);
+		t7 = _mm_slli_si128(t7, 12);
+		t3 = _mm_xor_si128(t3, t7);
+		__m128i t2 = _mm_srli_epi32(t3, 1);
+		t4 = _mm_srli_epi32(t3, 2);
+		t5 = _mm_srli_epi32(t3, 7);
+		t2 = _mm_xor_si128(t2, t4);
+		t2 = _mm_xor_si128(t2, t5);
+		t2 = _mm_xor_si128(t2, t8);
+		t3 = _mm_xor_si128(t3, t2);
+		return _mm_xor_si128(t6, t3);
+	}
+
+	GSBM_AESNI_TARGET void GhashHardware(const uint8_t* hashKey, uint8_t* state, const uint8_t* data, size_t size)
+	{
+		const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		__m128i h = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hashKey)), reverse);
+		__m128i x = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), reverse);
+		for (size_t offset = 0; offset < size; offset += 16)
+		{
+			__m128i block;
+			if (size - offset >= 16)
+			{
+				block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+			}
+			else
+			{
+				alignas(16) uint8_t padded[16] = {};
+				memcpy(padded, data + offset, size - offset);
+				block = _mm_load_si128(reinterpret_cast<const __m128i*>(padded));
+			}
+			x = GfMul(_mm_xor_si128(x, _mm_shuffle_epi8(block, reverse)), h);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi8(x, reverse));
+	}
+
+	// CTR mode, four blocks per iteration so the AES units stay busy
+	GSBM_AESNI_TARGET void CtrHardware(const uint8_t* roundKeyBytes, const uint8_t* counterBlock, uint8_t* data, size_t size)
+	{
+		__m128i rk[15];
+		for (int i = 0; i < 15; ++i) rk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(roundKeyBytes + 16 * i));
+		alignas(16) uint8_t counter[4][16];
+		uint32_t next = LoadBe32(counterBlock + 12);
+		for (size_t offset = 0; offset < size; offset += 64)
+		{
+			__m128i b[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				memcpy(counter[k], counterBlock, 12);
+				StoreBe32(counter[k] + 12, next++);
+				b[k] = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(counter[k])), rk[0]);
+			}
+			for (int r = 1; r < 14; ++r)
+			{
+				for (int k = 0; k < 4; ++k) b[k] = _mm_aesenc_si128(b[k], rk[r]);
+			}
+			for (int k = 0; k < 4; ++k) b[k] = _mm_aesenclast_si128(b[k], rk[14]);
+
+			size_t remaining = size - offset;
+			if (remaining >= 64)
+			{
+				for (int k = 0; k < 4; ++k)
+				{
+					__m128i* p = reinterpret_cast<__m128i*>(data + offset + 16 * k);
+					_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), b[k]));
+				}
+			}
+			else
+			{
+				alignas(16) uint8_t keystream[64];
+				for (int k = 0; k < 4; ++k) _mm_store_si128(reinterpret_cast<__m128i*>(keystream + 16 * k), b[k]);
+				for (size_t i = 0; i < remaining; ++i) data[offset + i] ^= keystream[i];
+			}
+		}
+	}
+#endif
+}
+
+AesGcm::AesGcm(const uint8_t* key, bool allowHardware)
+{
+	const AesTables& t = GetAesTables();
+	// AES-256 key schedule: 8-word key, 14 rounds
+	for (int i = 0; i < 8; ++i) m_roundKeys[i] = LoadBe32(key + 4 * i);
+	uint8_t rcon = 1;
+	for (int i = 8; i < 60; ++i)
+	{
+		uint32_t temp = m_roundKeys[i - 1];
+		auto subWord = [&](uint32_t w)
+			{
+				return (static_cast<uint32_t>(t.sbox[w >> 24]) << 24) | (static_cast<uint32_t>(t.sbox[(w >> 16) & 0xFF]) << 16)
+					| (static_cast<uint32_t>(t.sbox[(w >> 8) & 0xFF]) << 8) | t.sbox[w & 0xFF];
+			};
+		if (i % 8 == 0)
+		{
+			temp = subWord((temp << 8) | (temp >> 24)) ^ (static_cast<uint32_t>(rcon) << 24);
+			rcon = Times2(rcon);
+		}
+		else if (i % 8 == 4)
+		{
+			temp = subWord(temp);
+		}
+		m_roundKeys[i] = m_roundKeys[i - 8] ^ temp;
+	}
+	for (int i = 0; i < 60; ++i) StoreBe32(m_roundKeyBytes + 4 * i, m_roundKeys[i]);
+	m_hardware = allowHardware && CpuSupportsHardware();
+
+	uint8_t zero[16] = {};
+	EncryptBlock(zero, m_h);
+
+	// GHASH tables: m_hh/m_hl[i] = H * i (as a 4-bit polynomial), high and low halves
+	uint64_t vh = LoadBe64(m_h);
+	uint64_t vl = LoadBe64(m_h + 8);
+	m_hh[0] = m_hl[0] = 0;
+	m_hh[8] = vh;
+	m_hl[8] = vl;
+	for (int i = 4; i > 0; i >>= 1)
+	{
+		uint64_t carry = (vl & 1) * 0xe1000000ULL;
+		vl = (vh << 63) | (vl >> 1);
+		vh = (vh >> 1) ^ (carry << 32);
+		m_hh[i] = vh;
+		m_hl[i] = vl;
+	}
+	for (int i = 2; i <= 8; i *= 2)
+	{
+		for (int j = 1; j < i; ++j)
+		{
+			m_hh[i + j] = m_hh[i] ^ m_hh[j];
+			m_hl[i + j] = m_hl[i] ^ m_hl[j];
+		}
+	}
+}
+
+bool AesGcm::CpuSupportsHardware()
+{
+#if GSBM_AES_X86
+	unsigned int ecx = 0;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	ecx = static_cast<unsigned int>(info[2]);
+#else
+	unsigned int eax, ebx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+#endif
+	const unsigned int aes = 1u << 25, pclmul = 1u << 1, ssse3 = 1u << 9;
+	return (ecx & aes) && (ecx & pclmul) && (ecx & ssse3);
+#else
+	return false;
+#endif
+}
+
+void AesGcm::EncryptBlock(const uint8_t* in, uint8_t* out) const
+{
+	const AesTables& t = GetAesTables();
+	const uint32_t* rk = m_roundKeys;
+	uint32_t s0 = LoadBe32(in) ^ rk[0];
+	uint32_t s1 = LoadBe32(in + 4) ^ rk[1];
+	uint32_t s2 = LoadBe32(in + 8) ^ rk[2];
+	uint32_t s3 = LoadBe32(in + 12) ^ rk[3];
+	for (int round = 1; round < 14; ++round)
+	{
+		rk += 4;
+		uint32_t t0 = t.te[0][s0 >> 24] ^ t.te[1][(s1 >> 16) & 0xFF] ^ t.te[2][(s2 >> 8) & 0xFF] ^ t.te[3][s3 & 0xFF] ^ rk[0];
+		uint32_t t1 = t.te[0][s1 >> 24] ^ t.te[1][(s2 >> 16) & 0xFF] ^ t.te[2][(s3 >> 8) & 0xFF] ^ t.te[3][s0 & 0xFF] ^ rk[1];
+		uint32_t t2 = t.te[0][s2 >> 24] ^ t.te[1][(s3 >> 16) & 0xFF] ^ t.te[2][(s0 >> 8) & 0xFF] ^ t.te[3][s1 & 0xFF] ^ rk[2];
+		uint32_t t3 = t.te[0][s3 >> 24] ^ t.te[1][(s0 >> 16) & 0xFF] ^ t.te[2][(s1 >> 8) & 0xFF] ^ t.te[3][s2 & 0xFF] ^ rk[3];
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+	rk += 4;
+	auto last = [&](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t key)
+		{
+			return ((static_cast<uint32_t>(t.sbox[a >> 24]) << 24) | (static_cast<uint32_t>(t.sbox[(b >> 16) & 0xFF]) << 16)
+				| (static_cast<uint32_t>(t.sbox[(c >> 8) & 0xFF]) << 8) | t.sbox[d & 0xFF]) ^ key;
+		};
+	StoreBe32(out, last(s0, s1, s2, s3, rk[0]));
+	StoreBe32(out + 4, last(s1, s2, s3, s0, rk[1]));
+	StoreBe32(out + 8, last(s2, s3, s0, s1, rk[2]));
+	StoreBe32(out + 12, last(s3, s0, s1, s2, rk[3]));
+}
+
+void AesGcm::Ctr(const uint8_t* counterBlock, uint8_t* data, size_t size) const
+{
+#if GSBM_AES_X86
+	if (m_hardware)
+	{
+		CtrHardware(m_roundKeyBytes, counterBlock, data, size);
+		return;
+	}
+#endif
+	uint8_t counter[16], keystream[16];
+	memcpy(counter, counterBlock, 16);
+	uint32_t next = LoadBe32(counterBlock + 12);
+	for (size_t offset = 0; offset < size; offset += 16)
+	{
+		StoreBe32(counter + 12, next++);
+		EncryptBlock(counter, keystream);
+		size_t n = min<size_t>(16, size - offset);
+		for (size_t i = 0; i < n; ++i) data[offset + i] ^= keystream[i];
+	}
+}
+
+void AesGcm::Ghash(uint8_t* state, const uint8_t* data, size_t size) const
+{
+#if GSBM_AES_X86
+	if (m_hardware)
+	{
+		GhashHardware(m_h, state, data, size);
+		return;
+	}
+#endif
+	for (size_t offset = 0; offset < size; offset += 16)
+	{
+		size_t n = min<size_t>(16, size - offset);
+		uint8_t x[16];
+		memcpy(x, state, 16);
+		for (size_t i = 0; i < n; ++i) x[i] ^= data[offset + i];
+
+		// x * H, one nibble at a time from the last byte to the first
+		uint8_t lo = x[15] & 0x0F;
+		uint64_t zh = m_hh[lo];
+		uint64_t zl = m_hl[lo];
+		for (int i = 15; i >= 0; --i)
+		{
+			lo = x[i] & 0x0F;
+			uint8_t hi = (x[i] >> 4) & 0x0F;
+			if (i != 15)
+			{
+				uint8_t rem = static_cast<uint8_t>(zl & 0x0F);
+				zl = (zh << 60) | (zl >> 4);
+				zh = (zh >> 4) ^ (kLast4[rem] << 48);
+				zh ^= m_hh[lo];
+				zl ^= m_hl[lo];
+			}
+			uint8_t rem = static_cast<uint8_t>(zl & 0x0F);
+			zl = (zh << 60) | (zl >> 4);
+			zh = (zh >> 4) ^ (kLast4[rem] << 48);
+			zh ^= m_hh[hi];
+			zl ^= m_hl[hi];
+		}
+		StoreBe64(state, zh);
+		StoreBe64(state + 8, zl);
+	}
+}
+
+void AesGcm::ComputeTag(const uint8_t* j0, const uint8_t* aad, size_t aadSize, const uint8_t* cipher, size_t size, uint8_t* tag) const
+{
+	uint8_t state[16] = {};
+	Ghash(state, aad, aadSize);
+	Ghash(state, cipher, size);
+	uint8_t lengths[16];
+	StoreBe64(lengths, static_cast<uint64_t>(aadSize) * 8);
+	StoreBe64(lengths + 8, static_cast<uint64_t>(size) * 8);
+	Ghash(state, lengths, sizeof(lengths));
+	uint8_t mask[16];
+	EncryptBlock(j0, mask);
+	for (int i = 0; i < 16; ++i) tag[i] = state[i] ^ mask[i];
+}
+
+void AesGcm::Encrypt(const uint8_t* nonce, const uint8_t* aad, size_t aadSize, uint8_t* data, size_t size, uint8_t* tag) const
+{
+	uint8_t j0[16];
+	memcpy(j0, nonce, kNonceSize);
+	StoreBe32(j0 + 12, 1);
+	uint8_t counter[16];
+	memcpy(counter, j0, 16);
+	StoreBe32(counter + 12, 2);
+	Ctr(counter, data, size);
+	ComputeTag(j0, aad, aadSize, data, size, tag);
+}
+
+bool AesGcm::Decrypt(const uint8_t* nonce, const uint8_t* aad, size_t aadSize, uint8_t* data, size_t size, const uint8_t* tag) const
+{
+	uint8_t j0[16];
+	memcpy(j0, nonce, kNonceSize);
+	StoreBe32(j0 + 12, 1);
+	uint8_t expected[16];
+	ComputeTag(j0, aad, aadSize, data, size, expected);
+	uint8_t difference = 0;
+	for (int i = 0; i < 16; ++i) difference |= static_cast<uint8_t>(expected[i] ^ tag[i]); // Constant time
+	if (difference != 0) return false;
+
+	uint8_t counter[16];
+	memcpy(counter, j0, 16);
+	StoreBe32(counter + 12, 2);
+	Ctr(counter, data, size);
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// AES-256-GCM (FIPS 197 / NIST SP 800-38D) with 96-bit nonces. Uses AES-NI and PCLMULQDQ when
+// the CPU has them and falls back to a portable table implementation otherwise, so cloud
+// encryption needs no external crypto library.
+
+#include <cstddef>
+#include <cstdint>
+
+class AesGcm
+{
+public:
+	static constexpr size_t kKeySize = 32;
+	static constexpr size_t kNonceSize = 12;
+	static constexpr size_t kTagSize = 16;
+
+	/**
+	 * @param key 32 bytes.
+	 * @param allowHardware False forces the portable code (tests, benchmarks).
+	 */
+	explicit AesGcm(const uint8_t* key, bool allowHardware = true);
+
+	// True if this instance uses AES-NI and PCLMULQDQ
+	bool Hardware() const { return m_hardware; }
+
+	/**
+	 * @brief Encrypts data[0, size) in place and writes the 16-byte tag.
+	 */
+	void Encrypt(const uint8_t* nonce, const uint8_t* aad, size_t aadSize, uint8_t* data, size_t size, uint8_t* tag) const;
+
+	/**
+	 * @brief Checks the tag, then decrypts data[0, size) in place. Returns false, with the data
+	 * left encrypted, if the tag does not match.
+	 */
+	bool Decrypt(const uint8_t* nonce, const uint8_t* aad, size_t aadSize, uint8_t* data, size_t size, const uint8_t* tag) const;
+
+	static bool CpuSupportsHardware();
+
+private:
+	void EncryptBlock(const uint8_t* in, uint8_t* out) const;
+	void Ctr(const uint8_t* counterBlock, uint8_t* data, size_t size) const;
+	void Ghash(uint8_t* state, const uint8_t* data, size_t size) const; // Zero-pads a partial last block
+	void ComputeTag(const uint8_t* j0, const uint8_t* aad, size_t aadSize, const uint8_t* cipher, size_t size, uint8_t* tag) const;
+
+	bool m_hardware = false;
+	uint32_t m_roundKeys[60];    // Big-endian words (portable rounds)
+	uint8_t m_roundKeyBytes[240]; // Same keys in memory order (AES-NI)
+	uint8_t m_h[16];             // Hash subkey E(K, 0)
+	uint64_t m_hh[16], m_hl[16]; // 4-bit multiplication tables for the portable GHASH
+};
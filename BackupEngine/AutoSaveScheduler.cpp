@@ -0,0 +1,66 @@
+#include "AutoSaveScheduler.h"
+
+using namespace std;
+
+AutoSaveScheduler::~AutoSaveScheduler()
+{
+	Stop();
+}
+
+void AutoSaveScheduler::Start(chrono::milliseconds interval, function<void()> task)
+{
+	StartWithLag(interval, [task = move(task)](chrono::nanoseconds) { task(); });
+}
+
+void AutoSaveScheduler::StartWithLag(chrono::milliseconds interval, LaggedTask task)
+{
+	StartAdaptive(interval, [interval, task = move(task)](chrono::nanoseconds lateBy) { task(lateBy); return interval; });
+}
+
+void AutoSaveScheduler::StartAdaptive(chrono::milliseconds firstDelay, AdaptiveTask task)
+{
+	Stop();
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopRequested = false;
+	}
+	m_thread = thread(&AutoSaveScheduler::ThreadFunction, this, firstDelay, move(task));
+}
+
+void AutoSaveScheduler::Stop()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopRequested = true;
+	}
+	m_wake.notify_all();
+	// Stop() may be reached from the task itself (e.g. a signal handler); never self-join
+	if (m_thread.joinable() && m_thread.get_id() != this_thread::get_id())
+		m_thread.join(); // Wait for thread to finish
+}
+
+bool AutoSaveScheduler::IsRunning() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_thread.joinable() && !m_stopRequested;
+}
+
+/**
+ * @brief Waits the delay (or until Stop()), runs the task, and repeats with the delay it returns.
+ */
+void AutoSaveScheduler::ThreadFunction(chrono::milliseconds firstDelay, AdaptiveTask task)
+{
+	auto nextRun = chrono::steady_clock::now() + firstDelay;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(m_mutex);
+			if (m_wake.wait_until(lock, nextRun, [this] { return m_stopRequested; }))
+				return; // Stop requested while waiting
+		}
+
+		chrono::milliseconds delay = task(chrono::steady_clock::now() - nextRun);
+		// Like the old loop, the next interval starts after the backup finishes
+		nextRun = chrono::steady_clock::now() + delay;
+	}
+}
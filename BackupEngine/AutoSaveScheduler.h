@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Runs a task on a background thread at a fixed interval until stopped, or at intervals
+ * the task chooses itself (StartAdaptive).
+ * Replaces the old "sleep one second, check a flag" loop: Stop() wakes the thread
+ * immediately instead of waiting for the next one-second tick.
+ */
+class AutoSaveScheduler
+{
+public:
+	// Task that also receives how late it started relative to its scheduled time
+	using LaggedTask = std::function<void(std::chrono::nanoseconds lateBy)>;
+	// Task that returns how long to wait before its next run
+	using AdaptiveTask = std::function<std::chrono::milliseconds(std::chrono::nanoseconds lateBy)>;
+
+	AutoSaveScheduler() = default;
+	~AutoSaveScheduler();
+
+	AutoSaveScheduler(const AutoSaveScheduler&) = delete;
+	AutoSaveScheduler& operator=(const AutoSaveScheduler&) = delete;
+
+	/**
+	 * @brief Starts the background thread. The task first runs one full interval after Start().
+	 * Any previously running schedule is stopped first.
+	 */
+	void Start(std::chrono::milliseconds interval, std::function<void()> task);
+
+	/**
+	 * @brief Like Start(), but passes each run's schedule lag to the task (for latency metrics).
+	 */
+	void StartWithLag(std::chrono::milliseconds interval, LaggedTask task);
+
+	/**
+	 * @brief Like StartWithLag(), but the task first runs `firstDelay` after Start() and each run
+	 * returns the delay before the next one (counted from when it finishes).
+	 */
+	void StartAdaptive(std::chrono::milliseconds firstDelay, AdaptiveTask task);
+
+	/**
+	 * @brief Signals the thread to stop and waits for it. Safe to call when not running.
+	 * A task that is already executing is allowed to finish.
+	 */
+	void Stop();
+
+	bool IsRunning() const;
+
+private:
+	void ThreadFunction(std::chrono::milliseconds firstDelay, AdaptiveTask task);
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_stopRequested = false;
+	std::thread m_thread;
+};
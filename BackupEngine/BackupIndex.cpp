@@ -0,0 +1,156 @@
+#include "BackupIndex.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+fs::path GetBackupIndexPath(const fs::path& gameBackupDir, const wstring& folderName)
+{
+	return gameBackupDir / ".manifests" / ToPath(folderName + L".manifest");
+}
+
+BackupManifest ManifestFromScan(const TreeScan& scan, const fs::path& root)
+{
+	BackupManifest manifest;
+	manifest.entries.reserve(scan.entries.size());
+	for (const auto& scanned : scan.entries)
+	{
+		ManifestEntry entry;
+		entry.path = scanned.relativePath.generic_u8string();
+		entry.type = scanned.type;
+		if (scanned.type == fs::file_type::regular)
+		{
+			entry.size = scanned.size;
+			entry.mtime = FileTimeToUnixNanos(scanned.mtime);
+			if (auto layout = FindSparseLayout(root / scanned.relativePath, scanned.size))
+			{
+				entry.sparse = true;
+				entry.extents = move(*layout);
+			}
+		}
+		else if (scanned.type == fs::file_type::symlink)
+		{
+			error_code ec;
+			entry.linkTarget = fs::read_symlink(root / scanned.relativePath, ec).u8string();
+		}
+		else if (scanned.type != fs::file_type::directory)
+		{
+			continue; // Not copied into backups either
+		}
+		manifest.entries.push_back(move(entry));
+	}
+
+	// Path order keeps folders ahead of their contents and lets DiffBackups skip its sort
+	sort(manifest.entries.begin(), manifest.entries.end(), [](const ManifestEntry& a, const ManifestEntry& b) { return a.path < b.path; });
+	return manifest;
+}
+
+void SaveBackupIndex(const fs::path& backupFolder, const BackupManifest& manifest)
+{
+	fs::path file = GetBackupIndexPath(backupFolder.parent_path(), PathToWide(backupFolder.filename()));
+	fs::create_directories(file.parent_path());
+	fs::path temp = file;
+	temp += ".tmp";
+	string text = manifest.Serialize();
+	{
+		ofstream out(temp, ios::binary | ios::trunc);
+		if (!out.write(text.data(), static_cast<streamsize>(text.size())).flush())
+		{
+			throw fs::filesystem_error("Cannot write backup index", temp, make_error_code(errc::io_error));
+		}
+	}
+	fs::rename(temp, file);
+}
+
+BackupManifest LoadBackupIndex(const fs::path& backupFolder)
+{
+	fs::path file = GetBackupIndexPath(backupFolder.parent_path(), PathToWide(backupFolder.filename()));
+	ifstream in(file, ios::binary | ios::ate);
+	if (in)
+	{
+		string text(static_cast<size_t>(max<streamoff>(in.tellg(), 0)), '\0');
+		in.seekg(0);
+		if (in.read(text.data(), static_cast<streamsize>(text.size())))
+		{
+			try { return BackupManifest::Parse(text); }
+			catch (const ManifestError&) {} // Rebuilt below
+		}
+	}
+
+	// Older backup: its files were copied with their save-folder times where the platform keeps them
+	BackupManifest manifest = ManifestFromScan(ScanTree(backupFolder), backupFolder);
+	try { SaveBackupIndex(backupFolder, manifest); }
+	catch (const fs::filesystem_error&) {} // Read-only backups still work, just without the shortcut
+	return manifest;
+}
+
+void RemoveBackupIndex(const fs::path& backupFolder)
+{
+	error_code ec;
+	fs::remove(GetBackupIndexPath(backupFolder.parent_path(), PathToWide(backupFolder.filename())), ec);
+}
+
+BackupDiff DiffBackups(const BackupManifest& from, const BackupManifest& to)
+{
+	auto sortedFiles = [](const BackupManifest& manifest)
+		{
+			vector<const ManifestEntry*> files;
+			files.reserve(manifest.entries.size());
+			for (const auto& entry : manifest.entries)
+			{
+				if (entry.type != fs::file_type::directory) files.push_back(&entry);
+			}
+			// Indexes are saved in path order (ManifestFromScan), so this is usually one linear pass
+			auto byPath = [](const ManifestEntry* a, const ManifestEntry* b) { return a->path < b->path; };
+			if (!is_sorted(files.begin(), files.end(), byPath)) sort(files.begin(), files.end(), byPath);
+			return files;
+		};
+	auto differs = [](const ManifestEntry& a, const ManifestEntry& b)
+		{
+			if (a.type != b.type) return true;
+			if (a.type == fs::file_type::symlink) return a.linkTarget != b.linkTarget;
+			if (a.size != b.size) return true;
+			if (!a.sha256.empty() && !b.sha256.empty()) return a.sha256 != b.sha256;
+			return a.mtime != b.mtime;
+		};
+
+	vector<const ManifestEntry*> before = sortedFiles(from);
+	vector<const ManifestEntry*> after = sortedFiles(to);
+	BackupDiff diff;
+	diff.sizeDelta = static_cast<int64_t>(to.TotalBytes()) - static_cast<int64_t>(from.TotalBytes());
+
+	// Merge of the two sorted lists
+	size_t i = 0, j = 0;
+	while (i < before.size() || j < after.size())
+	{
+		int order = i == before.size() ? 1 : j == after.size() ? -1 : before[i]->path.compare(after[j]->path);
+		if (order < 0)
+		{
+			diff.changes.push_back({ FileChange::Kind::Removed, before[i]->path, before[i]->size, 0 });
+			diff.removed++;
+			i++;
+		}
+		else if (order > 0)
+		{
+			diff.changes.push_back({ FileChange::Kind::Added, after[j]->path, 0, after[j]->size });
+			diff.added++;
+			j++;
+		}
+		else
+		{
+			if (differs(*before[i], *after[j]))
+			{
+				diff.changes.push_back({ FileChange::Kind::Modified, after[j]->path, before[i]->size, after[j]->size });
+				diff.modified++;
+			}
+			i++;
+			j++;
+		}
+	}
+	return diff;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Index of a local backup: its manifest (Manifest.h) with every folder, file and symlink and the
+// size and modification time the file had in the save folder, kept next to the backup folders:
+//
+//   <game backup dir>/.manifests/<backup folder>.manifest
+//
+// Written when the backup is made, so browsing a backup, restoring single files from it or
+// comparing it with another one (DiffBackups) reads one small file instead of walking the
+// backup. Backups made before indexes existed get one built from their folder on first use.
+
+#include "BackupOperations.h"
+#include "Manifest.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief "<gameBackupDir>/.manifests/<folderName>.manifest".
+ */
+std::filesystem::path GetBackupIndexPath(const std::filesystem::path& gameBackupDir, const std::wstring& folderName);
+
+/**
+ * @brief Builds a manifest (no digests, no chunks), in path order, from a scan of `root`.
+ * Symlink targets and the holes of sparse files are read from `root`.
+ */
+BackupManifest ManifestFromScan(const TreeScan& scan, const std::filesystem::path& root);
+
+/**
+ * @brief Writes the index of a backup folder atomically. Throws fs::filesystem_error.
+ */
+void SaveBackupIndex(const std::filesystem::path& backupFolder, const BackupManifest& manifest);
+
+/**
+ * @brief Reads the index of a backup folder, or builds it from the folder (and saves it, best
+ * effort) if it is missing or unreadable. Throws fs::filesystem_error if the folder cannot be scanned.
+ */
+BackupManifest LoadBackupIndex(const std::filesystem::path& backupFolder);
+
+/**
+ * @brief Deletes the index of a backup folder, if any.
+ */
+void RemoveBackupIndex(const std::filesystem::path& backupFolder);
+
+// One file that differs between two backups (or a backup and the save folder)
+struct FileChange
+{
+	enum class Kind { Added, Removed, Modified };
+
+	Kind kind = Kind::Modified;
+	std::string path;     // '/'-separated
+	uint64_t oldSize = 0; // Removed and Modified
+	uint64_t newSize = 0; // Added and Modified
+};
+
+struct BackupDiff
+{
+	std::vector<FileChange> changes; // Sorted by path
+	uint64_t added = 0;
+	uint64_t removed = 0;
+	uint64_t modified = 0;
+	int64_t sizeDelta = 0; // Bytes in `to` minus bytes in `from`
+};
+
+/**
+ * @brief Compares two file lists (indexes, manifests, or ManifestFromScan of a live folder)
+ * without reading any file. A file is modified if its type, size, link target, SHA-256 (when
+ * both sides have one) or, failing that, modification time differs. Folders are not listed.
+ */
+BackupDiff DiffBackups(const BackupManifest& from, const BackupManifest& to);
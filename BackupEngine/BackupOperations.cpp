@@ -0,0 +1,704 @@
+#include "BackupOperations.h"
+#include "BackupIndex.h"
+#include "ChunkStore.h"
+#include "CloudEncryption.h"
+#include "ContentStore.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "SearchIndex.h"
+#include "Sha256.h"
+#include "StorageBackend.h"
+#include "Trace.h"
+
+#include <algorithm> // For std::sort
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const wstring& StorageKey(const GameProfile& profile)
+	{
+		if (profile.id.empty()) throw invalid_argument("Game profile has no ID");
+		return profile.id;
+	}
+
+	// Work folders of RestoreBackup, next to the save folder (on the same volume): the backup is
+	// copied into "<save>.gsbm-restoring", and the replaced files wait in "<save>.gsbm-previous"
+	const string kRestoreStagingSuffix = ".gsbm-restoring";
+	const string kRestorePreviousSuffix = ".gsbm-previous";
+
+	fs::path RestoreWorkFolder(const fs::path& savePath, const string& suffix)
+	{
+		fs::path folder = savePath.lexically_normal();
+		if (!folder.has_filename()) folder = folder.parent_path(); // "C:\Saves\" -> "C:\Saves"
+		folder += suffix;
+		return folder;
+	}
+
+	bool IsRestoreWorkFolder(const fs::path& name)
+	{
+		string text = name.u8string();
+		auto endsWith = [&](const string& suffix) { return text.size() > suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0; };
+		return endsWith(kRestoreStagingSuffix) || endsWith(kRestorePreviousSuffix);
+	}
+
+	// A backup file linked to the shared content store (ContentStore.h) carries the time of the
+	// first backup that stored those contents, so the restored files take theirs from the index
+	void RestoreModificationTimes(const BackupManifest& index, const fs::path& folder)
+	{
+		for (const auto& entry : index.entries)
+		{
+			if (entry.type != fs::file_type::regular || entry.mtime == 0) continue;
+			error_code ec;
+			fs::last_write_time(folder / fs::u8path(entry.path), UnixNanosToFileTime(entry.mtime), ec);
+		}
+	}
+
+	vector<fs::path> ListNames(const fs::path& folder)
+	{
+		vector<fs::path> names;
+		for (const auto& entry : fs::directory_iterator(folder)) names.push_back(entry.path().filename());
+		return names;
+	}
+
+	// Moves <root>/<legacy> to <root>/<id>. Returns false (with a log line) if anything is left behind.
+	bool MoveLegacyFolder(const fs::path& legacyDir, const fs::path& idDir, const wstring& locationName, vector<wstring>& logCollector)
+	{
+		error_code ec;
+		if (!fs::exists(legacyDir, ec)) return !ec; // Nothing to move, or already moved
+		if (!fs::exists(idDir, ec))
+		{
+			fs::create_directories(idDir.parent_path(), ec);
+			fs::rename(legacyDir, idDir, ec); // O(1): no backup is copied
+			if (!ec) return true;
+			logCollector.push_back(L"   [" + locationName + L"] Could not move " + PathToWide(legacyDir) + L": " + s2ws(ec.message()));
+			return false;
+		}
+
+		// Both exist (e.g. an earlier attempt was interrupted): move backups that are not there yet
+		bool complete = true;
+		for (const auto& entry : fs::directory_iterator(legacyDir, ec))
+		{
+			fs::path target = idDir / entry.path().filename();
+			error_code moveError;
+			if (fs::exists(target, moveError))
+			{
+				complete = false; // Same folder name in both places; leave it for the user
+				continue;
+			}
+			fs::rename(entry.path(), target, moveError);
+			if (moveError) complete = false;
+		}
+		if (ec) complete = false;
+		if (complete) fs::remove(legacyDir, ec); // Only succeeds if empty
+		if (!complete || ec)
+		{
+			logCollector.push_back(L"   [" + locationName + L"] Some backups were left in " + PathToWide(legacyDir));
+			return false;
+		}
+		return true;
+	}
+}
+
+fs::path GetLocalGameBackupDir(const fs::path& backupsRoot, const GameProfile& profile)
+{
+	return backupsRoot / ToPath(StorageKey(profile));
+}
+
+fs::path GetCloudGameBackupDir(const wstring& cloudRoot, const GameProfile& profile)
+{
+	return ToPath(cloudRoot) / ToPath(kCloudFolderName) / ToPath(StorageKey(profile));
+}
+
+size_t MigrateLegacyBackupFolders(vector<GameProfile>& profiles, const GlobalSettings& settings, const fs::path& backupsRoot, vector<wstring>& logCollector)
+{
+	size_t migrated = 0;
+	for (auto& profile : profiles)
+	{
+		if (profile.legacyFolder.empty()) continue;
+		bool done = MoveLegacyFolder(backupsRoot / ToPath(profile.legacyFolder), GetLocalGameBackupDir(backupsRoot, profile), L"Local", logCollector);
+		if (!settings.googleDrivePath.empty())
+		{
+			fs::path cloudRoot = ToPath(settings.googleDrivePath) / ToPath(kCloudFolderName);
+			done = MoveLegacyFolder(cloudRoot / ToPath(profile.legacyFolder), GetCloudGameBackupDir(settings.googleDrivePath, profile), L"Cloud", logCollector) && done;
+		}
+		if (!done) continue; // Retried on the next start
+		logCollector.push_back(L"Migrated backups of " + profile.name + L" to profile ID " + profile.id);
+		profile.legacyFolder.clear();
+		migrated++;
+	}
+	return migrated;
+}
+
+TreeScan ScanTree(const fs::path& root)
+{
+	TreeScan scan;
+	for (auto it = fs::recursive_directory_iterator(root); it != fs::recursive_directory_iterator(); ++it)
+	{
+		const fs::directory_entry& entry = *it;
+		if (IsRestoreWorkFolder(entry.path().filename()))
+		{
+			it.disable_recursion_pending(); // A restore into a save folder nested in this one
+			continue;
+		}
+		ScannedEntry scanned;
+		scanned.relativePath = entry.path().lexically_relative(root);
+		scanned.type = entry.symlink_status().type();
+		if (scanned.type == fs::file_type::regular)
+		{
+			scanned.size = entry.file_size();
+			scanned.mtime = entry.last_write_time();
+			scan.files++;
+			scan.bytes += scanned.size;
+		}
+		scan.entries.push_back(move(scanned));
+	}
+	return scan;
+}
+
+CopyStats CopyScannedTree(const TreeScan& scan, const fs::path& from, const fs::path& to, fs::copy_options options, const BackupManifest* layouts, OperationProgress* progress, BackupManifest* digests)
+{
+	const fs::copy_options existingFileOptions = options & (fs::copy_options::skip_existing | fs::copy_options::overwrite_existing | fs::copy_options::update_existing);
+	const bool copySymlinks = (options & fs::copy_options::copy_symlinks) != fs::copy_options::none;
+	unordered_map<string, const vector<FileExtent>*> sparseFiles; // Usually empty
+	if (layouts)
+	{
+		for (const auto& entry : layouts->entries)
+		{
+			if (entry.sparse) sparseFiles[entry.path] = &entry.extents;
+		}
+	}
+	unordered_map<string, ManifestEntry*> hashed;
+	if (digests)
+	{
+		hashed.reserve(digests->entries.size());
+		for (auto& entry : digests->entries) hashed[entry.path] = &entry;
+	}
+
+	CopyStats stats;
+	fs::create_directory(to);
+	if (progress) progress->Begin(scan.files, scan.bytes);
+	for (const auto& entry : scan.entries)
+	{
+		fs::path source = from / entry.relativePath;
+		fs::path target = to / entry.relativePath;
+		if (progress && entry.type != fs::file_type::regular) progress->ThrowIfCancelled();
+		switch (entry.type)
+		{
+		case fs::file_type::directory:
+			fs::create_directory(target);
+			break;
+		case fs::file_type::regular:
+		{
+			// Large files get their own span so slow copies stand out in the trace
+			TraceSpan span("copy_file", "file", entry.size >= GetTracer().FileThreshold());
+			if (span.Active()) span.SetArgs("\"path\": \"" + EscapeJson(entry.relativePath.u8string()) + "\", \"bytes\": " + to_string(entry.size));
+			const vector<FileExtent>* layout = nullptr;
+			if (!sparseFiles.empty())
+			{
+				auto found = sparseFiles.find(entry.relativePath.generic_u8string());
+				if (found != sparseFiles.end()) layout = found->second;
+			}
+			ManifestEntry* indexed = nullptr;
+			if (digests)
+			{
+				auto found = hashed.find(entry.relativePath.generic_u8string());
+				if (found != hashed.end()) indexed = found->second;
+			}
+			if (progress) progress->StartFile(entry.relativePath);
+			Sha256 digest;
+			if (CopySaveFile(source, target, entry.size, existingFileOptions, layout, progress, indexed ? &digest : nullptr) && indexed)
+			{
+				Sha256::Digest value = digest.Final();
+				indexed->sha256 = ToHex(value.data(), value.size());
+			}
+			if (progress) progress->FinishFile(entry.size);
+			stats.filesCopied++;
+			stats.bytesCopied += entry.size;
+			break;
+		}
+		case fs::file_type::symlink:
+			if (copySymlinks) fs::copy_symlink(source, target);
+			else fs::copy(source, target, options | fs::copy_options::recursive); // Follow the link
+			stats.filesCopied++;
+			break;
+		default:
+			stats.filesSkipped++; // Sockets, FIFOs, devices
+			break;
+		}
+	}
+	if (progress) progress->Finish();
+	return stats;
+}
+
+namespace
+{
+	void RecordCopy(OperationCounters& counters, const CopyStats& stats)
+	{
+		counters.filesCopied.fetch_add(stats.filesCopied, memory_order_relaxed);
+		counters.bytesCopied.fetch_add(stats.bytesCopied, memory_order_relaxed);
+		counters.filesSkipped.fetch_add(stats.filesSkipped, memory_order_relaxed);
+		counters.bytesResumed.fetch_add(stats.bytesResumed, memory_order_relaxed);
+		counters.bytesDeduplicated.fetch_add(stats.bytesDeduplicated, memory_order_relaxed);
+	}
+}
+
+/**
+ * @brief Creates a backup, syncs if enabled, purges old backups, and collects log
+ * lines with purges grouped after the summary.
+ */
+BackupResult BackupSaveFolder(const GameProfile& profile, const GlobalSettings& settings, const fs::path& backupsRoot, bool autosave, OperationProgress* progress)
+{
+	BackupResult result;
+	wstring prefix = (autosave ? L"A" : L"M");
+	auto now_time_point = chrono::system_clock::now();
+	time_t now_t = chrono::system_clock::to_time_t(now_time_point);
+	long long epochTime = static_cast<long long>(now_t);
+	wstring currentTime = s2ws(GetCurrentDateTime()); // Consistent timestamp for this operation
+
+	// Construct paths
+	fs::path backupPathBase = GetLocalGameBackupDir(backupsRoot, profile);
+	result.folderName = to_wstring(epochTime) + L"-[" + FormatFolderDateTime(now_t) + L"]-" + prefix;
+	fs::path targetBackupPath = backupPathBase / ToPath(result.folderName);
+
+	std::vector<wstring> purgeMessages; // Purge messages are logged after the summary
+	EngineMetrics& metrics = GetEngineMetrics();
+	metrics.Op(MetricOp::Backup).runs++;
+	TraceSpan backupSpan(autosave ? "autosave" : "backup", "operation");
+	if (backupSpan.Active()) backupSpan.SetArgs("\"game\": \"" + EscapeJson(ws2s(profile.name)) + "\", \"folder\": \"" + EscapeJson(ws2s(result.folderName)) + "\"");
+
+	// --- 1. Perform Local Backup ---
+	TreeScan scan; // Reused for the cloud copy
+	BackupManifest index;
+	try {
+		{
+			StageTimer timer(MetricStage::Scan);
+			TraceSpan span("scan");
+			scan = ScanTree(ToPath(profile.savePath));
+		}
+		// Index for browsing and single-file restores, its digests taken during the copy
+		index = ManifestFromScan(scan, ToPath(profile.savePath));
+		fs::create_directories(backupPathBase);
+		StageTimer timer(MetricStage::Copy);
+		TraceSpan span("copy");
+		RecordCopy(metrics.Op(MetricOp::Backup), CopyScannedTree(scan, ToPath(profile.savePath), targetBackupPath, fs::copy_options::copy_symlinks, &index, progress, &index));
+		result.localSuccess = true;
+	}
+	catch (const OperationCancelled&) {
+		result.cancelled = true;
+		result.log.push_back(L"[" + currentTime + L"] [" + prefix + L"] Backup " + result.folderName + L" cancelled; the partial copy was removed.");
+		error_code ec;
+		fs::remove_all(targetBackupPath, ec);
+		return result;
+	}
+	catch (const fs::filesystem_error& e) {
+		metrics.Op(MetricOp::Backup).errors++;
+		result.log.push_back(L"[" + currentTime + L"] [" + prefix + L"] Local backup FAILED for " + result.folderName + L": " + s2ws(e.what()));
+		error_code ec;
+		fs::remove_all(targetBackupPath, ec); // Attempt cleanup
+		return result;
+	}
+
+	// Rebuilt from the folder if this fails
+	BackupSearchIndex search(backupPathBase);
+	try { SaveBackupIndex(targetBackupPath, index); }
+	catch (const fs::filesystem_error&) {}
+
+	// Identical files of every game's backups share one copy on disk
+	if (settings.deduplicateBackups)
+	{
+		DedupStats dedup = DeduplicateBackup(backupsRoot, targetBackupPath, index);
+		metrics.Op(MetricOp::Backup).bytesDeduplicated.fetch_add(dedup.bytesSaved, memory_order_relaxed);
+	}
+
+	// --- 2. Purge Old Local Backups (Collect Messages) ---
+	PurgeBackups(backupPathBase, prefix, settings.localAutoSaveLimit, settings.localManualSaveLimit, L"Local", purgeMessages);
+
+	// A concurrent backup saving its own copy of the file can drop this one from it; the next
+	// Reconcile() adds it back from the backup index
+	search.AddBackup(result.folderName, index);
+	search.Reconcile();
+	search.Save();
+
+	// Shared copies only purged backups used are freed a few shards at a time, in the background
+	// so neither this backup's cloud copy nor the next backup waits for it
+	if (settings.deduplicateBackups)
+	{
+		ScheduleContentSweep(backupsRoot, kSweepShardsPerBackup, [game = profile.name](const ContentSweepStats& sweep)
+			{
+				GetEngineMetrics().Op(MetricOp::Purge).filesDeleted.fetch_add(sweep.filesRemoved, memory_order_relaxed);
+				if (sweep.filesRemoved == 0) return;
+				wstringstream wss;
+				wss << L"[PURGE:Shared] Removed " << sweep.filesRemoved << L" shared file(s) no backup uses (" << sweep.bytesFreed / 1024 << L" KB freed).";
+				GetLogger().Log(LogLevel::Info, game, L"purge", wss.str());
+			});
+	}
+
+	// --- 3. Perform Cloud Backup (if enabled and a storage backend is configured) ---
+	unique_ptr<StorageBackend> cloud = profile.cloudSaveEnabled ? CreateStorageBackend(settings) : nullptr;
+	if (cloud)
+	{
+		result.cloudAttempted = true;
+		metrics.Op(MetricOp::CloudSync).runs++;
+		string gamePrefix = GetStorageGamePrefix(profile);
+
+		try {
+			// Encrypted profiles always use the chunk store, where encryption happens
+			shared_ptr<const EncryptionKeys> keys;
+			if (IsEncryptionEnabled(profile)) keys = OpenStoredKeys(*cloud, gamePrefix, GetProfileSecret(profile), true);
+			bool chunked = keys || UseChunkStore(settings);
+			uint64_t packBelow = chunked ? 0 : GetPackThreshold(settings);
+
+			// Finish transfers that an earlier run left half-done before starting this one
+			ResumeStoredTransfers(*cloud, backupPathBase, gamePrefix, chunked, result.log, keys.get(), packBelow);
+
+			{
+				StageTimer timer(MetricStage::Sync);
+				TraceSpan span("sync");
+				if (span.Active()) span.SetArgs(string("\"backend\": \"") + cloud->Kind() + "\", \"chunked\": " + (chunked ? "true" : "false") + ", \"encrypted\": " + (keys ? "true" : "false"));
+				// Checkpointed, so a sync cut short here is resumed by the next backup. Returns once
+				// the backend holds every file (for S3: acknowledged by the server).
+				RecordCopy(metrics.Op(MetricOp::CloudSync), UploadStoredBackup(*cloud, scan, targetBackupPath, gamePrefix, result.folderName, backupPathBase, chunked, keys.get(), packBelow));
+			}
+			result.cloudSuccess = true;
+
+			// --- 4. Purge Old Cloud Backups (Collect Messages) ---
+			size_t purged = PurgeStoredBackups(*cloud, gamePrefix, settings.cloudAutoSaveLimit, settings.cloudManualSaveLimit, L"Cloud", purgeMessages);
+			if (chunked && purged > 0)
+			{
+				// Chunks only the purged backups used
+				ChunkIndex index(GetChunkIndexPath(backupPathBase), *cloud, gamePrefix);
+				SweepChunkPool(*cloud, gamePrefix, index, L"Cloud", purgeMessages, keys.get());
+			}
+		}
+		catch (const exception& e) { // fs::filesystem_error for folders, StorageError/HttpError for object stores, EncryptionError
+			metrics.Op(MetricOp::CloudSync).errors++;
+			result.log.push_back(L"[" + currentTime + L"] [CLOUD] Sync FAILED for " + result.folderName + L": " + s2ws(e.what()));
+		}
+	}
+
+	// --- 5. Consolidated summary line ---
+	wstring summary = L"[" + currentTime + L"] [" + prefix + L"] Backup " + result.folderName;
+	if (result.cloudAttempted && result.cloudSuccess) {
+		summary += L" completed (Local + Cloud Sync).";
+	}
+	else if (result.cloudAttempted) {
+		summary += L" completed (Local only due to Cloud sync failure).";
+	}
+	else {
+		summary += L" completed (Local).";
+	}
+	result.log.push_back(summary);
+	result.log.insert(result.log.end(), purgeMessages.begin(), purgeMessages.end());
+	return result;
+}
+
+/**
+ * @brief Deletes old backups (auto or manual) if they exceed limits, collecting log messages.
+ */
+void PurgeBackups(const fs::path& backupDir, const wstring& /*prefix*/, int autoLimit, int manualLimit, const wstring& locationName, std::vector<wstring>& logCollector)
+{
+	if (!fs::exists(backupDir)) return; // Don't proceed if the directory doesn't exist
+
+	OperationCounters& counters = GetEngineMetrics().Op(MetricOp::Purge);
+	counters.runs++;
+	StageTimer timer(MetricStage::Purge);
+	TraceSpan span("purge");
+
+	vector<fs::path> autoSaves;
+	vector<fs::path> manualSaves;
+	// Iterate through the backup directory and categorize folders by suffix
+	for (const auto& entry : fs::directory_iterator(backupDir))
+	{
+		if (entry.is_directory()) // Only consider directories
+		{
+			wstring dirName = PathToWide(entry.path().filename());
+			if (endsWith(dirName, L"-A")) autoSaves.push_back(entry.path());
+			else if (endsWith(dirName, L"-M")) manualSaves.push_back(entry.path());
+		}
+	}
+
+	// Sort backups chronologically (oldest first)
+	sort(autoSaves.begin(), autoSaves.end());
+	sort(manualSaves.begin(), manualSaves.end());
+
+	auto purge = [&](const vector<fs::path>& saves, int limit, const wstring& kind)
+		{
+			if (limit <= 0 || saves.size() <= static_cast<size_t>(limit)) return;
+
+			int toDelete = static_cast<int>(saves.size()) - limit;
+			wstringstream wss;
+			wss << L"      [PURGE:" << locationName << L"] " << kind << L"-save limit (" << limit << L") exceeded. Deleting " << toDelete << L" oldest...";
+			logCollector.push_back(wss.str());
+
+			for (int i = 0; i < toDelete; ++i)
+			{
+				wstring folder = PathToWide(saves[i].filename());
+				try {
+					logCollector.push_back(L"         - Deleting: " + folder);
+					counters.filesDeleted.fetch_add(fs::remove_all(saves[i]), memory_order_relaxed); // Delete the folder recursively
+					RemoveBackupIndex(saves[i]);
+				}
+				catch (const fs::filesystem_error& e) {
+					counters.errors++;
+					logCollector.push_back(L"      [PURGE:" + locationName + L"] FAILED to delete " + kind + L" " + folder + L": " + s2ws(e.what()));
+				}
+			}
+		};
+
+	purge(autoSaves, autoLimit, L"Auto");
+	purge(manualSaves, manualLimit, L"Manual");
+}
+
+vector<fs::path> ListBackups(const fs::path& gameBackupDir)
+{
+	vector<fs::path> backups;
+	if (!fs::exists(gameBackupDir) || !fs::is_directory(gameBackupDir)) return backups;
+
+	for (const auto& entry : fs::directory_iterator(gameBackupDir))
+	{
+		// Only backup folders, not ".transfers" or ".manifests"
+		wstring dirName = PathToWide(entry.path().filename());
+		if (entry.is_directory() && (endsWith(dirName, L"-A") || endsWith(dirName, L"-M")))
+		{
+			backups.push_back(entry.path());
+		}
+	}
+	// Sort backups by path name (timestamp) in descending order (newest first)
+	sort(backups.rbegin(), backups.rend());
+	return backups;
+}
+
+fs::path FindLatestManualBackup(const fs::path& gameBackupDir)
+{
+	fs::path latestManualBackup;
+	if (!fs::exists(gameBackupDir)) return latestManualBackup;
+
+	fs::file_time_type latestTime = fs::file_time_type::min();
+	for (const auto& entry : fs::directory_iterator(gameBackupDir))
+	{
+		if (entry.is_directory() && endsWith(PathToWide(entry.path().filename()), L"-M"))
+		{
+			try {
+				auto modTime = fs::last_write_time(entry);
+				// Keep the first manual save found, or a newer one
+				if (latestManualBackup.empty() || modTime > latestTime)
+				{
+					latestTime = modTime;
+					latestManualBackup = entry.path();
+				}
+			}
+			catch (const fs::filesystem_error&) {
+				// Ignore errors reading time for a specific backup folder, skip it
+			}
+		}
+	}
+	return latestManualBackup;
+}
+
+bool RestoreBackup(const fs::path& backupFolder, const fs::path& savePath, OperationProgress* progress)
+{
+	OperationCounters& counters = GetEngineMetrics().Op(MetricOp::Restore);
+	counters.runs++;
+	StageTimer timer(MetricStage::Restore);
+	TraceSpan span("restore", "operation");
+
+	// Ensure the target save path exists and is a directory
+	if (!fs::exists(savePath)) {
+		fs::create_directories(savePath);
+	}
+	else if (!fs::is_directory(savePath)) {
+		counters.errors++;
+		return false;
+	}
+
+	// The backup is copied into a staging folder first and only swapped in once complete, so a
+	// failed or cancelled copy leaves the save as it was
+	fs::path staging = RestoreWorkFolder(savePath, kRestoreStagingSuffix);
+	fs::path previous = RestoreWorkFolder(savePath, kRestorePreviousSuffix);
+	error_code ec;
+	try {
+		if (fs::exists(previous, ec))
+		{
+			// Holds save files of a restore cut short mid-swap (a crash): never deleted here
+			throw fs::filesystem_error("An earlier restore was interrupted; the save files it replaced are still in", previous, make_error_code(errc::file_exists));
+		}
+		fs::remove_all(staging); // Left by an interrupted copy
+		// Its index has the holes of sparse files, in case the backup's copies lost them (a
+		// backup drive without sparse file support)
+		BackupManifest index;
+		if (fs::exists(GetBackupIndexPath(backupFolder.parent_path(), PathToWide(backupFolder.filename())), ec)) index = LoadBackupIndex(backupFolder);
+		RecordCopy(counters, CopyScannedTree(ScanTree(backupFolder), backupFolder, staging, fs::copy_options::overwrite_existing, &index, progress));
+		RestoreModificationTimes(index, staging);
+
+		// Swap: the current contents move aside, the restored ones move in, and only then are the
+		// old ones deleted. Renames only, so a file the game holds open fails it before anything
+		// is lost, and everything moved so far is moved back.
+		vector<fs::path> movedAside, movedIn;
+		try {
+			fs::create_directory(previous);
+			for (const auto& name : ListNames(savePath))
+			{
+				fs::rename(savePath / name, previous / name);
+				movedAside.push_back(name);
+			}
+			for (const auto& name : ListNames(staging))
+			{
+				fs::rename(staging / name, savePath / name);
+				movedIn.push_back(name);
+			}
+		}
+		catch (const fs::filesystem_error&) {
+			error_code undo;
+			for (const auto& name : movedIn) fs::rename(savePath / name, staging / name, undo);
+			bool allBack = true;
+			for (const auto& name : movedAside)
+			{
+				fs::rename(previous / name, savePath / name, undo);
+				if (undo) allBack = false;
+			}
+			if (allBack) fs::remove(previous, undo); // Otherwise kept: it holds save files
+			throw;
+		}
+		uintmax_t removed = fs::remove_all(previous);
+		counters.filesDeleted.fetch_add(removed > 0 ? removed - 1 : 0, memory_order_relaxed); // Not the folder itself
+		fs::remove(staging);
+	}
+	catch (const OperationCancelled&) {
+		fs::remove_all(staging, ec);
+		throw;
+	}
+	catch (const fs::filesystem_error&) {
+		counters.errors++;
+		fs::remove_all(staging, ec);
+		throw;
+	}
+	return true;
+}
+
+CopyStats RestoreSelectedFiles(const fs::path& backupFolder, const BackupManifest& selection, const fs::path& savePath, OperationProgress* progress)
+{
+	OperationCounters& counters = GetEngineMetrics().Op(MetricOp::Restore);
+	counters.runs++;
+	StageTimer timer(MetricStage::Restore);
+	TraceSpan span("restore_files", "operation");
+
+	// Every file (and symlink) is copied to "<name>.partial" first and only renamed into place once
+	// all of them are, so the game never sees a half-restored save. Each file it replaces is kept as
+	// "<name>.gsbm-previous" until the end: a cancel or an error, even partway through the renames,
+	// puts those back and removes the folders the restore created.
+	struct Placed { fs::path target, previous; }; // `previous` is empty if nothing was replaced
+	vector<pair<fs::path, fs::path>> partials; // Partial file, target
+	vector<Placed> placed;
+	vector<fs::path> createdFolders; // Parents before children
+	auto createFolders = [&](const fs::path& folder)
+		{
+			vector<fs::path> missing;
+			for (fs::path parent = folder; !parent.empty() && !fs::exists(fs::symlink_status(parent)); parent = parent.parent_path()) missing.push_back(parent);
+			fs::create_directories(folder);
+			createdFolders.insert(createdFolders.end(), missing.rbegin(), missing.rend());
+		};
+	auto rollBack = [&]()
+		{
+			error_code ec;
+			for (auto it = placed.rbegin(); it != placed.rend(); ++it)
+			{
+				fs::remove(it->target, ec);
+				if (!it->previous.empty()) fs::rename(it->previous, it->target, ec);
+			}
+			for (const auto& [partial, target] : partials) fs::remove(partial, ec); // Those not renamed yet
+			for (auto it = createdFolders.rbegin(); it != createdFolders.rend(); ++it) fs::remove(*it, ec); // Only if empty
+		};
+	CopyStats stats;
+	try {
+		vector<fs::path> relatives;
+		relatives.reserve(selection.entries.size());
+		uint64_t files = 0, bytes = 0;
+		for (const auto& entry : selection.entries)
+		{
+			fs::path relative = fs::u8path(entry.path).lexically_normal();
+			if (relative.empty() || relative.is_absolute() || relative.has_root_name() || *relative.begin() == "..")
+			{
+				throw fs::filesystem_error("Refusing to restore outside the save folder", relative, make_error_code(errc::invalid_argument));
+			}
+			relatives.push_back(move(relative));
+			if (entry.type != fs::file_type::directory && entry.type != fs::file_type::symlink)
+			{
+				files++;
+				bytes += entry.size;
+			}
+		}
+
+		if (progress) progress->Begin(files, bytes);
+		for (size_t i = 0; i < selection.entries.size(); ++i)
+		{
+			const ManifestEntry& entry = selection.entries[i];
+			if (entry.type == fs::file_type::directory) continue;
+			fs::path target = savePath / relatives[i];
+			createFolders(target.parent_path());
+			fs::path partial = target;
+			partial += ".partial";
+			partials.emplace_back(partial, target);
+			if (entry.type == fs::file_type::symlink)
+			{
+				if (progress) progress->ThrowIfCancelled();
+				if (fs::is_symlink(fs::symlink_status(partial))) fs::remove(partial);
+				fs::copy_symlink(backupFolder / relatives[i], partial);
+				stats.filesCopied++;
+				continue;
+			}
+			if (progress) progress->StartFile(relatives[i]);
+			CopySaveFile(backupFolder / relatives[i], partial, entry.size, fs::copy_options::overwrite_existing, entry.sparse ? &entry.extents : nullptr, progress);
+			if (entry.mtime != 0)
+			{
+				error_code ec;
+				fs::last_write_time(partial, UnixNanosToFileTime(entry.mtime), ec); // As for RestoreBackup
+			}
+			if (progress) progress->FinishFile(entry.size);
+			stats.filesCopied++;
+			stats.bytesCopied += entry.size;
+		}
+
+		for (size_t i = 0; i < selection.entries.size(); ++i)
+		{
+			if (selection.entries[i].type == fs::file_type::directory) createFolders(savePath / relatives[i]);
+		}
+		for (const auto& [partial, target] : partials)
+		{
+			Placed step{ target, {} };
+			fs::file_status status = fs::symlink_status(target);
+			if (fs::exists(status) && !fs::is_directory(status)) // A folder in the way fails the rename below
+			{
+				step.previous = target;
+				step.previous += kRestorePreviousSuffix;
+				fs::rename(target, step.previous);
+			}
+			placed.push_back(step);
+			fs::rename(partial, target);
+		}
+		error_code ec;
+		for (const auto& step : placed) if (!step.previous.empty()) fs::remove(step.previous, ec);
+		if (progress) progress->Finish();
+	}
+	catch (const OperationCancelled&) {
+		rollBack();
+		throw;
+	}
+	catch (const fs::filesystem_error&) {
+		counters.errors++;
+		rollBack();
+		RecordCopy(counters, stats);
+		throw;
+	}
+	RecordCopy(counters, stats);
+	return stats;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Config.h"
+#include "Manifest.h"
+#include "Progress.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Name of the folder created inside the configured cloud sync path
+inline const std::wstring kCloudFolderName = L"Game Save Backup Manager";
+
+/**
+ * @brief Local backup folder for a game: <backupsRoot>/<profile.id>.
+ * Throws std::invalid_argument if the profile has no ID.
+ */
+std::filesystem::path GetLocalGameBackupDir(const std::filesystem::path& backupsRoot, const GameProfile& profile);
+
+/**
+ * @brief Cloud backup folder for a game: <cloudRoot>/Game Save Backup Manager/<profile.id>.
+ */
+std::filesystem::path GetCloudGameBackupDir(const std::wstring& cloudRoot, const GameProfile& profile);
+
+/**
+ * @brief One-time move of name-based backup folders to ID-based ones, for profiles with a
+ * legacyFolder (see LoadProfiles). Each folder is renamed in place; if the ID folder already
+ * exists, the backups inside are moved one by one. legacyFolder is cleared once both the local
+ * and cloud folders are done, so an interrupted migration resumes on the next start.
+ * @return Number of profiles whose legacyFolder was cleared (save the profiles if non-zero).
+ */
+size_t MigrateLegacyBackupFolders(std::vector<GameProfile>& profiles, const GlobalSettings& settings, const std::filesystem::path& backupsRoot, std::vector<std::wstring>& logCollector);
+
+// One entry of a scanned folder, relative to the scanned root
+struct ScannedEntry
+{
+	std::filesystem::path relativePath;
+	std::filesystem::file_type type = std::filesystem::file_type::none; // Symlinks are not followed
+	uintmax_t size = 0; // Regular files only
+	std::filesystem::file_time_type mtime{}; // Regular files only
+};
+
+// Result of ScanTree: entries with parents before children, plus totals for regular files
+struct TreeScan
+{
+	std::vector<ScannedEntry> entries;
+	uint64_t files = 0;
+	uint64_t bytes = 0;
+};
+
+struct CopyStats
+{
+	uint64_t filesCopied = 0;
+	uint64_t bytesCopied = 0;
+	uint64_t filesSkipped = 0; // Entries that are neither files, folders nor symlinks
+	uint64_t filesResumed = 0; // Already at the destination from an interrupted transfer (not sent again)
+	uint64_t bytesResumed = 0; // Bytes of resumed files and of partial files that were continued
+	uint64_t bytesDeduplicated = 0; // Chunk store only: bytes of chunks the destination already held
+};
+
+/**
+ * @brief Enumerates a folder recursively. Throws fs::filesystem_error if it is missing or unreadable.
+ * Skips the work folders of a restore ("*.gsbm-restoring", "*.gsbm-previous", see RestoreBackup)
+ * into a save folder nested in this one.
+ */
+TreeScan ScanTree(const std::filesystem::path& root);
+
+/**
+ * @brief Copies the entries of a scan from one root to another (creating `to`), like
+ * fs::copy(from, to, recursive | options). With copy_symlinks, symlinks are copied as links;
+ * otherwise they are followed. Sparse files keep their holes; `layouts` (the index of a backup
+ * being restored) gives the holes of files whose copy in `from` lost them. With `progress`,
+ * reports the scan's totals and each file, and stops before the next entry with
+ * OperationCancelled once cancelled (the caller removes `to`). With `digests` (the scan's
+ * entries, e.g. ManifestFromScan), each copied regular file's SHA-256 is computed while it is
+ * copied and set on its entry. Throws fs::filesystem_error on the first failure.
+ */
+CopyStats CopyScannedTree(const TreeScan& scan, const std::filesystem::path& from, const std::filesystem::path& to, std::filesystem::copy_options options,
+	const BackupManifest* layouts = nullptr, OperationProgress* progress = nullptr, BackupManifest* digests = nullptr);
+
+// Outcome of a single BackupSaveFolder call. Log lines are in display order
+// (failures, then the summary line, then purge messages).
+struct BackupResult
+{
+	bool localSuccess = false;
+	bool cloudAttempted = false; // Cloud was enabled and the path is set
+	bool cloudSuccess = false;
+	bool cancelled = false;      // The local copy was cancelled (and removed); nothing else ran
+	std::wstring folderName;     // "<epoch>-[YYYY-MM-DD_HH-MM-SS]-<A|M>"
+	std::vector<std::wstring> log;
+};
+
+/**
+ * @brief Creates a backup, syncs it to the cloud if enabled, and purges old backups.
+ * @param profile The game profile to back up.
+ * @param settings Global settings (retention limits and cloud path).
+ * @param backupsRoot The local "Backups" folder.
+ * @param autosave True if this is an automatic backup, False if manual (Ctrl+B).
+ * @param progress Optional progress of the local copy; cancelling it removes the partial backup.
+ */
+BackupResult BackupSaveFolder(const GameProfile& profile, const GlobalSettings& settings, const std::filesystem::path& backupsRoot, bool autosave = false, OperationProgress* progress = nullptr);
+
+/**
+ * @brief Deletes old backups (auto or manual) if they exceed limits, collecting log messages.
+ * @param backupDir Directory containing backups.
+ * @param prefix Type of backup just created ("A" or "M").
+ * @param autoLimit Max auto-saves to keep (0=all).
+ * @param manualLimit Max manual-saves to keep (0=all).
+ * @param locationName "Local" or "Cloud".
+ * @param logCollector Vector to store generated log messages.
+ */
+void PurgeBackups(const std::filesystem::path& backupDir, const std::wstring& prefix, int autoLimit, int manualLimit, const std::wstring& locationName, std::vector<std::wstring>& logCollector);
+
+/**
+ * @brief Lists the backup folders of a game, newest first. Returns an empty list if the folder is missing.
+ */
+std::vector<std::filesystem::path> ListBackups(const std::filesystem::path& gameBackupDir);
+
+/**
+ * @brief Finds the most recently written "-M" backup folder, or an empty path if there is none.
+ */
+std::filesystem::path FindLatestManualBackup(const std::filesystem::path& gameBackupDir);
+
+/**
+ * @brief Replaces the contents of savePath with the contents of a backup folder.
+ * Creates savePath if it is missing. The backup is copied into "<savePath>.gsbm-restoring" next
+ * to it, and only once complete are the current contents moved to "<savePath>.gsbm-previous", the
+ * restored ones moved in, and the previous ones deleted. A copy that fails or is cancelled through
+ * `progress` (OperationCancelled), or a swap that fails, leaves the save as it was. If a crash left
+ * "<savePath>.gsbm-previous" behind, it throws without touching it. Throws fs::filesystem_error.
+ * @return False (without touching anything) if savePath exists but is not a directory.
+ */
+bool RestoreBackup(const std::filesystem::path& backupFolder, const std::filesystem::path& savePath, OperationProgress* progress = nullptr);
+
+/**
+ * @brief Copies only the selected entries of a backup (e.g. LoadBackupIndex(...).Select(paths))
+ * into savePath, replacing those files and leaving everything else in savePath alone. Each file
+ * is written to "<name>.partial", and all are renamed into place once every copy is done, the
+ * files they replace kept as "<name>.gsbm-previous" until the last rename. A failed or cancelled
+ * (OperationCancelled) restore, even one that fails partway through the renames, puts the
+ * replaced files back and removes the partial files and the folders it created. Throws
+ * fs::filesystem_error.
+ */
+CopyStats RestoreSelectedFiles(const std::filesystem::path& backupFolder, const BackupManifest& selection, const std::filesystem::path& savePath, OperationProgress* progress = nullptr);
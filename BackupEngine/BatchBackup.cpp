@@ -0,0 +1,83 @@
+#include "BatchBackup.h"
+#include "EngineUtils.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+BatchBackupReport BackupAllProfiles(const vector<GameProfile>& profiles, const GlobalSettings& settings, const fs::path& backupsRoot,
+	int workers, const function<void(const BatchBackupProgress&)>& onProgress)
+{
+	auto start = chrono::steady_clock::now();
+	TraceSpan span("batch_backup", "operation");
+	BatchBackupReport report;
+	report.items.resize(profiles.size());
+	workers = max(1, workers);
+
+	// Sizes first, so small saves can go ahead of large ones. A folder that cannot be read
+	// sorts first and fails fast in its backup.
+	ParallelFor(profiles.size(), workers, [&](size_t i)
+		{
+			report.items[i].profile = i;
+			try { report.items[i].bytes = ScanTree(ToPath(profiles[i].savePath)).bytes; }
+			catch (const fs::filesystem_error&) {}
+		});
+	vector<size_t> bySize(profiles.size());
+	iota(bySize.begin(), bySize.end(), 0);
+	stable_sort(bySize.begin(), bySize.end(), [&](size_t a, size_t b) { return report.items[a].bytes < report.items[b].bytes; });
+
+	BatchBackupProgress progress;
+	progress.profilesTotal = profiles.size();
+	for (const auto& item : report.items) progress.bytesTotal += item.bytes;
+	if (onProgress) onProgress(progress);
+
+	mutex queueMutex;
+	size_t smallest = 0;             // Next to take from the small end
+	size_t largest = bySize.size();  // One past the next to take from the large end
+	size_t started = 0;
+	mutex progressMutex;
+	size_t lanes = min(profiles.size(), static_cast<size_t>(workers));
+
+	ParallelFor(lanes, static_cast<int>(lanes), [&](size_t lane)
+		{
+			bool largeLane = lane == 0 && lanes > 1;
+			while (true)
+			{
+				BatchBackupItem* item;
+				{
+					lock_guard<mutex> lock(queueMutex);
+					if (smallest == largest) return;
+					item = &report.items[largeLane ? bySize[--largest] : bySize[smallest++]];
+					item->startOrder = started++;
+				}
+
+				auto itemStart = chrono::steady_clock::now();
+				try
+				{
+					item->result = BackupSaveFolder(profiles[item->profile], settings, backupsRoot, false);
+				}
+				catch (const exception& e) // Anything the backup does not report itself
+				{
+					item->result.localSuccess = false;
+					item->result.log.push_back(L"[" + s2ws(GetCurrentDateTime()) + L"] [M] Backup FAILED: " + s2ws(e.what()));
+				}
+				item->elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - itemStart);
+
+				lock_guard<mutex> lock(progressMutex);
+				progress.profilesDone++;
+				progress.bytesDone += item->bytes;
+				if (!item->result.localSuccess) progress.profilesFailed++;
+				progress.finished = item;
+				if (onProgress) onProgress(progress);
+			}
+		});
+
+	report.failed = progress.profilesFailed;
+	report.elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+	if (span.Active()) span.SetArgs("\"profiles\": " + to_string(profiles.size()) + ", \"workers\": " + to_string(lanes) + ", \"failed\": " + to_string(report.failed));
+	return report;
+}
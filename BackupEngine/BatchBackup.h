@@ -0,0 +1,51 @@
+#pragma once
+
+// Backing up every profile at once (e.g. before a system update). Profiles are backed up
+// concurrently by a fixed number of workers, the global limit on backups copying at a time.
+//
+// Save folders are sized first (metadata only), then handed out from both ends of a list sorted
+// by size: one worker takes the largest first and the others the smallest first. The many small
+// saves finish early instead of queueing behind a huge world, and the huge world still starts
+// at once rather than last, so it does not stretch the whole batch. With one worker, smallest first.
+
+#include "BackupOperations.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BatchBackupItem
+{
+	size_t profile = 0;                // Index into the profile list
+	uint64_t bytes = 0;                // Save-folder size when the batch started
+	size_t startOrder = 0;             // 0 for the first backup started, 1 for the next, ...
+	BackupResult result;
+	std::chrono::milliseconds elapsed{ 0 };
+};
+
+struct BatchBackupProgress
+{
+	size_t profilesDone = 0;
+	size_t profilesTotal = 0;
+	size_t profilesFailed = 0;
+	uint64_t bytesDone = 0;            // Save-folder bytes of the finished profiles
+	uint64_t bytesTotal = 0;
+	const BatchBackupItem* finished = nullptr; // The profile that just finished (null: batch starting)
+};
+
+struct BatchBackupReport
+{
+	std::vector<BatchBackupItem> items; // Same order as the profiles
+	size_t failed = 0;                  // Profiles without a local backup
+	std::chrono::milliseconds elapsed{ 0 };
+};
+
+/**
+ * @brief Backs up every profile (manual backups), at most `workers` at a time. `onProgress`
+ * runs once before the first backup and once as each one finishes, one call at a time, on the
+ * worker that finished it. A profile whose backup throws counts as failed; the others go on.
+ */
+BatchBackupReport BackupAllProfiles(const std::vector<GameProfile>& profiles, const GlobalSettings& settings, const std::filesystem::path& backupsRoot,
+	int workers, const std::function<void(const BatchBackupProgress&)>& onProgress = nullptr);
@@ -0,0 +1,421 @@
+#include "ChunkStore.h"
+#include "Chunker.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "Metrics.h"
+#include "Sha256.h"
+#include "Trace.h"
+
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const char* const kIndexHeader = "GSBM-CHUNKS 1";
+
+	// Indexed chunks checked against the backend whenever an index file is loaded
+	constexpr size_t kIndexSpotChecks = 3;
+
+	// One chunked upload or sweep at a time: a sweep must see every manifest that refers to a
+	// chunk an upload skipped because the index listed it
+	mutex g_chunkStoreMutex;
+
+	// Manifest paths come from the backend, so refuse anything that would leave the target
+	fs::path SafeRelativePath(const string& path)
+	{
+		fs::path relative = fs::u8path(path).lexically_normal();
+		if (relative.empty() || relative.is_absolute() || relative.has_root_name() || *relative.begin() == "..")
+		{
+			throw StorageError("Refusing to restore outside the target folder: " + path);
+		}
+		return relative;
+	}
+
+	bool IsChunkName(const string& name)
+	{
+		return name.size() == 64 && name.find_first_not_of("0123456789abcdef") == string::npos;
+	}
+}
+
+string GetChunkKey(const string& gamePrefix, const string& chunkId)
+{
+	return gamePrefix + "chunks/" + chunkId.substr(0, 2) + "/" + chunkId;
+}
+
+fs::path GetChunkIndexPath(const fs::path& gameBackupDir)
+{
+	return gameBackupDir / ".chunk-index";
+}
+
+ChunkIndex::ChunkIndex(fs::path file, StorageBackend& backend, string gamePrefix)
+	: m_file(move(file)), m_backend(backend), m_gamePrefix(move(gamePrefix))
+{
+	bool loaded = false;
+	{
+		ifstream in(m_file, ios::binary);
+		string line;
+		if (in && getline(in, line) && line == string(kIndexHeader) + "\t" + m_backend.Location())
+		{
+			while (getline(in, line))
+			{
+				if (IsChunkName(line)) m_chunks.insert(line);
+			}
+			loaded = true;
+		}
+	}
+	size_t checked = 0;
+	for (auto it = m_chunks.begin(); loaded && it != m_chunks.end() && checked < kIndexSpotChecks; ++it, ++checked)
+	{
+		loaded = m_backend.Exists(GetChunkKey(m_gamePrefix, *it));
+	}
+	if (!loaded) Rebuild();
+}
+
+void ChunkIndex::Rebuild()
+{
+	TraceSpan span("chunk_index_rebuild");
+	lock_guard<mutex> lock(m_mutex);
+	m_chunks.clear();
+	for (const auto& object : m_backend.ListAll(m_gamePrefix + "chunks/"))
+	{
+		string name = object.key.substr(object.key.rfind('/') + 1);
+		if (IsChunkName(name)) m_chunks.insert(name);
+	}
+	m_rebuilt = true;
+}
+
+bool ChunkIndex::Contains(const string& chunkId) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_chunks.count(chunkId) != 0;
+}
+
+void ChunkIndex::Add(const string& chunkId)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_chunks.insert(chunkId);
+}
+
+void ChunkIndex::Remove(const string& chunkId)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_chunks.erase(chunkId);
+}
+
+size_t ChunkIndex::Size() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_chunks.size();
+}
+
+bool ChunkIndex::Save() const
+{
+	string text = string(kIndexHeader) + "\t" + m_backend.Location() + "\n";
+	{
+		lock_guard<mutex> lock(m_mutex);
+		text.reserve(text.size() + m_chunks.size() * 65);
+		for (const auto& id : m_chunks) text += id + "\n";
+	}
+	error_code ec;
+	fs::create_directories(m_file.parent_path(), ec);
+	fs::path temp = m_file;
+	temp += ".tmp";
+	{
+		ofstream out(temp, ios::binary | ios::trunc);
+		if (!out.write(text.data(), static_cast<streamsize>(text.size())).flush()) return false;
+	}
+	fs::rename(temp, m_file, ec);
+	return !ec;
+}
+
+CopyStats PutChunkedBackup(StorageBackend& backend, const TreeScan& scan, const fs::path& from, const string& gamePrefix, const string& folderName, ChunkIndex& index, TransferJournal* journal, const EncryptionKeys* keys)
+{
+	lock_guard<mutex> storeLock(g_chunkStoreMutex);
+	CopyStats stats;
+	mutex statsMutex;
+	unordered_set<string> claimed; // Chunks this backup already stored or skipped
+
+	// Uploads one chunk unless the pool (or this backup) already has it
+	auto storeChunk = [&](const string& id, const char* data, size_t size)
+		{
+			{
+				lock_guard<mutex> lock(statsMutex);
+				if (!claimed.insert(id).second || index.Contains(id))
+				{
+					stats.bytesDeduplicated += size;
+					return;
+				}
+			}
+			string key = GetChunkKey(gamePrefix, id);
+			if (journal && backend.IsStoredAsJournaled(key, *journal))
+			{
+				index.Add(id);
+				lock_guard<mutex> lock(statsMutex);
+				stats.filesResumed++;
+				stats.bytesResumed += size;
+				return;
+			}
+			// Encrypted while the chunk is still in cache from hashing; no extra pass over the file
+			string body = keys ? keys->Encrypt(string_view(data, size)) : string(data, size);
+			bool stored = backend.PutBytes(key, body, true);
+			if (journal) journal->FileDone(key, body.size(), keys ? Sha256Hex(body) : id);
+			index.Add(id);
+			lock_guard<mutex> lock(statsMutex);
+			(stored ? stats.bytesCopied : stats.bytesDeduplicated) += size;
+		};
+
+	vector<ManifestEntry> entries(scan.entries.size());
+	vector<size_t> files;
+	vector<bool> listed(scan.entries.size(), false);
+	for (size_t i = 0; i < scan.entries.size(); ++i)
+	{
+		const ScannedEntry& scanned = scan.entries[i];
+		ManifestEntry& entry = entries[i];
+		entry.path = scanned.relativePath.generic_u8string();
+		entry.type = scanned.type;
+		switch (scanned.type)
+		{
+		case fs::file_type::regular:
+			files.push_back(i);
+			break;
+		case fs::file_type::directory:
+			break;
+		case fs::file_type::symlink:
+			entry.linkTarget = fs::read_symlink(from / scanned.relativePath).u8string();
+			break;
+		default:
+			stats.filesSkipped++;
+			continue;
+		}
+		listed[i] = true;
+	}
+
+	try
+	{
+		ChunkerParams params;
+		ParallelFor(files.size(), backend.Parallelism(), [&](size_t n)
+			{
+				ManifestEntry& entry = entries[files[n]];
+				fs::path source = from / scan.entries[files[n]].relativePath;
+				TraceSpan span("chunk_file");
+				entry.mtime = FileTimeToUnixNanos(fs::last_write_time(source));
+				if (auto layout = FindSparseLayout(source, scan.entries[files[n]].size))
+				{
+					entry.sparse = true;
+					entry.extents = move(*layout);
+				}
+				Sha256 whole;
+				ForEachFileChunk(source, params, [&](uint64_t /*offset*/, const char* data, size_t size)
+					{
+						whole.Update(data, size);
+						string sha = Sha256Hex(string_view(data, size));
+						string id = keys ? keys->ChunkId(sha) : sha;
+						entry.chunks.push_back({ id, size });
+						entry.size += size;
+						storeChunk(id, data, size);
+					});
+				Sha256::Digest digest = whole.Final();
+				entry.sha256 = ToHex(digest.data(), digest.size());
+				if (span.Active()) span.SetArgs("\"file\": \"" + EscapeJson(entry.path) + "\", \"chunks\": " + to_string(entry.chunks.size()));
+			});
+
+		BackupManifest manifest;
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			if (listed[i]) manifest.entries.push_back(move(entries[i]));
+		}
+		// Last, so a backup without a manifest is just an unfinished upload
+		string text = manifest.Serialize();
+		backend.PutBytes(gamePrefix + folderName + "/" + kManifestObjectName, keys ? keys->Encrypt(text) : text);
+	}
+	catch (...)
+	{
+		index.Save(); // Chunks that did get stored stay known
+		throw;
+	}
+	index.Save();
+	if (journal) journal->TreeDone();
+	stats.filesCopied = files.size();
+	return stats;
+}
+
+bool HasStoredManifest(StorageBackend& backend, const string& backupPrefix)
+{
+	return backend.Exists(backupPrefix + kManifestObjectName);
+}
+
+BackupManifest GetStoredManifest(StorageBackend& backend, const string& backupPrefix, const EncryptionKeys* keys)
+{
+	string data = backend.GetBytes(backupPrefix + kManifestObjectName);
+	if (!IsEncryptedObject(data)) return BackupManifest::Parse(data);
+	if (!keys) throw EncryptionError("Backup " + backupPrefix + " is encrypted; set the profile's passphrase or key file");
+	BackupManifest manifest = BackupManifest::Parse(keys->Decrypt(data));
+	manifest.encrypted = true;
+	return manifest;
+}
+
+CopyStats RestoreChunkedBackup(StorageBackend& backend, const string& gamePrefix, const BackupManifest& manifest, const fs::path& target, const EncryptionKeys* keys, OperationProgress* progress)
+{
+	if (manifest.encrypted && !keys) throw EncryptionError("Backup is encrypted; set the profile's passphrase or key file");
+	CopyStats stats;
+	mutex statsMutex;
+	fs::create_directories(target);
+
+	vector<const ManifestEntry*> files;
+	for (const auto& entry : manifest.entries)
+	{
+		fs::path path = target / SafeRelativePath(entry.path);
+		if (entry.type == fs::file_type::directory)
+		{
+			fs::create_directories(path);
+		}
+		else if (entry.type == fs::file_type::symlink)
+		{
+			error_code ec;
+			fs::create_directories(path.parent_path());
+			fs::remove(path, ec);
+			fs::create_symlink(fs::u8path(entry.linkTarget), path, ec);
+			if (ec) stats.filesSkipped++; // e.g. no symlink privilege on Windows
+		}
+		else
+		{
+			files.push_back(&entry);
+		}
+	}
+
+	if (progress)
+	{
+		uint64_t bytes = 0;
+		for (const ManifestEntry* entry : files) bytes += entry->size;
+		progress->Begin(files.size(), bytes);
+	}
+	ParallelFor(files.size(), backend.Parallelism(), [&](size_t n)
+		{
+			const ManifestEntry& entry = *files[n];
+			fs::path path = target / SafeRelativePath(entry.path);
+			if (progress)
+			{
+				lock_guard<mutex> lock(statsMutex); // Progress is reported from one thread at a time
+				progress->StartFile(SafeRelativePath(entry.path)); // Throws OperationCancelled
+			}
+			fs::create_directories(path.parent_path());
+			fs::path partial = path;
+			partial += ".partial";
+			try
+			{
+				ofstream out(partial, ios::binary | ios::trunc);
+				if (!out) throw fs::filesystem_error("Cannot create file", partial, make_error_code(errc::io_error));
+				if (entry.sparse) MarkSparseFile(partial);
+				Sha256 whole;
+				uint64_t offset = 0;
+				for (const auto& chunk : entry.chunks)
+				{
+					if (progress) progress->ThrowIfCancelled(); // A large file stops between chunks
+					string data = backend.GetBytes(GetChunkKey(gamePrefix, chunk.id));
+					if (manifest.encrypted) data = keys->Decrypt(data); // Checks every segment's tag
+					string sha = Sha256Hex(data);
+					if (data.size() != chunk.size || (manifest.encrypted ? keys->ChunkId(sha) : sha) != chunk.id)
+					{
+						throw StorageError("Chunk " + chunk.id + " of " + entry.path + " is damaged");
+					}
+					whole.Update(data);
+					if (!entry.sparse)
+					{
+						out.write(data.data(), static_cast<streamsize>(data.size()));
+					}
+					else
+					{
+						// Holes are skipped over, and the file extended to its size below
+						ForEachDataRun(entry.extents, offset, data.data(), data.size(), [&](uint64_t runOffset, const char* run, size_t length)
+							{
+								out.seekp(static_cast<streamoff>(runOffset));
+								out.write(run, static_cast<streamsize>(length));
+							});
+					}
+					offset += data.size();
+				}
+				if (!out.flush()) throw fs::filesystem_error("Write failed", partial, make_error_code(errc::io_error));
+				out.close();
+				if (entry.sparse) fs::resize_file(partial, entry.size);
+				Sha256::Digest digest = whole.Final();
+				if (ToHex(digest.data(), digest.size()) != entry.sha256) throw StorageError("Restored " + entry.path + " does not match its SHA-256");
+				fs::rename(partial, path);
+			}
+			catch (...)
+			{
+				error_code ec;
+				fs::remove(partial, ec);
+				throw;
+			}
+			error_code ec;
+			fs::last_write_time(path, UnixNanosToFileTime(entry.mtime), ec);
+			lock_guard<mutex> lock(statsMutex);
+			stats.filesCopied++;
+			stats.bytesCopied += entry.size;
+			if (progress) progress->FinishFile(entry.size);
+		});
+	if (progress) progress->Finish();
+	return stats;
+}
+
+uint64_t SweepChunkPool(StorageBackend& backend, const string& gamePrefix, ChunkIndex& index, const wstring& locationName, vector<wstring>& logCollector, const EncryptionKeys* keys)
+{
+	lock_guard<mutex> storeLock(g_chunkStoreMutex);
+	OperationCounters& counters = GetEngineMetrics().Op(MetricOp::Purge);
+	TraceSpan span("chunk_sweep");
+
+	// Mark: every chunk a remaining manifest refers to
+	unordered_set<string> referenced;
+	for (const auto& name : ListStoredBackups(backend, gamePrefix))
+	{
+		string backupPrefix = gamePrefix + name + "/";
+		try
+		{
+			if (!HasStoredManifest(backend, backupPrefix)) continue; // Stored as a plain folder
+			for (const auto& entry : GetStoredManifest(backend, backupPrefix, keys).entries)
+			{
+				for (const auto& chunk : entry.chunks) referenced.insert(chunk.id);
+			}
+		}
+		catch (const exception& e)
+		{
+			counters.errors++;
+			logCollector.push_back(L"      [PURGE:" + locationName + L"] Chunk sweep skipped, cannot read the manifest of " + s2ws(name) + L": " + s2ws(e.what()));
+			return 0;
+		}
+	}
+
+	// Sweep: the rest of the pool
+	uint64_t removed = 0;
+	uint64_t bytes = 0;
+	try
+	{
+		for (const auto& object : backend.ListAll(gamePrefix + "chunks/"))
+		{
+			string name = object.key.substr(object.key.rfind('/') + 1);
+			if (referenced.count(name)) continue;
+			backend.Remove(object.key);
+			index.Remove(name);
+			removed++;
+			bytes += object.size;
+		}
+	}
+	catch (const exception& e)
+	{
+		counters.errors++;
+		logCollector.push_back(L"      [PURGE:" + locationName + L"] Chunk sweep FAILED: " + s2ws(e.what()));
+	}
+	index.Save();
+	counters.filesDeleted.fetch_add(removed, memory_order_relaxed);
+	if (removed > 0)
+	{
+		wstringstream wss;
+		wss << L"      [PURGE:" << locationName << L"] Removed " << removed << L" unreferenced chunk(s) (" << bytes / 1024 << L" KB).";
+		logCollector.push_back(wss.str());
+	}
+	return removed;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+// Cloud layout that stores each distinct piece of save data once. Files are split into
+// content-defined chunks (Chunker.h) kept in a content-addressed pool per game, and each
+// backup is a manifest (Manifest.h) listing its files and their chunks:
+//
+//   <id>/chunks/<first 2 hex digits>/<chunk id> chunk objects, shared by all backups of the game
+//   <id>/<backup folder>/.gsbm-manifest         one per backup; written last
+//
+// A chunk ID is the chunk's SHA-256, or for an encrypted profile (CloudEncryption.h) a keyed
+// hash of it; chunks and manifests of such a profile are stored encrypted.
+//
+// Whether a chunk is already stored is answered by a local index (one listing of the pool
+// when it is missing or stale), not by a request per chunk, so a backup whose saves barely
+// changed uploads a few chunks and one manifest. Chunks no manifest refers to any more are
+// swept after cloud backups are purged.
+
+#include "BackupOperations.h"
+#include "CloudEncryption.h"
+#include "Manifest.h"
+#include "StorageBackend.h"
+#include "TransferJournal.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Object name of a backup's manifest inside its folder
+inline const std::string kManifestObjectName = ".gsbm-manifest";
+
+/**
+ * @brief Key of a chunk in a game's pool: "<id>/chunks/<chunkId[0:2]>/<chunkId>".
+ */
+std::string GetChunkKey(const std::string& gamePrefix, const std::string& chunkId);
+
+/**
+ * @brief Local cache of the chunk digests a backend holds for one game:
+ * "<gameBackupDir>/.chunk-index", one digest per line after a header naming the destination.
+ */
+std::filesystem::path GetChunkIndexPath(const std::filesystem::path& gameBackupDir);
+
+class ChunkIndex
+{
+public:
+	/**
+	 * @brief Loads the index file, or lists the pool if the file is missing, unreadable or was
+	 * written for another destination (StorageBackend::Location). A few indexed chunks are
+	 * checked with Stat(); if one is gone (pool deleted outside the program) the pool is listed again.
+	 */
+	ChunkIndex(std::filesystem::path file, StorageBackend& backend, std::string gamePrefix);
+
+	ChunkIndex(const ChunkIndex&) = delete;
+	ChunkIndex& operator=(const ChunkIndex&) = delete;
+
+	// Thread-safe
+	bool Contains(const std::string& chunkId) const;
+	void Add(const std::string& chunkId);
+	void Remove(const std::string& chunkId);
+	size_t Size() const;
+
+	// True if the constructor had to list the pool
+	bool Rebuilt() const { return m_rebuilt; }
+
+	/**
+	 * @brief Writes the index (temporary file, then rename). Returns false on failure; the next
+	 * load then lists the pool.
+	 */
+	bool Save() const;
+
+private:
+	void Rebuild();
+
+	std::filesystem::path m_file;
+	StorageBackend& m_backend;
+	std::string m_gamePrefix;
+	bool m_rebuilt = false;
+	mutable std::mutex m_mutex;
+	std::unordered_set<std::string> m_chunks;
+};
+
+/**
+ * @brief Stores a scanned tree as chunks plus a manifest under "<gamePrefix><folderName>/".
+ * Chunks in the index (or already in the journal and confirmed by Stat) are not sent; the
+ * rest are uploaded with a conditional put, backend.Parallelism() at a time. The manifest is
+ * written last, so a backup is either complete or invisible to restores.
+ * @return filesCopied = files in the backup, bytesCopied = chunk bytes sent,
+ * bytesDeduplicated = chunk bytes already stored, filesResumed/bytesResumed = chunks an
+ * interrupted attempt had sent.
+ * @param keys If set, every chunk and the manifest are encrypted as they are sent.
+ */
+CopyStats PutChunkedBackup(StorageBackend& backend, const TreeScan& scan, const std::filesystem::path& from, const std::string& gamePrefix, const std::string& folderName, ChunkIndex& index, TransferJournal* journal = nullptr, const EncryptionKeys* keys = nullptr);
+
+/**
+ * @brief True if "<backupPrefix>.gsbm-manifest" exists (a chunked backup).
+ */
+bool HasStoredManifest(StorageBackend& backend, const std::string& backupPrefix);
+
+/**
+ * @brief Reads and parses a backup's manifest, decrypting it if needed. Throws StorageError,
+ * ManifestError, or EncryptionError (encrypted, and `keys` missing or wrong).
+ */
+BackupManifest GetStoredManifest(StorageBackend& backend, const std::string& backupPrefix, const EncryptionKeys* keys = nullptr);
+
+/**
+ * @brief Rebuilds a chunked backup in `target` from its manifest. Every chunk and every file
+ * is checked against its SHA-256 (and encrypted chunks against their GCM tags); a mismatch throws
+ * StorageError or EncryptionError and leaves no file at that path. File modification times are restored.
+ * @param keys Required if manifest.encrypted.
+ * @param progress Per file (files are fetched in parallel). A cancel stops every file not yet
+ * complete with OperationCancelled; completed files stay in `target`.
+ */
+CopyStats RestoreChunkedBackup(StorageBackend& backend, const std::string& gamePrefix, const BackupManifest& manifest, const std::filesystem::path& target, const EncryptionKeys* keys = nullptr, OperationProgress* progress = nullptr);
+
+/**
+ * @brief Removes chunks of a game's pool that no stored manifest refers to, and drops them from
+ * the index. Does nothing (returns 0) if a manifest cannot be read, e.g. an encrypted one
+ * without `keys`. Adds one log line if anything was removed.
+ * @return The number of chunks removed.
+ */
+uint64_t SweepChunkPool(StorageBackend& backend, const std::string& gamePrefix, ChunkIndex& index, const std::wstring& locationName, std::vector<std::wstring>& logCollector, const EncryptionKeys* keys = nullptr);
@@ -0,0 +1,110 @@
+#include "Chunker.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	// Fixed pseudo-random table (splitmix64), so every build cuts files at the same places
+	const array<uint64_t, 256>& GearTable()
+	{
+		static const array<uint64_t, 256> table = []
+			{
+				array<uint64_t, 256> gear{};
+				uint64_t state = 0x6773626d2d636463ULL;
+				for (auto& value : gear)
+				{
+					uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+					z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+					z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+					value = z ^ (z >> 31);
+				}
+				return gear;
+			}();
+		return table;
+	}
+
+	// Mask of the `bits` most significant bits: the gear hash shifts left, so its top bits
+	// depend on the last 64 bytes
+	uint64_t TopBitsMask(int bits)
+	{
+		bits = clamp(bits, 1, 63);
+		return ~0ULL << (64 - bits);
+	}
+
+	int Log2(size_t value)
+	{
+		int bits = 0;
+		while (value > 1)
+		{
+			value >>= 1;
+			bits++;
+		}
+		return bits;
+	}
+}
+
+size_t FindChunkBoundary(const uint8_t* data, size_t size, const ChunkerParams& params)
+{
+	if (size <= params.minSize) return size;
+	size_t limit = min(size, params.maxSize);
+	size_t normal = min(limit, max(params.avgSize, params.minSize));
+
+	// Normalized chunking: a stricter mask before the average size and a looser one after
+	// keeps most chunks close to the average
+	int bits = Log2(params.avgSize);
+	uint64_t strictMask = TopBitsMask(bits + 2);
+	uint64_t looseMask = TopBitsMask(bits - 2);
+
+	const auto& gear = GearTable();
+	uint64_t hash = 0;
+	size_t i = params.minSize;
+	for (; i < normal; ++i)
+	{
+		hash = (hash << 1) + gear[data[i]];
+		if (!(hash & strictMask)) return i + 1;
+	}
+	for (; i < limit; ++i)
+	{
+		hash = (hash << 1) + gear[data[i]];
+		if (!(hash & looseMask)) return i + 1;
+	}
+	return limit;
+}
+
+void ForEachFileChunk(const fs::path& file, const ChunkerParams& params,
+	const function<void(uint64_t offset, const char* data, size_t size)>& onChunk)
+{
+	ifstream in(file, ios::binary);
+	if (!in) throw fs::filesystem_error("Cannot open file", file, make_error_code(errc::io_error));
+
+	vector<char> buffer(params.maxSize);
+	size_t filled = 0;
+	uint64_t offset = 0;
+	bool atEnd = false;
+	while (true)
+	{
+		if (!atEnd && filled < buffer.size())
+		{
+			in.read(buffer.data() + filled, static_cast<streamsize>(buffer.size() - filled));
+			filled += static_cast<size_t>(in.gcount());
+			if (in.bad()) throw fs::filesystem_error("Read failed", file, make_error_code(errc::io_error));
+			atEnd = in.eof();
+		}
+		if (filled == 0) return;
+
+		size_t cut = FindChunkBoundary(reinterpret_cast<const uint8_t*>(buffer.data()), filled, params);
+		if (cut == filled && !atEnd && filled < params.maxSize) continue; // Need more data to decide
+		onChunk(offset, buffer.data(), cut);
+		offset += cut;
+		memmove(buffer.data(), buffer.data() + cut, filled - cut);
+		filled -= cut;
+	}
+}
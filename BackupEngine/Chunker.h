@@ -0,0 +1,31 @@
+#pragma once
+
+// Content-defined chunking (FastCDC: gear rolling hash with normalized chunk sizes). Cut points
+// depend only on the bytes just before them, so an edit inside a large save file changes the
+// chunk around it and leaves the chunks before and after it identical. The cloud chunk store
+// (ChunkStore.h) relies on this to upload only what changed between backups.
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+
+struct ChunkerParams
+{
+	size_t minSize = 256 * 1024;
+	size_t avgSize = 1024 * 1024; // Rounded down to a power of two
+	size_t maxSize = 4 * 1024 * 1024;
+};
+
+/**
+ * @brief Length of the first chunk of data[0, size). Returns `size` if no cut point is found
+ * before the end (the caller then either has the last chunk or must supply more data).
+ */
+size_t FindChunkBoundary(const uint8_t* data, size_t size, const ChunkerParams& params);
+
+/**
+ * @brief Splits a file into chunks, calling onChunk(offset, data, size) for each in order.
+ * Reads the file once with a buffer of params.maxSize. Throws fs::filesystem_error on read errors.
+ */
+void ForEachFileChunk(const std::filesystem::path& file, const ChunkerParams& params,
+	const std::function<void(uint64_t offset, const char* data, size_t size)>& onChunk);
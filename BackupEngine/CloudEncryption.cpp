@@ -0,0 +1,259 @@
+#include "CloudEncryption.h"
+#include "EngineUtils.h"
+#include "Sha256.h"
+#include "StorageBackend.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const char kMagic[8] = { 'G', 'S', 'B', 'M', 'E', 'N', 'C', '1' };
+	const char* const kKeyRecordHeader = "GSBM-KEY 1";
+	const char* const kKeyRecordName = ".gsbm-key";
+
+	// Segments larger than this in a header are treated as damage, not allocated
+	constexpr uint32_t kMaxSegmentSize = 16 * 1024 * 1024;
+
+	string RandomBytes(size_t size)
+	{
+		random_device device; // OS entropy (getrandom / RtlGenRandom)
+		string bytes(size, '\0');
+		for (size_t i = 0; i < size; i += 4)
+		{
+			uint32_t value = device();
+			memcpy(&bytes[i], &value, min<size_t>(4, size - i));
+		}
+		return bytes;
+	}
+
+	string Hmac(const string& key, string_view data)
+	{
+		Sha256::Digest digest = HmacSha256(key, data);
+		return string(reinterpret_cast<const char*>(digest.data()), digest.size());
+	}
+
+	string HexToBytes(const string& hex)
+	{
+		if (hex.size() % 2 || hex.find_first_not_of("0123456789abcdef") != string::npos) throw EncryptionError("Malformed key record");
+		string bytes;
+		for (size_t i = 0; i < hex.size(); i += 2) bytes += static_cast<char>(stoi(hex.substr(i, 2), nullptr, 16));
+		return bytes;
+	}
+
+	string ToHexString(const string& bytes)
+	{
+		return ToHex(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+	}
+
+	// Per-object key from the data key and the salt in the object's header
+	string ObjectKey(const EncryptionKeys& keys, string_view header)
+	{
+		return Hmac(keys.DataKey(), header.substr(12, 16));
+	}
+
+	void SegmentNonce(uint32_t index, bool last, uint8_t* nonce)
+	{
+		memset(nonce, 0, AesGcm::kNonceSize);
+		nonce[7] = static_cast<uint8_t>(index >> 24);
+		nonce[8] = static_cast<uint8_t>(index >> 16);
+		nonce[9] = static_cast<uint8_t>(index >> 8);
+		nonce[10] = static_cast<uint8_t>(index);
+		nonce[11] = last ? 1 : 0;
+	}
+
+	string NewHeader()
+	{
+		string header(kMagic, sizeof(kMagic));
+		uint32_t segmentSize = StreamEncryptor::kSegmentSize;
+		for (int i = 0; i < 4; ++i) header += static_cast<char>((segmentSize >> (8 * i)) & 0xFF);
+		header += RandomBytes(16);
+		return header;
+	}
+
+	string CheckedHeader(string_view header)
+	{
+		if (header.size() < StreamEncryptor::kHeaderSize || !IsEncryptedObject(header)) throw EncryptionError("Not an encrypted object");
+		return string(header.substr(0, StreamEncryptor::kHeaderSize));
+	}
+
+	mutex g_keyCacheMutex;
+	map<string, shared_ptr<const EncryptionKeys>> g_keyCache; // Digest of secret, salt and iterations -> keys
+}
+
+EncryptionKeys::EncryptionKeys(string_view secret, string_view salt, uint32_t iterations)
+{
+	string master = Pbkdf2HmacSha256(secret, salt, max<uint32_t>(1, iterations), 32);
+	m_dataKey = Hmac(master, "gsbm data key");
+	m_idKey = Hmac(master, "gsbm chunk id key");
+	m_verifier = ToHexString(Hmac(master, "gsbm key verifier"));
+}
+
+string EncryptionKeys::Encrypt(string_view plaintext) const
+{
+	StreamEncryptor encryptor(*this);
+	string object = encryptor.Header();
+	size_t segments = plaintext.empty() ? 1 : (plaintext.size() + StreamEncryptor::kSegmentSize - 1) / StreamEncryptor::kSegmentSize;
+	object.reserve(object.size() + plaintext.size() + segments * AesGcm::kTagSize);
+	for (size_t i = 0; i < segments; ++i)
+	{
+		size_t offset = i * StreamEncryptor::kSegmentSize;
+		size_t size = min(StreamEncryptor::kSegmentSize, plaintext.size() - offset);
+		encryptor.Segment(plaintext.data() + offset, size, i + 1 == segments, object);
+	}
+	return object;
+}
+
+string EncryptionKeys::Decrypt(string_view object) const
+{
+	StreamDecryptor decryptor(*this, object);
+	string plaintext(object.substr(StreamEncryptor::kHeaderSize));
+	size_t segment = decryptor.SegmentSize() + AesGcm::kTagSize;
+	size_t read = 0, written = 0;
+	do
+	{
+		size_t size = min(segment, plaintext.size() - read);
+		bool last = read + size == plaintext.size();
+		decryptor.Segment(&plaintext[read], size, last);
+		memmove(&plaintext[written], &plaintext[read], size - AesGcm::kTagSize);
+		read += size;
+		written += size - AesGcm::kTagSize;
+	} while (read < plaintext.size());
+	plaintext.resize(written);
+	return plaintext;
+}
+
+string EncryptionKeys::ChunkId(const string& sha256Hex) const
+{
+	return ToHexString(Hmac(m_idKey, sha256Hex));
+}
+
+bool IsEncryptedObject(string_view data)
+{
+	return data.size() >= sizeof(kMagic) && memcmp(data.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+StreamEncryptor::StreamEncryptor(const EncryptionKeys& keys, bool allowHardware)
+	: m_header(NewHeader()), m_aes(reinterpret_cast<const uint8_t*>(ObjectKey(keys, m_header).data()), allowHardware)
+{
+}
+
+void StreamEncryptor::Segment(const char* data, size_t size, bool last, string& out)
+{
+	if (m_finished || size > kSegmentSize || (!last && size != kSegmentSize)) throw logic_error("StreamEncryptor: bad segment size or segment after the last");
+	uint8_t nonce[AesGcm::kNonceSize];
+	SegmentNonce(m_index++, last, nonce);
+	size_t start = out.size();
+	out.append(data, size);
+	out.resize(start + size + AesGcm::kTagSize);
+	uint8_t* buffer = reinterpret_cast<uint8_t*>(&out[start]);
+	m_aes.Encrypt(nonce, reinterpret_cast<const uint8_t*>(m_header.data()), m_header.size(), buffer, size, buffer + size);
+	m_finished = last;
+}
+
+StreamDecryptor::StreamDecryptor(const EncryptionKeys& keys, string_view header, bool allowHardware)
+	: m_header(CheckedHeader(header)), m_aes(reinterpret_cast<const uint8_t*>(ObjectKey(keys, m_header).data()), allowHardware)
+{
+	uint32_t segmentSize = 0;
+	for (int i = 0; i < 4; ++i) segmentSize |= static_cast<uint32_t>(static_cast<uint8_t>(m_header[8 + i])) << (8 * i);
+	if (segmentSize == 0 || segmentSize > kMaxSegmentSize) throw EncryptionError("Encrypted object has a bad segment size");
+	m_segmentSize = segmentSize;
+}
+
+void StreamDecryptor::Segment(char* data, size_t size, bool last)
+{
+	if (size < AesGcm::kTagSize || size - AesGcm::kTagSize > m_segmentSize || (!last && size - AesGcm::kTagSize != m_segmentSize))
+	{
+		throw EncryptionError("Encrypted object is truncated");
+	}
+	uint8_t nonce[AesGcm::kNonceSize];
+	SegmentNonce(m_index++, last, nonce);
+	uint8_t* buffer = reinterpret_cast<uint8_t*>(data);
+	size_t plainSize = size - AesGcm::kTagSize;
+	if (!m_aes.Decrypt(nonce, reinterpret_cast<const uint8_t*>(m_header.data()), m_header.size(), buffer, plainSize, buffer + plainSize))
+	{
+		throw EncryptionError("Encrypted data failed its integrity check (altered, truncated or wrong key)");
+	}
+}
+
+bool IsEncryptionEnabled(const GameProfile& profile)
+{
+	return !profile.encryptionPassphrase.empty() || !profile.encryptionKeyFile.empty() || !profile.unreadablePassphrase.empty();
+}
+
+string GetProfileSecret(const GameProfile& profile)
+{
+	if (profile.encryptionKeyFile.empty() && profile.encryptionPassphrase.empty() && !profile.unreadablePassphrase.empty())
+	{
+		// Never replaced by an empty or sealed secret, which would create keys nobody knows
+		throw EncryptionError("The stored encryption passphrase cannot be opened by this Windows user; enter it again");
+	}
+	if (profile.encryptionKeyFile.empty()) return ws2s(profile.encryptionPassphrase);
+	ifstream in(ToPath(profile.encryptionKeyFile), ios::binary);
+	string secret;
+	if (in) secret.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+	if (secret.empty()) throw EncryptionError("Cannot read encryption key file " + ws2s(profile.encryptionKeyFile));
+	return secret;
+}
+
+shared_ptr<const EncryptionKeys> OpenStoredKeys(StorageBackend& backend, const string& gamePrefix, const string& secret, bool create, uint32_t iterations)
+{
+	if (secret.empty()) throw EncryptionError("Empty passphrase");
+	string key = gamePrefix + kKeyRecordName;
+	string salt;
+	string verifier;
+	if (backend.Exists(key))
+	{
+		istringstream in(backend.GetBytes(key));
+		string header, line;
+		getline(in, header);
+		getline(in, line);
+		vector<string> fields = SplitTabFields(line);
+		if (header != kKeyRecordHeader || fields.size() != 4 || fields[0] != "pbkdf2-sha256") throw EncryptionError("Malformed key record " + key);
+		try { iterations = static_cast<uint32_t>(stoul(fields[1])); }
+		catch (const exception&) { throw EncryptionError("Malformed key record " + key); }
+		salt = HexToBytes(fields[2]);
+		verifier = fields[3];
+	}
+	else if (!create)
+	{
+		return nullptr;
+	}
+	else
+	{
+		salt = RandomBytes(16);
+	}
+
+	string cacheKey = Sha256Hex(secret + '\0' + salt + '\0' + to_string(iterations));
+	shared_ptr<const EncryptionKeys> keys;
+	{
+		lock_guard<mutex> lock(g_keyCacheMutex);
+		auto it = g_keyCache.find(cacheKey);
+		if (it != g_keyCache.end()) keys = it->second;
+	}
+	if (!keys)
+	{
+		keys = make_shared<EncryptionKeys>(secret, salt, iterations);
+		lock_guard<mutex> lock(g_keyCacheMutex);
+		g_keyCache.emplace(cacheKey, keys);
+	}
+
+	if (verifier.empty())
+	{
+		// First encrypted backup of this game here: publish the salt; a concurrent writer wins
+		string record = string(kKeyRecordHeader) + "\npbkdf2-sha256\t" + to_string(iterations) + "\t" + ToHexString(salt) + "\t" + keys->Verifier() + "\n";
+		if (!backend.PutBytes(key, record, true)) return OpenStoredKeys(backend, gamePrefix, secret, false, iterations);
+	}
+	else if (verifier != keys->Verifier())
+	{
+		throw EncryptionError("Wrong passphrase or key file for the encrypted cloud backups of this game");
+	}
+	return keys;
+}
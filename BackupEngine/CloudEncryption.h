@@ -0,0 +1,139 @@
+#pragma once
+
+// Optional per-profile encryption of everything a chunk-store backup writes to the cloud
+// (chunks and manifests), with AES-256-GCM (AesGcm.h) in the STREAM construction. An object
+// is a header followed by 64 KiB segments, each with its own tag; the nonce holds the segment
+// number and a last-segment flag, so segments cannot be reordered, dropped or cut off without
+// the restore noticing:
+//
+//   object  = "GSBMENC1" | segment size (u32 LE) | object salt (16 random bytes) | segment...
+//   segment = ciphertext | tag (16)
+//   object key = HMAC-SHA256(data key, object salt), nonce = 0 (7 bytes) | segment (u32 BE) | last (1)
+//   associated data = the 28-byte header
+//
+// Keys come from the profile's passphrase or key file through PBKDF2-HMAC-SHA256. The salt,
+// iteration count and a verifier (to tell a wrong passphrase from damaged data) are stored
+// in "<id>/.gsbm-key" at the destination, so a restore on another machine needs only the secret.
+
+#include "AesGcm.h"
+#include "Config.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+class StorageBackend;
+
+class EncryptionError : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+class EncryptionKeys
+{
+public:
+	static constexpr uint32_t kDefaultIterations = 310000;
+
+	/**
+	 * @brief Derives the data, chunk-ID and verifier keys. Costs `iterations` HMACs; see OpenStoredKeys for caching.
+	 */
+	EncryptionKeys(std::string_view secret, std::string_view salt, uint32_t iterations);
+
+	// Whole objects, for chunks and manifests already in memory
+	std::string Encrypt(std::string_view plaintext) const;
+	std::string Decrypt(std::string_view object) const; // Throws EncryptionError if anything was altered
+
+	/**
+	 * @brief Pool name of a chunk: keyed hash of its plaintext digest, so the destination cannot
+	 * test whether it holds a known file.
+	 */
+	std::string ChunkId(const std::string& sha256Hex) const;
+
+	// Hex value stored in the key record
+	const std::string& Verifier() const { return m_verifier; }
+
+	const std::string& DataKey() const { return m_dataKey; }
+
+private:
+	std::string m_dataKey;
+	std::string m_idKey;
+	std::string m_verifier;
+};
+
+/**
+ * @brief True if `data` starts like an encrypted object.
+ */
+bool IsEncryptedObject(std::string_view data);
+
+class StreamEncryptor
+{
+public:
+	static constexpr size_t kHeaderSize = 28;
+	static constexpr size_t kSegmentSize = 64 * 1024;
+
+	explicit StreamEncryptor(const EncryptionKeys& keys, bool allowHardware = true);
+
+	// Written before the first segment
+	const std::string& Header() const { return m_header; }
+
+	/**
+	 * @brief Encrypts the next segment and appends ciphertext and tag to `out`. Every segment but
+	 * the last must be exactly kSegmentSize bytes; the last may be shorter or empty.
+	 */
+	void Segment(const char* data, size_t size, bool last, std::string& out);
+
+	bool Hardware() const { return m_aes.Hardware(); }
+
+private:
+	std::string m_header;
+	AesGcm m_aes;
+	uint32_t m_index = 0;
+	bool m_finished = false;
+};
+
+class StreamDecryptor
+{
+public:
+	/**
+	 * @brief Reads the header (the first kHeaderSize bytes). Throws EncryptionError if it is not one.
+	 */
+	StreamDecryptor(const EncryptionKeys& keys, std::string_view header, bool allowHardware = true);
+
+	size_t SegmentSize() const { return m_segmentSize; }
+
+	/**
+	 * @brief Checks and decrypts one segment (ciphertext followed by its tag) in place; the
+	 * plaintext is the first size - 16 bytes. Throws EncryptionError on a bad tag.
+	 */
+	void Segment(char* data, size_t size, bool last);
+
+private:
+	std::string m_header;
+	AesGcm m_aes;
+	size_t m_segmentSize = 0;
+	uint32_t m_index = 0;
+};
+
+/**
+ * @brief True if the profile has a passphrase or key file set, including a stored passphrase
+ * that could not be unsealed.
+ */
+bool IsEncryptionEnabled(const GameProfile& profile);
+
+/**
+ * @brief The profile's secret: the key file's contents if one is set, else the passphrase (UTF-8).
+ * Throws EncryptionError if the key file cannot be read or is empty, or if the stored passphrase
+ * could not be unsealed (GameProfile::unreadablePassphrase) and none was entered since.
+ */
+std::string GetProfileSecret(const GameProfile& profile);
+
+/**
+ * @brief Keys for a game's encrypted backups at a destination, from its key record
+ * ("<gamePrefix>.gsbm-key"). Derived keys are cached per process, so only the first call pays for PBKDF2.
+ * @param create Write a new record (fresh random salt) if there is none; otherwise return nullptr.
+ * Throws EncryptionError if the secret does not match the record, StorageError on I/O errors.
+ */
+std::shared_ptr<const EncryptionKeys> OpenStoredKeys(StorageBackend& backend, const std::string& gamePrefix, const std::string& secret, bool create, uint32_t iterations = EncryptionKeys::kDefaultIterations);
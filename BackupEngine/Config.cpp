@@ -0,0 +1,339 @@
+#include "Config.h"
+#include "IniFile.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <wincrypt.h>
+#pragma comment(lib, "Crypt32.lib")
+#endif
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	// Stored passphrases are sealed for the current Windows user with DPAPI, as "dpapi:<hex>".
+	// Other platforms have no such store and keep the passphrase as typed (use a key file there).
+	const wstring kSealedPrefix = L"dpapi:";
+#ifdef _WIN32
+	constexpr bool kCanSealSecrets = true;
+#else
+	constexpr bool kCanSealSecrets = false;
+#endif
+
+	bool IsSealed(const wstring& stored)
+	{
+		return stored.compare(0, kSealedPrefix.size(), kSealedPrefix) == 0;
+	}
+
+	wstring SealSecret(const wstring& secret)
+	{
+		if (!IsAcceptedPassphrase(secret)) throw invalid_argument("An encryption passphrase cannot start with \"dpapi:\"");
+		if (!kCanSealSecrets || secret.empty()) return secret;
+#ifdef _WIN32
+		DATA_BLOB in{ static_cast<DWORD>(secret.size() * sizeof(wchar_t)), reinterpret_cast<BYTE*>(const_cast<wchar_t*>(secret.data())) };
+		DATA_BLOB out{};
+		if (!CryptProtectData(&in, L"Game Save Backup Manager", nullptr, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &out))
+		{
+			throw runtime_error("Cannot protect the encryption passphrase"); // Never written in cleartext instead
+		}
+		wstringstream sealed;
+		sealed << kSealedPrefix << hex << setfill(L'0');
+		for (DWORD i = 0; i < out.cbData; ++i) sealed << setw(2) << static_cast<unsigned>(out.pbData[i]);
+		LocalFree(out.pbData);
+		return sealed.str();
+#else
+		return secret;
+#endif
+	}
+
+	// False if the value is sealed and cannot be unsealed here (another user or PC); `secret`
+	// is then empty. The sealed value itself is never used as a passphrase.
+	bool UnsealSecret(const wstring& stored, wstring& secret)
+	{
+		secret.clear();
+		if (!IsSealed(stored))
+		{
+			secret = stored;
+			return true;
+		}
+#ifdef _WIN32
+		string blob;
+		for (size_t i = kSealedPrefix.size(); i + 1 < stored.size(); i += 2)
+		{
+			try { blob.push_back(static_cast<char>(stoi(stored.substr(i, 2), nullptr, 16))); }
+			catch (const exception&) { return false; }
+		}
+		DATA_BLOB in{ static_cast<DWORD>(blob.size()), reinterpret_cast<BYTE*>(blob.data()) };
+		DATA_BLOB out{};
+		if (!CryptUnprotectData(&in, nullptr, nullptr, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &out)) return false;
+		secret.assign(reinterpret_cast<const wchar_t*>(out.pbData), out.cbData / sizeof(wchar_t));
+		SecureZeroMemory(out.pbData, out.cbData);
+		LocalFree(out.pbData);
+		return !secret.empty();
+#else
+		return false;
+#endif
+	}
+
+	void WriteProfileSection(IniDocument& ini, const GameProfile& profile)
+	{
+		if (profile.id.empty()) throw invalid_argument("Game profile has no ID");
+		ini.SetString(profile.id, L"Id", profile.id);
+		ini.SetString(profile.id, L"Name", profile.name);
+		ini.SetString(profile.id, L"SavePath", profile.savePath);
+		ini.SetString(profile.id, L"AutoSaveInterval", to_wstring(profile.autoSaveInterval)); // Save interval in seconds
+		ini.SetString(profile.id, L"CloudSaveEnabled", profile.cloudSaveEnabled ? L"1" : L"0"); // Save boolean as 1 or 0
+		ini.SetString(profile.id, L"AdaptiveAutoSave", profile.adaptiveAutoSave ? L"1" : L"0");
+		ini.SetString(profile.id, L"AutoSaveFloor", to_wstring(profile.autoSaveFloor)); // Seconds
+		if (!profile.legacyFolder.empty())
+		{
+			ini.SetString(profile.id, L"LegacyFolder", profile.legacyFolder);
+		}
+		else
+		{
+			ini.RemoveKey(profile.id, L"LegacyFolder"); // Migration finished
+		}
+		// Optional keys are only written when set, so profiles without them stay as before
+		auto setOptional = [&](const wchar_t* key, const wstring& value)
+			{
+				if (!value.empty()) ini.SetString(profile.id, key, value);
+				else ini.RemoveKey(profile.id, key);
+			};
+		// A passphrase that could not be unsealed is written back as it was found
+		setOptional(L"EncryptionPassphrase", profile.encryptionPassphrase.empty() ? profile.unreadablePassphrase : SealSecret(profile.encryptionPassphrase));
+		setOptional(L"EncryptionKeyFile", profile.encryptionKeyFile);
+		setOptional(L"GameExecutable", profile.gameExecutable);
+	}
+}
+
+/**
+ * @brief Loads global settings (limits, cloud path) and setup flags from Config.ini.
+ * Creates Config.ini with default flags if it doesn't exist.
+ * @param configFile Full path to Config.ini.
+ * @return The loaded settings (defaults for any missing key).
+ */
+GlobalSettings LoadGlobalConfig(const fs::path& configFile)
+{
+	// Create Config.ini with default setup flags if it doesn't exist
+	if (!fs::exists(configFile)) {
+		ofstream create_file(configFile);
+		if (create_file.is_open()) {
+			create_file << "[Setup]" << endl;
+			create_file << "GDriveSetupComplete=0" << endl; // Default to 0 (not complete)
+			create_file << "FirstGameAdded=0" << endl;      // Default to 0 (not complete)
+			create_file.close();
+		}
+		else {
+			throw runtime_error("Failed to create Config.ini");
+		}
+	}
+
+	// Parse once; every lookup below is a hash probe
+	IniDocument ini = IniDocument::Load(configFile);
+	GlobalSettings settings;
+	// Load settings from [GlobalSettings] section
+	settings.googleDrivePath = ini.GetString(L"GlobalSettings", L"GoogleDrivePath", L"");
+	settings.localAutoSaveLimit = ini.GetInt(L"GlobalSettings", L"LocalAutoSaveLimit", 20);
+	settings.localManualSaveLimit = ini.GetInt(L"GlobalSettings", L"LocalManualSaveLimit", 0);
+	settings.cloudAutoSaveLimit = ini.GetInt(L"GlobalSettings", L"CloudAutoSaveLimit", 10);
+	settings.cloudManualSaveLimit = ini.GetInt(L"GlobalSettings", L"CloudManualSaveLimit", 25);
+
+	// Load setup progress flags from [Setup] section
+	settings.gdriveSetupComplete = ini.GetInt(L"Setup", L"GDriveSetupComplete", 0) == 1;
+	settings.firstGameAdded = ini.GetInt(L"Setup", L"FirstGameAdded", 0) == 1;
+
+	// Load opt-in diagnostics from [Diagnostics] section
+	settings.traceEnabled = ini.GetInt(L"Diagnostics", L"TraceEnabled", 0) == 1;
+	settings.traceFileThresholdKb = ini.GetInt(L"Diagnostics", L"TraceFileThresholdKB", 1024);
+
+	// Load the cloud storage backend from [CloudStorage] section
+	settings.cloudBackend = ini.GetString(L"CloudStorage", L"Backend", L"sync-folder");
+	settings.s3Endpoint = ini.GetString(L"CloudStorage", L"S3Endpoint", L"");
+	settings.s3Bucket = ini.GetString(L"CloudStorage", L"S3Bucket", L"");
+	settings.s3Region = ini.GetString(L"CloudStorage", L"S3Region", L"us-east-1");
+	settings.s3AccessKey = ini.GetString(L"CloudStorage", L"S3AccessKey", L"");
+	settings.s3SecretKey = ini.GetString(L"CloudStorage", L"S3SecretKey", L"");
+	settings.s3PartSizeMb = ini.GetInt(L"CloudStorage", L"S3PartSizeMB", 8);
+	settings.s3Parallelism = ini.GetInt(L"CloudStorage", L"S3Parallelism", 4);
+	settings.cloudLayout = ini.GetString(L"CloudStorage", L"Layout", L"auto");
+	settings.packSmallFilesKb = ini.GetInt(L"CloudStorage", L"PackSmallFilesKB", 0);
+
+	// Load large-file copy tuning from [Performance] section
+	settings.largeFileThresholdMb = ini.GetInt(L"Performance", L"LargeFileThresholdMB", 64);
+	settings.directIo = ini.GetInt(L"Performance", L"DirectIo", 0) == 1;
+	settings.dropPageCache = ini.GetInt(L"Performance", L"DropPageCache", 1) == 1;
+	settings.deduplicateBackups = ini.GetInt(L"Performance", L"DeduplicateBackups", 0) == 1;
+	settings.loadDeferMaxSeconds = ini.GetInt(L"Performance", L"LoadDeferMaxSeconds", 300);
+	settings.cpuPressureLimit = ini.GetInt(L"Performance", L"CpuPressureLimit", 25);
+	settings.ioPressureLimit = ini.GetInt(L"Performance", L"IoPressureLimit", 25);
+	settings.batchBackupWorkers = ini.GetInt(L"Performance", L"BatchBackupWorkers", 4);
+	return settings;
+}
+
+/**
+ * @brief Saves global settings (limits, cloud path) and setup flags to Config.ini.
+ */
+void SaveGlobalConfig(const fs::path& configFile, const GlobalSettings& settings)
+{
+	IniDocument ini = IniDocument::Load(configFile);
+	// Save settings to [GlobalSettings] section
+	ini.SetString(L"GlobalSettings", L"GoogleDrivePath", settings.googleDrivePath);
+	ini.SetString(L"GlobalSettings", L"LocalAutoSaveLimit", to_wstring(settings.localAutoSaveLimit));
+	ini.SetString(L"GlobalSettings", L"LocalManualSaveLimit", to_wstring(settings.localManualSaveLimit));
+	ini.SetString(L"GlobalSettings", L"CloudAutoSaveLimit", to_wstring(settings.cloudAutoSaveLimit));
+	ini.SetString(L"GlobalSettings", L"CloudManualSaveLimit", to_wstring(settings.cloudManualSaveLimit));
+	// Save setup progress flags to [Setup] section
+	ini.SetString(L"Setup", L"GDriveSetupComplete", settings.gdriveSetupComplete ? L"1" : L"0");
+	ini.SetString(L"Setup", L"FirstGameAdded", settings.firstGameAdded ? L"1" : L"0");
+	// Save diagnostics to [Diagnostics] section
+	ini.SetString(L"Diagnostics", L"TraceEnabled", settings.traceEnabled ? L"1" : L"0");
+	ini.SetString(L"Diagnostics", L"TraceFileThresholdKB", to_wstring(settings.traceFileThresholdKb));
+	// Save the cloud storage backend to [CloudStorage] section
+	ini.SetString(L"CloudStorage", L"Backend", settings.cloudBackend);
+	ini.SetString(L"CloudStorage", L"S3Endpoint", settings.s3Endpoint);
+	ini.SetString(L"CloudStorage", L"S3Bucket", settings.s3Bucket);
+	ini.SetString(L"CloudStorage", L"S3Region", settings.s3Region);
+	ini.SetString(L"CloudStorage", L"S3AccessKey", settings.s3AccessKey);
+	ini.SetString(L"CloudStorage", L"S3SecretKey", settings.s3SecretKey);
+	ini.SetString(L"CloudStorage", L"S3PartSizeMB", to_wstring(settings.s3PartSizeMb));
+	ini.SetString(L"CloudStorage", L"S3Parallelism", to_wstring(settings.s3Parallelism));
+	ini.SetString(L"CloudStorage", L"Layout", settings.cloudLayout);
+	ini.SetString(L"CloudStorage", L"PackSmallFilesKB", to_wstring(settings.packSmallFilesKb));
+	// Save large-file copy tuning to [Performance] section
+	ini.SetString(L"Performance", L"LargeFileThresholdMB", to_wstring(settings.largeFileThresholdMb));
+	ini.SetString(L"Performance", L"DirectIo", settings.directIo ? L"1" : L"0");
+	ini.SetString(L"Performance", L"DropPageCache", settings.dropPageCache ? L"1" : L"0");
+	ini.SetString(L"Performance", L"DeduplicateBackups", settings.deduplicateBackups ? L"1" : L"0");
+	ini.SetString(L"Performance", L"LoadDeferMaxSeconds", to_wstring(settings.loadDeferMaxSeconds));
+	ini.SetString(L"Performance", L"CpuPressureLimit", to_wstring(settings.cpuPressureLimit));
+	ini.SetString(L"Performance", L"IoPressureLimit", to_wstring(settings.ioPressureLimit));
+	ini.SetString(L"Performance", L"BatchBackupWorkers", to_wstring(settings.batchBackupWorkers));
+	ini.Save(configFile); // One atomic write for all keys
+}
+
+/**
+ * @brief Returns a new random profile ID (16 lowercase hex digits).
+ */
+wstring GenerateProfileId()
+{
+	static mutex generatorMutex;
+	static mt19937_64 generator(random_device{}() ^ static_cast<uint64_t>(chrono::system_clock::now().time_since_epoch().count()));
+	lock_guard<mutex> lock(generatorMutex);
+	wostringstream id;
+	id << hex << setw(16) << setfill(L'0') << generator();
+	return id.str();
+}
+
+/**
+ * @brief Loads all game profiles from GameProfiles.ini.
+ * Creates an empty GameProfiles.ini if it doesn't exist.
+ * Pre-ID sections are given an ID and the file is rewritten once (see Config.h).
+ * @param profilesFile Full path to GameProfiles.ini.
+ * @return Profiles in file order; entries without a Name or SavePath are skipped.
+ */
+vector<GameProfile> LoadProfiles(const fs::path& profilesFile)
+{
+	vector<GameProfile> profiles;
+	// Create GameProfiles.ini if it doesn't exist
+	if (!fs::exists(profilesFile))
+	{
+		ofstream create_file(profilesFile);
+		create_file.close(); // Create empty file
+		return profiles;
+	}
+
+	// Parse once; with thousands of profiles this is one read instead of four per profile
+	IniDocument ini = IniDocument::Load(profilesFile);
+	vector<wstring> sectionNames = ini.SectionNames();
+	profiles.reserve(sectionNames.size());
+	ProfileIndex seen;
+	bool migrated = false;
+
+	// Each section name is a profile ID (or, before IDs existed, a game name)
+	for (const auto& sectionName : sectionNames)
+	{
+		GameProfile profile;
+		profile.id = ini.GetString(sectionName, L"Id", L"");
+		profile.name = ini.GetString(sectionName, L"Name", L"");
+		profile.savePath = ini.GetString(sectionName, L"SavePath", L"");
+		profile.autoSaveInterval = ini.GetInt(sectionName, L"AutoSaveInterval", 600); // Default 10 min (600s)
+		profile.cloudSaveEnabled = ini.GetInt(sectionName, L"CloudSaveEnabled", 0) == 1; // Default 0 (false)
+		profile.adaptiveAutoSave = ini.GetInt(sectionName, L"AdaptiveAutoSave", 0) == 1;
+		profile.autoSaveFloor = ini.GetInt(sectionName, L"AutoSaveFloor", 60);
+		profile.legacyFolder = ini.GetString(sectionName, L"LegacyFolder", L"");
+		wstring storedPassphrase = ini.GetString(sectionName, L"EncryptionPassphrase", L"");
+		if (!UnsealSecret(storedPassphrase, profile.encryptionPassphrase)) profile.unreadablePassphrase = storedPassphrase;
+		if (kCanSealSecrets && !storedPassphrase.empty() && !IsSealed(storedPassphrase)) migrated = true; // Cleartext from an older version
+		profile.encryptionKeyFile = ini.GetString(sectionName, L"EncryptionKeyFile", L"");
+		profile.gameExecutable = ini.GetString(sectionName, L"GameExecutable", L"");
+
+		// Add profile only if Name and SavePath were successfully read
+		if (profile.name.empty() || profile.savePath.empty()) continue;
+		if (profile.id.empty())
+		{
+			// Pre-ID section: its backups live in a folder named after the section
+			profile.id = GenerateProfileId();
+			profile.legacyFolder = sectionName;
+			migrated = true;
+		}
+		if (!seen.emplace(profile.id, profiles.size()).second) continue; // Duplicate section, first wins
+		profiles.push_back(profile);
+	}
+
+	if (migrated) SaveProfiles(profilesFile, profiles); // One-time rewrite to ID-keyed sections and sealed passphrases
+	return profiles;
+}
+
+/**
+ * @brief Saves a single game profile's details to GameProfiles.ini under a section named after its ID.
+ * Renaming a game only changes the Name key; the section and backup folders stay the same.
+ */
+void SaveProfile(const fs::path& profilesFile, const GameProfile& profile)
+{
+	IniDocument ini = IniDocument::Load(profilesFile);
+	WriteProfileSection(ini, profile);
+	ini.Save(profilesFile); // One atomic write for the whole profile
+}
+
+bool IsAcceptedPassphrase(const wstring& passphrase)
+{
+	return !IsSealed(passphrase);
+}
+
+/**
+ * @brief Rewrites GameProfiles.ini with exactly these profiles, in order.
+ */
+void SaveProfiles(const fs::path& profilesFile, const vector<GameProfile>& profiles)
+{
+	IniDocument ini;
+	for (const auto& profile : profiles) WriteProfileSection(ini, profile);
+	ini.Save(profilesFile);
+}
+
+/**
+ * @brief Deletes a specific game's section from GameProfiles.ini.
+ */
+void DeleteProfileIniEntry(const fs::path& profilesFile, const wstring& profileId)
+{
+	DeleteIniSection(profilesFile, profileId);
+}
+
+ProfileIndex BuildProfileIndex(const vector<GameProfile>& profiles)
+{
+	ProfileIndex index;
+	index.reserve(profiles.size());
+	for (size_t i = 0; i < profiles.size(); ++i) index.emplace(profiles[i].id, i);
+	return index;
+}
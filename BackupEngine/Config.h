@@ -0,0 +1,135 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Struct to hold all information for a single game profile
+struct GameProfile
+{
+	std::wstring name;              // Display name; renaming only rewrites this field
+	std::wstring savePath;
+	int autoSaveInterval = 600; // Stored in seconds
+	bool cloudSaveEnabled = false;
+	std::wstring id;                // Immutable; names the INI section and the backup folders
+	std::wstring legacyFolder;      // Name-based backup folder still to be moved to <id> (pre-ID configs)
+	// Cloud encryption (CloudEncryption.h): a key file wins over a passphrase; both empty = off.
+	// The passphrase is stored sealed with DPAPI on Windows (see SaveProfile).
+	std::wstring encryptionPassphrase;
+	std::wstring encryptionKeyFile;
+	// Sealed passphrase this Windows user cannot open (another user or PC). Kept in the file,
+	// and the game's cloud backups fail until a passphrase is entered again.
+	std::wstring unreadablePassphrase;
+	// Adaptive auto-save (AdaptiveAutoSave.h): back up when the save changes, at most every
+	// autoSaveFloor seconds; autoSaveInterval is then the longest wait
+	bool adaptiveAutoSave = false;
+	int autoSaveFloor = 60;
+	// Game executable file name (ProcessWatcher.h): auto-saves only while it runs, and a backup
+	// when it exits. Empty = back up on schedule whether the game runs or not.
+	std::wstring gameExecutable;
+};
+
+// Profile ID -> position in the loaded profile list
+using ProfileIndex = std::unordered_map<std::wstring, size_t>;
+
+// Global settings stored in Config.ini
+struct GlobalSettings
+{
+	std::wstring googleDrivePath;    // Cloud sync root, empty if not configured
+	int localAutoSaveLimit = 20;
+	int localManualSaveLimit = 0;    // 0 means keep all
+	int cloudAutoSaveLimit = 10;
+	int cloudManualSaveLimit = 25;   // 0 means keep all
+	bool gdriveSetupComplete = false; // Tracks if initial GDrive setup prompt was shown
+	bool firstGameAdded = false;      // Tracks if the first game has been added
+	bool traceEnabled = false;        // Write a Chrome trace of backup stages to Logs\trace-*.json
+	int traceFileThresholdKb = 1024;  // Files at least this large get their own trace span
+
+	// [CloudStorage]: where cloud copies go. "sync-folder" (default) and "local" use googleDrivePath;
+	// "s3" uploads to an S3-compatible object store instead.
+	std::wstring cloudBackend = L"sync-folder";
+	std::wstring s3Endpoint;          // e.g. http://127.0.0.1:9000
+	std::wstring s3Bucket;
+	std::wstring s3Region = L"us-east-1";
+	std::wstring s3AccessKey;
+	std::wstring s3SecretKey;
+	int s3PartSizeMb = 8;             // Multipart chunk size (minimum 5)
+	int s3Parallelism = 4;            // Concurrent uploads
+	// "chunks": content-addressed chunk pool plus a manifest per backup (only changed data is
+	// uploaded); "folders": one plain copy per backup; "auto": chunks for s3, folders otherwise
+	std::wstring cloudLayout = L"auto";
+	// "folders" layout: files smaller than this many KB are stored together in a few pack files
+	// (PackStore.h), so sync clients handle a handful of files instead of thousands. 0: off.
+	int packSmallFilesKb = 0;
+
+	// [Performance]: files at least largeFileThresholdMb in size are copied through large
+	// aligned buffers (FileCopy.h) instead of fs::copy_file
+	int largeFileThresholdMb = 64;
+	bool directIo = false;            // Bypass the page cache entirely (where the file system supports it)
+	bool dropPageCache = true;        // Otherwise drop copied pages from the cache as the copy goes
+	// Hard-link identical files of all games' local backups to one shared copy (ContentStore.h)
+	bool deduplicateBackups = false;
+	// Auto-saves wait while the system is busy (SystemLoad.h): CPU or I/O pressure above these
+	// percentages, for at most loadDeferMaxSeconds (0: never wait). Manual backups never wait.
+	int loadDeferMaxSeconds = 300;
+	int cpuPressureLimit = 25;
+	int ioPressureLimit = 25;
+	// Profiles backed up at the same time by "Back Up All Games" (BatchBackup.h)
+	int batchBackupWorkers = 4;
+};
+
+/**
+ * @brief Loads global settings and setup flags from Config.ini.
+ * Creates Config.ini with default setup flags if it doesn't exist.
+ * Throws std::runtime_error if the file cannot be created.
+ */
+GlobalSettings LoadGlobalConfig(const std::filesystem::path& configFile);
+
+/**
+ * @brief Saves global settings and setup flags to Config.ini.
+ */
+void SaveGlobalConfig(const std::filesystem::path& configFile, const GlobalSettings& settings);
+
+/**
+ * @brief Returns a new random profile ID (16 lowercase hex digits).
+ */
+std::wstring GenerateProfileId();
+
+/**
+ * @brief Loads all game profiles from GameProfiles.ini.
+ * Creates an empty GameProfiles.ini if it doesn't exist. Sections written before profile IDs
+ * existed (keyed by game name) get a new ID and are rewritten once, with legacyFolder set so
+ * their backup folders can be moved by MigrateLegacyBackupFolders. On Windows, a cleartext
+ * EncryptionPassphrase from an older version is sealed by the same one-time rewrite.
+ */
+std::vector<GameProfile> LoadProfiles(const std::filesystem::path& profilesFile);
+
+/**
+ * @brief Saves a single game profile's details under a section named after its ID.
+ * On Windows, EncryptionPassphrase is sealed for the current user with DPAPI ("dpapi:<hex>"),
+ * so it is never in the file in cleartext; elsewhere it is stored as is.
+ * Throws std::invalid_argument if the profile has no ID or its passphrase is not accepted
+ * (IsAcceptedPassphrase).
+ */
+void SaveProfile(const std::filesystem::path& profilesFile, const GameProfile& profile);
+
+/**
+ * @brief False for a passphrase starting with "dpapi:", which would read back as a sealed one.
+ */
+bool IsAcceptedPassphrase(const std::wstring& passphrase);
+
+/**
+ * @brief Rewrites GameProfiles.ini with exactly these profiles, in order, in one atomic write.
+ */
+void SaveProfiles(const std::filesystem::path& profilesFile, const std::vector<GameProfile>& profiles);
+
+/**
+ * @brief Deletes a specific game's section from GameProfiles.ini.
+ */
+void DeleteProfileIniEntry(const std::filesystem::path& profilesFile, const std::wstring& profileId);
+
+/**
+ * @brief Builds the ID lookup for a profile list. Rebuild it whenever the list is reloaded.
+ */
+ProfileIndex BuildProfileIndex(const std::vector<GameProfile>& profiles);
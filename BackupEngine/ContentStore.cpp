@@ -0,0 +1,264 @@
+#include "ContentStore.h"
+#include "Config.h"
+#include "EngineUtils.h"
+#include "Trace.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	string ShardName(unsigned shard)
+	{
+		char name[3];
+		snprintf(name, sizeof(name), "%02x", shard % kContentStoreShards);
+		return name;
+	}
+
+	unsigned LoadCursor(const fs::path& file)
+	{
+		ifstream in(file);
+		unsigned shard = 0;
+		if (!(in >> shard) || shard >= kContentStoreShards) return 0;
+		return shard;
+	}
+
+	void SaveCursor(const fs::path& file, unsigned shard)
+	{
+		// Written aside and renamed, so an interrupted write cannot leave a bad cursor. The name
+		// is unique, so another program instance sweeping the same store never shares the file.
+		fs::path partial = file;
+		partial += "." + ws2s(GenerateProfileId()) + ".partial";
+		{
+			ofstream out(partial, ios::trunc);
+			out << shard << '\n';
+			if (!out.flush()) return;
+		}
+		error_code ec;
+		fs::rename(partial, file, ec);
+	}
+
+	// Background mode for the collector's thread: lowest CPU priority, idle I/O priority
+	void LowerThreadPriority()
+	{
+#ifdef _WIN32
+		SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#else
+		setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19); // Per thread on Linux
+#ifdef SYS_ioprio_set
+		const int ioprioWhoProcess = 1, ioprioClassIdle = 3, ioprioClassShift = 13;
+		syscall(SYS_ioprio_set, ioprioWhoProcess, 0, ioprioClassIdle << ioprioClassShift); // 0: this thread
+#endif
+#endif
+	}
+
+	// Runs queued sweeps one after another on its own thread, started when there is work and
+	// ending when there is none
+	class ContentSweeper
+	{
+	public:
+		~ContentSweeper()
+		{
+			Wait();
+			if (m_thread.joinable()) m_thread.join();
+		}
+
+		void Schedule(const fs::path& backupsRoot, unsigned maxShards, function<void(const ContentSweepStats&)> onSwept)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			for (const auto& queued : m_queue)
+			{
+				if (queued.backupsRoot == backupsRoot) return; // Not started yet: it covers this one
+			}
+			m_queue.push_back({ backupsRoot, maxShards, move(onSwept) });
+			if (m_running) return;
+			if (m_thread.joinable()) m_thread.join(); // Finished: it ran out of work
+			m_running = true;
+			m_thread = thread([this] { Run(); });
+		}
+
+		void Wait()
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_idle.wait(lock, [this] { return !m_running; });
+		}
+
+	private:
+		struct Request
+		{
+			fs::path backupsRoot;
+			unsigned maxShards;
+			function<void(const ContentSweepStats&)> onSwept;
+		};
+
+		void Run()
+		{
+			LowerThreadPriority();
+			unique_lock<mutex> lock(m_mutex);
+			while (!m_queue.empty())
+			{
+				Request request = move(m_queue.front());
+				m_queue.pop_front();
+				lock.unlock();
+				try {
+					ContentSweepStats stats = SweepContentStore(request.backupsRoot, request.maxShards);
+					if (request.onSwept) request.onSwept(stats);
+				}
+				catch (const exception&) {} // The next sweep starts from the saved cursor
+				lock.lock();
+			}
+			m_running = false;
+			m_idle.notify_all();
+		}
+
+		mutex m_mutex;
+		condition_variable m_idle;
+		deque<Request> m_queue;
+		bool m_running = false;
+		thread m_thread;
+	};
+
+	ContentSweeper& GetContentSweeper()
+	{
+		static ContentSweeper sweeper;
+		return sweeper;
+	}
+}
+
+fs::path GetContentStorePath(const fs::path& backupsRoot, const ManifestEntry& entry)
+{
+	return backupsRoot / fs::u8path(kContentStoreFolder) / fs::u8path(entry.sha256.substr(0, 2)) / fs::u8path(entry.sha256 + "-" + to_string(entry.size));
+}
+
+DedupStats DeduplicateBackup(const fs::path& backupsRoot, const fs::path& backupDir, const BackupManifest& index)
+{
+	TraceSpan span("dedup");
+	DedupStats stats;
+	fs::path staging = backupsRoot / fs::u8path(kContentStoreFolder) / "staging";
+	error_code ec;
+	fs::create_directories(staging, ec);
+	if (ec) return stats;
+
+	// Unique among concurrent backups of any game
+	static atomic<uint64_t> s_sequence{ 0 };
+	string tag = ws2s(GenerateProfileId());
+
+	for (const auto& entry : index.entries)
+	{
+		if (entry.type != fs::file_type::regular || entry.size == 0 || entry.sha256.size() < 2) continue;
+		fs::path file = backupDir / fs::u8path(entry.path);
+		fs::path shared = GetContentStorePath(backupsRoot, entry);
+
+		if (fs::exists(shared, ec))
+		{
+			if (fs::equivalent(shared, file, ec)) continue; // Already linked
+			// The digest was taken while this copy was written (CopyScannedTree), so digest and size
+			// name its contents; a store file of another size is damaged and this copy is kept
+			if (fs::file_size(shared, ec) != entry.size || ec) continue;
+
+			// Linked aside, then renamed over the backup's copy, so the file is never missing
+			fs::path temp = staging / (tag + "-" + to_string(s_sequence++));
+			fs::create_hard_link(shared, temp, ec);
+			if (!ec)
+			{
+				fs::rename(temp, file, ec);
+				if (!ec)
+				{
+					stats.filesLinked++;
+					stats.bytesSaved += entry.size;
+					continue;
+				}
+				error_code ignored;
+				fs::remove(temp, ignored);
+				continue; // e.g. a read-only file on Windows
+			}
+			// Swept meanwhile, or at the file system's link limit: this copy takes its place
+			fs::remove(shared, ec);
+		}
+
+		fs::create_directories(shared.parent_path(), ec);
+		fs::create_hard_link(file, shared, ec);
+		if (!ec) stats.filesAdded++;
+	}
+	if (span.Active()) span.SetArgs("\"linked\": " + to_string(stats.filesLinked) + ", \"added\": " + to_string(stats.filesAdded));
+	return stats;
+}
+
+ContentSweepStats SweepContentStore(const fs::path& backupsRoot, unsigned maxShards)
+{
+	ContentSweepStats stats;
+	fs::path store = backupsRoot / fs::u8path(kContentStoreFolder);
+	error_code ec;
+	if (!fs::is_directory(store, ec)) return stats;
+
+	// Concurrent backups (BackupAllProfiles) would otherwise sweep the same shards and overwrite
+	// each other's cursor; the one already sweeping covers for the others
+	static mutex s_sweepMutex;
+	unique_lock<mutex> lock(s_sweepMutex, try_to_lock);
+	if (!lock.owns_lock()) return stats;
+	TraceSpan span("content_sweep");
+
+	fs::path cursorFile = store / "sweep-cursor";
+	unsigned shard = LoadCursor(cursorFile);
+	for (unsigned i = 0; i < maxShards && i < kContentStoreShards; ++i)
+	{
+		for (const auto& entry : fs::directory_iterator(store / ShardName(shard), ec))
+		{
+			error_code fileError;
+			uintmax_t size = entry.file_size(fileError);
+			// Linked from no backup. A backup linking it right now keeps its own link either way.
+			if (!fileError && fs::hard_link_count(entry.path(), fileError) == 1 && !fileError && fs::remove(entry.path(), fileError))
+			{
+				stats.filesRemoved++;
+				stats.bytesFreed += size;
+			}
+		}
+		shard = (shard + 1) % kContentStoreShards;
+		SaveCursor(cursorFile, shard);
+		stats.shardsSwept++;
+
+		if (shard == 0)
+		{
+			// Links left by interrupted backups. One being renamed right now fails and that
+			// backup keeps its own copy of the file.
+			for (const auto& entry : fs::directory_iterator(store / "staging", ec))
+			{
+				error_code fileError;
+				fs::remove(entry.path(), fileError);
+			}
+			stats.passCompleted = true;
+		}
+	}
+	if (span.Active()) span.SetArgs("\"shards\": " + to_string(stats.shardsSwept) + ", \"removed\": " + to_string(stats.filesRemoved));
+	return stats;
+}
+
+void ScheduleContentSweep(const fs::path& backupsRoot, unsigned maxShards, function<void(const ContentSweepStats&)> onSwept)
+{
+	GetContentSweeper().Schedule(backupsRoot, maxShards, move(onSwept));
+}
+
+void WaitForContentSweeps()
+{
+	GetContentSweeper().Wait();
+}
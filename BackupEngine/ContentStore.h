@@ -0,0 +1,89 @@
+#pragma once
+
+// Shared content store for local backups. Every profile's backups are full folder copies, so
+// unchanged files, games on the same engine and profiles pointing at similar save folders keep
+// many identical files. With [Performance] DeduplicateBackups=1, each finished backup's files are
+// hard-linked with one shared copy per distinct file:
+//
+//   <backups root>/.content/<2 hex>/<sha256>-<size>       one link per distinct file
+//   <backups root>/.content/staging/                      links on their way into a backup
+//   <backups root>/.content/sweep-cursor                  next shard the collector visits
+//
+// Backups stay plain folders that every other part of the program reads as before. Files are
+// shared by content alone, so the same file in two games, two profiles or two backups saved at
+// different times has one copy. Files are identified by the digest taken while the backup copied
+// them, and their size, so linking reads nothing more. Links share
+// one modification time, that of the first backup to store the file, so a linked backup file can
+// carry an older time than the save it came from. The backup index keeps the original, and
+// RestoreBackup and RestoreSelectedFiles set it on the restored files.
+//
+// The link counts are the reference counts: a store file whose only link is its own belongs to
+// no backup any more. SweepContentStore removes those a few shards at a time, without locks.
+// Backups running meanwhile lose at most a chance to share a file (a removed store file never
+// takes data from a backup, which holds its own link), and an interrupted sweep continues from
+// the saved cursor.
+
+#include "Manifest.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+// Folder under the backups root
+inline const std::string kContentStoreFolder = ".content";
+
+// Shards per pass of the collector (the first byte of the digest)
+inline constexpr unsigned kContentStoreShards = 256;
+
+// Shards swept in the background after each backup (BackupSaveFolder): a full pass every 8 backups
+inline constexpr unsigned kSweepShardsPerBackup = 32;
+
+struct DedupStats
+{
+	uint64_t filesLinked = 0; // Backup files replaced by a link to an identical shared file
+	uint64_t bytesSaved = 0;
+	uint64_t filesAdded = 0;  // Backup files that became the shared copy
+};
+
+struct ContentSweepStats
+{
+	uint64_t filesRemoved = 0;
+	uint64_t bytesFreed = 0;
+	unsigned shardsSwept = 0;
+	bool passCompleted = false; // The sweep reached the last shard
+};
+
+/**
+ * @brief "<backupsRoot>/.content/<2 hex>/<sha256>-<size>" for a manifest entry with a digest.
+ */
+std::filesystem::path GetContentStorePath(const std::filesystem::path& backupsRoot, const ManifestEntry& entry);
+
+/**
+ * @brief Links the regular files of a finished backup (its index, with the digests taken during
+ * the copy) to the shared store: a file with the digest and size of a stored one is replaced by a link to it, any other becomes the
+ * stored copy. Files that cannot be linked (other volume, link limit, read-only) keep their own
+ * copy. Never throws for a single file.
+ */
+DedupStats DeduplicateBackup(const std::filesystem::path& backupsRoot, const std::filesystem::path& backupDir, const BackupManifest& index);
+
+/**
+ * @brief One incremental step of the collector: visits up to `maxShards` shards from the saved
+ * cursor and removes stored files no backup links to any more. Clears the staging folder at the
+ * end of each pass. Safe to run alongside backups. Only one sweep runs at a time in a process:
+ * while one is running (another game's backup), this returns at once with nothing swept.
+ */
+ContentSweepStats SweepContentStore(const std::filesystem::path& backupsRoot, unsigned maxShards = kContentStoreShards);
+
+/**
+ * @brief Queues SweepContentStore(backupsRoot, maxShards) on the collector's own thread, which
+ * runs at background CPU and I/O priority, and returns at once. A request for a root that is
+ * still queued is dropped (the queued one covers it). `onSwept` gets the result on that thread.
+ */
+void ScheduleContentSweep(const std::filesystem::path& backupsRoot, unsigned maxShards = kSweepShardsPerBackup,
+	std::function<void(const ContentSweepStats&)> onSwept = nullptr);
+
+/**
+ * @brief Waits until every queued sweep has run (before exiting, and in tests).
+ */
+void WaitForContentSweeps();
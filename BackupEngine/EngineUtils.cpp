@@ -0,0 +1,334 @@
+#include "EngineUtils.h"
+
+#include <algorithm> // For std::transform
+#include <atomic>
+#include <chrono>
+#include <cwctype>   // For towupper
+#include <exception>
+#include <iomanip>   // For std::setw
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+/**
+ * @brief Converts a UTF-8 string to a wide string.
+ * Invalid sequences are replaced with U+FFFD instead of aborting the conversion.
+ * @param str The input UTF-8 string.
+ * @return The converted wide string.
+ */
+wstring s2ws(const string& str)
+{
+	wstring out;
+	out.reserve(str.size());
+	size_t i = 0;
+	while (i < str.size())
+	{
+		unsigned char c = static_cast<unsigned char>(str[i]);
+		char32_t cp = 0;
+		size_t extra = 0;
+		if (c < 0x80) { cp = c; }
+		else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; extra = 1; }
+		else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; extra = 2; }
+		else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; extra = 3; }
+		else { out.push_back(L'\xFFFD'); ++i; continue; } // Stray continuation byte
+
+		if (i + extra >= str.size() && extra > 0)
+		{
+			out.push_back(L'\xFFFD'); // Truncated sequence at end of input
+			break;
+		}
+		bool valid = true;
+		for (size_t k = 1; k <= extra; ++k)
+		{
+			unsigned char cc = static_cast<unsigned char>(str[i + k]);
+			if ((cc & 0xC0) != 0x80) { valid = false; break; }
+			cp = (cp << 6) | (cc & 0x3F);
+		}
+		if (!valid)
+		{
+			out.push_back(L'\xFFFD');
+			++i;
+			continue;
+		}
+		i += extra + 1;
+
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			if (cp >= 0x10000) // Encode as a UTF-16 surrogate pair
+			{
+				cp -= 0x10000;
+				out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+				out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+				continue;
+			}
+		}
+		out.push_back(static_cast<wchar_t>(cp));
+	}
+	return out;
+}
+
+/**
+ * @brief Converts a wide string to a UTF-8 string.
+ * @param wstr The input wide string.
+ * @return The converted UTF-8 string.
+ */
+string ws2s(const wstring& wstr)
+{
+	string out;
+	out.reserve(wstr.size());
+	for (size_t i = 0; i < wstr.size(); ++i)
+	{
+		char32_t cp = static_cast<char32_t>(wstr[i]);
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			// Combine UTF-16 surrogate pairs
+			if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < wstr.size())
+			{
+				char32_t low = static_cast<char32_t>(wstr[i + 1]);
+				if (low >= 0xDC00 && low <= 0xDFFF)
+				{
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+					++i;
+				}
+			}
+		}
+
+		if (cp < 0x80) out.push_back(static_cast<char>(cp));
+		else if (cp < 0x800)
+		{
+			out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+			out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+		}
+		else if (cp < 0x10000)
+		{
+			out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+			out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+		}
+		else
+		{
+			out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+			out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+		}
+	}
+	return out;
+}
+
+fs::path ToPath(const wstring& str)
+{
+#ifdef _WIN32
+	return fs::path(str); // Native wide paths, no conversion needed
+#else
+	return fs::u8path(ws2s(str));
+#endif
+}
+
+wstring PathToWide(const fs::path& path)
+{
+#ifdef _WIN32
+	return path.wstring();
+#else
+	return s2ws(path.u8string());
+#endif
+}
+
+bool endsWith(const wstring& str, const wstring& suffix)
+{
+	if (str.length() < suffix.length()) {
+		return false;
+	}
+	return str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
+}
+
+/**
+ * @brief Checks if a given wide string is a valid filename/directory name on Windows,
+ * excluding reserved characters and names.
+ * @param name The wide string name to check.
+ * @return True if valid, False otherwise.
+ */
+bool IsValidFilename(const wstring& name)
+{
+	if (name.empty()) // Cannot be empty
+	{
+		return false;
+	}
+	// Check for invalid characters
+	for (wchar_t c : name)
+	{
+		// Characters forbidden in Windows filenames/paths
+		if (c == L'<' || c == L'>' || c == L':' || c == L'"' || c == L'/' || c == L'\\' || c == L'|' || c == L'?' || c == L'*')
+		{
+			return false;
+		}
+		// ASCII Control characters (0-31) are also invalid
+		if (c < 32) return false;
+	}
+	// Check for reserved filenames (case-insensitive)
+	wstring upperName = name;
+	transform(upperName.begin(), upperName.end(), upperName.begin(), [](wchar_t c) { return static_cast<wchar_t>(towupper(c)); });
+	// Standard reserved names
+	if (upperName == L"CON" || upperName == L"PRN" || upperName == L"AUX" || upperName == L"NUL" ||
+		// COM1-COM9
+		(upperName.length() == 4 && upperName.substr(0, 3) == L"COM" && upperName[3] >= L'1' && upperName[3] <= L'9') ||
+		// LPT1-LPT9
+		(upperName.length() == 4 && upperName.substr(0, 3) == L"LPT" && upperName[3] >= L'1' && upperName[3] <= L'9')) {
+		return false;
+	}
+	// Check for trailing spaces or dots, which are problematic
+	if (name.back() == L' ' || name.back() == L'.') {
+		return false;
+	}
+
+	// If none of the checks failed, the name is valid
+	return true;
+}
+
+tm LocalTime(time_t t)
+{
+	tm ltm{};
+#ifdef _WIN32
+	localtime_s(&ltm, &t);
+#else
+	localtime_r(&t, &ltm);
+#endif
+	return ltm;
+}
+
+/**
+ * @brief Gets the current date and time formatted as "YYYY-MM-DD HH:MM:SS".
+ * @return Formatted date/time string.
+ */
+string GetCurrentDateTime()
+{
+	tm ltm = LocalTime(time(nullptr));
+	stringstream ss;
+	ss << (1900 + ltm.tm_year) << "-" // Year is years since 1900
+		<< setfill('0') << setw(2) << (1 + ltm.tm_mon) << "-" // Month is 0-11
+		<< setfill('0') << setw(2) << ltm.tm_mday << " "
+		<< setfill('0') << setw(2) << ltm.tm_hour << ":"
+		<< setfill('0') << setw(2) << ltm.tm_min << ":"
+		<< setfill('0') << setw(2) << ltm.tm_sec;
+	return ss.str();
+}
+
+wstring FormatFolderDateTime(time_t t)
+{
+	tm ltm = LocalTime(t);
+	wchar_t timeBuffer[100];
+	wcsftime(timeBuffer, 100, L"%Y-%m-%d_%H-%M-%S", &ltm);
+	return timeBuffer;
+}
+
+string EscapeTabField(const string& text)
+{
+	string out;
+	out.reserve(text.size());
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '\\': out += "\\\\"; break;
+		case '\t': out += "\\t"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		default: out += c;
+		}
+	}
+	return out;
+}
+
+string UnescapeTabField(const string& text)
+{
+	string out;
+	out.reserve(text.size());
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		if (text[i] != '\\' || i + 1 == text.size())
+		{
+			out += text[i];
+			continue;
+		}
+		char c = text[++i];
+		out += c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+	}
+	return out;
+}
+
+vector<string> SplitTabFields(const string& line)
+{
+	vector<string> fields;
+	size_t start = 0;
+	while (true)
+	{
+		size_t tab = line.find('\t', start);
+		fields.push_back(line.substr(start, tab == string::npos ? string::npos : tab - start));
+		if (tab == string::npos) return fields;
+		start = tab + 1;
+	}
+}
+
+namespace
+{
+	// Unix epoch minus the file clock's epoch. Both clocks tick together and the epochs differ by
+	// whole seconds (1601 on Windows, 2174 in libstdc++), so rounding one sample gives it exactly.
+	chrono::nanoseconds FileClockUnixOffset()
+	{
+		static const chrono::nanoseconds offset = []
+			{
+				auto fileNow = fs::file_time_type::clock::now().time_since_epoch();
+				auto systemNow = chrono::system_clock::now().time_since_epoch();
+				auto difference = chrono::duration_cast<chrono::nanoseconds>(fileNow) - chrono::duration_cast<chrono::nanoseconds>(systemNow);
+				return chrono::duration_cast<chrono::nanoseconds>(chrono::round<chrono::seconds>(difference));
+			}();
+		return offset;
+	}
+}
+
+int64_t FileTimeToUnixNanos(fs::file_time_type time)
+{
+	return (chrono::duration_cast<chrono::nanoseconds>(time.time_since_epoch()) - FileClockUnixOffset()).count();
+}
+
+fs::file_time_type UnixNanosToFileTime(int64_t nanos)
+{
+	auto sinceFileEpoch = chrono::nanoseconds(nanos) + FileClockUnixOffset();
+	return fs::file_time_type(chrono::duration_cast<fs::file_time_type::duration>(sinceFileEpoch));
+}
+
+void ParallelFor(size_t count, int threads, const function<void(size_t)>& work)
+{
+	atomic<size_t> next{ 0 };
+	atomic<bool> failed{ false };
+	exception_ptr firstError;
+	mutex errorMutex;
+	auto worker = [&]
+		{
+			while (!failed.load(memory_order_relaxed))
+			{
+				size_t i = next.fetch_add(1, memory_order_relaxed);
+				if (i >= count) return;
+				try
+				{
+					work(i);
+				}
+				catch (...)
+				{
+					lock_guard<mutex> lock(errorMutex);
+					if (!firstError) firstError = current_exception();
+					failed.store(true, memory_order_relaxed);
+				}
+			}
+		};
+	size_t workerCount = min(count, static_cast<size_t>(max(1, threads)));
+	vector<thread> pool;
+	for (size_t t = 1; t < workerCount; ++t) pool.emplace_back(worker);
+	worker(); // The calling thread works too
+	for (auto& t : pool) t.join();
+	if (firstError) rethrow_exception(firstError);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Portable helpers shared by the backup engine and the console front-end.
+// Everything here compiles on both Windows (MSVC) and Linux (GCC/Clang).
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Converts a UTF-8 string to a wide string (UTF-16 on Windows, UTF-32 elsewhere).
+ */
+std::wstring s2ws(const std::string& str);
+
+/**
+ * @brief Converts a wide string to a UTF-8 string.
+ */
+std::string ws2s(const std::wstring& wstr);
+
+/**
+ * @brief Builds a filesystem path from a wide string without depending on the C locale.
+ * On Linux, libstdc++ converts wide paths through the global locale, which fails for
+ * non-ASCII names under the default "C" locale, so we always go through UTF-8.
+ */
+std::filesystem::path ToPath(const std::wstring& str);
+
+/**
+ * @brief Returns the wide-string form of a path (inverse of ToPath).
+ */
+std::wstring PathToWide(const std::filesystem::path& path);
+
+/**
+ * @brief Checks if a wide string ends with a specific suffix (case-sensitive).
+ */
+bool endsWith(const std::wstring& str, const std::wstring& suffix);
+
+/**
+ * @brief Checks if a given wide string is a valid filename/directory name on Windows,
+ * excluding reserved characters and names. Applied on every platform so that profiles
+ * created on Linux stay usable on Windows.
+ */
+bool IsValidFilename(const std::wstring& name);
+
+/**
+ * @brief Thread-safe localtime wrapper (localtime_s on Windows, localtime_r elsewhere).
+ */
+std::tm LocalTime(std::time_t t);
+
+/**
+ * @brief Gets the current date and time formatted as "YYYY-MM-DD HH:MM:SS".
+ */
+std::string GetCurrentDateTime();
+
+/**
+ * @brief Formats a time as "YYYY-MM-DD_HH-MM-SS" (safe for folder names).
+ */
+std::wstring FormatFolderDateTime(std::time_t t);
+
+/**
+ * @brief Escapes backslash, tab, CR and LF, so a value (a file path) fits in one tab-separated field.
+ */
+std::string EscapeTabField(const std::string& text);
+
+/**
+ * @brief Inverse of EscapeTabField.
+ */
+std::string UnescapeTabField(const std::string& text);
+
+/**
+ * @brief Splits a line on tabs (empty fields kept).
+ */
+std::vector<std::string> SplitTabFields(const std::string& line);
+
+/**
+ * @brief Converts a file time to nanoseconds since the Unix epoch (and back), independent of
+ * the file clock's epoch on this platform.
+ */
+int64_t FileTimeToUnixNanos(std::filesystem::file_time_type time);
+std::filesystem::file_time_type UnixNanosToFileTime(int64_t nanos);
+
+/**
+ * @brief Runs work(i) for every i in [0, count) on up to `threads` threads (the caller is one
+ * of them). After the first exception no new items start; it is rethrown once all threads stop.
+ */
+void ParallelFor(size_t count, int threads, const std::function<void(size_t)>& work);
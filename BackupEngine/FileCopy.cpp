@@ -0,0 +1,643 @@
+#include "FileCopy.h"
+#include "Sha256.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	mutex g_optionsMutex;
+	LargeFileCopyOptions g_options;
+
+	// Blocks written but not yet known to be on disk, when dropping pages from the cache
+	constexpr size_t kWritebackWindow = 4;
+
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + AlignedBufferPool::kAlignment - 1) / AlignedBufferPool::kAlignment * AlignedBufferPool::kAlignment;
+	}
+
+	[[noreturn]] void ThrowCopyError(const char* what, const fs::path& file, error_code ec)
+	{
+		throw fs::filesystem_error(what, file, ec);
+	}
+
+	bool IsZero(const char* data, size_t length)
+	{
+		return length == 0 || (data[0] == 0 && memcmp(data, data + 1, length - 1) == 0);
+	}
+
+	// Gets a copy's contents in order, each block once it is written, holes as the zeros they read as
+	using ContentSink = function<void(const char* data, size_t length)>;
+
+	ContentSink DigestSink(Sha256* digest)
+	{
+		if (!digest) return nullptr;
+		return [digest](const char* data, size_t length) { digest->Update(data, length); };
+	}
+
+	// The zeros a hole reads as, for a sparse copy that never reads them
+	void FeedZeros(const ContentSink& sink, uint64_t length)
+	{
+		if (!sink) return;
+		static const char zeros[64 * 1024] = {};
+		for (; length > 0; length -= min<uint64_t>(length, sizeof(zeros))) sink(zeros, static_cast<size_t>(min<uint64_t>(length, sizeof(zeros))));
+	}
+
+#ifdef _WIN32
+	error_code LastError() { return error_code(static_cast<int>(GetLastError()), system_category()); }
+
+	struct Handle
+	{
+		HANDLE value = INVALID_HANDLE_VALUE;
+		~Handle() { if (value != INVALID_HANDLE_VALUE) CloseHandle(value); }
+	};
+
+	// Unbuffered handles need sector-aligned offsets, lengths and buffers; the pool's buffers
+	// are aligned and only the last block is short. The first `start` bytes of the target are
+	// kept from an earlier copy (start is aligned, see ResumeSaveFileCopy).
+	void CopyHandles(const fs::path& source, const fs::path& target, const LargeFileCopyOptions& options, const function<void(uint64_t)>& onCopied, const ContentSink& sink, uint64_t start = 0)
+	{
+		DWORD readFlags = FILE_FLAG_SEQUENTIAL_SCAN;
+		DWORD writeFlags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+		Handle in, out;
+		in.value = CreateFileW(source.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+			readFlags | (options.directIo ? FILE_FLAG_NO_BUFFERING : 0), nullptr);
+		if (in.value == INVALID_HANDLE_VALUE) ThrowCopyError("Cannot read file", source, LastError());
+		out.value = CreateFileW(target.c_str(), GENERIC_WRITE, 0, nullptr, start > 0 ? OPEN_ALWAYS : CREATE_ALWAYS,
+			writeFlags | (options.directIo ? FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH : 0), nullptr);
+		if (out.value == INVALID_HANDLE_VALUE) ThrowCopyError("Cannot write file", target, LastError());
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(in.value, &size)) ThrowCopyError("Cannot read file", source, LastError());
+		const uint64_t total = static_cast<uint64_t>(size.QuadPart);
+		if (start > 0)
+		{
+			// Anything after the kept part is dropped, and both files continue from there
+			LARGE_INTEGER at;
+			at.QuadPart = static_cast<LONGLONG>(start);
+			if (!SetFilePointerEx(out.value, at, nullptr, FILE_BEGIN) || !SetEndOfFile(out.value)) ThrowCopyError("Cannot write file", target, LastError());
+			if (!SetFilePointerEx(in.value, at, nullptr, FILE_BEGIN)) ThrowCopyError("Cannot read file", source, LastError());
+		}
+		if (options.preallocate && total > start)
+		{
+			FILE_ALLOCATION_INFO allocation{};
+			allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(total);
+			SetFileInformationByHandle(out.value, FileAllocationInfo, &allocation, sizeof(allocation)); // A hint; failure is harmless
+		}
+
+		AlignedBufferPool::Lease buffer = AlignedBufferPool::Shared().Acquire();
+		for (uint64_t offset = start; offset < total; )
+		{
+			DWORD want = static_cast<DWORD>(min<uint64_t>(buffer.Size(), total - offset));
+			DWORD request = options.directIo ? static_cast<DWORD>(AlignUp(want)) : want;
+			DWORD got = 0;
+			while (got < want)
+			{
+				DWORD read = 0;
+				if (!ReadFile(in.value, buffer.Data() + got, request - got, &read, nullptr)) ThrowCopyError("Cannot read file", source, LastError());
+				if (read == 0) ThrowCopyError("File changed while copying", source, make_error_code(errc::io_error));
+				got += read;
+			}
+			if (request > want) memset(buffer.Data() + want, 0, request - want); // Padding, cut off below
+			DWORD written = 0;
+			if (!WriteFile(out.value, buffer.Data(), request, &written, nullptr) || written != request) ThrowCopyError("Cannot write file", target, LastError());
+			if (sink) sink(buffer.Data(), want);
+			offset += want;
+			if (onCopied) onCopied(want);
+		}
+		if (options.directIo && total % AlignedBufferPool::kAlignment != 0)
+		{
+			FILE_END_OF_FILE_INFO end{};
+			end.EndOfFile.QuadPart = static_cast<LONGLONG>(total);
+			if (!SetFileInformationByHandle(out.value, FileEndOfFileInfo, &end, sizeof(end))) ThrowCopyError("Cannot write file", target, LastError());
+		}
+
+		// Keep the save's time, as CopyFile (and so fs::copy_file) does here
+		FILETIME written;
+		if (GetFileTime(in.value, nullptr, nullptr, &written)) SetFileTime(out.value, nullptr, nullptr, &written);
+	}
+
+	// Only files marked sparse have holes on NTFS; others are all data
+	vector<FileExtent> QueryExtents(HANDLE file, uint64_t size)
+	{
+		vector<FileExtent> extents;
+		BY_HANDLE_FILE_INFORMATION info;
+		if (size == 0) return extents;
+		if (!GetFileInformationByHandle(file, &info) || !(info.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE)) return { { 0, size } };
+
+		FILE_ALLOCATED_RANGE_BUFFER query{};
+		query.Length.QuadPart = static_cast<LONGLONG>(size);
+		FILE_ALLOCATED_RANGE_BUFFER ranges[64];
+		for (;;)
+		{
+			DWORD bytes = 0;
+			BOOL complete = DeviceIoControl(file, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(query), ranges, sizeof(ranges), &bytes, nullptr);
+			if (!complete && GetLastError() != ERROR_MORE_DATA) return { { 0, size } };
+			DWORD count = bytes / sizeof(ranges[0]);
+			for (DWORD i = 0; i < count; ++i)
+			{
+				uint64_t offset = static_cast<uint64_t>(ranges[i].FileOffset.QuadPart);
+				if (offset < size) extents.push_back({ offset, min<uint64_t>(static_cast<uint64_t>(ranges[i].Length.QuadPart), size - offset) });
+			}
+			if (complete || count == 0) break;
+			uint64_t next = static_cast<uint64_t>(ranges[count - 1].FileOffset.QuadPart + ranges[count - 1].Length.QuadPart);
+			if (next >= size) break;
+			query.FileOffset.QuadPart = static_cast<LONGLONG>(next);
+			query.Length.QuadPart = static_cast<LONGLONG>(size - next);
+		}
+		return extents;
+	}
+
+	void CopySparseHandles(const fs::path& source, const fs::path& target, const vector<FileExtent>& layout, const ContentSink& sink, uint64_t start = 0)
+	{
+		Handle in, out;
+		in.value = CreateFileW(source.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (in.value == INVALID_HANDLE_VALUE) ThrowCopyError("Cannot read file", source, LastError());
+		out.value = CreateFileW(target.c_str(), GENERIC_WRITE, 0, nullptr, start > 0 ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (out.value == INVALID_HANDLE_VALUE) ThrowCopyError("Cannot write file", target, LastError());
+		DWORD ignored = 0;
+		DeviceIoControl(out.value, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &ignored, nullptr); // Refused by FAT: holes are written as zeros there
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(in.value, &size)) ThrowCopyError("Cannot read file", source, LastError());
+		const uint64_t total = static_cast<uint64_t>(size.QuadPart);
+		FILE_END_OF_FILE_INFO end{};
+		if (start > 0)
+		{
+			// Cut back to the kept part first, so what follows it is a hole again
+			end.EndOfFile.QuadPart = static_cast<LONGLONG>(start);
+			if (!SetFileInformationByHandle(out.value, FileEndOfFileInfo, &end, sizeof(end))) ThrowCopyError("Cannot write file", target, LastError());
+		}
+		end.EndOfFile.QuadPart = static_cast<LONGLONG>(total);
+		if (!SetFileInformationByHandle(out.value, FileEndOfFileInfo, &end, sizeof(end))) ThrowCopyError("Cannot write file", target, LastError());
+
+		AlignedBufferPool::Lease buffer = AlignedBufferPool::Shared().Acquire();
+		uint64_t fed = start;
+		for (const auto& extent : QueryExtents(in.value, total))
+		{
+			if (extent.offset + extent.length <= start) continue;
+			uint64_t from = max(extent.offset, start);
+			FeedZeros(sink, from - fed);
+			fed = extent.offset + extent.length;
+			for (uint64_t offset = from; offset < extent.offset + extent.length; )
+			{
+				DWORD want = static_cast<DWORD>(min<uint64_t>(buffer.Size(), extent.offset + extent.length - offset));
+				OVERLAPPED at{};
+				at.Offset = static_cast<DWORD>(offset);
+				at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+				DWORD read = 0;
+				if (!ReadFile(in.value, buffer.Data(), want, &read, &at)) ThrowCopyError("Cannot read file", source, LastError());
+				if (read != want) ThrowCopyError("File changed while copying", source, make_error_code(errc::io_error));
+				ForEachDataRun(layout, offset, buffer.Data(), want, [&](uint64_t runOffset, const char* data, size_t length)
+					{
+						OVERLAPPED runAt{};
+						runAt.Offset = static_cast<DWORD>(runOffset);
+						runAt.OffsetHigh = static_cast<DWORD>(runOffset >> 32);
+						DWORD written = 0;
+						if (!WriteFile(out.value, data, static_cast<DWORD>(length), &written, &runAt) || written != length) ThrowCopyError("Cannot write file", target, LastError());
+					});
+				if (sink) sink(buffer.Data(), want);
+				offset += want;
+			}
+		}
+		FeedZeros(sink, total - fed);
+
+		FILETIME written;
+		if (GetFileTime(in.value, nullptr, nullptr, &written)) SetFileTime(out.value, nullptr, nullptr, &written);
+	}
+#else
+	struct Descriptor
+	{
+		int value = -1;
+		~Descriptor() { if (value >= 0) close(value); }
+	};
+
+	error_code LastError() { return error_code(errno, generic_category()); }
+
+	// Opens with O_DIRECT if asked, retrying without it where the file system refuses it (tmpfs)
+	int OpenFile(const fs::path& file, int flags, bool direct, bool& isDirect)
+	{
+		int fd = -1;
+#ifdef O_DIRECT
+		if (direct)
+		{
+			fd = open(file.c_str(), flags | O_DIRECT | O_CLOEXEC, 0644);
+			isDirect = fd >= 0;
+			if (fd >= 0 || errno != EINVAL) return fd;
+		}
+#else
+		(void)direct;
+#endif
+		isDirect = false;
+		return open(file.c_str(), flags | O_CLOEXEC, 0644);
+	}
+
+	// Writes back a copied range and drops it, and the source range it came from, from the cache
+	void DropRange(int in, int out, uint64_t offset, uint64_t length)
+	{
+#ifdef __linux__
+		sync_file_range(out, static_cast<off_t>(offset), static_cast<off_t>(length), SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+		posix_fadvise(out, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+		posix_fadvise(in, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+	}
+
+	// The first `start` bytes of the target are kept from an earlier copy (start is aligned,
+	// see ResumeSaveFileCopy)
+	void CopyDescriptors(const fs::path& source, const fs::path& target, const LargeFileCopyOptions& options, const function<void(uint64_t)>& onCopied, const ContentSink& sink, uint64_t start = 0)
+	{
+		Descriptor in, out;
+		bool inDirect = false, outDirect = false;
+		in.value = OpenFile(source, O_RDONLY, options.directIo, inDirect);
+		if (in.value < 0) ThrowCopyError("Cannot read file", source, LastError());
+		struct stat info;
+		if (fstat(in.value, &info) != 0) ThrowCopyError("Cannot read file", source, LastError());
+		out.value = OpenFile(target, O_WRONLY | O_CREAT | (start > 0 ? 0 : O_TRUNC), options.directIo, outDirect);
+		if (out.value < 0) ThrowCopyError("Cannot write file", target, LastError());
+		if (start > 0 && ftruncate(out.value, static_cast<off_t>(start)) != 0) ThrowCopyError("Cannot write file", target, LastError()); // Drop anything after the kept part
+
+		const uint64_t total = static_cast<uint64_t>(info.st_size);
+		posix_fadvise(in.value, 0, 0, POSIX_FADV_SEQUENTIAL);
+		if (options.preallocate && total > start)
+		{
+			// One extent where the file system allows it; EOPNOTSUPP and the like just skip it
+			int result = posix_fallocate(out.value, static_cast<off_t>(start), static_cast<off_t>(total - start));
+			if (result == ENOSPC) ThrowCopyError("Cannot write file", target, error_code(result, generic_category()));
+		}
+
+		// Writeback of a block is started as soon as it is written and waited for (then dropped)
+		// kWritebackWindow blocks later, so the disk always has work queued behind the copy
+		const bool drop = options.dropCache && !(inDirect && outDirect);
+		AlignedBufferPool::Lease buffer = AlignedBufferPool::Shared().Acquire();
+		deque<pair<uint64_t, uint64_t>> pending; // Offset, length
+		for (uint64_t offset = start; offset < total; )
+		{
+			size_t want = static_cast<size_t>(min<uint64_t>(buffer.Size(), total - offset));
+			size_t request = inDirect ? static_cast<size_t>(AlignUp(want)) : want;
+			size_t got = 0;
+			while (got < want)
+			{
+				ssize_t read = pread(in.value, buffer.Data() + got, request - got, static_cast<off_t>(offset + got));
+				if (read < 0 && errno == EINTR) continue;
+				if (read < 0) ThrowCopyError("Cannot read file", source, LastError());
+				if (read == 0) ThrowCopyError("File changed while copying", source, make_error_code(errc::io_error));
+				got += static_cast<size_t>(read);
+			}
+			size_t length = outDirect ? static_cast<size_t>(AlignUp(want)) : want;
+			if (length > want) memset(buffer.Data() + want, 0, length - want); // Padding, cut off below
+			for (size_t done = 0; done < length; )
+			{
+				ssize_t written = pwrite(out.value, buffer.Data() + done, length - done, static_cast<off_t>(offset + done));
+				if (written < 0 && errno == EINTR) continue;
+				if (written <= 0) ThrowCopyError("Cannot write file", target, LastError());
+				done += static_cast<size_t>(written);
+			}
+			if (sink) sink(buffer.Data(), want);
+
+			if (drop)
+			{
+#ifdef __linux__
+				sync_file_range(out.value, static_cast<off_t>(offset), static_cast<off_t>(want), SYNC_FILE_RANGE_WRITE);
+#endif
+				pending.emplace_back(offset, want);
+				if (pending.size() > kWritebackWindow)
+				{
+					DropRange(in.value, out.value, pending.front().first, pending.front().second);
+					pending.pop_front();
+				}
+			}
+			offset += want;
+			if (onCopied) onCopied(want);
+		}
+		for (const auto& [offset, length] : pending) DropRange(in.value, out.value, offset, length);
+		if (outDirect && total % AlignedBufferPool::kAlignment != 0 && ftruncate(out.value, static_cast<off_t>(total)) != 0)
+		{
+			ThrowCopyError("Cannot write file", target, LastError());
+		}
+		fchmod(out.value, info.st_mode & 07777);
+	}
+
+	vector<FileExtent> QueryExtents(int fd, uint64_t size)
+	{
+		vector<FileExtent> extents;
+#ifdef SEEK_DATA
+		for (uint64_t offset = 0; offset < size; )
+		{
+			off_t data = lseek(fd, static_cast<off_t>(offset), SEEK_DATA);
+			if (data < 0 && errno == ENXIO) break; // Only a hole left
+			if (data < 0) return { { 0, size } };  // Not supported here: all data
+			if (static_cast<uint64_t>(data) >= size) break;
+			off_t hole = lseek(fd, data, SEEK_HOLE);
+			uint64_t end = hole <= data ? size : min<uint64_t>(static_cast<uint64_t>(hole), size);
+			extents.push_back({ static_cast<uint64_t>(data), end - static_cast<uint64_t>(data) });
+			offset = end;
+		}
+#else
+		if (size > 0) extents.push_back({ 0, size });
+#endif
+		return extents;
+	}
+
+	void CopySparseDescriptors(const fs::path& source, const fs::path& target, const vector<FileExtent>& layout, const ContentSink& sink, uint64_t start = 0)
+	{
+		Descriptor in, out;
+		in.value = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+		if (in.value < 0) ThrowCopyError("Cannot read file", source, LastError());
+		struct stat info;
+		if (fstat(in.value, &info) != 0) ThrowCopyError("Cannot read file", source, LastError());
+		out.value = open(target.c_str(), O_WRONLY | O_CREAT | (start > 0 ? 0 : O_TRUNC) | O_CLOEXEC, 0644);
+		if (out.value < 0) ThrowCopyError("Cannot write file", target, LastError());
+
+		// Sized first, so everything left unwritten is a hole (cut back to the kept part before,
+		// so what an earlier copy wrote after it is a hole again)
+		const uint64_t total = static_cast<uint64_t>(info.st_size);
+		if (start > 0 && ftruncate(out.value, static_cast<off_t>(start)) != 0) ThrowCopyError("Cannot write file", target, LastError());
+		if (ftruncate(out.value, static_cast<off_t>(total)) != 0) ThrowCopyError("Cannot write file", target, LastError());
+
+		AlignedBufferPool::Lease buffer = AlignedBufferPool::Shared().Acquire();
+		uint64_t fed = start;
+		for (const auto& extent : QueryExtents(in.value, total))
+		{
+			if (extent.offset + extent.length <= start) continue;
+			uint64_t from = max(extent.offset, start);
+			FeedZeros(sink, from - fed);
+			fed = extent.offset + extent.length;
+			for (uint64_t offset = from; offset < extent.offset + extent.length; )
+			{
+				size_t want = static_cast<size_t>(min<uint64_t>(buffer.Size(), extent.offset + extent.length - offset));
+				for (size_t got = 0; got < want; )
+				{
+					ssize_t read = pread(in.value, buffer.Data() + got, want - got, static_cast<off_t>(offset + got));
+					if (read < 0 && errno == EINTR) continue;
+					if (read < 0) ThrowCopyError("Cannot read file", source, LastError());
+					if (read == 0) ThrowCopyError("File changed while copying", source, make_error_code(errc::io_error));
+					got += static_cast<size_t>(read);
+				}
+				ForEachDataRun(layout, offset, buffer.Data(), want, [&](uint64_t runOffset, const char* data, size_t length)
+					{
+						for (size_t done = 0; done < length; )
+						{
+							ssize_t written = pwrite(out.value, data + done, length - done, static_cast<off_t>(runOffset + done));
+							if (written < 0 && errno == EINTR) continue;
+							if (written <= 0) ThrowCopyError("Cannot write file", target, LastError());
+							done += static_cast<size_t>(written);
+						}
+					});
+				if (sink) sink(buffer.Data(), want);
+				offset += want;
+			}
+		}
+		FeedZeros(sink, total - fed);
+		fchmod(out.value, info.st_mode & 07777);
+	}
+#endif
+}
+
+void SetLargeFileCopyOptions(const LargeFileCopyOptions& options)
+{
+	lock_guard<mutex> lock(g_optionsMutex);
+	g_options = options;
+}
+
+LargeFileCopyOptions GetLargeFileCopyOptions()
+{
+	lock_guard<mutex> lock(g_optionsMutex);
+	return g_options;
+}
+
+AlignedBufferPool::~AlignedBufferPool()
+{
+	for (char* data : m_idle) ::operator delete(data, align_val_t(kAlignment));
+}
+
+AlignedBufferPool& AlignedBufferPool::Shared()
+{
+	static AlignedBufferPool pool;
+	return pool;
+}
+
+AlignedBufferPool::Lease AlignedBufferPool::Acquire()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (!m_idle.empty())
+		{
+			char* data = m_idle.back();
+			m_idle.pop_back();
+			return Lease(*this, data);
+		}
+		m_allocations++;
+	}
+	return Lease(*this, static_cast<char*>(::operator new(kBufferSize, align_val_t(kAlignment))));
+}
+
+size_t AlignedBufferPool::Allocations() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_allocations;
+}
+
+void AlignedBufferPool::Release(char* data)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (m_idle.size() < m_maxIdle)
+		{
+			m_idle.push_back(data);
+			return;
+		}
+	}
+	::operator delete(data, align_val_t(kAlignment));
+}
+
+void CopyLargeFile(const fs::path& source, const fs::path& target, const LargeFileCopyOptions& options, const function<void(uint64_t)>& onCopied, Sha256* digest)
+{
+	TraceSpan span("copy_large", "file");
+#ifdef _WIN32
+	CopyHandles(source, target, options, onCopied, DigestSink(digest));
+#else
+	CopyDescriptors(source, target, options, onCopied, DigestSink(digest));
+#endif
+}
+
+vector<FileExtent> DataExtents(const fs::path& file)
+{
+#ifdef _WIN32
+	Handle handle;
+	handle.value = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle.value == INVALID_HANDLE_VALUE) ThrowCopyError("Cannot read file", file, LastError());
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle.value, &size)) ThrowCopyError("Cannot read file", file, LastError());
+	return QueryExtents(handle.value, static_cast<uint64_t>(size.QuadPart));
+#else
+	Descriptor descriptor;
+	descriptor.value = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (descriptor.value < 0) ThrowCopyError("Cannot read file", file, LastError());
+	struct stat info;
+	if (fstat(descriptor.value, &info) != 0) ThrowCopyError("Cannot read file", file, LastError());
+	return QueryExtents(descriptor.value, static_cast<uint64_t>(info.st_size));
+#endif
+}
+
+optional<vector<FileExtent>> FindSparseLayout(const fs::path& file, uint64_t size)
+{
+	if (size < kSparseCheckSize) return nullopt;
+	try {
+		vector<FileExtent> extents = DataExtents(file);
+		uint64_t data = 0;
+		for (const auto& extent : extents) data += extent.length;
+		if (data < size) return extents;
+	}
+	catch (const fs::filesystem_error&) {} // Copied (and fails) as a regular file
+	return nullopt;
+}
+
+void ForEachDataRun(const vector<FileExtent>& layout, uint64_t offset, const char* data, size_t length, const function<void(uint64_t, const char*, size_t)>& write)
+{
+	constexpr uint64_t kBlock = 4096;
+	const uint64_t end = offset + length;
+	uint64_t runStart = offset, position = offset; // Pending run: [runStart, position)
+	auto flush = [&]()
+		{
+			if (position > runStart) write(runStart, data + (runStart - offset), static_cast<size_t>(position - runStart));
+		};
+
+	// First region of the layout ending after `offset`
+	auto extent = upper_bound(layout.begin(), layout.end(), offset, [](uint64_t value, const FileExtent& e) { return value < e.offset + e.length; });
+	while (position < end)
+	{
+		if (extent != layout.end() && extent->offset <= position)
+		{
+			position = min(end, extent->offset + extent->length);
+			if (position == extent->offset + extent->length) ++extent;
+			continue;
+		}
+		// A hole up to the next region: only blocks with something in them are written
+		uint64_t holeEnd = extent == layout.end() ? end : min(end, extent->offset);
+		while (position < holeEnd)
+		{
+			uint64_t blockEnd = min(holeEnd, (position / kBlock + 1) * kBlock);
+			if (IsZero(data + (position - offset), static_cast<size_t>(blockEnd - position)))
+			{
+				flush();
+				runStart = blockEnd;
+			}
+			position = blockEnd;
+		}
+	}
+	flush();
+}
+
+void MarkSparseFile(const fs::path& file)
+{
+#ifdef _WIN32
+	Handle handle;
+	handle.value = CreateFileW(file.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	DWORD ignored = 0;
+	if (handle.value != INVALID_HANDLE_VALUE) DeviceIoControl(handle.value, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &ignored, nullptr);
+#else
+	(void)file;
+#endif
+}
+
+void CopySparseFile(const fs::path& source, const fs::path& target, const vector<FileExtent>& layout, Sha256* digest)
+{
+	TraceSpan span("copy_sparse", "file");
+#ifdef _WIN32
+	CopySparseHandles(source, target, layout, DigestSink(digest));
+#else
+	CopySparseDescriptors(source, target, layout, DigestSink(digest));
+#endif
+}
+
+bool CopySaveFile(const fs::path& source, const fs::path& target, uint64_t size, fs::copy_options options, const vector<FileExtent>* layout, OperationProgress* progress, Sha256* digest)
+{
+	// Holes come first: a sparse image well under the large-file threshold would still be
+	// written out at its full size by fs::copy_file
+	optional<vector<FileExtent>> found;
+	if (!layout && (found = FindSparseLayout(source, size))) layout = &*found;
+	LargeFileCopyOptions large = GetLargeFileCopyOptions();
+	const bool small = !layout && size < large.threshold;
+	if (small && !digest) return fs::copy_file(source, target, options);
+
+	// The existing-file rules of fs::copy_file
+	error_code ec;
+	if (fs::exists(target, ec))
+	{
+		if ((options & fs::copy_options::skip_existing) != fs::copy_options::none) return false;
+		if ((options & fs::copy_options::update_existing) != fs::copy_options::none)
+		{
+			if (fs::last_write_time(source) <= fs::last_write_time(target)) return false;
+		}
+		else if ((options & fs::copy_options::overwrite_existing) == fs::copy_options::none)
+		{
+			throw fs::filesystem_error("Cannot copy file", source, target, make_error_code(errc::file_exists));
+		}
+	}
+	if (layout)
+	{
+		CopySparseFile(source, target, *layout, digest);
+		return true;
+	}
+	if (small)
+	{
+		// Hashed on its way through a plain buffered copy, like the one fs::copy_file makes (and
+		// without a trace span each: there can be thousands)
+		const LargeFileCopyOptions plain{ 0, false, false, false };
+#ifdef _WIN32
+		CopyHandles(source, target, plain, nullptr, DigestSink(digest));
+#else
+		CopyDescriptors(source, target, plain, nullptr, DigestSink(digest));
+#endif
+		return true;
+	}
+	if (progress) CopyLargeFile(source, target, large, [progress](uint64_t bytes) { progress->AddBytes(bytes); }, digest);
+	else CopyLargeFile(source, target, large, nullptr, digest);
+	return true;
+}
+
+void ResumeSaveFileCopy(const fs::path& source, const fs::path& target, uint64_t size, uint64_t resumeFrom, const function<void(const char*, size_t)>& onWritten)
+{
+	if (resumeFrom % AlignedBufferPool::kAlignment != 0 || resumeFrom > size) throw invalid_argument("Copy resumed at an unaligned offset or past the end");
+	if (fs::file_size(source) < resumeFrom) ThrowCopyError("File changed while copying", source, make_error_code(errc::io_error));
+	TraceSpan span("copy_resumed", "file");
+	if (optional<vector<FileExtent>> layout = FindSparseLayout(source, size))
+	{
+#ifdef _WIN32
+		CopySparseHandles(source, target, *layout, onWritten, resumeFrom);
+#else
+		CopySparseDescriptors(source, target, *layout, onWritten, resumeFrom);
+#endif
+		return;
+	}
+	// Small files as CopySaveFile hashes them: plain buffered I/O
+	LargeFileCopyOptions options = GetLargeFileCopyOptions();
+	if (size < options.threshold) options = LargeFileCopyOptions{ 0, false, false, false };
+#ifdef _WIN32
+	CopyHandles(source, target, options, nullptr, onWritten, resumeFrom);
+#else
+	CopyDescriptors(source, target, options, nullptr, onWritten, resumeFrom);
+#endif
+}
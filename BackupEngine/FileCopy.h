@@ -0,0 +1,157 @@
+#pragma once
+
+// Copy path for large save files (multi-GB sandbox worlds, emulator memory cards).
+// fs::copy_file streams through the page cache, so backing up a big file evicts the running
+// game's working set. Files at or above a size threshold are instead streamed through large
+// aligned buffers taken from a shared pool, into a destination preallocated up front, and the
+// pages the copy touched are dropped from the cache behind it (or bypassed with direct I/O).
+//
+// Sparse files (emulator and VM disk images that are mostly holes) are copied region by region
+// instead: only their data is read and written, and the holes stay holes at the destination.
+
+#include "Manifest.h"
+#include "Progress.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+class Sha256;
+
+// Files smaller than this are not checked for holes
+inline constexpr uint64_t kSparseCheckSize = 1024 * 1024;
+
+struct LargeFileCopyOptions
+{
+	uint64_t threshold = 64ull * 1024 * 1024; // Smaller files go through fs::copy_file
+	bool directIo = false;   // O_DIRECT / FILE_FLAG_NO_BUFFERING; buffered where the file system refuses it
+	bool dropCache = true;   // Buffered mode: drop source and destination pages once copied (Linux)
+	bool preallocate = true; // Reserve the destination's full size before writing
+};
+
+/**
+ * @brief Process-wide options for CopySaveFile, normally from [Performance] in Config.ini.
+ */
+void SetLargeFileCopyOptions(const LargeFileCopyOptions& options);
+LargeFileCopyOptions GetLargeFileCopyOptions();
+
+// Fixed-size buffers aligned for direct I/O, kept for reuse instead of being freed
+class AlignedBufferPool
+{
+public:
+	static constexpr size_t kBufferSize = 8 * 1024 * 1024;
+	static constexpr size_t kAlignment = 4096; // Covers 512-byte and 4K sectors
+
+	// A buffer on loan; returned to the pool on destruction
+	class Lease
+	{
+	public:
+		Lease(AlignedBufferPool& pool, char* data) : m_pool(&pool), m_data(data) {}
+		Lease(Lease&& other) noexcept : m_pool(other.m_pool), m_data(other.m_data) { other.m_data = nullptr; }
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+		Lease& operator=(Lease&&) = delete;
+		~Lease() { if (m_data) m_pool->Release(m_data); }
+
+		char* Data() const { return m_data; }
+		size_t Size() const { return kBufferSize; }
+
+	private:
+		AlignedBufferPool* m_pool;
+		char* m_data;
+	};
+
+	explicit AlignedBufferPool(size_t maxIdle = 4) : m_maxIdle(maxIdle) {}
+	~AlignedBufferPool();
+	AlignedBufferPool(const AlignedBufferPool&) = delete;
+	AlignedBufferPool& operator=(const AlignedBufferPool&) = delete;
+
+	static AlignedBufferPool& Shared();
+
+	// Thread-safe
+	Lease Acquire();
+	size_t Allocations() const; // Buffers allocated so far (not served from the pool)
+
+private:
+	void Release(char* data);
+
+	size_t m_maxIdle;
+	mutable std::mutex m_mutex;
+	std::vector<char*> m_idle;
+	size_t m_allocations = 0;
+};
+
+/**
+ * @brief Copies `source` over `target` (created or truncated) with the large-file path,
+ * whatever the size. Permissions are copied, as by fs::copy_file; on Windows the modification
+ * time is too, as CopyFile does. `onCopied` gets the size of each block once it is written, and
+ * `digest` (if given) each block as it is read. Throws fs::filesystem_error, including when the
+ * source shrinks during the copy.
+ */
+void CopyLargeFile(const std::filesystem::path& source, const std::filesystem::path& target, const LargeFileCopyOptions& options, const std::function<void(uint64_t bytes)>& onCopied = nullptr,
+	Sha256* digest = nullptr);
+
+/**
+ * @brief The data regions of a file, in order, from SEEK_DATA / SEEK_HOLE (the allocated ranges
+ * of a sparse file on Windows). A file without holes, or on a file system that cannot tell, is
+ * one region. Throws fs::filesystem_error.
+ */
+std::vector<FileExtent> DataExtents(const std::filesystem::path& file);
+
+/**
+ * @brief DataExtents(file) if a file of `size` bytes (at least kSparseCheckSize) has holes,
+ * otherwise nothing. Errors count as no holes.
+ */
+std::optional<std::vector<FileExtent>> FindSparseLayout(const std::filesystem::path& file, uint64_t size);
+
+/**
+ * @brief Copies `source` over `target` (created or truncated) reading only the source's data
+ * regions and leaving `layout`'s holes unwritten, so the target is sparse where the file system
+ * allows it. A hole in `layout` that the source holds non-zero data for is still copied, so a
+ * stale layout cannot lose data. Permissions are copied; on Windows the modification time too.
+ * `digest` (if given) gets the whole contents, the source's holes as the zeros they read as.
+ * Throws fs::filesystem_error.
+ */
+void CopySparseFile(const std::filesystem::path& source, const std::filesystem::path& target, const std::vector<FileExtent>& layout, Sha256* digest = nullptr);
+
+/**
+ * @brief Splits `length` bytes to be written at `offset` of a file with `layout` into the runs
+ * that need writing: everything but whole 4 KB blocks that lie in a hole and are all zeros.
+ * For writers that create the file themselves (MarkSparseFile, then extend it to its size).
+ */
+void ForEachDataRun(const std::vector<FileExtent>& layout, uint64_t offset, const char* data, size_t length, const std::function<void(uint64_t offset, const char* data, size_t length)>& write);
+
+/**
+ * @brief Lets unwritten ranges of a new file stay holes: marks it sparse on Windows (NTFS only
+ * keeps holes in files marked so); nothing to do elsewhere. Best effort.
+ */
+void MarkSparseFile(const std::filesystem::path& file);
+
+/**
+ * @brief Finishes a copy of `source` (`size` bytes) into `target`, whose first `resumeFrom` bytes
+ * (a multiple of AlignedBufferPool::kAlignment, at most `size`) an earlier attempt wrote: the
+ * target is cut back to them and the rest copied as CopySaveFile copies it, region by region
+ * leaving holes if the source is sparse. `resumeFrom` 0 copies the whole file. `onWritten` gets
+ * the contents from `resumeFrom` on, in order, each block once it is written, holes as the zeros
+ * they read as, so a caller can checkpoint what it was given. Permissions are copied as by
+ * CopySaveFile. Throws fs::filesystem_error, std::invalid_argument for a bad `resumeFrom`.
+ */
+void ResumeSaveFileCopy(const std::filesystem::path& source, const std::filesystem::path& target, uint64_t size, uint64_t resumeFrom,
+	const std::function<void(const char* data, size_t length)>& onWritten);
+
+/**
+ * @brief fs::copy_file(source, target, options) for a file of `size` bytes. Sparse files go
+ * through CopySparseFile, with `layout` if given (a manifest's record of the original file's
+ * data regions, for a copy that may have lost its holes) or else the source's own; other files
+ * through CopyLargeFile when the size reaches the configured threshold, reporting each block to
+ * `progress` (AddBytes) if given. With `digest`, the contents are hashed as they are read, so
+ * nothing reads the file again for its SHA-256; small files then take a plain buffered copy
+ * instead of fs::copy_file. Returns false if the copy was skipped (skip_existing / update_existing),
+ * leaving `digest` untouched.
+ */
+bool CopySaveFile(const std::filesystem::path& source, const std::filesystem::path& target, uint64_t size, std::filesystem::copy_options options = std::filesystem::copy_options::none,
+	const std::vector<FileExtent>* layout = nullptr, OperationProgress* progress = nullptr, Sha256* digest = nullptr);
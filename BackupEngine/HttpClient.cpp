@@ -0,0 +1,384 @@
+#include "HttpClient.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+#ifdef _WIN32
+	void EnsureWinsock()
+	{
+		static once_flag once;
+		call_once(once, [] { WSADATA data; WSAStartup(MAKEWORD(2, 2), &data); });
+	}
+	void CloseHandle(SocketHandle handle) { closesocket(static_cast<SOCKET>(handle)); }
+	SOCKET Native(SocketHandle handle) { return static_cast<SOCKET>(handle); }
+#else
+	void EnsureWinsock() {}
+	void CloseHandle(SocketHandle handle) { close(handle); }
+	int Native(SocketHandle handle) { return handle; }
+#endif
+
+	void SetTimeouts(SocketHandle handle, chrono::milliseconds timeout)
+	{
+#ifdef _WIN32
+		DWORD millis = static_cast<DWORD>(timeout.count());
+		setsockopt(Native(handle), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&millis), sizeof(millis));
+		setsockopt(Native(handle), SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&millis), sizeof(millis));
+#else
+		timeval tv{ static_cast<time_t>(timeout.count() / 1000), static_cast<suseconds_t>((timeout.count() % 1000) * 1000) };
+		setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		setsockopt(handle, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#endif
+	}
+
+	string ToLower(string text)
+	{
+		for (auto& c : text) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		return text;
+	}
+
+	string TrimSpaces(const string& text)
+	{
+		size_t start = text.find_first_not_of(" \t");
+		if (start == string::npos) return "";
+		size_t end = text.find_last_not_of(" \t\r");
+		return text.substr(start, end - start + 1);
+	}
+
+	// Buffered reader over a socket for line- and length-based parsing
+	class SocketReader
+	{
+	public:
+		explicit SocketReader(TcpSocket& socket) : m_socket(socket) {}
+
+		bool ReadLine(string& line)
+		{
+			while (true)
+			{
+				size_t newline = m_buffer.find("\r\n", m_pos);
+				if (newline != string::npos)
+				{
+					line = m_buffer.substr(m_pos, newline - m_pos);
+					m_pos = newline + 2;
+					return true;
+				}
+				if (!Fill()) return false;
+			}
+		}
+
+		void ReadExact(size_t size, string& out)
+		{
+			while (m_buffer.size() - m_pos < size)
+			{
+				if (!Fill()) throw HttpError("Connection closed in the middle of a message body");
+			}
+			out.append(m_buffer, m_pos, size);
+			m_pos += size;
+		}
+
+		void ReadToEnd(string& out)
+		{
+			while (Fill()) {}
+			out.append(m_buffer, m_pos, string::npos);
+			m_pos = m_buffer.size();
+		}
+
+	private:
+		bool Fill()
+		{
+			if (m_pos > 0 && m_pos == m_buffer.size())
+			{
+				m_buffer.clear();
+				m_pos = 0;
+			}
+			char chunk[64 * 1024];
+			size_t received = m_socket.Receive(chunk, sizeof(chunk));
+			if (received == 0) return false;
+			m_buffer.append(chunk, received);
+			return true;
+		}
+
+		TcpSocket& m_socket;
+		string m_buffer;
+		size_t m_pos = 0;
+	};
+}
+
+SocketHandle TcpSocket::InvalidHandle()
+{
+#ifdef _WIN32
+	return static_cast<SocketHandle>(INVALID_SOCKET);
+#else
+	return -1;
+#endif
+}
+
+TcpSocket::~TcpSocket()
+{
+	Close();
+}
+
+TcpSocket::TcpSocket(TcpSocket&& other) noexcept : m_handle(other.m_handle)
+{
+	other.m_handle = InvalidHandle();
+}
+
+TcpSocket& TcpSocket::operator=(TcpSocket&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_handle = other.m_handle;
+		other.m_handle = InvalidHandle();
+	}
+	return *this;
+}
+
+bool TcpSocket::IsOpen() const
+{
+	return m_handle != InvalidHandle();
+}
+
+void TcpSocket::Close()
+{
+	if (IsOpen()) CloseHandle(m_handle);
+	m_handle = InvalidHandle();
+}
+
+TcpSocket TcpSocket::Connect(const string& host, uint16_t port, chrono::milliseconds timeout)
+{
+	EnsureWinsock();
+	addrinfo hints{};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* results = nullptr;
+	if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &results) != 0 || !results)
+	{
+		throw HttpError("Cannot resolve host " + host);
+	}
+
+	TcpSocket socket;
+	for (addrinfo* ai = results; ai; ai = ai->ai_next)
+	{
+		auto handle = static_cast<SocketHandle>(::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+		if (handle == InvalidHandle()) continue;
+		TcpSocket candidate(handle);
+		SetTimeouts(handle, timeout);
+		if (connect(Native(handle), ai->ai_addr, static_cast<int>(ai->ai_addrlen)) == 0)
+		{
+			int noDelay = 1; // Requests are written in one or two sends; don't wait for ACKs
+			setsockopt(Native(handle), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+			socket = move(candidate);
+			break;
+		}
+	}
+	freeaddrinfo(results);
+	if (!socket.IsOpen()) throw HttpError("Cannot connect to " + host + ":" + to_string(port));
+	return socket;
+}
+
+TcpSocket TcpSocket::ListenLoopback(uint16_t port)
+{
+	EnsureWinsock();
+	auto handle = static_cast<SocketHandle>(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+	if (handle == InvalidHandle()) throw HttpError("Cannot create a socket");
+	TcpSocket socket(handle);
+
+	int reuse = 1;
+	setsockopt(Native(handle), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (::bind(Native(handle), reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(Native(handle), 64) != 0)
+	{
+		throw HttpError("Cannot listen on 127.0.0.1:" + to_string(port));
+	}
+	return socket;
+}
+
+TcpSocket TcpSocket::Accept()
+{
+	auto handle = static_cast<SocketHandle>(::accept(Native(m_handle), nullptr, nullptr));
+	if (handle == InvalidHandle()) throw HttpError("accept failed");
+	return TcpSocket(handle);
+}
+
+uint16_t TcpSocket::LocalPort() const
+{
+	sockaddr_in address{};
+	socklen_t length = sizeof(address);
+	getsockname(Native(m_handle), reinterpret_cast<sockaddr*>(&address), &length);
+	return ntohs(address.sin_port);
+}
+
+void TcpSocket::SendAll(const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		int chunk = static_cast<int>(min<size_t>(size, 1 << 30));
+#ifdef _WIN32
+		int sent = send(Native(m_handle), data, chunk, 0);
+#else
+		ssize_t sent = send(m_handle, data, static_cast<size_t>(chunk), MSG_NOSIGNAL);
+#endif
+		if (sent <= 0) throw HttpError("Connection lost while sending");
+		data += sent;
+		size -= static_cast<size_t>(sent);
+	}
+}
+
+size_t TcpSocket::Receive(char* buffer, size_t size)
+{
+#ifdef _WIN32
+	int received = recv(Native(m_handle), buffer, static_cast<int>(min<size_t>(size, 1 << 30)), 0);
+#else
+	ssize_t received = recv(m_handle, buffer, size, 0);
+#endif
+	if (received < 0) throw HttpError("Connection error or timeout while receiving");
+	return static_cast<size_t>(received);
+}
+
+string HttpResponse::Header(const string& lowercaseName) const
+{
+	auto it = headers.find(lowercaseName);
+	return it == headers.end() ? string() : it->second;
+}
+
+HttpUrl ParseHttpUrl(const string& url)
+{
+	const string scheme = "http://";
+	if (ToLower(url.substr(0, scheme.size())) != scheme)
+	{
+		throw HttpError("Only http:// endpoints are supported: " + url);
+	}
+	string rest = url.substr(scheme.size());
+	size_t slash = rest.find('/');
+	string authority = rest.substr(0, slash);
+
+	HttpUrl parsed;
+	parsed.basePath = slash == string::npos ? "" : rest.substr(slash);
+	while (!parsed.basePath.empty() && parsed.basePath.back() == '/') parsed.basePath.pop_back();
+	size_t colon = authority.rfind(':');
+	if (colon != string::npos && authority.find(']') == string::npos)
+	{
+		parsed.host = authority.substr(0, colon);
+		parsed.port = static_cast<uint16_t>(stoi(authority.substr(colon + 1)));
+	}
+	else
+	{
+		parsed.host = authority;
+	}
+	if (parsed.host.empty()) throw HttpError("Missing host in " + url);
+	return parsed;
+}
+
+bool ReadHttpMessage(TcpSocket& socket, bool isRequest, string& firstLine, map<string, string>& headers, string& body, bool headOnly)
+{
+	SocketReader reader(socket);
+	if (!reader.ReadLine(firstLine)) return false;
+
+	headers.clear();
+	body.clear();
+	string line;
+	while (true)
+	{
+		if (!reader.ReadLine(line)) throw HttpError("Connection closed inside the message head");
+		if (line.empty()) break;
+		size_t colon = line.find(':');
+		if (colon == string::npos) continue;
+		headers[ToLower(TrimSpaces(line.substr(0, colon)))] = TrimSpaces(line.substr(colon + 1));
+	}
+
+	if (headOnly) return true;
+	auto transferEncoding = headers.find("transfer-encoding");
+	auto contentLength = headers.find("content-length");
+	if (transferEncoding != headers.end() && ToLower(transferEncoding->second).find("chunked") != string::npos)
+	{
+		while (true)
+		{
+			if (!reader.ReadLine(line)) throw HttpError("Connection closed inside a chunked body");
+			size_t chunkSize = stoul(line, nullptr, 16);
+			if (chunkSize == 0)
+			{
+				while (reader.ReadLine(line) && !line.empty()) {} // Trailers
+				break;
+			}
+			reader.ReadExact(chunkSize, body);
+			reader.ReadLine(line); // CRLF after each chunk
+		}
+	}
+	else if (contentLength != headers.end())
+	{
+		reader.ReadExact(static_cast<size_t>(stoull(contentLength->second)), body);
+	}
+	else if (!isRequest && firstLine.find(" 204 ") == string::npos && firstLine.find(" 304 ") == string::npos)
+	{
+		reader.ReadToEnd(body); // Response without a length: body ends when the server closes
+	}
+	return true;
+}
+
+HttpResponse SendHttpRequest(const HttpRequest& request, chrono::milliseconds timeout)
+{
+	TcpSocket socket = TcpSocket::Connect(request.host, request.port, timeout);
+
+	string head = request.method + " " + request.target + " HTTP/1.1\r\nHost: " + request.host;
+	if (request.port != 80) head += ":" + to_string(request.port);
+	head += "\r\n";
+	for (const auto& header : request.headers) head += header.first + ": " + header.second + "\r\n";
+	head += "Content-Length: " + to_string(request.body.size()) + "\r\nConnection: close\r\n\r\n";
+	socket.SendAll(head.data(), head.size());
+	socket.SendAll(request.body.data(), request.body.size());
+
+	HttpResponse response;
+	string statusLine;
+	if (!ReadHttpMessage(socket, false, statusLine, response.headers, response.body, request.method == "HEAD"))
+	{
+		throw HttpError("Empty response from " + request.host);
+	}
+	size_t space = statusLine.find(' ');
+	if (space == string::npos) throw HttpError("Malformed status line: " + statusLine);
+	response.status = atoi(statusLine.c_str() + space + 1);
+	return response;
+}
+
+string UriEncode(const string& text, bool keepSlash)
+{
+	static const char kDigits[] = "0123456789ABCDEF";
+	string encoded;
+	encoded.reserve(text.size());
+	for (unsigned char c : text)
+	{
+		if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' || c == '~' || (keepSlash && c == '/'))
+		{
+			encoded += static_cast<char>(c);
+		}
+		else
+		{
+			encoded += '%';
+			encoded += kDigits[c >> 4];
+			encoded += kDigits[c & 0xF];
+		}
+	}
+	return encoded;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+// Minimal blocking HTTP/1.1 client over plain TCP, enough for an S3-compatible endpoint
+// (MinIO, a LAN gateway, or the test stand-in). One connection per request; callers that
+// want parallel transfers use one request per thread. No TLS: use a local or gateway endpoint.
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+using SocketHandle = uintptr_t; // SOCKET, without pulling winsock2.h into every includer
+#else
+using SocketHandle = int;
+#endif
+
+class HttpError : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief A connected (or listening) TCP socket. Closed on destruction. Throws HttpError on failure.
+ */
+class TcpSocket
+{
+public:
+	TcpSocket() = default;
+	~TcpSocket();
+	TcpSocket(TcpSocket&& other) noexcept;
+	TcpSocket& operator=(TcpSocket&& other) noexcept;
+	TcpSocket(const TcpSocket&) = delete;
+	TcpSocket& operator=(const TcpSocket&) = delete;
+
+	static TcpSocket Connect(const std::string& host, uint16_t port, std::chrono::milliseconds timeout);
+
+	// Listens on 127.0.0.1; port 0 picks a free port (see LocalPort)
+	static TcpSocket ListenLoopback(uint16_t port = 0);
+	TcpSocket Accept();
+	uint16_t LocalPort() const;
+
+	void SendAll(const char* data, size_t size);
+	size_t Receive(char* buffer, size_t size); // 0 = connection closed
+	void Close();
+	bool IsOpen() const;
+
+private:
+	explicit TcpSocket(SocketHandle handle) : m_handle(handle) {}
+	SocketHandle m_handle = InvalidHandle();
+	static SocketHandle InvalidHandle();
+};
+
+struct HttpRequest
+{
+	std::string method = "GET";
+	std::string host;
+	uint16_t port = 80;
+	std::string target = "/"; // Already-encoded path plus optional "?query"
+	std::vector<std::pair<std::string, std::string>> headers; // Host and Content-Length are added when sending
+	std::string body;
+};
+
+struct HttpResponse
+{
+	int status = 0;
+	std::map<std::string, std::string> headers; // Lowercase names
+	std::string body;
+
+	std::string Header(const std::string& lowercaseName) const;
+};
+
+struct HttpUrl
+{
+	std::string host;
+	uint16_t port = 80;
+	std::string basePath; // Without trailing slash, "" for the root
+};
+
+/**
+ * @brief Parses "http://host[:port][/path]". Throws HttpError for other schemes (https is not supported).
+ */
+HttpUrl ParseHttpUrl(const std::string& url);
+
+/**
+ * @brief Sends one request and reads the whole response (Content-Length, chunked, or until close).
+ * Throws HttpError on connection or protocol errors; HTTP error statuses are returned normally.
+ */
+HttpResponse SendHttpRequest(const HttpRequest& request, std::chrono::milliseconds timeout = std::chrono::seconds(60));
+
+/**
+ * @brief Reads one HTTP message head plus body (used by the client and by test servers).
+ * Connections carry a single message each way, so nothing after the body is kept.
+ * @param isRequest Parse a request line ("PUT /x HTTP/1.1") instead of a status line.
+ * @param firstLine Receives the request or status line.
+ * @param headOnly The message has no body whatever its headers say (a response to HEAD).
+ * @return False if the peer closed the connection before sending anything.
+ */
+bool ReadHttpMessage(TcpSocket& socket, bool isRequest, std::string& firstLine, std::map<std::string, std::string>& headers, std::string& body, bool headOnly = false);
+
+/**
+ * @brief Percent-encodes everything except RFC 3986 unreserved characters (and '/' if keepSlash).
+ */
+std::string UriEncode(const std::string& text, bool keepSlash);
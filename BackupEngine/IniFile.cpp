@@ -0,0 +1,364 @@
+#include "IniFile.h"
+#include "EngineUtils.h"
+
+#include <cwctype>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+#ifdef _WIN32
+	const char* kLineEnding = "\r\n";
+#else
+	const char* kLineEnding = "\n";
+#endif
+
+	wstring Trim(const wstring& s)
+	{
+		size_t start = s.find_first_not_of(L" \t\r");
+		if (start == wstring::npos) return L"";
+		size_t end = s.find_last_not_of(L" \t\r");
+		return s.substr(start, end - start + 1);
+	}
+
+	// Lookup key for the hash indexes; section and key names are case-insensitive
+	wstring Fold(const wstring& s)
+	{
+		wstring folded(s);
+		for (auto& c : folded) c = static_cast<wchar_t>(towlower(c));
+		return folded;
+	}
+
+	/**
+	 * @brief Reads the whole file and splits it into lines. Handles UTF-8 (with or
+	 * without BOM) and UTF-16LE files, which is what WritePrivateProfileStringW may leave behind.
+	 */
+	vector<wstring> ReadLines(const fs::path& file)
+	{
+		vector<wstring> lines;
+		ifstream in(file, ios::binary);
+		if (!in.is_open()) return lines;
+		string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+		wstring text;
+		if (bytes.size() >= 2 && static_cast<unsigned char>(bytes[0]) == 0xFF && static_cast<unsigned char>(bytes[1]) == 0xFE)
+		{
+			// UTF-16LE: rebuild as UTF-8 first so surrogate pairs are handled in one place
+			u16string utf16;
+			for (size_t i = 2; i + 1 < bytes.size(); i += 2)
+			{
+				utf16.push_back(static_cast<char16_t>(static_cast<unsigned char>(bytes[i]) | (static_cast<unsigned char>(bytes[i + 1]) << 8)));
+			}
+			wstring wide;
+			for (size_t i = 0; i < utf16.size(); ++i)
+			{
+				char32_t cp = utf16[i];
+				if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < utf16.size())
+				{
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (utf16[i + 1] - 0xDC00);
+					++i;
+				}
+				if (sizeof(wchar_t) == 2 && cp >= 0x10000)
+				{
+					wide.push_back(static_cast<wchar_t>(0xD800 + ((cp - 0x10000) >> 10)));
+					wide.push_back(static_cast<wchar_t>(0xDC00 + ((cp - 0x10000) & 0x3FF)));
+				}
+				else
+				{
+					wide.push_back(static_cast<wchar_t>(cp));
+				}
+			}
+			text = wide;
+		}
+		else
+		{
+			if (bytes.size() >= 3 && bytes.compare(0, 3, "\xEF\xBB\xBF") == 0) bytes.erase(0, 3); // Skip UTF-8 BOM
+			text = s2ws(bytes);
+		}
+
+		size_t start = 0;
+		while (start <= text.size())
+		{
+			size_t end = text.find(L'\n', start);
+			if (end == wstring::npos)
+			{
+				if (start < text.size()) lines.push_back(text.substr(start));
+				break;
+			}
+			lines.push_back(text.substr(start, end - start));
+			start = end + 1;
+		}
+		for (auto& line : lines)
+		{
+			if (!line.empty() && line.back() == L'\r') line.pop_back();
+		}
+		return lines;
+	}
+
+	// Returns the section name if the line is a "[Section]" header.
+	bool ParseSectionHeader(const wstring& line, wstring& name)
+	{
+		wstring t = Trim(line);
+		if (t.size() < 2 || t.front() != L'[') return false;
+		size_t close = t.find(L']');
+		if (close == wstring::npos) return false;
+		name = Trim(t.substr(1, close - 1));
+		return true;
+	}
+
+	// Splits "key=value" and returns false for comments and blank lines.
+	bool ParseKeyValue(const wstring& line, wstring& key, wstring& value)
+	{
+		wstring t = Trim(line);
+		if (t.empty() || t[0] == L';' || t[0] == L'#') return false;
+		size_t eq = t.find(L'=');
+		if (eq == wstring::npos) return false;
+		key = Trim(t.substr(0, eq));
+		value = Trim(t.substr(eq + 1));
+		// GetPrivateProfileString strips one pair of surrounding quotes
+		if (value.size() >= 2 && ((value.front() == L'"' && value.back() == L'"') || (value.front() == L'\'' && value.back() == L'\'')))
+		{
+			value = value.substr(1, value.size() - 2);
+		}
+		return true;
+	}
+}
+
+IniDocument IniDocument::Load(const fs::path& file)
+{
+	IniDocument doc;
+	for (auto& line : ReadLines(file))
+	{
+		wstring name, key, value;
+		if (ParseSectionHeader(line, name))
+		{
+			Section section;
+			section.name = name;
+			section.header = move(line);
+			doc.m_sections.push_back(move(section));
+			continue;
+		}
+		if (doc.m_sections.empty())
+		{
+			doc.m_preamble.push_back(move(line)); // Keys outside a section are ignored, as in Win32
+			continue;
+		}
+
+		Section& section = doc.m_sections.back();
+		Line entry;
+		entry.isKey = ParseKeyValue(line, key, value);
+		entry.text = move(line);
+		if (entry.isKey)
+		{
+			section.keys.emplace(Fold(key), section.lines.size()); // emplace keeps the first duplicate
+			section.keyLinesEnd = section.lines.size() + 1;
+			entry.key = move(key);
+			entry.value = move(value);
+		}
+		section.lines.push_back(move(entry));
+	}
+	doc.RebuildSectionIndex();
+	return doc;
+}
+
+bool IniDocument::Save(const fs::path& file) const
+{
+	string bytes;
+	auto append = [&](const wstring& line)
+		{
+			bytes += ws2s(line);
+			bytes += kLineEnding;
+		};
+	for (const auto& line : m_preamble) append(line);
+	for (const auto& section : m_sections)
+	{
+		append(section.header);
+		for (const auto& line : section.lines) append(line.text);
+	}
+
+	fs::path temp = file;
+	temp += ".tmp";
+	{
+		ofstream out(temp, ios::binary | ios::trunc);
+		if (!out.is_open()) return false;
+		out.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+		if (!out.flush())
+		{
+			out.close();
+			error_code ignored;
+			fs::remove(temp, ignored);
+			return false;
+		}
+	}
+
+	error_code ec;
+	fs::rename(temp, file, ec); // Replaces the old file in one step
+	if (ec)
+	{
+		fs::remove(temp, ec);
+		return false;
+	}
+	return true;
+}
+
+const IniDocument::Section* IniDocument::FindSection(const wstring& name) const
+{
+	auto it = m_sectionIndex.find(Fold(name));
+	return it == m_sectionIndex.end() ? nullptr : &m_sections[it->second];
+}
+
+void IniDocument::RebuildSectionIndex()
+{
+	m_sectionIndex.clear();
+	m_sectionIndex.reserve(m_sections.size());
+	for (size_t i = 0; i < m_sections.size(); ++i)
+	{
+		m_sectionIndex.emplace(Fold(m_sections[i].name), i);
+	}
+}
+
+wstring IniDocument::GetString(const wstring& section, const wstring& key, const wstring& defaultValue) const
+{
+	const Section* found = FindSection(section);
+	if (!found) return defaultValue;
+	auto it = found->keys.find(Fold(key));
+	return it == found->keys.end() ? defaultValue : found->lines[it->second].value;
+}
+
+int IniDocument::GetInt(const wstring& section, const wstring& key, int defaultValue) const
+{
+	wstring value = GetString(section, key, L"");
+	if (value.empty()) return defaultValue;
+	try
+	{
+		return stoi(value);
+	}
+	catch (...)
+	{
+		return defaultValue;
+	}
+}
+
+void IniDocument::SetString(const wstring& section, const wstring& key, const wstring& value)
+{
+	wstring foldedSection = Fold(section);
+	auto sectionIt = m_sectionIndex.find(foldedSection);
+	if (sectionIt == m_sectionIndex.end())
+	{
+		Section added;
+		added.name = section;
+		added.header = L"[" + section + L"]";
+		sectionIt = m_sectionIndex.emplace(foldedSection, m_sections.size()).first;
+		m_sections.push_back(move(added));
+	}
+
+	Section& target = m_sections[sectionIt->second];
+	wstring foldedKey = Fold(key);
+	auto keyIt = target.keys.find(foldedKey);
+	if (keyIt != target.keys.end())
+	{
+		Line& line = target.lines[keyIt->second];
+		line.text = line.key + L"=" + value; // Replace in place, keeping the original key spelling
+		line.value = value;
+		return;
+	}
+
+	// Only non-key lines (comments, blanks) follow keyLinesEnd, so existing key indexes stay valid
+	Line line;
+	line.isKey = true;
+	line.key = key;
+	line.value = value;
+	line.text = key + L"=" + value;
+	target.lines.insert(target.lines.begin() + static_cast<ptrdiff_t>(target.keyLinesEnd), move(line));
+	target.keys.emplace(foldedKey, target.keyLinesEnd);
+	target.keyLinesEnd++;
+}
+
+bool IniDocument::RemoveKey(const wstring& section, const wstring& key)
+{
+	auto sectionIt = m_sectionIndex.find(Fold(section));
+	if (sectionIt == m_sectionIndex.end()) return false;
+	Section& target = m_sections[sectionIt->second];
+	auto keyIt = target.keys.find(Fold(key));
+	if (keyIt == target.keys.end()) return false;
+
+	size_t removed = keyIt->second;
+	target.lines.erase(target.lines.begin() + static_cast<ptrdiff_t>(removed));
+	target.keys.erase(keyIt);
+	for (auto& entry : target.keys)
+	{
+		if (entry.second > removed) entry.second--;
+	}
+	// A later duplicate of the removed key becomes visible, as it would after re-reading the file
+	target.keyLinesEnd = 0;
+	for (size_t i = 0; i < target.lines.size(); ++i)
+	{
+		if (!target.lines[i].isKey) continue;
+		target.keys.emplace(Fold(target.lines[i].key), i);
+		target.keyLinesEnd = i + 1;
+	}
+	return true;
+}
+
+bool IniDocument::RemoveSection(const wstring& section)
+{
+	wstring folded = Fold(section);
+	if (m_sectionIndex.find(folded) == m_sectionIndex.end()) return false;
+
+	size_t kept = 0;
+	for (size_t i = 0; i < m_sections.size(); ++i)
+	{
+		if (Fold(m_sections[i].name) == folded) continue; // Drops duplicates too
+		if (kept != i) m_sections[kept] = move(m_sections[i]);
+		kept++;
+	}
+	m_sections.resize(kept);
+	RebuildSectionIndex();
+	return true;
+}
+
+bool IniDocument::HasSection(const wstring& section) const
+{
+	return FindSection(section) != nullptr;
+}
+
+vector<wstring> IniDocument::SectionNames() const
+{
+	vector<wstring> names;
+	names.reserve(m_sections.size());
+	for (const auto& section : m_sections) names.push_back(section.name);
+	return names;
+}
+
+wstring ReadIniString(const fs::path& file, const wstring& section, const wstring& key, const wstring& defaultValue)
+{
+	return IniDocument::Load(file).GetString(section, key, defaultValue);
+}
+
+int ReadIniInt(const fs::path& file, const wstring& section, const wstring& key, int defaultValue)
+{
+	return IniDocument::Load(file).GetInt(section, key, defaultValue);
+}
+
+vector<wstring> ReadIniSectionNames(const fs::path& file)
+{
+	return IniDocument::Load(file).SectionNames();
+}
+
+bool WriteIniString(const fs::path& file, const wstring& section, const wstring& key, const wstring& value)
+{
+	IniDocument doc = IniDocument::Load(file);
+	doc.SetString(section, key, value);
+	return doc.Save(file);
+}
+
+bool DeleteIniSection(const fs::path& file, const wstring& section)
+{
+	IniDocument doc = IniDocument::Load(file);
+	if (!doc.RemoveSection(section)) return true; // Nothing to delete
+	return doc.Save(file);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+// Portable replacements for the Win32 GetPrivateProfile*/WritePrivateProfile* calls.
+// Semantics follow the Win32 API: section and key names are case-insensitive, the first
+// of duplicate sections/keys wins, and a missing file reads as empty.
+//
+// IniDocument parses a file once into memory (hashed section and key lookup) and writes
+// it back atomically. The free functions below are one-shot wrappers that load, read or
+// modify, and save on every call; prefer IniDocument when touching more than one key.
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class IniDocument
+{
+public:
+	/**
+	 * @brief Parses a file (UTF-8 with or without BOM, or UTF-16LE). A missing file gives an empty document.
+	 */
+	static IniDocument Load(const std::filesystem::path& file);
+
+	/**
+	 * @brief Writes the document as UTF-8 to a temporary file and renames it over `file`,
+	 * so readers never see a half-written config. Comments and key order are preserved.
+	 * @return False if the file could not be written.
+	 */
+	bool Save(const std::filesystem::path& file) const;
+
+	std::wstring GetString(const std::wstring& section, const std::wstring& key, const std::wstring& defaultValue) const;
+	int GetInt(const std::wstring& section, const std::wstring& key, int defaultValue) const;
+
+	/**
+	 * @brief Sets a key, replacing it in place or adding it after the section's last key.
+	 * A missing section is appended to the end of the document.
+	 */
+	void SetString(const std::wstring& section, const std::wstring& key, const std::wstring& value);
+
+	/**
+	 * @brief Removes a key from the first section with this name. Returns false if it was not there.
+	 */
+	bool RemoveKey(const std::wstring& section, const std::wstring& key);
+
+	/**
+	 * @brief Removes every section with this name. Returns false if there was none.
+	 */
+	bool RemoveSection(const std::wstring& section);
+
+	bool HasSection(const std::wstring& section) const;
+
+	// Section names in file order (duplicates included, like GetPrivateProfileSectionNames)
+	std::vector<std::wstring> SectionNames() const;
+
+private:
+	struct Line
+	{
+		std::wstring text;  // Raw line as written to the file
+		bool isKey = false;
+		std::wstring key;   // Parsed key/value when isKey
+		std::wstring value;
+	};
+
+	struct Section
+	{
+		std::wstring name;
+		std::wstring header;                          // Raw "[Name]" line
+		std::vector<Line> lines;
+		std::unordered_map<std::wstring, size_t> keys; // Folded key -> first line with that key
+		size_t keyLinesEnd = 0;                        // One past the last key line (new keys go here)
+	};
+
+	const Section* FindSection(const std::wstring& name) const;
+	void RebuildSectionIndex();
+
+	std::vector<std::wstring> m_preamble;               // Lines before the first section
+	std::vector<Section> m_sections;
+	std::unordered_map<std::wstring, size_t> m_sectionIndex; // Folded name -> first section with that name
+};
+
+/**
+ * @brief Reads a string value, or returns defaultValue if the section/key is missing.
+ */
+std::wstring ReadIniString(const std::filesystem::path& file, const std::wstring& section, const std::wstring& key, const std::wstring& defaultValue);
+
+/**
+ * @brief Reads an integer value, or returns defaultValue if missing or not numeric.
+ */
+int ReadIniInt(const std::filesystem::path& file, const std::wstring& section, const std::wstring& key, int defaultValue);
+
+/**
+ * @brief Returns all section names in file order.
+ */
+std::vector<std::wstring> ReadIniSectionNames(const std::filesystem::path& file);
+
+/**
+ * @brief Writes (creating or replacing) a key inside a section. Creates the file if needed.
+ * @return False if the file could not be written.
+ */
+bool WriteIniString(const std::filesystem::path& file, const std::wstring& section, const std::wstring& key, const std::wstring& value);
+
+/**
+ * @brief Removes a whole section and all of its keys.
+ * @return False if the file could not be written.
+ */
+bool DeleteIniSection(const std::filesystem::path& file, const std::wstring& section);
@@ -0,0 +1,76 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+size_t LatencyHistogram::BucketIndex(uint64_t micros)
+{
+	if (micros < kSubBucketCount) return static_cast<size_t>(micros);
+
+	int exponent = 0; // Shift that brings the value into [kSubBucketHalf, kSubBucketCount)
+	while ((micros >> exponent) >= kSubBucketCount) ++exponent;
+	if (exponent > kExponents) return kBucketCount - 1; // Clamp absurd values into the last bucket
+	return static_cast<size_t>(kSubBucketCount + (exponent - 1) * kSubBucketHalf + ((micros >> exponent) - kSubBucketHalf));
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index)
+{
+	if (index < kSubBucketCount) return index;
+
+	size_t offset = index - kSubBucketCount;
+	int exponent = static_cast<int>(offset / kSubBucketHalf) + 1;
+	uint64_t subBucket = offset % kSubBucketHalf + kSubBucketHalf;
+	return ((subBucket + 1) << exponent) - 1;
+}
+
+void LatencyHistogram::Record(chrono::nanoseconds latency)
+{
+	uint64_t micros = static_cast<uint64_t>(max<int64_t>(0, chrono::duration_cast<chrono::microseconds>(latency).count()));
+	m_buckets[BucketIndex(micros)].fetch_add(1, memory_order_relaxed);
+	m_count.fetch_add(1, memory_order_relaxed);
+
+	uint64_t previous = m_max.load(memory_order_relaxed);
+	while (micros > previous && !m_max.compare_exchange_weak(previous, micros, memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::Reset()
+{
+	for (auto& bucket : m_buckets) bucket.store(0, memory_order_relaxed);
+	m_count.store(0, memory_order_relaxed);
+	m_max.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::PercentileMicros(double quantile) const
+{
+	uint64_t total = Count();
+	if (total == 0) return 0;
+
+	// Rank of the sample at the quantile (1-based, rounded up like HdrHistogram)
+	uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.999999));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < kBucketCount; ++i)
+	{
+		seen += m_buckets[i].load(memory_order_relaxed);
+		if (seen >= rank) return min(BucketUpperBound(i), MaxMicros());
+	}
+	return MaxMicros();
+}
+
+wstring LatencyHistogram::Summary() const
+{
+	auto ms = [](uint64_t micros) { return static_cast<double>(micros) / 1000.0; };
+	return FormatSummary(Count(), ms(PercentileMicros(0.50)), ms(PercentileMicros(0.99)), ms(MaxMicros()));
+}
+
+wstring LatencyHistogram::FormatSummary(uint64_t count, double p50Ms, double p99Ms, double maxMs)
+{
+	if (count == 0) return L"no samples";
+
+	wostringstream out;
+	out << fixed << setprecision(1)
+		<< L"p50 " << p50Ms << L" ms | p99 " << p99Ms << L" ms | max " << maxMs << L" ms (n=" << count << L")";
+	return out.str();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief High-dynamic-range latency histogram (HdrHistogram-style log-linear buckets).
+ * Covers 1 microsecond to ~19 hours with about 1.6% relative error, so one histogram can
+ * hold both a 3 ms hotkey restore and a 10 minute cloud sync. Record() is lock-free and
+ * Reset() is a few thousand relaxed stores, cheap enough to call from a hotkey.
+ */
+class LatencyHistogram
+{
+public:
+	LatencyHistogram() { Reset(); }
+
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+	void Record(std::chrono::nanoseconds latency);
+	void Reset();
+
+	uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+	// Value at the given quantile (0..1) in microseconds; 0 when empty
+	uint64_t PercentileMicros(double quantile) const;
+	uint64_t MaxMicros() const { return m_max.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Formats "p50 12 ms | p99 40 ms | max 55 ms (n=5)", or "no samples".
+	 */
+	std::wstring Summary() const;
+	// The same for figures read back from an exported snapshot
+	static std::wstring FormatSummary(uint64_t count, double p50Ms, double p99Ms, double maxMs);
+
+private:
+	static constexpr int kSubBucketBits = 7; // 128 linear sub-buckets per power of two
+	static constexpr uint64_t kSubBucketCount = uint64_t(1) << kSubBucketBits;
+	static constexpr uint64_t kSubBucketHalf = kSubBucketCount / 2;
+	static constexpr int kExponents = 30;    // Values up to 2^36 us
+	static constexpr size_t kBucketCount = kSubBucketCount + kExponents * kSubBucketHalf;
+
+	static size_t BucketIndex(uint64_t micros);
+	static uint64_t BucketUpperBound(size_t index);
+
+	std::array<std::atomic<uint64_t>, kBucketCount> m_buckets;
+	std::atomic<uint64_t> m_count;
+	std::atomic<uint64_t> m_max;
+};
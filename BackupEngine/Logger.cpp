@@ -0,0 +1,302 @@
+#include "Logger.h"
+#include "EngineUtils.h"
+
+#include <algorithm>
+#include <cwchar>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	static_assert((Logger::kQueueCapacity & (Logger::kQueueCapacity - 1)) == 0, "Queue capacity must be a power of two");
+
+	constexpr int kFullRetries = 64; // Yields before a record is dropped on a full queue
+
+#ifdef _WIN32
+	const char* const kNewline = "\r\n";
+#else
+	const char* const kNewline = "\n";
+#endif
+
+	// Copies text into a fixed buffer, marking truncation with "..."
+	template <size_t N>
+	void CopyField(wchar_t(&target)[N], wstring_view text)
+	{
+		size_t length = min(text.size(), N - 1);
+		wmemcpy(target, text.data(), length);
+		target[length] = L'\0';
+		if (length < text.size() && N > 4)
+		{
+			target[length - 1] = target[length - 2] = target[length - 3] = L'.';
+		}
+	}
+
+	const wchar_t* LevelName(LogLevel level)
+	{
+		switch (level)
+		{
+		case LogLevel::Debug: return L"DEBUG";
+		case LogLevel::Info: return L"INFO ";
+		case LogLevel::Warning: return L"WARN ";
+		case LogLevel::Error: return L"ERROR";
+		}
+		return L"?????";
+	}
+}
+
+Logger::Logger() : m_slots(new Slot[kQueueCapacity])
+{
+	for (size_t i = 0; i < kQueueCapacity; ++i)
+	{
+		m_slots[i].sequence.store(i, memory_order_relaxed);
+	}
+}
+
+Logger::~Logger()
+{
+	Stop();
+}
+
+void Logger::Start(const LoggerOptions& options)
+{
+	Stop();
+	m_options = options;
+	OpenLogFile();
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopRequested = false;
+	}
+	m_thread = thread(&Logger::WriterThread, this);
+}
+
+void Logger::Stop()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopRequested = true;
+	}
+	m_wake.notify_all();
+	if (m_thread.joinable()) m_thread.join(); // The writer drains the queue before exiting
+	m_file.close();
+}
+
+bool Logger::Log(LogLevel level, wstring_view game, wstring_view operation, wstring_view message)
+{
+	return Enqueue(level, false, game, operation, message);
+}
+
+bool Logger::Separator()
+{
+	return Enqueue(LogLevel::Info, true, {}, {}, L"--------------------------------------------------");
+}
+
+bool Logger::Enqueue(LogLevel level, bool consoleOnly, wstring_view game, wstring_view operation, wstring_view message)
+{
+	// A long message takes consecutive slots, claimed at once so no other record lands between
+	constexpr size_t kPerRecord = LogRecord::kMaxMessage - 1;
+	const size_t records = min(kMaxSpill, max<size_t>(1, (message.size() + kPerRecord - 1) / kPerRecord));
+
+	size_t pos = m_enqueuePos.load(memory_order_relaxed);
+	int attempts = 0;
+	while (true)
+	{
+		Slot& slot = m_slots[pos & (kQueueCapacity - 1)];
+		size_t sequence = slot.sequence.load(memory_order_acquire);
+		auto diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+		bool runFree = true;
+		for (size_t i = 1; diff == 0 && i < records && runFree; ++i)
+		{
+			runFree = m_slots[(pos + i) & (kQueueCapacity - 1)].sequence.load(memory_order_acquire) == pos + i;
+		}
+		if (diff == 0 && runFree)
+		{
+			// Slots are free for these positions; claim them
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + records, memory_order_relaxed))
+			{
+				auto now = chrono::system_clock::now();
+				for (size_t i = 0; i < records; ++i)
+				{
+					Slot& part = m_slots[(pos + i) & (kQueueCapacity - 1)];
+					LogRecord& record = part.record;
+					record.timestamp = now;
+					record.level = level;
+					record.consoleOnly = consoleOnly;
+					record.continued = i + 1 < records;
+					CopyField(record.game, game);
+					CopyField(record.operation, operation);
+					CopyField(record.message, record.continued ? message.substr(i * kPerRecord, kPerRecord) : message.substr(i * kPerRecord)); // The last one is cut if still too long
+					part.sequence.store(pos + i + 1, memory_order_release); // Publish to the writer
+				}
+				m_wake.notify_one();
+				return true;
+			}
+		}
+		else if (diff < 0 || (diff == 0 && !runFree))
+		{
+			// Queue is full; give the writer a moment before dropping
+			if (++attempts > kFullRetries)
+			{
+				m_dropped.fetch_add(1, memory_order_relaxed);
+				return false;
+			}
+			this_thread::yield();
+			pos = m_enqueuePos.load(memory_order_relaxed);
+		}
+		else
+		{
+			pos = m_enqueuePos.load(memory_order_relaxed); // Another producer took this slot
+		}
+	}
+}
+
+bool Logger::TryDequeue(LogRecord& record)
+{
+	size_t pos = m_dequeuePos.load(memory_order_relaxed);
+	Slot& slot = m_slots[pos & (kQueueCapacity - 1)];
+	if (slot.sequence.load(memory_order_acquire) != pos + 1) return false; // Empty, or still being filled
+
+	record = slot.record;
+	slot.sequence.store(pos + kQueueCapacity, memory_order_release); // Hand the slot back to producers
+	m_dequeuePos.store(pos + 1, memory_order_relaxed);
+	return true;
+}
+
+void Logger::Flush()
+{
+	size_t target = m_enqueuePos.load(memory_order_relaxed);
+	unique_lock<mutex> lock(m_mutex);
+	if (!m_thread.joinable()) return;
+	m_wake.notify_one();
+	// Timed wait: a producer may still be filling a claimed slot
+	while (m_writtenPos < target && m_thread.joinable())
+	{
+		m_written.wait_for(lock, chrono::milliseconds(50));
+	}
+}
+
+void Logger::WriterThread()
+{
+	LogRecord record;
+	while (true)
+	{
+		bool wroteAny = false;
+		while (TryDequeue(record))
+		{
+			Write(record);
+			wroteAny = true;
+		}
+		if (wroteAny)
+		{
+			// One flush per batch instead of one per line
+			if (m_options.console) m_options.console->flush();
+			if (m_file.is_open()) m_file.flush();
+		}
+
+		unique_lock<mutex> lock(m_mutex);
+		m_writtenPos = m_dequeuePos.load(memory_order_relaxed);
+		m_written.notify_all();
+		size_t pos = m_dequeuePos.load(memory_order_relaxed);
+		bool pending = m_slots[pos & (kQueueCapacity - 1)].sequence.load(memory_order_acquire) == pos + 1;
+		if (m_stopRequested && !pending) return;
+		// Producers notify without the lock, so a wake-up can be missed; the timeout bounds that delay
+		if (!pending) m_wake.wait_for(lock, chrono::milliseconds(50));
+	}
+}
+
+void Logger::Write(const LogRecord& record)
+{
+	// Spilled records arrive together and in order: joined, then written as one line
+	if (record.continued)
+	{
+		m_spilled += record.message;
+		return;
+	}
+	wstring_view message = record.message;
+	if (!m_spilled.empty())
+	{
+		m_spilled += record.message;
+		message = m_spilled;
+	}
+	WriteLine(record, message);
+	m_spilled.clear();
+}
+
+void Logger::WriteLine(const LogRecord& record, wstring_view message)
+{
+	if (m_options.console)
+	{
+		*m_options.console << message << L'\n';
+	}
+	if (!m_file.is_open() || record.consoleOnly) return;
+
+	string line = ws2s(FormatFileLine(record, message)) + kNewline;
+	if (m_fileBytes > 0 && m_fileBytes + line.size() > m_options.maxFileBytes)
+	{
+		RotateLogFile();
+		if (!m_file.is_open()) return;
+	}
+	m_file.write(line.data(), static_cast<streamsize>(line.size()));
+	m_fileBytes += line.size();
+}
+
+void Logger::OpenLogFile()
+{
+	m_file.close();
+	m_fileBytes = 0;
+	if (m_options.logFile.empty()) return;
+
+	error_code ec;
+	fs::create_directories(m_options.logFile.parent_path(), ec);
+	m_fileBytes = fs::exists(m_options.logFile, ec) ? fs::file_size(m_options.logFile, ec) : 0;
+	if (ec) m_fileBytes = 0;
+	m_file.open(m_options.logFile, ios::binary | ios::app);
+}
+
+void Logger::RotateLogFile()
+{
+	m_file.close();
+	auto rotated = [&](int index)
+		{
+			fs::path file = m_options.logFile;
+			if (index > 0) file += "." + to_string(index);
+			return file;
+		};
+
+	// GameSaveBackupManager.log -> .log.1 -> .log.2 ..., dropping the oldest
+	error_code ec;
+	fs::remove(rotated(max(1, m_options.maxFiles - 1)), ec);
+	for (int i = max(1, m_options.maxFiles - 1); i > 0; --i)
+	{
+		if (fs::exists(rotated(i - 1), ec)) fs::rename(rotated(i - 1), rotated(i), ec);
+	}
+	m_file.open(m_options.logFile, ios::binary | ios::trunc);
+	m_fileBytes = 0;
+}
+
+wstring Logger::FormatFileLine(const LogRecord& record)
+{
+	return FormatFileLine(record, record.message);
+}
+
+wstring Logger::FormatFileLine(const LogRecord& record, wstring_view message)
+{
+	time_t seconds = chrono::system_clock::to_time_t(record.timestamp);
+	auto millis = chrono::duration_cast<chrono::milliseconds>(record.timestamp.time_since_epoch()).count() % 1000;
+	tm local = LocalTime(seconds);
+
+	wostringstream out;
+	out << put_time(&local, L"%Y-%m-%d %H:%M:%S") << L'.' << setw(3) << setfill(L'0') << millis << L' '
+		<< LevelName(record.level) << L" [" << (record.game[0] ? record.game : L"-") << L"] ["
+		<< (record.operation[0] ? record.operation : L"-") << L"] " << message;
+	return out.str();
+}
+
+Logger& GetLogger()
+{
+	static Logger logger;
+	return logger;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+// Asynchronous structured logger. Any thread can call Log(); records go into a fixed-size
+// lock-free ring (multi-producer, single-consumer) and one writer thread prints them to the
+// console and appends them to a rotating log file. Logging never allocates on the caller's
+// thread: game, operation and message are copied (and truncated if needed) into the slot. A
+// message too long for one slot spills over into the next ones, claimed together, and the
+// writer joins it back into one line.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class LogLevel
+{
+	Debug,
+	Info,
+	Warning,
+	Error
+};
+
+/**
+ * @brief One log entry as stored in the queue. Fixed size so slots can be reused without allocating.
+ */
+struct LogRecord
+{
+	static constexpr size_t kMaxGame = 64;
+	static constexpr size_t kMaxOperation = 16;
+	static constexpr size_t kMaxMessage = 384;
+
+	std::chrono::system_clock::time_point timestamp;
+	LogLevel level = LogLevel::Info;
+	bool consoleOnly = false; // Visual separators are not written to the log file
+	bool continued = false;   // The message goes on in the next record (spilled, see Logger::Log)
+	wchar_t game[kMaxGame] = {};
+	wchar_t operation[kMaxOperation] = {};
+	wchar_t message[kMaxMessage] = {};
+};
+
+struct LoggerOptions
+{
+	std::wostream* console = nullptr; // Usually &std::wcout; nullptr disables console output
+	std::filesystem::path logFile;    // Empty disables the log file
+	uintmax_t maxFileBytes = 1024 * 1024;
+	int maxFiles = 3;                 // Current file plus rotated ".1", ".2", ...
+};
+
+class Logger
+{
+public:
+	static constexpr size_t kQueueCapacity = 1024; // Power of two
+	static constexpr size_t kMaxSpill = 8;         // Records one message may fill; beyond that it is cut, ending in "..."
+
+	Logger();
+	~Logger();
+
+	Logger(const Logger&) = delete;
+	Logger& operator=(const Logger&) = delete;
+
+	/**
+	 * @brief Starts the writer thread. Records logged before Start() are kept and written then.
+	 */
+	void Start(const LoggerOptions& options);
+
+	/**
+	 * @brief Writes everything still queued, then stops the writer thread.
+	 */
+	void Stop();
+
+	/**
+	 * @brief Queues a record. Never blocks for long and never allocates. A message longer than
+	 * LogRecord::kMaxMessage - 1 characters takes up to kMaxSpill consecutive records.
+	 * @return False if the queue stayed full and the record was dropped (counted in Dropped()).
+	 */
+	bool Log(LogLevel level, std::wstring_view game, std::wstring_view operation, std::wstring_view message);
+
+	/**
+	 * @brief Queues a console-only separator line ("-----...") shown after each operation.
+	 */
+	bool Separator();
+
+	/**
+	 * @brief Waits until every record queued so far has been written. No-op if not running.
+	 */
+	void Flush();
+
+	uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Formats a record as a log file line (without the trailing newline):
+	 * "YYYY-MM-DD HH:MM:SS.mmm LEVEL [game] [operation] message". `message` replaces the
+	 * record's own, for one joined from spilled records.
+	 */
+	static std::wstring FormatFileLine(const LogRecord& record);
+	static std::wstring FormatFileLine(const LogRecord& record, std::wstring_view message);
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		LogRecord record;
+	};
+
+	bool Enqueue(LogLevel level, bool consoleOnly, std::wstring_view game, std::wstring_view operation, std::wstring_view message);
+	bool TryDequeue(LogRecord& record);
+	void WriterThread();
+	void Write(const LogRecord& record);
+	void WriteLine(const LogRecord& record, std::wstring_view message);
+	void OpenLogFile();
+	void RotateLogFile();
+
+	std::unique_ptr<Slot[]> m_slots;
+	std::atomic<size_t> m_enqueuePos{ 0 };
+	std::atomic<size_t> m_dequeuePos{ 0 };
+	std::atomic<uint64_t> m_dropped{ 0 };
+
+	LoggerOptions m_options;
+	std::wstring m_spilled; // Writer thread: the start of a message still being joined
+	std::ofstream m_file;
+	uintmax_t m_fileBytes = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;    // Writer waits here when the queue is empty
+	std::condition_variable m_written; // Flush() waits here
+	size_t m_writtenPos = 0;           // Guarded by m_mutex
+	bool m_stopRequested = false;
+	std::thread m_thread;
+};
+
+/**
+ * @brief Process-wide logger used by the console front-end.
+ */
+Logger& GetLogger();
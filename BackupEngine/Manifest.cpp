@@ -0,0 +1,189 @@
+#include "Manifest.h"
+#include "EngineUtils.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const char* const kManifestHeader = "GSBM-MANIFEST 1";
+
+	// Parse() is on the path of every diff and restore browse, so it walks the text in place:
+	// a 100k-file index should load in tens of milliseconds, not a stream per line
+	template <typename T>
+	T ParseNumber(const char* begin, const char* end, const string& line)
+	{
+		T value = 0;
+		auto [ptr, ec] = from_chars(begin, end, value);
+		if (begin == end || ec != errc() || ptr != end)
+		{
+			throw ManifestError("Malformed manifest line: " + line);
+		}
+		return value;
+	}
+
+	string UnescapeField(const char* begin, const char* end)
+	{
+		if (find(begin, end, '\\') == end) return string(begin, end);
+		return UnescapeTabField(string(begin, end));
+	}
+}
+
+uint64_t BackupManifest::TotalBytes() const
+{
+	uint64_t total = 0;
+	for (const auto& entry : entries)
+	{
+		if (entry.type == fs::file_type::regular) total += entry.size;
+	}
+	return total;
+}
+
+string BackupManifest::Serialize() const
+{
+	string out = kManifestHeader;
+	out += '\n';
+	for (const auto& entry : entries)
+	{
+		switch (entry.type)
+		{
+		case fs::file_type::directory:
+			out += "D\t" + EscapeTabField(entry.path) + "\n";
+			break;
+		case fs::file_type::symlink:
+			out += "L\t" + EscapeTabField(entry.path) + "\t" + EscapeTabField(entry.linkTarget) + "\n";
+			break;
+		default:
+			out += "F\t" + EscapeTabField(entry.path) + "\t" + to_string(entry.size) + "\t" + to_string(entry.mtime) + "\t" + entry.sha256 + "\t";
+			for (size_t i = 0; i < entry.chunks.size(); ++i)
+			{
+				if (i) out += ',';
+				out += entry.chunks[i].id + ":" + to_string(entry.chunks[i].size);
+			}
+			if (entry.sparse)
+			{
+				out += '\t';
+				for (size_t i = 0; i < entry.extents.size(); ++i)
+				{
+					if (i) out += ',';
+					out += to_string(entry.extents[i].offset) + "+" + to_string(entry.extents[i].length);
+				}
+			}
+			out += '\n';
+		}
+	}
+	return out;
+}
+
+BackupManifest BackupManifest::Select(const vector<string>& paths) const
+{
+	vector<string> prefixes;
+	for (string path : paths)
+	{
+		while (!path.empty() && path.back() == '/') path.pop_back();
+		if (path.empty() || path == ".") return *this;
+		prefixes.push_back(path);
+	}
+
+	BackupManifest selected;
+	selected.encrypted = encrypted;
+	for (const auto& entry : entries)
+	{
+		for (const auto& prefix : prefixes)
+		{
+			if (entry.path.compare(0, prefix.size(), prefix) == 0 && (entry.path.size() == prefix.size() || entry.path[prefix.size()] == '/'))
+			{
+				selected.entries.push_back(entry);
+				break;
+			}
+		}
+	}
+	return selected;
+}
+
+BackupManifest BackupManifest::Parse(const string& text)
+{
+	size_t headerEnd = text.find('\n');
+	if (text.compare(0, headerEnd, kManifestHeader) != 0) throw ManifestError("Not a backup manifest");
+
+	BackupManifest manifest;
+	manifest.entries.reserve(count(text.begin(), text.end(), '\n'));
+	const char* fields[8]; // Field i is [fields[i], fields[i + 1] - 1)
+	size_t lineStart = headerEnd == string::npos ? text.size() : headerEnd + 1;
+	while (lineStart < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == string::npos) lineEnd = text.size();
+		const char* begin = text.data() + lineStart;
+		const char* end = text.data() + lineEnd;
+		lineStart = lineEnd + 1;
+		if (begin == end) continue;
+
+		size_t fieldCount = 0;
+		fields[fieldCount++] = begin;
+		for (const char* c = begin; c != end && fieldCount < 8; ++c)
+		{
+			if (*c == '\t') fields[fieldCount++] = c + 1;
+		}
+		if (fieldCount == 8) throw ManifestError("Malformed manifest line: " + string(begin, end));
+		fields[fieldCount] = end + 1;
+		auto fieldEnd = [&](size_t i) { return fields[i + 1] - 1; };
+
+		ManifestEntry entry;
+		char kind = fieldEnd(0) - fields[0] == 1 ? *fields[0] : '\0';
+		if (fieldCount >= 2) entry.path = UnescapeField(fields[1], fieldEnd(1));
+		if (kind == 'D' && fieldCount == 2)
+		{
+			entry.type = fs::file_type::directory;
+		}
+		else if (kind == 'L' && fieldCount == 3)
+		{
+			entry.type = fs::file_type::symlink;
+			entry.linkTarget = UnescapeField(fields[2], fieldEnd(2));
+		}
+		else if (kind == 'F' && (fieldCount == 6 || fieldCount == 7))
+		{
+			string line(begin, end);
+			entry.size = ParseNumber<uint64_t>(fields[2], fieldEnd(2), line);
+			entry.mtime = ParseNumber<int64_t>(fields[3], fieldEnd(3), line);
+			entry.sha256.assign(fields[4], fieldEnd(4));
+			uint64_t chunkBytes = 0;
+			for (const char* chunk = fields[5]; chunk < fieldEnd(5); )
+			{
+				const char* chunkEnd = find(chunk, fieldEnd(5), ',');
+				const char* colon = find(chunk, chunkEnd, ':');
+				if (colon == chunkEnd) throw ManifestError("Malformed manifest line: " + line);
+				entry.chunks.push_back({ string(chunk, colon), ParseNumber<uint64_t>(colon + 1, chunkEnd, line) });
+				chunkBytes += entry.chunks.back().size;
+				chunk = chunkEnd + 1;
+			}
+			if (!entry.chunks.empty() && chunkBytes != entry.size) throw ManifestError("Chunk sizes do not add up for " + entry.path);
+			entry.sparse = fieldCount == 7;
+			uint64_t dataEnd = 0;
+			for (const char* extent = entry.sparse ? fields[6] : end; extent < end; )
+			{
+				const char* extentEnd = find(extent, end, ',');
+				const char* plus = find(extent, extentEnd, '+');
+				if (plus == extentEnd) throw ManifestError("Malformed manifest line: " + line);
+				FileExtent parsed{ ParseNumber<uint64_t>(extent, plus, line), ParseNumber<uint64_t>(plus + 1, extentEnd, line) };
+				if (parsed.offset < dataEnd || parsed.length == 0 || parsed.length > entry.size || parsed.offset > entry.size - parsed.length)
+				{
+					throw ManifestError("Sparse layout out of order or past the end for " + entry.path);
+				}
+				dataEnd = parsed.offset + parsed.length;
+				entry.extents.push_back(parsed);
+				extent = extentEnd + 1;
+			}
+		}
+		else
+		{
+			throw ManifestError("Malformed manifest line: " + string(begin, end));
+		}
+		if (entry.path.empty()) throw ManifestError("Malformed manifest line: " + string(begin, end));
+		manifest.entries.push_back(move(entry));
+	}
+	return manifest;
+}
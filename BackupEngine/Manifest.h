@@ -0,0 +1,76 @@
+#pragma once
+
+// Manifest of one backup: every folder, file and symlink with its size and modification time,
+// plus, in the cloud chunk store, its SHA-256 and the chunks it is rebuilt from. Local backups
+// keep one without digests or chunks as their index (BackupIndex.h). Stored as text:
+//
+//   GSBM-MANIFEST 1
+//   D <path>
+//   F <path> <size> <mtime ns> <sha256> <chunk id>:<size>,... [<data offset>+<length>,...]
+//   L <path> <target>
+//
+// Fields are tab-separated; paths are '/'-separated and escaped with EscapeTabField. The last
+// field of an F line is only there for sparse files: the regions holding data, the rest being
+// holes (possibly none, for a file that is all hole). An encrypted backup stores this text as
+// an encrypted object (CloudEncryption.h).
+
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct ChunkRef
+{
+	std::string id; // SHA-256 of the chunk; in encrypted backups its keyed ID (EncryptionKeys::ChunkId)
+	uint64_t size = 0;
+};
+
+// A run of data in a sparse file; the bytes between runs are holes and read as zeros
+struct FileExtent
+{
+	uint64_t offset = 0;
+	uint64_t length = 0;
+
+	bool operator==(const FileExtent& other) const { return offset == other.offset && length == other.length; }
+};
+
+struct ManifestEntry
+{
+	std::string path; // Relative to the backup folder, '/'-separated
+	std::filesystem::file_type type = std::filesystem::file_type::regular; // regular, directory or symlink
+	uint64_t size = 0;
+	int64_t mtime = 0;        // Nanoseconds since the Unix epoch
+	std::string sha256;       // Whole file; empty in local indexes
+	std::vector<ChunkRef> chunks; // Empty in local indexes
+	std::string linkTarget;   // Symlinks only
+	bool sparse = false;      // Files with holes: `extents` lists their data, restores recreate the holes
+	std::vector<FileExtent> extents;
+};
+
+class ManifestError : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+struct BackupManifest
+{
+	std::vector<ManifestEntry> entries; // Parents before children
+	bool encrypted = false;             // Read from an encrypted object (not part of the text)
+
+	uint64_t TotalBytes() const;
+
+	std::string Serialize() const;
+
+	/**
+	 * @brief The entries at or below any of `paths` (relative, '/'-separated; "" selects
+	 * everything), in manifest order.
+	 */
+	BackupManifest Select(const std::vector<std::string>& paths) const;
+
+	/**
+	 * @brief Parses Serialize() output. Throws ManifestError on a bad header or a malformed line.
+	 */
+	static BackupManifest Parse(const std::string& text);
+};
@@ -0,0 +1,221 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const char* const kOpNames[] = { "backup", "purge", "cloud_sync", "restore" };
+	const char* const kStageNames[] = { "scan", "copy", "purge", "sync", "restore", "deferral" };
+	const char* const kLatencyNames[] = { "manual_backup", "quick_restore", "autosave_lag" };
+	const double kLatencyQuantiles[] = { 0.5, 0.99 };
+
+	bool WriteFileAtomically(const fs::path& file, const string& contents)
+	{
+		fs::path tmp = file;
+		tmp += ".tmp";
+		{
+			ofstream out(tmp, ios::binary | ios::trunc);
+			if (!out) return false;
+			out << contents;
+			if (!out.flush()) return false;
+		}
+		error_code ec;
+		fs::rename(tmp, file, ec);
+		return !ec;
+	}
+
+	// Reads the number after the first `label` at or after `from` (ToJson's layout); moves `from` past it
+	template <typename T>
+	bool ReadJsonNumber(const string& text, size_t& from, const string& label, T& value)
+	{
+		size_t at = text.find(label, from);
+		if (at == string::npos) return false;
+		istringstream in(text.substr(at + label.size(), 32));
+		if (!(in >> value)) return false;
+		from = at + label.size();
+		return true;
+	}
+}
+
+void DurationHistogram::Record(chrono::nanoseconds duration)
+{
+	double seconds = chrono::duration<double>(duration).count();
+	size_t bucket = 0;
+	while (bucket < kBoundsSeconds.size() && seconds > kBoundsSeconds[bucket]) ++bucket;
+	m_buckets[bucket].fetch_add(1, memory_order_relaxed);
+	m_count.fetch_add(1, memory_order_relaxed);
+	m_sumNanos.fetch_add(static_cast<uint64_t>(max<int64_t>(0, duration.count())), memory_order_relaxed);
+}
+
+void DurationHistogram::Reset()
+{
+	for (auto& bucket : m_buckets) bucket.store(0, memory_order_relaxed);
+	m_count.store(0, memory_order_relaxed);
+	m_sumNanos.store(0, memory_order_relaxed);
+}
+
+void EngineMetrics::Reset()
+{
+	for (auto& op : m_ops)
+	{
+		op.runs = 0;
+		op.errors = 0;
+		op.filesCopied = 0;
+		op.filesSkipped = 0;
+		op.filesDeleted = 0;
+		op.bytesCopied = 0;
+		op.bytesResumed = 0;
+		op.bytesDeduplicated = 0;
+	}
+	for (auto& stage : m_stages) stage.Reset();
+	m_deferrals.checks = 0;
+	m_deferrals.deferred = 0;
+	m_deferrals.gaveUp = 0;
+	ResetLatencies();
+}
+
+void EngineMetrics::ResetLatencies()
+{
+	for (auto& latency : m_latencies) latency.Reset();
+}
+
+string EngineMetrics::ToJson() const
+{
+	ostringstream out;
+	out << "{\n  \"timestamp\": " << chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count() << ",\n";
+	out << "  \"operations\": {\n";
+	for (size_t i = 0; i < m_ops.size(); ++i)
+	{
+		const auto& op = m_ops[i];
+		out << "    \"" << kOpNames[i] << "\": {\"runs\": " << op.runs << ", \"errors\": " << op.errors
+			<< ", \"files_copied\": " << op.filesCopied << ", \"files_skipped\": " << op.filesSkipped
+			<< ", \"files_deleted\": " << op.filesDeleted << ", \"bytes_copied\": " << op.bytesCopied << ", \"bytes_resumed\": " << op.bytesResumed
+			<< ", \"bytes_deduplicated\": " << op.bytesDeduplicated << "}"
+			<< (i + 1 < m_ops.size() ? "," : "") << "\n";
+	}
+	out << "  },\n  \"stages\": {\n";
+	for (size_t i = 0; i < m_stages.size(); ++i)
+	{
+		const auto& stage = m_stages[i];
+		out << "    \"" << kStageNames[i] << "\": {\"count\": " << stage.Count() << ", \"sum_seconds\": " << stage.SumSeconds() << ", \"buckets\": [";
+		for (size_t b = 0; b <= DurationHistogram::kBoundsSeconds.size(); ++b)
+		{
+			out << (b ? ", " : "") << "{\"le\": ";
+			if (b < DurationHistogram::kBoundsSeconds.size()) out << DurationHistogram::kBoundsSeconds[b];
+			else out << "\"+Inf\"";
+			out << ", \"count\": " << stage.BucketCount(b) << "}";
+		}
+		out << "]}" << (i + 1 < m_stages.size() ? "," : "") << "\n";
+	}
+	out << "  },\n  \"deferrals\": {\"checks\": " << m_deferrals.checks << ", \"deferred\": " << m_deferrals.deferred
+		<< ", \"gave_up\": " << m_deferrals.gaveUp << "},\n  \"latencies\": {\n";
+	for (size_t i = 0; i < m_latencies.size(); ++i)
+	{
+		const auto& latency = m_latencies[i];
+		out << "    \"" << kLatencyNames[i] << "\": {\"count\": " << latency.Count()
+			<< ", \"p50_ms\": " << latency.PercentileMicros(0.5) / 1000.0
+			<< ", \"p99_ms\": " << latency.PercentileMicros(0.99) / 1000.0
+			<< ", \"max_ms\": " << latency.MaxMicros() / 1000.0 << "}"
+			<< (i + 1 < m_latencies.size() ? "," : "") << "\n";
+	}
+	out << "  }\n}\n";
+	return out.str();
+}
+
+string EngineMetrics::ToPrometheusText() const
+{
+	ostringstream out;
+	auto counter = [&](const char* name, const char* help, atomic<uint64_t> OperationCounters::* field)
+		{
+			out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n";
+			for (size_t i = 0; i < m_ops.size(); ++i)
+				out << name << "{op=\"" << kOpNames[i] << "\"} " << (m_ops[i].*field).load(memory_order_relaxed) << "\n";
+		};
+	counter("gsbm_operations_total", "Operations started.", &OperationCounters::runs);
+	counter("gsbm_operation_errors_total", "Operations that failed.", &OperationCounters::errors);
+	counter("gsbm_files_copied_total", "Files copied.", &OperationCounters::filesCopied);
+	counter("gsbm_files_skipped_total", "Entries skipped while copying.", &OperationCounters::filesSkipped);
+	counter("gsbm_files_deleted_total", "Files and folders deleted.", &OperationCounters::filesDeleted);
+	counter("gsbm_bytes_copied_total", "Bytes copied.", &OperationCounters::bytesCopied);
+	counter("gsbm_bytes_resumed_total", "Bytes not sent again because an interrupted transfer had already stored them.", &OperationCounters::bytesResumed);
+	counter("gsbm_bytes_deduplicated_total", "Bytes not uploaded because the cloud chunk store already held them, or not stored because a shared local copy did.", &OperationCounters::bytesDeduplicated);
+
+	out << "# HELP gsbm_stage_duration_seconds Duration of each operation stage.\n# TYPE gsbm_stage_duration_seconds histogram\n";
+	for (size_t i = 0; i < m_stages.size(); ++i)
+	{
+		const auto& stage = m_stages[i];
+		uint64_t cumulative = 0;
+		for (size_t b = 0; b <= DurationHistogram::kBoundsSeconds.size(); ++b)
+		{
+			cumulative += stage.BucketCount(b);
+			out << "gsbm_stage_duration_seconds_bucket{stage=\"" << kStageNames[i] << "\",le=\"";
+			if (b < DurationHistogram::kBoundsSeconds.size()) out << DurationHistogram::kBoundsSeconds[b];
+			else out << "+Inf";
+			out << "\"} " << cumulative << "\n";
+		}
+		out << "gsbm_stage_duration_seconds_sum{stage=\"" << kStageNames[i] << "\"} " << stage.SumSeconds() << "\n";
+		out << "gsbm_stage_duration_seconds_count{stage=\"" << kStageNames[i] << "\"} " << stage.Count() << "\n";
+	}
+
+	out << "# HELP gsbm_autosave_load_checks_total Auto-saves that checked the system load before starting.\n# TYPE gsbm_autosave_load_checks_total counter\n"
+		<< "gsbm_autosave_load_checks_total " << m_deferrals.checks << "\n";
+	out << "# HELP gsbm_autosave_deferrals_total Auto-saves that waited for the system load to drop (durations: stage=\"deferral\").\n# TYPE gsbm_autosave_deferrals_total counter\n"
+		<< "gsbm_autosave_deferrals_total " << m_deferrals.deferred << "\n";
+	out << "# HELP gsbm_autosave_deferrals_gave_up_total Deferred auto-saves that ran at the longest wait with the system still busy.\n# TYPE gsbm_autosave_deferrals_gave_up_total counter\n"
+		<< "gsbm_autosave_deferrals_gave_up_total " << m_deferrals.gaveUp << "\n";
+
+	out << "# HELP gsbm_latency_seconds User-facing latency (hotkey to completion, auto-save schedule lag).\n# TYPE gsbm_latency_seconds summary\n";
+	for (size_t i = 0; i < m_latencies.size(); ++i)
+	{
+		const auto& latency = m_latencies[i];
+		for (double quantile : kLatencyQuantiles)
+			out << "gsbm_latency_seconds{kind=\"" << kLatencyNames[i] << "\",quantile=\"" << quantile << "\"} " << latency.PercentileMicros(quantile) / 1e6 << "\n";
+		out << "gsbm_latency_seconds{kind=\"" << kLatencyNames[i] << "\",quantile=\"1\"} " << latency.MaxMicros() / 1e6 << "\n";
+		out << "gsbm_latency_seconds_count{kind=\"" << kLatencyNames[i] << "\"} " << latency.Count() << "\n";
+	}
+	return out.str();
+}
+
+EngineMetrics& GetEngineMetrics()
+{
+	static EngineMetrics metrics;
+	return metrics;
+}
+
+bool ReadLatencySnapshot(const fs::path& jsonFile, LatencySnapshots& latencies, int64_t& timestamp)
+{
+	ifstream in(jsonFile, ios::binary);
+	if (!in) return false;
+	string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	size_t from = 0;
+	if (!ReadJsonNumber(text, from, "\"timestamp\": ", timestamp)) return false;
+	size_t section = text.find("\"latencies\": {");
+	if (section == string::npos) return false;
+	for (size_t i = 0; i < latencies.size(); ++i)
+	{
+		from = section;
+		LatencySnapshot& latency = latencies[i];
+		if (!ReadJsonNumber(text, from, "\"" + string(kLatencyNames[i]) + "\": {\"count\": ", latency.count) ||
+			!ReadJsonNumber(text, from, "\"p50_ms\": ", latency.p50Ms) ||
+			!ReadJsonNumber(text, from, "\"p99_ms\": ", latency.p99Ms) ||
+			!ReadJsonNumber(text, from, "\"max_ms\": ", latency.maxMs))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool WriteMetricsFiles(const EngineMetrics& metrics, const fs::path& jsonFile, const fs::path& promFile)
+{
+	bool jsonOk = WriteFileAtomically(jsonFile, metrics.ToJson());
+	bool promOk = WriteFileAtomically(promFile, metrics.ToPrometheusText());
+	return jsonOk && promOk;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+// Operation metrics for backup, purge, cloud sync and restore.
+// Recording is lock-free (relaxed atomics) so the engine can update counters from any thread;
+// the front-end periodically exports a snapshot as JSON and Prometheus text.
+
+#include "LatencyHistogram.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Operations with their own counters
+enum class MetricOp
+{
+	Backup,
+	Purge,
+	CloudSync,
+	Restore,
+	Count
+};
+
+// Timed stages of an operation
+enum class MetricStage
+{
+	Scan,    // Enumerating the save folder
+	Copy,    // Local copy
+	Purge,   // Deleting backups over the retention limit
+	Sync,    // Copy to the cloud folder
+	Restore, // Wipe + copy back into the save folder
+	Deferral, // Auto-save waiting for the system load to drop (SystemLoad.h)
+	Count
+};
+
+// End-to-end latencies as the user experiences them
+enum class LatencyMetric
+{
+	ManualBackup, // CTRL+B received -> backup completed
+	QuickRestore, // CTRL+R received -> restore completed
+	AutoSaveLag,  // Scheduled auto-save time -> backup started
+	Count
+};
+
+struct OperationCounters
+{
+	std::atomic<uint64_t> runs{ 0 };
+	std::atomic<uint64_t> errors{ 0 };
+	std::atomic<uint64_t> filesCopied{ 0 };
+	std::atomic<uint64_t> filesSkipped{ 0 };  // Entries that were not copied (sockets, devices, ...)
+	std::atomic<uint64_t> filesDeleted{ 0 };  // Files and folders removed (purge, restore wipe)
+	std::atomic<uint64_t> bytesCopied{ 0 };
+	std::atomic<uint64_t> bytesResumed{ 0 }; // Found at the destination after an interrupted transfer
+	std::atomic<uint64_t> bytesDeduplicated{ 0 }; // Chunks the cloud chunk store already held; local: files linked to a shared copy
+};
+
+// Due auto-saves and the system load (SystemLoad.h); how long each waited is the Deferral stage
+struct DeferralCounters
+{
+	std::atomic<uint64_t> checks{ 0 };   // Auto-saves that looked at the load before starting
+	std::atomic<uint64_t> deferred{ 0 }; // Waited for it to drop
+	std::atomic<uint64_t> gaveUp{ 0 };   // Ran at the longest wait with the system still busy
+};
+
+/**
+ * @brief Fixed-bucket duration histogram in the Prometheus style (cumulative "le" buckets on export).
+ */
+class DurationHistogram
+{
+public:
+	// Upper bounds in seconds; an implicit +Inf bucket follows
+	static constexpr std::array<double, 12> kBoundsSeconds = { 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 30, 60, 300 };
+
+	DurationHistogram() { Reset(); }
+
+	void Record(std::chrono::nanoseconds duration);
+	void Reset();
+
+	uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+	double SumSeconds() const { return static_cast<double>(m_sumNanos.load(std::memory_order_relaxed)) / 1e9; }
+	// Non-cumulative count of bucket i (i == kBoundsSeconds.size() is the +Inf bucket)
+	uint64_t BucketCount(size_t i) const { return m_buckets[i].load(std::memory_order_relaxed); }
+
+private:
+	std::array<std::atomic<uint64_t>, kBoundsSeconds.size() + 1> m_buckets;
+	std::atomic<uint64_t> m_count;
+	std::atomic<uint64_t> m_sumNanos;
+};
+
+/**
+ * @brief All engine metrics. Use GetEngineMetrics() for the process-wide instance.
+ */
+class EngineMetrics
+{
+public:
+	OperationCounters& Op(MetricOp op) { return m_ops[static_cast<size_t>(op)]; }
+	const OperationCounters& Op(MetricOp op) const { return m_ops[static_cast<size_t>(op)]; }
+	DurationHistogram& Stage(MetricStage stage) { return m_stages[static_cast<size_t>(stage)]; }
+	const DurationHistogram& Stage(MetricStage stage) const { return m_stages[static_cast<size_t>(stage)]; }
+
+	LatencyHistogram& Latency(LatencyMetric metric) { return m_latencies[static_cast<size_t>(metric)]; }
+	const LatencyHistogram& Latency(LatencyMetric metric) const { return m_latencies[static_cast<size_t>(metric)]; }
+	DeferralCounters& Deferrals() { return m_deferrals; }
+	const DeferralCounters& Deferrals() const { return m_deferrals; }
+
+	void Reset();
+	void ResetLatencies();
+
+	std::string ToJson() const;
+	std::string ToPrometheusText() const;
+
+private:
+	std::array<OperationCounters, static_cast<size_t>(MetricOp::Count)> m_ops;
+	std::array<DurationHistogram, static_cast<size_t>(MetricStage::Count)> m_stages;
+	std::array<LatencyHistogram, static_cast<size_t>(LatencyMetric::Count)> m_latencies;
+	DeferralCounters m_deferrals;
+};
+
+EngineMetrics& GetEngineMetrics();
+
+/**
+ * @brief Records the lifetime of the object into a stage histogram.
+ */
+class StageTimer
+{
+public:
+	explicit StageTimer(MetricStage stage) : m_stage(stage), m_start(std::chrono::steady_clock::now()) {}
+	~StageTimer() { GetEngineMetrics().Stage(m_stage).Record(std::chrono::steady_clock::now() - m_start); }
+
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+	MetricStage m_stage;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// A latency as a JSON snapshot records it
+struct LatencySnapshot
+{
+	uint64_t count = 0;
+	double p50Ms = 0;
+	double p99Ms = 0;
+	double maxMs = 0;
+};
+
+using LatencySnapshots = std::array<LatencySnapshot, static_cast<size_t>(LatencyMetric::Count)>;
+
+/**
+ * @brief Reads back the latencies (in LatencyMetric order) and the time (Unix seconds) of a JSON
+ * snapshot written by WriteMetricsFiles, e.g. the one a running instance keeps refreshing.
+ * @return False if the file is missing or holds no latencies.
+ */
+bool ReadLatencySnapshot(const std::filesystem::path& jsonFile, LatencySnapshots& latencies, int64_t& timestamp);
+
+/**
+ * @brief Writes a snapshot as JSON and Prometheus text. Each file is written to a temporary
+ * name and renamed, so a scraper never reads a half-written file.
+ * @return False if either file could not be written.
+ */
+bool WriteMetricsFiles(const EngineMetrics& metrics, const std::filesystem::path& jsonFile, const std::filesystem::path& promFile);
@@ -0,0 +1,311 @@
+#include "PackStore.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "Sha256.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const char* const kPackHeader = "GSBM-PACKS 1";
+
+	fs::path SafeRelativePath(const string& path)
+	{
+		fs::path relative = fs::u8path(path).lexically_normal();
+		if (relative.empty() || relative.is_absolute() || relative.has_root_name() || *relative.begin() == "..")
+		{
+			throw StorageError("Refusing to restore outside the target folder: " + path);
+		}
+		return relative;
+	}
+
+	string PackName(uint32_t pack)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "pack-%04u", static_cast<unsigned>(pack));
+		return name;
+	}
+
+	template <typename T>
+	T ParseNumber(const string& text, const string& line)
+	{
+		T value = 0;
+		auto [ptr, ec] = from_chars(text.data(), text.data() + text.size(), value);
+		if (text.empty() || ec != errc() || ptr != text.data() + text.size()) throw ManifestError("Malformed pack index line: " + line);
+		return value;
+	}
+
+	string ReadSmallFile(const fs::path& file)
+	{
+		ifstream in(file, ios::binary | ios::ate);
+		if (!in) throw fs::filesystem_error("Cannot read file", file, make_error_code(errc::io_error));
+		string data(static_cast<size_t>(in.tellg()), '\0');
+		in.seekg(0);
+		if (!in.read(data.data(), static_cast<streamsize>(data.size()))) throw fs::filesystem_error("Cannot read file", file, make_error_code(errc::io_error));
+		return data;
+	}
+}
+
+string PackIndex::Serialize() const
+{
+	string out = kPackHeader;
+	out += '\n';
+	for (const auto& entry : manifest.entries)
+	{
+		switch (entry.type)
+		{
+		case fs::file_type::directory:
+			out += "D\t" + EscapeTabField(entry.path) + "\n";
+			break;
+		case fs::file_type::symlink:
+			out += "L\t" + EscapeTabField(entry.path) + "\t" + EscapeTabField(entry.linkTarget) + "\n";
+			break;
+		default:
+		{
+			out += "F\t" + EscapeTabField(entry.path) + "\t" + to_string(entry.size) + "\t" + to_string(entry.mtime) + "\t" + entry.sha256;
+			auto slot = slots.find(entry.path);
+			if (slot != slots.end()) out += "\t" + to_string(slot->second.pack) + ":" + to_string(slot->second.offset);
+			out += '\n';
+		}
+		}
+	}
+	return out;
+}
+
+PackIndex PackIndex::Parse(const string& text)
+{
+	size_t headerEnd = text.find('\n');
+	if (text.compare(0, headerEnd, kPackHeader) != 0) throw ManifestError("Not a pack index");
+
+	PackIndex index;
+	size_t lineStart = headerEnd == string::npos ? text.size() : headerEnd + 1;
+	while (lineStart < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == string::npos) lineEnd = text.size();
+		string line = text.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		if (line.empty()) continue;
+
+		vector<string> fields = SplitTabFields(line);
+		ManifestEntry entry;
+		if (fields.size() >= 2) entry.path = UnescapeTabField(fields[1]);
+		if (entry.path.empty()) throw ManifestError("Malformed pack index line: " + line);
+		if (fields[0] == "D" && fields.size() == 2)
+		{
+			entry.type = fs::file_type::directory;
+		}
+		else if (fields[0] == "L" && fields.size() == 3)
+		{
+			entry.type = fs::file_type::symlink;
+			entry.linkTarget = UnescapeTabField(fields[2]);
+		}
+		else if (fields[0] == "F" && (fields.size() == 5 || fields.size() == 6))
+		{
+			entry.size = ParseNumber<uint64_t>(fields[2], line);
+			entry.mtime = ParseNumber<int64_t>(fields[3], line);
+			entry.sha256 = fields[4];
+			if (fields.size() == 6)
+			{
+				size_t colon = fields[5].find(':');
+				if (colon == string::npos || entry.sha256.empty()) throw ManifestError("Malformed pack index line: " + line);
+				index.slots[entry.path] = { ParseNumber<uint32_t>(fields[5].substr(0, colon), line), ParseNumber<uint64_t>(fields[5].substr(colon + 1), line) };
+			}
+		}
+		else
+		{
+			throw ManifestError("Malformed pack index line: " + line);
+		}
+		index.manifest.entries.push_back(move(entry));
+	}
+	return index;
+}
+
+string GetPackKey(const string& backupPrefix, uint32_t pack)
+{
+	return backupPrefix + kPackFolderName + "/" + PackName(pack);
+}
+
+TreeScan BuildPackedView(const TreeScan& scan, const fs::path& from, const fs::path& view, uint64_t packBelow)
+{
+	TraceSpan span("pack");
+	error_code ec;
+	fs::remove_all(view, ec); // Left over from an interrupted upload
+	fs::path packFolder = view / fs::u8path(kPackFolderName);
+	fs::create_directories(packFolder);
+
+	// Path order, so the same backup always packs the same way
+	vector<pair<string, const ScannedEntry*>> entries;
+	entries.reserve(scan.entries.size());
+	for (const auto& scanned : scan.entries) entries.emplace_back(scanned.relativePath.generic_u8string(), &scanned);
+	sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	PackIndex index;
+	ofstream pack;
+	uint32_t packCount = 0;
+	uint64_t packFill = 0;
+	auto closePack = [&]()
+		{
+			if (pack.is_open() && !pack.flush()) throw fs::filesystem_error("Cannot write file", packFolder / PackName(packCount - 1), make_error_code(errc::io_error));
+			pack.close();
+		};
+	for (const auto& [path, scanned] : entries)
+	{
+		ManifestEntry entry;
+		entry.path = path;
+		entry.type = scanned->type;
+		fs::path source = from / scanned->relativePath;
+		fs::path target = view / scanned->relativePath;
+		if (scanned->type == fs::file_type::symlink)
+		{
+			entry.linkTarget = fs::read_symlink(source).u8string();
+			fs::create_directories(target.parent_path());
+			fs::copy_symlink(source, target);
+		}
+		else if (scanned->type == fs::file_type::regular && scanned->size >= packBelow)
+		{
+			entry.size = scanned->size;
+			entry.mtime = FileTimeToUnixNanos(scanned->mtime);
+			fs::create_directories(target.parent_path());
+			fs::create_hard_link(source, target, ec);
+			if (ec) CopySaveFile(source, target, scanned->size); // Another volume, or no hard links there
+		}
+		else if (scanned->type == fs::file_type::regular)
+		{
+			string data = ReadSmallFile(source);
+			if (!pack.is_open() || packFill >= kPackSize)
+			{
+				closePack();
+				pack.open(packFolder / PackName(packCount++), ios::binary | ios::trunc);
+				if (!pack) throw fs::filesystem_error("Cannot write file", packFolder / PackName(packCount - 1), make_error_code(errc::io_error));
+				packFill = 0;
+			}
+			pack.write(data.data(), static_cast<streamsize>(data.size()));
+			index.slots[path] = { packCount - 1, packFill };
+			packFill += data.size();
+			entry.size = data.size();
+			entry.mtime = FileTimeToUnixNanos(scanned->mtime);
+			entry.sha256 = Sha256Hex(data);
+		}
+		else if (scanned->type != fs::file_type::directory)
+		{
+			continue; // Not copied into backups either
+		}
+		index.manifest.entries.push_back(move(entry));
+	}
+	closePack();
+
+	string text = index.Serialize();
+	ofstream out(packFolder / "index", ios::binary | ios::trunc);
+	if (!out.write(text.data(), static_cast<streamsize>(text.size())).flush())
+	{
+		throw fs::filesystem_error("Cannot write file", packFolder / "index", make_error_code(errc::io_error));
+	}
+	out.close();
+	if (span.Active()) span.SetArgs("\"packs\": " + to_string(packCount) + ", \"packed_files\": " + to_string(index.slots.size()));
+	return ScanTree(view);
+}
+
+bool IsPackedBackup(StorageBackend& backend, const string& backupPrefix)
+{
+	return backend.Exists(backupPrefix + kPackFolderName + "/index");
+}
+
+PackIndex GetPackIndex(StorageBackend& backend, const string& backupPrefix)
+{
+	return PackIndex::Parse(backend.GetBytes(backupPrefix + kPackFolderName + "/index"));
+}
+
+CopyStats RestorePackedBackup(StorageBackend& backend, const string& backupPrefix, const PackIndex& index, const BackupManifest& selection, const fs::path& target, OperationProgress* progress)
+{
+	TraceSpan span("restore_packed");
+	CopyStats stats;
+	fs::create_directories(target);
+	if (progress)
+	{
+		uint64_t files = 0, bytes = 0;
+		for (const auto& entry : selection.entries)
+		{
+			if (entry.type != fs::file_type::regular) continue;
+			files++;
+			bytes += entry.size;
+		}
+		progress->Begin(files, bytes);
+	}
+
+	map<uint32_t, vector<const ManifestEntry*>> byPack;
+	for (const auto& entry : selection.entries)
+	{
+		fs::path path = target / SafeRelativePath(entry.path);
+		if (entry.type == fs::file_type::directory)
+		{
+			fs::create_directories(path);
+		}
+		else if (entry.type == fs::file_type::symlink)
+		{
+			error_code ec;
+			fs::create_directories(path.parent_path());
+			fs::remove(path, ec);
+			fs::create_symlink(fs::u8path(entry.linkTarget), path, ec);
+			if (ec) stats.filesSkipped++; // e.g. no symlink privilege on Windows
+			else stats.filesCopied++;
+		}
+		else if (index.slots.count(entry.path))
+		{
+			byPack[index.slots.at(entry.path).pack].push_back(&entry);
+		}
+		else
+		{
+			if (progress) progress->StartFile(SafeRelativePath(entry.path));
+			backend.GetFile(backupPrefix + entry.path, path); // Written via ".partial"
+			if (progress) progress->FinishFile(entry.size);
+			stats.filesCopied++;
+			stats.bytesCopied += entry.size;
+		}
+	}
+
+	// One read per pack, however many of its files are restored
+	for (const auto& [pack, files] : byPack)
+	{
+		string data = backend.GetBytes(GetPackKey(backupPrefix, pack));
+		for (const ManifestEntry* entry : files)
+		{
+			const PackSlot& slot = index.slots.at(entry->path);
+			if (slot.offset > data.size() || entry->size > data.size() - slot.offset)
+			{
+				throw StorageError("Pack " + PackName(pack) + " of " + backupPrefix + " is too short for " + entry->path);
+			}
+			if (progress) progress->StartFile(SafeRelativePath(entry->path));
+			string_view content(data.data() + slot.offset, static_cast<size_t>(entry->size));
+			if (!entry->sha256.empty() && Sha256Hex(content) != entry->sha256) throw StorageError("Packed file " + entry->path + " is damaged");
+
+			fs::path path = target / SafeRelativePath(entry->path);
+			fs::create_directories(path.parent_path());
+			fs::path partial = path;
+			partial += ".partial";
+			{
+				ofstream out(partial, ios::binary | ios::trunc);
+				if (!out.write(content.data(), static_cast<streamsize>(content.size())).flush())
+				{
+					throw fs::filesystem_error("Cannot write file", partial, make_error_code(errc::io_error));
+				}
+			}
+			fs::rename(partial, path);
+			error_code ec;
+			fs::last_write_time(path, UnixNanosToFileTime(entry->mtime), ec);
+			if (progress) progress->FinishFile(entry->size);
+			stats.filesCopied++;
+			stats.bytesCopied += entry->size;
+		}
+	}
+	if (progress) progress->Finish();
+	return stats;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// Small-file packing for plain-folder cloud backups. A desktop sync client handles every file
+// as its own transaction, so a save made of thousands of tiny files (one per level, per map
+// chunk) syncs slowly however little data it holds. With packing on ([CloudStorage]
+// PackSmallFilesKB), files below the threshold are stored back to back in a few pack files:
+//
+//   <id>/<backup folder>/.gsbm-packs/index      every entry of the backup (format below)
+//   <id>/<backup folder>/.gsbm-packs/pack-0000  small files back to back, about kPackSize each
+//   <id>/<backup folder>/<path>                 files at or above the threshold, as before
+//
+// The index is text, tab-separated, paths escaped with EscapeTabField:
+//
+//   GSBM-PACKS 1
+//   D <path>
+//   F <path> <size> <mtime ns> <sha256> [<pack>:<offset>]   (no pack: stored on its own)
+//   L <path> <target>
+//
+// The packs are built in a local folder next to the backup and uploaded with the rest by
+// PutTree, so journaling, resuming and the sync folder's staging work as for any backup.
+// Packing is deterministic (path order), so a resumed upload rebuilds identical packs.
+
+#include "BackupOperations.h"
+#include "Manifest.h"
+#include "StorageBackend.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+
+// Folder of a packed backup holding its index and packs
+inline const std::string kPackFolderName = ".gsbm-packs";
+
+// A pack is closed once it reaches this size
+inline constexpr uint64_t kPackSize = 16 * 1024 * 1024;
+
+// Where a packed file's bytes are
+struct PackSlot
+{
+	uint32_t pack = 0;
+	uint64_t offset = 0;
+};
+
+struct PackIndex
+{
+	BackupManifest manifest;             // Every entry, in path order; packed files with their SHA-256
+	std::map<std::string, PackSlot> slots; // Path -> location, for packed files only
+
+	std::string Serialize() const;
+
+	/**
+	 * @brief Parses Serialize() output. Throws ManifestError on a bad header or a malformed line.
+	 */
+	static PackIndex Parse(const std::string& text);
+};
+
+/**
+ * @brief "<backupPrefix>.gsbm-packs/pack-NNNN".
+ */
+std::string GetPackKey(const std::string& backupPrefix, uint32_t pack);
+
+/**
+ * @brief Lays out a packed backup in `view` (emptied first): files of `packBelow` bytes or
+ * more are hard-linked (or copied) from `from`, smaller ones written into packs, plus the
+ * index. Only folders holding an unpacked file or symlink are created; the index lists all of
+ * them. Returns the scan of `view`, for PutTree. Throws fs::filesystem_error.
+ */
+TreeScan BuildPackedView(const TreeScan& scan, const std::filesystem::path& from, const std::filesystem::path& view, uint64_t packBelow);
+
+/**
+ * @brief True if the stored backup at "<id>/<folder>/" has a pack index.
+ */
+bool IsPackedBackup(StorageBackend& backend, const std::string& backupPrefix);
+
+/**
+ * @brief Reads the pack index of a stored backup. Throws StorageError or ManifestError.
+ */
+PackIndex GetPackIndex(StorageBackend& backend, const std::string& backupPrefix);
+
+/**
+ * @brief Restores `selection` (entries of index.manifest) into `target`. Each pack holding a
+ * selected file is read once; packed files are checked against their SHA-256, written to
+ * "<name>.partial" and renamed into place with their modification time. Unpacked files are
+ * downloaded as in a plain backup. Throws StorageError if a pack is damaged. A cancel through
+ * `progress` stops before the next file with OperationCancelled; completed files stay in `target`.
+ */
+CopyStats RestorePackedBackup(StorageBackend& backend, const std::string& backupPrefix, const PackIndex& index, const BackupManifest& selection, const std::filesystem::path& target, OperationProgress* progress = nullptr);
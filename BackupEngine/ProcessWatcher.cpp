@@ -0,0 +1,223 @@
+#include "ProcessWatcher.h"
+#include "EngineUtils.h"
+
+#include <cctype>
+#include <cwctype>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <tlhelp32.h>
+#else
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	bool EqualsNoCase(const wstring& a, const wstring& b)
+	{
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (towlower(a[i]) != towlower(b[i])) return false;
+		}
+		return true;
+	}
+
+#ifdef _WIN32
+	wstring BaseName(const wstring& path)
+	{
+		size_t slash = path.find_last_of(L"/\\");
+		return slash == wstring::npos ? path : path.substr(slash + 1);
+	}
+#else
+	// File name of a path in either separator style (Wine command lines use backslashes)
+	string BaseName(const string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == string::npos ? path : path.substr(slash + 1);
+	}
+
+	// Linux keeps at most 15 bytes of a process name in comm
+	constexpr size_t kCommLength = 15;
+
+	// One read(); /proc files are generated on open and small
+	string ReadProcFile(const string& path)
+	{
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return {};
+		char buffer[4096];
+		ssize_t n = read(fd, buffer, sizeof(buffer));
+		close(fd);
+		return n > 0 ? string(buffer, static_cast<size_t>(n)) : string();
+	}
+
+	bool EqualsNoCaseAscii(const string& a, const string& b)
+	{
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) return false;
+		}
+		return true;
+	}
+
+	// Full name of a process whose comm was cut short: the file name of argv[0]
+	string CommandName(const string& pidDir)
+	{
+		string cmdline = ReadProcFile(pidDir + "/cmdline");
+		return BaseName(cmdline.substr(0, cmdline.find('\0')));
+	}
+
+	// Name as comm holds it (UTF-8, cut to 15 bytes)
+	bool CommMatches(const string& comm, const string& exeName)
+	{
+		return EqualsNoCaseAscii(comm, exeName.substr(0, kCommLength));
+	}
+
+	string ProcessName(uint32_t pid, bool* zombie)
+	{
+		// "<pid> (<comm>) <state> ...": name and state in one read. comm may itself hold ')'.
+		string pidDir = "/proc/" + to_string(pid);
+		string stat = ReadProcFile(pidDir + "/stat");
+		size_t nameStart = stat.find('(');
+		size_t nameEnd = stat.rfind(')');
+		if (nameStart == string::npos || nameEnd == string::npos || nameEnd < nameStart || nameEnd + 2 >= stat.size()) return {};
+		if (zombie) *zombie = stat[nameEnd + 2] == 'Z'; // Exited, not yet reaped by its parent
+		string comm = stat.substr(nameStart + 1, nameEnd - nameStart - 1);
+		if (comm.size() < kCommLength) return comm;
+		string full = CommandName(pidDir);
+		return CommMatches(comm, full) ? full : comm;
+	}
+#endif
+}
+
+uint32_t FindProcess(const wstring& exeName)
+{
+	if (exeName.empty()) return 0;
+#ifdef _WIN32
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE) return 0;
+	PROCESSENTRY32W entry{};
+	entry.dwSize = sizeof(entry);
+	uint32_t found = 0;
+	for (BOOL more = Process32FirstW(snapshot, &entry); more && !found; more = Process32NextW(snapshot, &entry))
+	{
+		if (EqualsNoCase(entry.szExeFile, exeName)) found = entry.th32ProcessID;
+	}
+	CloseHandle(snapshot);
+	return found;
+#else
+	string name = ws2s(exeName);
+	DIR* proc = opendir("/proc");
+	if (!proc) return 0;
+	uint32_t found = 0;
+	while (dirent* entry = readdir(proc))
+	{
+		if (entry->d_name[0] < '1' || entry->d_name[0] > '9') continue; // Not a process
+		string pidDir = string("/proc/") + entry->d_name;
+		// comm first: one short read per process, the command line only for a likely match
+		string comm = ReadProcFile(pidDir + "/comm");
+		if (!comm.empty() && comm.back() == '\n') comm.pop_back();
+		if (!CommMatches(comm, name)) continue;
+		if (comm.size() >= kCommLength || name.size() > kCommLength)
+		{
+			if (!EqualsNoCaseAscii(CommandName(pidDir), name)) continue;
+		}
+		uint32_t pid = static_cast<uint32_t>(strtoul(entry->d_name, nullptr, 10));
+		if (IsProcessRunning(pid, exeName))
+		{
+			found = pid;
+			break;
+		}
+	}
+	closedir(proc);
+	return found;
+#endif
+}
+
+bool IsProcessRunning(uint32_t pid, const wstring& exeName)
+{
+	if (pid == 0 || exeName.empty()) return false;
+#ifdef _WIN32
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+	if (!process) return false;
+	DWORD exitCode = 0;
+	bool running = GetExitCodeProcess(process, &exitCode) && exitCode == STILL_ACTIVE;
+	CloseHandle(process);
+	return running && EqualsNoCase(GetProcessExeName(pid), exeName);
+#else
+	bool zombie = false;
+	string name = ProcessName(pid, &zombie);
+	return !zombie && !name.empty() && EqualsNoCase(s2ws(name), exeName);
+#endif
+}
+
+wstring GetProcessExeName(uint32_t pid)
+{
+#ifdef _WIN32
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+	if (!process) return {};
+	wchar_t path[MAX_PATH * 2];
+	DWORD size = static_cast<DWORD>(sizeof(path) / sizeof(path[0]));
+	wstring name;
+	if (QueryFullProcessImageNameW(process, 0, path, &size)) name = BaseName(wstring(path, size));
+	CloseHandle(process);
+	return name;
+#else
+	return s2ws(ProcessName(pid, nullptr));
+#endif
+}
+
+GameProcessWatcher::GameProcessWatcher(Probe probe)
+	: m_probe(move(probe))
+{
+	if (!m_probe)
+	{
+		m_probe = [](const wstring& exeName, uint32_t knownPid)
+			{
+				return IsProcessRunning(knownPid, exeName) ? knownPid : FindProcess(exeName);
+			};
+	}
+}
+
+GameProcessWatcher::~GameProcessWatcher()
+{
+	Stop();
+}
+
+void GameProcessWatcher::Start(const wstring& exeName, Callback onChange, ProcessWatchOptions options)
+{
+	Stop();
+	m_polls = 1;
+	m_pid = m_probe(exeName, 0);
+	m_running = m_pid != 0;
+	m_scheduler.StartAdaptive(m_running ? options.runningPoll : options.waitingPoll,
+		[this, exeName, onChange = move(onChange), options](chrono::nanoseconds) -> chrono::milliseconds
+		{
+			m_polls++;
+			uint32_t previous = m_pid;
+			m_pid = m_probe(exeName, previous);
+			bool running = m_pid != 0;
+			bool wasRunning = m_running.exchange(running);
+			if (onChange)
+			{
+				// Restarted between two polls: still an exit, whose final save needs its backup
+				if (wasRunning && running && m_pid != previous) onChange(false);
+				if (running != wasRunning || (running && m_pid != previous)) onChange(running);
+			}
+			return running ? options.runningPoll : options.waitingPoll;
+		});
+}
+
+void GameProcessWatcher::Stop()
+{
+	m_scheduler.Stop();
+}
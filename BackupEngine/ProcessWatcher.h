@@ -0,0 +1,83 @@
+#pragma once
+
+// Game process detection, for profiles that name the game's executable. While monitoring, the
+// watcher polls for the process: the auto-save schedule runs only while the game does, and the
+// game's exit triggers one last backup of its final save.
+//
+// Polling keeps it unprivileged and portable (the Linux proc connector needs CAP_NET_ADMIN).
+// Once the game is found, each poll looks at that one process only; the full process list is
+// read only while waiting for the game to start, and on Linux only each process's short name
+// (/proc/<pid>/comm) is read, its command line only on a match.
+
+#include "AutoSaveScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @brief ID of a running process whose executable file name is `exeName` ("eldenring.exe",
+ * compared without case), or 0. Linux also finds Windows games run through Wine/Proton.
+ */
+uint32_t FindProcess(const std::wstring& exeName);
+
+/**
+ * @brief Whether process `pid` is still running `exeName` (an ID reused by another program
+ * does not count). Much cheaper than FindProcess.
+ */
+bool IsProcessRunning(uint32_t pid, const std::wstring& exeName);
+
+/**
+ * @brief Executable file name of process `pid` (no folder), or empty if it cannot be read.
+ */
+std::wstring GetProcessExeName(uint32_t pid);
+
+struct ProcessWatchOptions
+{
+	std::chrono::milliseconds runningPoll{ 1000 }; // While the game runs: how soon its exit is seen
+	std::chrono::milliseconds waitingPoll{ 3000 }; // While it does not: how soon its start is seen
+};
+
+class GameProcessWatcher
+{
+public:
+	// Returns the game's process ID or 0. Gets the ID found by the previous poll (or 0) to check first.
+	using Probe = std::function<uint32_t(const std::wstring& exeName, uint32_t knownPid)>;
+	// Called on the watcher's thread when the game starts (true) or exits (false)
+	using Callback = std::function<void(bool running)>;
+
+	/**
+	 * @brief `probe` replaces the process lookup (for tests); by default IsProcessRunning on the
+	 * known process, then FindProcess.
+	 */
+	explicit GameProcessWatcher(Probe probe = nullptr);
+	~GameProcessWatcher();
+
+	GameProcessWatcher(const GameProcessWatcher&) = delete;
+	GameProcessWatcher& operator=(const GameProcessWatcher&) = delete;
+
+	/**
+	 * @brief Looks for the game once (IsGameRunning() is valid on return, no callback for this
+	 * first state), then polls on a background thread until Stop().
+	 */
+	void Start(const std::wstring& exeName, Callback onChange, ProcessWatchOptions options = {});
+
+	/**
+	 * @brief Stops polling and waits for a callback in progress. Safe to call when not running.
+	 */
+	void Stop();
+
+	bool IsGameRunning() const { return m_running.load(); }
+
+	// Probes made since Start(), for the cost figures in the benchmarks
+	uint64_t Polls() const { return m_polls.load(); }
+
+private:
+	Probe m_probe;
+	AutoSaveScheduler m_scheduler;
+	std::atomic<bool> m_running{ false };
+	std::atomic<uint64_t> m_polls{ 0 };
+	uint32_t m_pid = 0; // Only touched by Start() and then the polling thread
+};
@@ -0,0 +1,96 @@
+#include "Progress.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+	// The rate is averaged over about this long, so a burst of small files (or a cache hit)
+	// does not swing the ETA
+	constexpr double kRateWindowSeconds = 3.0;
+	// Shorter samples are too noisy to count
+	constexpr auto kMinRateSample = chrono::milliseconds(100);
+}
+
+OperationProgress::OperationProgress(Callback callback, chrono::milliseconds interval)
+	: m_callback(move(callback)), m_interval(interval)
+{
+}
+
+void OperationProgress::Begin(uint64_t files, uint64_t bytes)
+{
+	m_event = ProgressEvent();
+	m_event.filesTotal = files;
+	m_event.bytesTotal = bytes;
+	m_fileBytes = 0;
+	m_start = m_rateTime = Clock::now();
+	m_rateBytes = 0;
+	Publish(true);
+}
+
+void OperationProgress::StartFile(const filesystem::path& relativePath)
+{
+	ThrowIfCancelled();
+	m_event.currentFile = relativePath;
+	m_fileBytes = 0;
+	Publish(false);
+}
+
+void OperationProgress::AddBytes(uint64_t bytes)
+{
+	m_fileBytes += bytes;
+	m_event.bytesDone += bytes;
+	Publish(false);
+}
+
+void OperationProgress::FinishFile(uint64_t size)
+{
+	// The copy may have reported less than the scan (or nothing, for small files)
+	if (size > m_fileBytes) m_event.bytesDone += size - m_fileBytes;
+	m_fileBytes = 0;
+	m_event.filesDone++;
+	m_event.currentFile.clear();
+	Publish(false);
+}
+
+void OperationProgress::Finish()
+{
+	m_event.currentFile.clear();
+	m_event.finished = true;
+	m_event.eta = chrono::seconds(0);
+	Publish(true);
+}
+
+void OperationProgress::ThrowIfCancelled() const
+{
+	if (Cancelled()) throw OperationCancelled();
+}
+
+void OperationProgress::Publish(bool force)
+{
+	Clock::time_point now = Clock::now();
+	if (!force && now - m_lastPublish < m_interval) return;
+	m_lastPublish = now;
+	m_event.elapsed = chrono::duration_cast<chrono::milliseconds>(now - m_start);
+
+	// Exponentially weighted: each sample counts by how much of the window it covers
+	if (now - m_rateTime >= kMinRateSample)
+	{
+		double seconds = chrono::duration<double>(now - m_rateTime).count();
+		double sample = static_cast<double>(m_event.bytesDone - m_rateBytes) / seconds;
+		double weight = 1.0 - exp(-seconds / kRateWindowSeconds);
+		m_event.bytesPerSecond = m_event.bytesPerSecond == 0 ? sample : m_event.bytesPerSecond + weight * (sample - m_event.bytesPerSecond);
+		m_rateTime = now;
+		m_rateBytes = m_event.bytesDone;
+	}
+	if (!m_event.finished)
+	{
+		uint64_t left = m_event.bytesTotal - min(m_event.bytesDone, m_event.bytesTotal);
+		if (left == 0) m_event.eta = chrono::seconds(0);
+		else if (m_event.bytesPerSecond > 0) m_event.eta = chrono::seconds(static_cast<long long>(ceil(static_cast<double>(left) / m_event.bytesPerSecond)));
+		else m_event.eta = chrono::seconds(-1);
+	}
+	if (m_callback) m_callback(m_event);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// Progress of a long copy (a backup's local copy, a restore). The totals come from the scan the
+// copy already does, so progress costs no extra pass over the folder. Events are published at
+// most once per interval, on the copying thread: files and bytes done, the file being copied, the
+// recent copy rate and the time left at that rate.
+//
+// Cancelling is cooperative: Cancel() may be called from any thread (or from the callback), and
+// the copy stops before its next file with OperationCancelled. The operation then rolls back what
+// it had written, so a cancelled backup or restore leaves nothing half-done.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+
+class OperationCancelled : public std::runtime_error
+{
+public:
+	OperationCancelled() : std::runtime_error("Operation cancelled") {}
+};
+
+struct ProgressEvent
+{
+	uint64_t filesDone = 0;
+	uint64_t filesTotal = 0;
+	uint64_t bytesDone = 0;            // Includes the part of the current file copied so far
+	uint64_t bytesTotal = 0;
+	std::filesystem::path currentFile; // Relative to the copied folder; empty between files
+	double bytesPerSecond = 0;         // Recent rate (a few seconds), 0 until something was copied
+	std::chrono::seconds eta{ -1 };    // Time left at that rate; -1 while unknown
+	std::chrono::milliseconds elapsed{ 0 }; // Since Begin()
+	bool finished = false;             // The last event of a copy that completed
+};
+
+class OperationProgress
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using Callback = std::function<void(const ProgressEvent&)>;
+
+	/**
+	 * @brief `callback` receives the events (may be empty: cancellation only). An interval of 0
+	 * publishes every update.
+	 */
+	explicit OperationProgress(Callback callback, std::chrono::milliseconds interval = std::chrono::milliseconds(250));
+	OperationProgress(const OperationProgress&) = delete;
+	OperationProgress& operator=(const OperationProgress&) = delete;
+
+	// Called by the copy, on one thread
+	void Begin(uint64_t files, uint64_t bytes); // Publishes the first event
+	void StartFile(const std::filesystem::path& relativePath); // Throws OperationCancelled if cancelled
+	void AddBytes(uint64_t bytes);              // Part of the current file copied
+	void FinishFile(uint64_t size);             // The current file is done; `size` is its full size
+	void Finish();                              // Publishes the finished event
+
+	/**
+	 * @brief Throws OperationCancelled if Cancel() was called.
+	 */
+	void ThrowIfCancelled() const;
+
+	// Thread-safe
+	void Cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+	bool Cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+	const ProgressEvent& Last() const { return m_event; }
+
+private:
+	void Publish(bool force);
+
+	Callback m_callback;
+	std::chrono::milliseconds m_interval;
+	std::atomic<bool> m_cancelled{ false };
+	ProgressEvent m_event;
+	uint64_t m_fileBytes = 0; // Of the current file, already in m_event.bytesDone
+	Clock::time_point m_start{};
+	Clock::time_point m_lastPublish{};
+	Clock::time_point m_rateTime{};  // When m_rateBytes was taken
+	uint64_t m_rateBytes = 0;
+};
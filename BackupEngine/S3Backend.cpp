@@ -0,0 +1,517 @@
+#include "S3Backend.h"
+#include "EngineUtils.h"
+#include "Sha256.h"
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	string ToLower(string text)
+	{
+		for (auto& c : text) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		return text;
+	}
+
+	string XmlUnescape(const string& text)
+	{
+		string out;
+		out.reserve(text.size());
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			if (text[i] != '&')
+			{
+				out += text[i];
+				continue;
+			}
+			size_t semicolon = text.find(';', i);
+			if (semicolon == string::npos) { out += text[i]; continue; }
+			string entity = text.substr(i + 1, semicolon - i - 1);
+			if (entity == "amp") out += '&';
+			else if (entity == "lt") out += '<';
+			else if (entity == "gt") out += '>';
+			else if (entity == "quot") out += '"';
+			else if (entity == "apos") out += '\'';
+			else if (!entity.empty() && entity[0] == '#')
+			{
+				unsigned long code = entity.size() > 1 && (entity[1] == 'x' || entity[1] == 'X') ? stoul(entity.substr(2), nullptr, 16) : stoul(entity.substr(1));
+				if (code < 0x80) out += static_cast<char>(code);
+				else out += "?"; // Keys written by this app are plain UTF-8, never numeric entities
+			}
+			else { out += text.substr(i, semicolon - i + 1); }
+			i = semicolon;
+		}
+		return out;
+	}
+
+	// Inner text of every <tag>...</tag> in order (tags of one name are never nested in S3 replies)
+	vector<string> XmlElements(const string& xml, const string& tag)
+	{
+		vector<string> values;
+		string open = "<" + tag + ">", close = "</" + tag + ">";
+		size_t pos = 0;
+		while ((pos = xml.find(open, pos)) != string::npos)
+		{
+			size_t start = pos + open.size();
+			size_t end = xml.find(close, start);
+			if (end == string::npos) break;
+			values.push_back(xml.substr(start, end - start));
+			pos = end + close.size();
+		}
+		return values;
+	}
+
+	string XmlElement(const string& xml, const string& tag)
+	{
+		vector<string> values = XmlElements(xml, tag);
+		return values.empty() ? string() : XmlUnescape(values.front());
+	}
+
+	string ReadFileRange(const fs::path& file, uint64_t offset, uint64_t size)
+	{
+		ifstream in(file, ios::binary);
+		if (!in) throw StorageError("Cannot open " + file.u8string());
+		in.seekg(static_cast<streamoff>(offset));
+		string data(static_cast<size_t>(size), '\0');
+		in.read(&data[0], static_cast<streamsize>(size));
+		if (static_cast<uint64_t>(in.gcount()) != size) throw StorageError("Short read from " + file.u8string());
+		return data;
+	}
+
+	[[noreturn]] void ThrowS3Error(const string& operation, const string& key, const HttpResponse& response)
+	{
+		string code = XmlElement(response.body, "Code");
+		string message = XmlElement(response.body, "Message");
+		throw StorageError("S3 " + operation + " " + key + " failed: HTTP " + to_string(response.status)
+			+ (code.empty() ? "" : " " + code) + (message.empty() ? "" : " (" + message + ")"));
+	}
+
+	bool IsSuccess(const HttpResponse& response)
+	{
+		return response.status >= 200 && response.status < 300;
+	}
+}
+
+string AmzDateNow()
+{
+	time_t now = time(nullptr);
+	tm utc{};
+#ifdef _WIN32
+	gmtime_s(&utc, &now);
+#else
+	gmtime_r(&now, &utc);
+#endif
+	char buffer[20];
+	strftime(buffer, sizeof(buffer), "%Y%m%dT%H%M%SZ", &utc);
+	return buffer;
+}
+
+void SignAwsV4(HttpRequest& request, const string& accessKey, const string& secretKey, const string& region, const string& service, const string& amzDate)
+{
+	bool hasPayloadHash = any_of(request.headers.begin(), request.headers.end(),
+		[](const auto& header) { return ToLower(header.first) == "x-amz-content-sha256"; });
+	if (!hasPayloadHash) request.headers.emplace_back("x-amz-content-sha256", Sha256Hex(request.body));
+	request.headers.emplace_back("x-amz-date", amzDate);
+
+	// Canonical headers: lowercase names, sorted, Host included as SendHttpRequest writes it
+	vector<pair<string, string>> canonical;
+	canonical.emplace_back("host", request.port == 80 ? request.host : request.host + ":" + to_string(request.port));
+	string payloadHash;
+	for (const auto& header : request.headers)
+	{
+		canonical.emplace_back(ToLower(header.first), header.second);
+		if (canonical.back().first == "x-amz-content-sha256") payloadHash = header.second;
+	}
+	sort(canonical.begin(), canonical.end());
+	string canonicalHeaders, signedHeaders;
+	for (const auto& header : canonical)
+	{
+		canonicalHeaders += header.first + ":" + header.second + "\n";
+		signedHeaders += (signedHeaders.empty() ? "" : ";") + header.first;
+	}
+
+	// Canonical query: parameters sorted by (already encoded) name
+	size_t question = request.target.find('?');
+	string path = request.target.substr(0, question);
+	vector<string> parameters;
+	if (question != string::npos)
+	{
+		string query = request.target.substr(question + 1);
+		size_t start = 0;
+		while (start <= query.size())
+		{
+			size_t amp = query.find('&', start);
+			string parameter = query.substr(start, amp == string::npos ? string::npos : amp - start);
+			if (!parameter.empty()) parameters.push_back(parameter.find('=') == string::npos ? parameter + "=" : parameter);
+			if (amp == string::npos) break;
+			start = amp + 1;
+		}
+	}
+	sort(parameters.begin(), parameters.end());
+	string canonicalQuery;
+	for (const auto& parameter : parameters) canonicalQuery += (canonicalQuery.empty() ? "" : "&") + parameter;
+
+	string canonicalRequest = request.method + "\n" + path + "\n" + canonicalQuery + "\n" + canonicalHeaders + "\n" + signedHeaders + "\n" + payloadHash;
+	string date = amzDate.substr(0, 8);
+	string scope = date + "/" + region + "/" + service + "/aws4_request";
+	string stringToSign = "AWS4-HMAC-SHA256\n" + amzDate + "\n" + scope + "\n" + Sha256Hex(canonicalRequest);
+
+	auto asString = [](const Sha256::Digest& digest) { return string(reinterpret_cast<const char*>(digest.data()), digest.size()); };
+	string key = asString(HmacSha256("AWS4" + secretKey, date));
+	key = asString(HmacSha256(key, region));
+	key = asString(HmacSha256(key, service));
+	key = asString(HmacSha256(key, "aws4_request"));
+	Sha256::Digest signature = HmacSha256(key, stringToSign);
+
+	request.headers.emplace_back("Authorization", "AWS4-HMAC-SHA256 Credential=" + accessKey + "/" + scope
+		+ ",SignedHeaders=" + signedHeaders + ",Signature=" + ToHex(signature.data(), signature.size()));
+}
+
+S3Backend::S3Backend(S3Options options) : m_options(move(options)), m_url(ParseHttpUrl(m_options.endpoint))
+{
+	if (m_options.bucket.empty()) throw StorageError("S3 bucket is not set");
+	m_options.parallelism = max(1, m_options.parallelism);
+	m_options.partSize = max<uint64_t>(m_options.partSize, 5 * 1024 * 1024);
+	m_options.multipartThreshold = max(m_options.multipartThreshold, m_options.partSize);
+}
+
+HttpResponse S3Backend::Send(const string& method, const string& key, const Params& query, string body, Params headers)
+{
+	HttpRequest request;
+	request.method = method;
+	request.host = m_url.host;
+	request.port = m_url.port;
+	request.target = m_url.basePath + "/" + UriEncode(m_options.bucket, false) + (key.empty() ? "" : "/" + UriEncode(key, true));
+
+	Params sorted = query;
+	sort(sorted.begin(), sorted.end());
+	string queryString;
+	for (const auto& parameter : sorted)
+	{
+		queryString += (queryString.empty() ? "?" : "&") + UriEncode(parameter.first, false);
+		if (!parameter.second.empty() || parameter.first != "uploads") queryString += "=" + UriEncode(parameter.second, false);
+	}
+	request.target += queryString;
+	request.headers = move(headers);
+	request.body = move(body);
+	SignAwsV4(request, m_options.accessKey, m_options.secretKey, m_options.region, "s3", AmzDateNow());
+
+	m_requests.fetch_add(1, memory_order_relaxed);
+	return SendHttpRequest(request, m_options.timeout);
+}
+
+bool S3Backend::PutFile(const fs::path& source, const string& key, bool ifAbsent)
+{
+	CopyStats stats;
+	return PutJournaled(source, key, ifAbsent, nullptr, stats);
+}
+
+bool S3Backend::PutJournaled(const fs::path& source, const string& key, bool ifAbsent, TransferJournal* journal, CopyStats& stats)
+{
+	uint64_t size = fs::file_size(source);
+	if (size >= m_options.multipartThreshold) return PutMultipart(source, key, size, ifAbsent, journal, stats);
+
+	// The digest is stored as metadata so Stat() can verify the object without downloading it
+	string body = ReadFileRange(source, 0, size);
+	string sha256 = Sha256Hex(body);
+	Params headers = { { "x-amz-content-sha256", sha256 }, { "x-amz-meta-sha256", sha256 } };
+	if (ifAbsent) headers.emplace_back("If-None-Match", "*");
+	HttpResponse response = Send("PUT", key, {}, move(body), headers);
+	if (ifAbsent && response.status == 412) return false; // Precondition failed: the key exists
+	if (!IsSuccess(response)) ThrowS3Error("PUT", key, response);
+	if (journal) journal->FileDone(key, size, sha256);
+	stats.filesCopied++;
+	stats.bytesCopied += size;
+	return true;
+}
+
+bool S3Backend::PutBytes(const string& key, const string& data, bool ifAbsent)
+{
+	string sha256 = Sha256Hex(data);
+	Params headers = { { "x-amz-content-sha256", sha256 }, { "x-amz-meta-sha256", sha256 } };
+	if (ifAbsent) headers.emplace_back("If-None-Match", "*");
+	HttpResponse response = Send("PUT", key, {}, data, headers);
+	if (ifAbsent && response.status == 412) return false;
+	if (!IsSuccess(response)) ThrowS3Error("PUT", key, response);
+	return true;
+}
+
+string S3Backend::GetBytes(const string& key)
+{
+	HttpResponse response = Send("GET", key, {}, "");
+	if (response.status == 404) throw StorageError("No such object: " + key);
+	if (!IsSuccess(response)) ThrowS3Error("GET", key, response);
+	return move(response.body);
+}
+
+map<int, TransferJournal::Part> S3Backend::ListParts(const string& key, const string& uploadId, bool& uploadExists)
+{
+	map<int, TransferJournal::Part> parts;
+	string marker;
+	uploadExists = true;
+	while (true)
+	{
+		Params query = { { "uploadId", uploadId } };
+		if (!marker.empty()) query.emplace_back("part-number-marker", marker);
+		HttpResponse response = Send("GET", key, query, "");
+		if (response.status == 404) // NoSuchUpload: completed, aborted or expired
+		{
+			uploadExists = false;
+			return {};
+		}
+		if (!IsSuccess(response)) ThrowS3Error("ListParts", key, response);
+		for (const auto& part : XmlElements(response.body, "Part"))
+		{
+			string size = XmlElement(part, "Size");
+			parts[stoi(XmlElement(part, "PartNumber"))] = { XmlElement(part, "ETag"), size.empty() ? 0 : stoull(size) };
+		}
+		if (XmlElement(response.body, "IsTruncated") != "true") return parts;
+		marker = XmlElement(response.body, "NextPartNumberMarker");
+		if (marker.empty()) throw StorageError("S3 part listing of " + key + " is truncated but has no marker");
+	}
+}
+
+bool S3Backend::PutMultipart(const fs::path& source, const string& key, uint64_t size, bool ifAbsent, TransferJournal* journal, CopyStats& stats)
+{
+	if (ifAbsent && Exists(key)) return false; // Cheap early exit; the completion below is still conditional
+
+	size_t partCount = static_cast<size_t>((size + m_options.partSize - 1) / m_options.partSize);
+	auto partLength = [&](size_t i) { return min(m_options.partSize, size - i * m_options.partSize); };
+	vector<string> etags(partCount);
+
+	// Continue a journaled upload: parts that both the journal and the server know are kept
+	string uploadId;
+	uint64_t resumed = 0;
+	TransferJournal::Upload earlier;
+	if (journal && journal->FindUpload(key, earlier))
+	{
+		bool uploadExists = false;
+		map<int, TransferJournal::Part> listed = ListParts(key, earlier.uploadId, uploadExists);
+		if (uploadExists)
+		{
+			uploadId = earlier.uploadId;
+			for (const auto& [number, part] : earlier.parts)
+			{
+				auto server = listed.find(number);
+				if (number < 1 || static_cast<size_t>(number) > partCount || server == listed.end()) continue;
+				if (server->second.etag != part.etag || server->second.size != part.size || part.size != partLength(number - 1)) continue;
+				etags[number - 1] = part.etag;
+				resumed += part.size;
+			}
+		}
+	}
+
+	if (uploadId.empty())
+	{
+		// Digest as metadata (see PutJournaled); one local read pass before anything is sent
+		HttpResponse created = Send("POST", key, { { "uploads", "" } }, "", { { "x-amz-meta-sha256", Sha256FileHex(source) } });
+		if (!IsSuccess(created)) ThrowS3Error("CreateMultipartUpload", key, created);
+		uploadId = XmlElement(created.body, "UploadId");
+		if (uploadId.empty()) throw StorageError("S3 CreateMultipartUpload " + key + " returned no UploadId");
+		if (journal) journal->UploadStarted(key, uploadId);
+	}
+
+	vector<size_t> missing;
+	for (size_t i = 0; i < partCount; ++i)
+	{
+		if (etags[i].empty()) missing.push_back(i);
+	}
+	try
+	{
+		// Each part is read and sent by its own worker, so at most `parallelism` parts are in memory
+		ParallelFor(missing.size(), m_options.parallelism, [&](size_t m)
+			{
+				size_t i = missing[m];
+				uint64_t length = partLength(i);
+				HttpResponse part = Send("PUT", key, { { "partNumber", to_string(i + 1) }, { "uploadId", uploadId } }, ReadFileRange(source, i * m_options.partSize, length));
+				if (!IsSuccess(part)) ThrowS3Error("UploadPart", key, part);
+				etags[i] = part.Header("etag");
+				if (journal) journal->PartDone(key, static_cast<int>(i + 1), etags[i], length);
+			});
+
+		string complete = "<CompleteMultipartUpload>";
+		for (size_t i = 0; i < partCount; ++i)
+		{
+			complete += "<Part><PartNumber>" + to_string(i + 1) + "</PartNumber><ETag>" + etags[i] + "</ETag></Part>";
+		}
+		complete += "</CompleteMultipartUpload>";
+		Params headers;
+		if (ifAbsent) headers.emplace_back("If-None-Match", "*");
+		HttpResponse done = Send("POST", key, { { "uploadId", uploadId } }, complete, headers);
+		if (ifAbsent && done.status == 412)
+		{
+			Send("DELETE", key, { { "uploadId", uploadId } }, "");
+			return false;
+		}
+		// S3 can report a failed completion with status 200 and an <Error> body
+		if (!IsSuccess(done) || done.body.find("<Error>") != string::npos) ThrowS3Error("CompleteMultipartUpload", key, done);
+	}
+	catch (...)
+	{
+		// A journaled upload stays open so a later attempt can continue it (DiscardTransfer aborts it)
+		if (!journal)
+		{
+			try { Send("DELETE", key, { { "uploadId", uploadId } }, ""); } // Abort so the parts are not billed forever
+			catch (...) {}
+		}
+		throw;
+	}
+
+	if (journal)
+	{
+		StorageObject stored;
+		if (!Stat(key, stored)) throw StorageError("S3 object " + key + " is missing after CompleteMultipartUpload");
+		journal->FileDone(key, size, stored.sha256);
+	}
+	stats.filesCopied++;
+	stats.bytesCopied += size - resumed;
+	stats.bytesResumed += resumed;
+	return true;
+}
+
+void S3Backend::GetFile(const string& key, const fs::path& target)
+{
+	fs::create_directories(target.parent_path());
+	fs::path partial = target;
+	partial += ".partial";
+	{
+		ofstream out(partial, ios::binary | ios::trunc);
+		if (!out) throw StorageError("Cannot write " + partial.u8string());
+
+		// Ranged GETs keep memory bounded to one part for multi-GB objects
+		uint64_t offset = 0;
+		while (true)
+		{
+			uint64_t last = offset + m_options.partSize - 1;
+			HttpResponse response = Send("GET", key, {}, "", { { "Range", "bytes=" + to_string(offset) + "-" + to_string(last) } });
+			if (response.status == 416 && offset > 0) break; // Object size was an exact multiple of the part size
+			if (!IsSuccess(response)) ThrowS3Error("GET", key, response);
+			out.write(response.body.data(), static_cast<streamsize>(response.body.size()));
+			if (response.status == 200) break; // Server ignored the range and sent everything
+
+			string contentRange = response.Header("content-range"); // "bytes a-b/total"
+			size_t slash = contentRange.rfind('/');
+			uint64_t total = slash == string::npos ? 0 : stoull(contentRange.substr(slash + 1));
+			offset += response.body.size();
+			if (response.body.empty() || offset >= total) break;
+		}
+		if (!out.flush()) throw StorageError("Cannot write " + partial.u8string());
+	}
+	fs::rename(partial, target);
+}
+
+bool S3Backend::Exists(const string& key)
+{
+	HttpResponse response = Send("HEAD", key, {}, "");
+	if (response.status == 404) return false;
+	if (!IsSuccess(response)) ThrowS3Error("HEAD", key, response);
+	return true;
+}
+
+bool S3Backend::Stat(const string& key, StorageObject& object)
+{
+	HttpResponse response = Send("HEAD", key, {}, "");
+	if (response.status == 404) return false;
+	if (!IsSuccess(response)) ThrowS3Error("HEAD", key, response);
+	string length = response.Header("content-length");
+	object.key = key;
+	object.size = length.empty() ? 0 : stoull(length);
+	object.etag = response.Header("etag");
+	object.sha256 = response.Header("x-amz-meta-sha256"); // Empty for objects uploaded by other tools
+	return true;
+}
+
+StorageListing S3Backend::List(const string& prefix, const string& delimiter, const string& continuationToken, size_t maxKeys)
+{
+	Params query = { { "list-type", "2" }, { "prefix", prefix }, { "max-keys", to_string(maxKeys) } };
+	if (!delimiter.empty()) query.emplace_back("delimiter", delimiter);
+	if (!continuationToken.empty()) query.emplace_back("continuation-token", continuationToken);
+	HttpResponse response = Send("GET", "", query, "");
+	if (!IsSuccess(response)) ThrowS3Error("ListObjectsV2", prefix, response);
+
+	StorageListing listing;
+	for (const auto& contents : XmlElements(response.body, "Contents"))
+	{
+		StorageObject object;
+		object.key = XmlElement(contents, "Key");
+		string size = XmlElement(contents, "Size");
+		object.size = size.empty() ? 0 : stoull(size);
+		object.etag = XmlElement(contents, "ETag");
+		listing.objects.push_back(move(object));
+	}
+	for (const auto& common : XmlElements(response.body, "CommonPrefixes"))
+	{
+		listing.prefixes.push_back(XmlElement(common, "Prefix"));
+	}
+	if (XmlElement(response.body, "IsTruncated") == "true")
+	{
+		listing.nextToken = XmlElement(response.body, "NextContinuationToken");
+		if (listing.nextToken.empty()) throw StorageError("S3 listing of " + prefix + " is truncated but has no continuation token");
+	}
+	return listing;
+}
+
+void S3Backend::Remove(const string& key)
+{
+	HttpResponse response = Send("DELETE", key, {}, "");
+	if (!IsSuccess(response) && response.status != 404) ThrowS3Error("DELETE", key, response);
+}
+
+CopyStats S3Backend::PutTree(const TreeScan& scan, const fs::path& from, const string& prefix, TransferJournal* journal)
+{
+	vector<const ScannedEntry*> small, large;
+	CopyStats stats;
+	for (const auto& entry : scan.entries)
+	{
+		if (entry.type == fs::file_type::directory) continue;
+		if (entry.type != fs::file_type::regular)
+		{
+			stats.filesSkipped++;
+			continue;
+		}
+		(entry.size >= m_options.multipartThreshold ? large : small).push_back(&entry);
+	}
+
+	mutex statsMutex;
+	auto put = [&](const ScannedEntry* entry)
+		{
+			string key = prefix + entry->relativePath.generic_u8string();
+			CopyStats file;
+			if (journal && IsStoredAsJournaled(key, *journal))
+			{
+				file.filesResumed++;
+				file.bytesResumed += entry->size;
+			}
+			else PutJournaled(from / entry->relativePath, key, false, journal, file);
+
+			lock_guard<mutex> lock(statsMutex);
+			stats.filesCopied += file.filesCopied;
+			stats.bytesCopied += file.bytesCopied;
+			stats.filesResumed += file.filesResumed;
+			stats.bytesResumed += file.bytesResumed;
+		};
+	ParallelFor(small.size(), m_options.parallelism, [&](size_t i) { put(small[i]); });
+	for (const ScannedEntry* entry : large) put(entry); // Already parallel inside
+	if (journal) journal->TreeDone();
+	return stats;
+}
+
+void S3Backend::DiscardTransfer(const string& prefix, const TransferJournal& journal)
+{
+	for (const auto& [key, upload] : journal.Uploads())
+	{
+		HttpResponse response = Send("DELETE", key, { { "uploadId", upload.uploadId } }, "");
+		if (!IsSuccess(response) && response.status != 404) ThrowS3Error("AbortMultipartUpload", key, response);
+	}
+	RemovePrefix(prefix);
+}
@@ -0,0 +1,340 @@
+#include "SearchIndex.h"
+#include "BackupIndex.h"
+#include "BackupOperations.h"
+#include "Config.h"
+#include "EngineUtils.h"
+#include "Sha256.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <system_error>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const char* const kSearchHeader = "GSBM-SEARCH 1";
+
+	// Same content if both digests are known, otherwise same size and time
+	bool SameVersion(const string& sha256, uint64_t size, int64_t mtime, const string& otherSha256, uint64_t otherSize, int64_t otherMtime)
+	{
+		if (!sha256.empty() && !otherSha256.empty()) return sha256 == otherSha256;
+		return size == otherSize && mtime == otherMtime;
+	}
+
+	// Backups holding a version are mostly consecutive, so they are stored as runs: "0-41,57"
+	void AppendRanges(string& text, const vector<uint32_t>& ids)
+	{
+		for (size_t i = 0; i < ids.size(); )
+		{
+			size_t run = i;
+			while (run + 1 < ids.size() && ids[run + 1] == ids[run] + 1) run++;
+			if (i) text += ',';
+			text += to_string(ids[i]);
+			if (run > i) text += '-' + to_string(ids[run]);
+			i = run + 1;
+		}
+	}
+
+	// Maps file ids through `ids`; false if malformed or out of range
+	bool ParseRanges(const string& text, const vector<uint32_t>& ids, vector<uint32_t>& out)
+	{
+		const char* c = text.data();
+		const char* end = c + text.size();
+		while (c < end)
+		{
+			uint32_t first = 0, last = 0;
+			auto parsed = from_chars(c, end, first);
+			if (parsed.ec != errc()) return false;
+			c = parsed.ptr;
+			last = first;
+			if (c < end && *c == '-')
+			{
+				parsed = from_chars(c + 1, end, last);
+				if (parsed.ec != errc() || last < first) return false;
+				c = parsed.ptr;
+			}
+			if (last >= ids.size() || (c < end && *c++ != ',')) return false;
+			for (uint32_t id = first; id <= last; ++id) out.push_back(ids[id]);
+		}
+		return true;
+	}
+
+	string Lowercase(string text)
+	{
+		transform(text.begin(), text.end(), text.begin(), [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+		return text;
+	}
+}
+
+fs::path GetSearchIndexPath(const fs::path& gameBackupDir)
+{
+	return gameBackupDir / ".manifests" / "search.index";
+}
+
+BackupSearchIndex::BackupSearchIndex(fs::path gameBackupDir)
+	: m_gameBackupDir(move(gameBackupDir))
+{
+	Load();
+}
+
+void BackupSearchIndex::Load()
+{
+	ifstream in(GetSearchIndexPath(m_gameBackupDir), ios::binary);
+	string line;
+	if (!in || !getline(in, line) || line != kSearchHeader) return;
+
+	vector<uint32_t> ids; // File order -> id
+	while (getline(in, line))
+	{
+		vector<string> fields = SplitTabFields(line);
+		if (fields[0] == "B" && fields.size() == 2)
+		{
+			wstring name = s2ws(fields[1]);
+			if (name.empty() || m_backupIds.count(name)) break;
+			m_backupIds[name] = static_cast<uint32_t>(m_backups.size());
+			ids.push_back(static_cast<uint32_t>(m_backups.size()));
+			m_backups.push_back(name);
+			continue;
+		}
+		if (fields[0] != "V" || fields.size() != 6 || fields[1].empty()) break;
+		Version version;
+		version.sha256 = fields[2];
+		try {
+			version.size = stoull(fields[3]);
+			version.mtime = stoll(fields[4]);
+		}
+		catch (const exception&) {
+			break;
+		}
+		if (!ParseRanges(fields[5], ids, version.backups) || version.backups.empty()) break;
+		m_files[UnescapeTabField(fields[1])].push_back(move(version));
+	}
+	if (in) // Stopped at a malformed line: start over rather than trust part of it
+	{
+		m_backups.clear();
+		m_backupIds.clear();
+		m_files.clear();
+	}
+}
+
+void BackupSearchIndex::AddBackup(const wstring& folderName, const BackupManifest& index)
+{
+	RemoveBackup(folderName);
+	uint32_t id = static_cast<uint32_t>(m_backups.size());
+	m_backups.push_back(folderName);
+	m_backupIds[folderName] = id;
+
+	for (const auto& entry : index.entries)
+	{
+		if (entry.type != fs::file_type::regular) continue;
+		vector<Version>& versions = m_files[entry.path];
+		auto match = find_if(versions.begin(), versions.end(), [&](const Version& v) { return SameVersion(v.sha256, v.size, v.mtime, entry.sha256, entry.size, entry.mtime); });
+		if (match == versions.end())
+		{
+			versions.push_back({ entry.sha256, entry.size, entry.mtime, {} });
+			match = prev(versions.end());
+		}
+		else if (match->sha256.empty())
+		{
+			match->sha256 = entry.sha256;
+		}
+		if (match->backups.empty() || match->backups.back() != id) match->backups.push_back(id);
+	}
+}
+
+void BackupSearchIndex::RemoveBackup(const wstring& folderName)
+{
+	auto found = m_backupIds.find(folderName);
+	if (found == m_backupIds.end()) return;
+	uint32_t id = found->second;
+	m_backupIds.erase(found);
+	m_backups[id].clear();
+
+	for (auto it = m_files.begin(); it != m_files.end(); )
+	{
+		vector<Version>& versions = it->second;
+		for (auto& version : versions)
+		{
+			version.backups.erase(remove(version.backups.begin(), version.backups.end(), id), version.backups.end());
+		}
+		versions.erase(remove_if(versions.begin(), versions.end(), [](const Version& v) { return v.backups.empty(); }), versions.end());
+		it = versions.empty() ? m_files.erase(it) : next(it);
+	}
+}
+
+bool BackupSearchIndex::Covers(const wstring& folderName) const
+{
+	return m_backupIds.count(folderName) != 0;
+}
+
+bool BackupSearchIndex::Reconcile()
+{
+	TraceSpan span("search_index_reconcile");
+	unordered_set<wstring> onDisk;
+	for (const auto& folder : ListBackups(m_gameBackupDir))
+	{
+		onDisk.insert(PathToWide(folder.filename()));
+	}
+
+	bool changed = false;
+	vector<wstring> gone;
+	for (const auto& [name, id] : m_backupIds)
+	{
+		if (!onDisk.count(name)) gone.push_back(name);
+	}
+	for (const auto& name : gone)
+	{
+		RemoveBackup(name);
+		changed = true;
+	}
+	for (const auto& name : onDisk)
+	{
+		if (Covers(name)) continue;
+		try {
+			AddBackup(name, LoadBackupIndex(m_gameBackupDir / ToPath(name)));
+			changed = true;
+		}
+		catch (const fs::filesystem_error&) {} // Unreadable backup: tried again next time
+	}
+	return changed;
+}
+
+size_t BackupSearchIndex::FillDigests(BackupManifest& index, const fs::path& backupFolder) const
+{
+	TraceSpan span("digest");
+	size_t hashed = 0;
+	for (auto& entry : index.entries)
+	{
+		if (entry.type != fs::file_type::regular || !entry.sha256.empty()) continue;
+		auto found = m_files.find(entry.path);
+		if (found != m_files.end())
+		{
+			for (const auto& version : found->second)
+			{
+				if (!version.sha256.empty() && version.size == entry.size && version.mtime == entry.mtime)
+				{
+					entry.sha256 = version.sha256;
+					break;
+				}
+			}
+		}
+		if (!entry.sha256.empty()) continue;
+		try {
+			entry.sha256 = Sha256FileHex(backupFolder / fs::u8path(entry.path));
+			hashed++;
+		}
+		catch (const fs::filesystem_error&) {} // Indexed without a digest
+	}
+	return hashed;
+}
+
+FileVersion BackupSearchIndex::ToFileVersion(const string& path, const Version& version) const
+{
+	FileVersion result{ path, version.sha256, version.size, version.mtime, {} };
+	for (uint32_t id : version.backups) result.backups.push_back(m_backups[id]);
+	// Folder names start with the epoch time, as in ListBackups
+	sort(result.backups.rbegin(), result.backups.rend());
+	return result;
+}
+
+vector<FileVersion> BackupSearchIndex::Versions(const string& path) const
+{
+	vector<FileVersion> versions;
+	auto found = m_files.find(path);
+	if (found == m_files.end()) return versions;
+	for (const auto& version : found->second) versions.push_back(ToFileVersion(path, version));
+	sort(versions.begin(), versions.end(), [](const FileVersion& a, const FileVersion& b) { return a.backups.front() > b.backups.front(); });
+	return versions;
+}
+
+vector<FileVersion> BackupSearchIndex::WithDigest(const string& sha256) const
+{
+	vector<FileVersion> matches;
+	if (sha256.empty()) return matches;
+	for (const auto& [path, versions] : m_files)
+	{
+		for (const auto& version : versions)
+		{
+			if (version.sha256 == sha256) matches.push_back(ToFileVersion(path, version));
+		}
+	}
+	sort(matches.begin(), matches.end(), [](const FileVersion& a, const FileVersion& b) { return a.path < b.path; });
+	return matches;
+}
+
+vector<string> BackupSearchIndex::FindPaths(const string& fragment) const
+{
+	string needle = Lowercase(fragment);
+	vector<string> paths;
+	for (const auto& file : m_files)
+	{
+		if (Lowercase(file.first).find(needle) != string::npos) paths.push_back(file.first);
+	}
+	sort(paths.begin(), paths.end());
+	return paths;
+}
+
+size_t BackupSearchIndex::VersionCount() const
+{
+	size_t count = 0;
+	for (const auto& file : m_files) count += file.second.size();
+	return count;
+}
+
+bool BackupSearchIndex::Save() const
+{
+	// Ids are renumbered densely; removed backups leave gaps in memory only
+	vector<uint32_t> fileIds(m_backups.size(), 0);
+	string text = string(kSearchHeader) + "\n";
+	uint32_t nextId = 0;
+	for (size_t id = 0; id < m_backups.size(); ++id)
+	{
+		if (m_backups[id].empty()) continue;
+		fileIds[id] = nextId++;
+		text += "B\t" + ws2s(m_backups[id]) + "\n";
+	}
+	for (const auto& [path, versions] : m_files)
+	{
+		for (const auto& version : versions)
+		{
+			text += "V\t" + EscapeTabField(path) + "\t" + version.sha256 + "\t" + to_string(version.size) + "\t" + to_string(version.mtime) + "\t";
+			vector<uint32_t> ids;
+			ids.reserve(version.backups.size());
+			for (uint32_t id : version.backups) ids.push_back(fileIds[id]);
+			AppendRanges(text, ids);
+			text += '\n';
+		}
+	}
+
+	fs::path file = GetSearchIndexPath(m_gameBackupDir);
+	error_code ec;
+	fs::create_directories(file.parent_path(), ec);
+	// Each writer has its own temporary file, so two backups of the game saving at once never
+	// rename one another's half-written index into place
+	fs::path temp = file;
+	temp += "." + ws2s(GenerateProfileId()) + ".tmp";
+	{
+		ofstream out(temp, ios::binary | ios::trunc);
+		if (!out.write(text.data(), static_cast<streamsize>(text.size())).flush())
+		{
+			out.close();
+			fs::remove(temp, ec);
+			return false;
+		}
+	}
+	fs::rename(temp, file, ec);
+	if (ec) fs::remove(temp, ec);
+	return !ec;
+}
+
+BackupSearchIndex LoadBackupSearchIndex(const fs::path& gameBackupDir)
+{
+	BackupSearchIndex index(gameBackupDir);
+	if (index.Reconcile()) index.Save();
+	return index;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+// Index of every file version across a game's local backups, kept next to the backup indexes:
+//
+//   <game backup dir>/.manifests/search.index
+//
+// One line per backup it covers, then one line per distinct version of a file (path, SHA-256,
+// size, save-folder modification time) naming the backups that hold it. It is updated as each
+// backup is made, so "every version of slot2.sav" is a lookup instead of a walk of every
+// backup folder.
+
+#include "Manifest.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct FileVersion
+{
+	std::string path;                  // '/'-separated
+	std::string sha256;                // Empty if the backup was indexed without digests
+	uint64_t size = 0;
+	int64_t mtime = 0;                 // Nanoseconds since the Unix epoch
+	std::vector<std::wstring> backups; // Folder names, newest first
+};
+
+/**
+ * @brief "<gameBackupDir>/.manifests/search.index".
+ */
+std::filesystem::path GetSearchIndexPath(const std::filesystem::path& gameBackupDir);
+
+class BackupSearchIndex
+{
+public:
+	/**
+	 * @brief Loads the search index of a game's backup folder. A missing or unreadable file
+	 * gives an empty index; Reconcile() then fills it from the backup indexes.
+	 */
+	explicit BackupSearchIndex(std::filesystem::path gameBackupDir);
+
+	/**
+	 * @brief Adds a backup's files (its index, BackupIndex.h). Replaces it if already covered.
+	 */
+	void AddBackup(const std::wstring& folderName, const BackupManifest& index);
+	void RemoveBackup(const std::wstring& folderName);
+	bool Covers(const std::wstring& folderName) const;
+
+	/**
+	 * @brief Brings the index in line with the backup folders on disk: purged backups are
+	 * dropped, and backups it does not cover (made before it existed, or while it could not
+	 * be written) are added from their indexes. Returns true if anything changed.
+	 */
+	bool Reconcile();
+
+	/**
+	 * @brief Sets the SHA-256 of every regular file in `index`. A file whose path, size and
+	 * time match an indexed version reuses its digest; the rest are hashed from `backupFolder`
+	 * (left empty if unreadable). Returns the number of files hashed.
+	 */
+	size_t FillDigests(BackupManifest& index, const std::filesystem::path& backupFolder) const;
+
+	/**
+	 * @brief Distinct versions of a file, the one in the newest backup first.
+	 */
+	std::vector<FileVersion> Versions(const std::string& path) const;
+
+	/**
+	 * @brief Every path (in any backup) whose contents have this digest.
+	 */
+	std::vector<FileVersion> WithDigest(const std::string& sha256) const;
+
+	/**
+	 * @brief Indexed file paths containing `fragment` (ASCII case-insensitive), sorted.
+	 */
+	std::vector<std::string> FindPaths(const std::string& fragment) const;
+
+	size_t BackupCount() const { return m_backupIds.size(); }
+	size_t VersionCount() const;
+
+	/**
+	 * @brief Writes the index (temporary file, then rename). Returns false on failure; the next
+	 * Reconcile() then re-adds the backups the file misses.
+	 */
+	bool Save() const;
+
+private:
+	struct Version
+	{
+		std::string sha256;
+		uint64_t size = 0;
+		int64_t mtime = 0;
+		std::vector<uint32_t> backups; // Ids into m_backups; empty once every holder is removed
+	};
+
+	void Load();
+	FileVersion ToFileVersion(const std::string& path, const Version& version) const;
+
+	std::filesystem::path m_gameBackupDir;
+	std::vector<std::wstring> m_backups; // By id; removed backups leave an empty name
+	std::unordered_map<std::wstring, uint32_t> m_backupIds;
+	std::unordered_map<std::string, std::vector<Version>> m_files; // By path
+};
+
+/**
+ * @brief Loads and reconciles a game's search index, saving it (best effort) if it changed.
+ */
+BackupSearchIndex LoadBackupSearchIndex(const std::filesystem::path& gameBackupDir);
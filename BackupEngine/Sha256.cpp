@@ -0,0 +1,215 @@
+#include "Sha256.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const uint32_t kRoundConstants[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+	inline uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+}
+
+Sha256::Sha256()
+	: m_state{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }
+{
+}
+
+void Sha256::Transform(const uint8_t* block)
+{
+	uint32_t w[64];
+	for (int i = 0; i < 16; ++i)
+	{
+		w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) | (uint32_t(block[i * 4 + 2]) << 8) | block[i * 4 + 3];
+	}
+	for (int i = 16; i < 64; ++i)
+	{
+		uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+	uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+	for (int i = 0; i < 64; ++i)
+	{
+		uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRoundConstants[i] + w[i];
+		uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+	m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+	m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+}
+
+void Sha256::Update(const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	m_totalBytes += size;
+	if (m_bufferSize > 0)
+	{
+		size_t take = min(size, sizeof(m_buffer) - m_bufferSize);
+		memcpy(m_buffer + m_bufferSize, bytes, take);
+		m_bufferSize += take;
+		bytes += take;
+		size -= take;
+		if (m_bufferSize < sizeof(m_buffer)) return;
+		Transform(m_buffer);
+		m_bufferSize = 0;
+	}
+	for (; size >= 64; bytes += 64, size -= 64) Transform(bytes); // Whole blocks straight from the input
+	memcpy(m_buffer, bytes, size);
+	m_bufferSize = size;
+}
+
+Sha256::Digest Sha256::Final()
+{
+	uint64_t bitLength = m_totalBytes * 8;
+	uint8_t padding[72] = { 0x80 };
+	size_t padSize = (m_bufferSize < 56 ? 56 : 120) - m_bufferSize;
+	for (int i = 0; i < 8; ++i) padding[padSize + i] = static_cast<uint8_t>(bitLength >> (56 - 8 * i));
+	Update(padding, padSize + 8);
+
+	Digest digest;
+	for (int i = 0; i < 8; ++i)
+	{
+		digest[i * 4] = static_cast<uint8_t>(m_state[i] >> 24);
+		digest[i * 4 + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+		digest[i * 4 + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+		digest[i * 4 + 3] = static_cast<uint8_t>(m_state[i]);
+	}
+	return digest;
+}
+
+string ToHex(const uint8_t* data, size_t size)
+{
+	static const char kDigits[] = "0123456789abcdef";
+	string hex(size * 2, '0');
+	for (size_t i = 0; i < size; ++i)
+	{
+		hex[i * 2] = kDigits[data[i] >> 4];
+		hex[i * 2 + 1] = kDigits[data[i] & 0xF];
+	}
+	return hex;
+}
+
+string Sha256Hex(string_view data)
+{
+	Sha256 hash;
+	hash.Update(data);
+	Sha256::Digest digest = hash.Final();
+	return ToHex(digest.data(), digest.size());
+}
+
+Sha256::Digest HmacSha256(string_view key, string_view data)
+{
+	uint8_t block[64] = {};
+	if (key.size() > sizeof(block))
+	{
+		Sha256 keyHash;
+		keyHash.Update(key);
+		Sha256::Digest digest = keyHash.Final();
+		memcpy(block, digest.data(), digest.size());
+	}
+	else
+	{
+		memcpy(block, key.data(), key.size());
+	}
+
+	uint8_t innerPad[64], outerPad[64];
+	for (int i = 0; i < 64; ++i)
+	{
+		innerPad[i] = block[i] ^ 0x36;
+		outerPad[i] = block[i] ^ 0x5c;
+	}
+	Sha256 inner;
+	inner.Update(innerPad, sizeof(innerPad));
+	inner.Update(data);
+	Sha256::Digest innerDigest = inner.Final();
+
+	Sha256 outer;
+	outer.Update(outerPad, sizeof(outerPad));
+	outer.Update(innerDigest.data(), innerDigest.size());
+	return outer.Final();
+}
+
+string Sha256FileHex(const fs::path& file)
+{
+	ifstream in(file, ios::binary);
+	if (!in) throw fs::filesystem_error("Cannot read file", file, make_error_code(errc::io_error));
+	Sha256 hash;
+	vector<char> buffer(1024 * 1024);
+	while (in)
+	{
+		in.read(buffer.data(), static_cast<streamsize>(buffer.size()));
+		hash.Update(buffer.data(), static_cast<size_t>(in.gcount()));
+	}
+	Sha256::Digest digest = hash.Final();
+	return ToHex(digest.data(), digest.size());
+}
+
+string Pbkdf2HmacSha256(string_view password, string_view salt, uint32_t iterations, size_t length)
+{
+	// HMAC with the pads hashed once: each iteration then costs two compressions
+	uint8_t block[64] = {};
+	if (password.size() > sizeof(block))
+	{
+		Sha256 keyHash;
+		keyHash.Update(password);
+		Sha256::Digest digest = keyHash.Final();
+		memcpy(block, digest.data(), digest.size());
+	}
+	else
+	{
+		memcpy(block, password.data(), password.size());
+	}
+	uint8_t innerPad[64], outerPad[64];
+	for (int i = 0; i < 64; ++i)
+	{
+		innerPad[i] = block[i] ^ 0x36;
+		outerPad[i] = block[i] ^ 0x5c;
+	}
+	Sha256 innerBase, outerBase;
+	innerBase.Update(innerPad, sizeof(innerPad));
+	outerBase.Update(outerPad, sizeof(outerPad));
+	auto hmac = [&](const uint8_t* data, size_t size, const uint8_t* more = nullptr, size_t moreSize = 0)
+		{
+			Sha256 inner = innerBase;
+			inner.Update(data, size);
+			if (more) inner.Update(more, moreSize);
+			Sha256::Digest innerDigest = inner.Final();
+			Sha256 outer = outerBase;
+			outer.Update(innerDigest.data(), innerDigest.size());
+			return outer.Final();
+		};
+
+	string output;
+	output.reserve(length);
+	for (uint32_t blockIndex = 1; output.size() < length; ++blockIndex)
+	{
+		uint8_t counter[4] = { static_cast<uint8_t>(blockIndex >> 24), static_cast<uint8_t>(blockIndex >> 16), static_cast<uint8_t>(blockIndex >> 8), static_cast<uint8_t>(blockIndex) };
+		Sha256::Digest u = hmac(reinterpret_cast<const uint8_t*>(salt.data()), salt.size(), counter, sizeof(counter));
+		Sha256::Digest t = u;
+		for (uint32_t i = 1; i < iterations; ++i)
+		{
+			u = hmac(u.data(), u.size());
+			for (size_t b = 0; b < t.size(); ++b) t[b] ^= u[b];
+		}
+		output.append(reinterpret_cast<const char*>(t.data()), min(t.size(), length - output.size()));
+	}
+	return output;
+}
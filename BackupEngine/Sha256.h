@@ -0,0 +1,55 @@
+#pragma once
+
+// SHA-256, HMAC-SHA256 and PBKDF2-HMAC-SHA256 (FIPS 180-4 / RFC 2104 / RFC 8018). Used to sign
+// object-store requests, to fingerprint file contents and to derive encryption keys; no
+// external crypto library is needed.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+class Sha256
+{
+public:
+	using Digest = std::array<uint8_t, 32>;
+
+	Sha256();
+
+	void Update(const void* data, size_t size);
+	void Update(std::string_view data) { Update(data.data(), data.size()); }
+
+	/**
+	 * @brief Finishes the hash. The object must not be updated afterwards.
+	 */
+	Digest Final();
+
+private:
+	void Transform(const uint8_t* block);
+
+	uint32_t m_state[8];
+	uint8_t m_buffer[64];
+	size_t m_bufferSize = 0;
+	uint64_t m_totalBytes = 0;
+};
+
+/**
+ * @brief Lowercase hex encoding of a byte range.
+ */
+std::string ToHex(const uint8_t* data, size_t size);
+
+std::string Sha256Hex(std::string_view data);
+
+/**
+ * @brief Hex SHA-256 of a file's contents. Throws fs::filesystem_error if it cannot be read.
+ */
+std::string Sha256FileHex(const std::filesystem::path& file);
+
+Sha256::Digest HmacSha256(std::string_view key, std::string_view data);
+
+/**
+ * @brief PBKDF2-HMAC-SHA256: `length` bytes of key material from a password and salt.
+ */
+std::string Pbkdf2HmacSha256(std::string_view password, std::string_view salt, uint32_t iterations, size_t length);
@@ -0,0 +1,772 @@
+#include "StorageBackend.h"
+#include "ChunkStore.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "Metrics.h"
+#include "PackStore.h"
+#include "S3Backend.h"
+#include "Sha256.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	fs::path KeyToRelativePath(const string& key)
+	{
+		return fs::u8path(key);
+	}
+
+	string RelativePathToKey(const fs::path& relative)
+	{
+		return relative.generic_u8string();
+	}
+
+	bool StartsWith(const string& text, const string& prefix)
+	{
+		return text.compare(0, prefix.size(), prefix) == 0;
+	}
+
+	// Journal label: a journal written for another backend, layout or encryption setting is not resumed
+	string TransferKind(const StorageBackend& backend, bool chunked, const EncryptionKeys* keys, uint64_t packBelow)
+	{
+		return string(backend.Kind()) + (chunked ? "+chunks" : "") + (keys ? "+encrypted" : "") + (packBelow ? "+packs" + to_string(packBelow) : "");
+	}
+
+	CopyStats PutStoredBackup(StorageBackend& backend, const TreeScan& scan, const fs::path& from, const string& gamePrefix, const string& folderName, const fs::path& gameBackupDir, bool chunked, TransferJournal& journal, const EncryptionKeys* keys, uint64_t packBelow)
+	{
+		if (!chunked && packBelow)
+		{
+			// Packs are built next to the backup and uploaded like any tree, then dropped
+			fs::path view = gameBackupDir / ".packing" / fs::u8path(folderName);
+			auto removeView = [&]()
+				{
+					error_code ec;
+					fs::remove_all(view, ec);
+					fs::remove(view.parent_path(), ec); // Only if no other upload is packing
+				};
+			try
+			{
+				CopyStats stats = backend.PutTree(BuildPackedView(scan, from, view, packBelow), view, gamePrefix + folderName + "/", &journal);
+				removeView();
+				return stats;
+			}
+			catch (...)
+			{
+				removeView();
+				throw;
+			}
+		}
+		if (!chunked) return backend.PutTree(scan, from, gamePrefix + folderName + "/", &journal);
+		ChunkIndex index(GetChunkIndexPath(gameBackupDir), backend, gamePrefix);
+		return PutChunkedBackup(backend, scan, from, gamePrefix, folderName, index, &journal, keys);
+	}
+
+	// Copies to "<target>.partial" and renames, so readers never see a partial file
+	void CopyFileAtomically(const fs::path& source, const fs::path& target)
+	{
+		fs::create_directories(target.parent_path());
+		fs::path partial = target;
+		partial += ".partial";
+		CopySaveFile(source, partial, fs::file_size(source), fs::copy_options::overwrite_existing);
+		fs::rename(partial, target);
+	}
+
+	// Large files are copied (and checkpointed) in chunks of this size
+	constexpr uint64_t kCopyChunkSize = 4 * 1024 * 1024;
+	static_assert(kCopyChunkSize % AlignedBufferPool::kAlignment == 0, "Copies resume at chunk boundaries");
+
+	[[noreturn]] void ThrowIoError(const char* what, const fs::path& file)
+	{
+		throw fs::filesystem_error(what, file, make_error_code(errc::io_error));
+	}
+
+	// Copies through "<target>.partial", recording each finished chunk. Chunks of the partial
+	// file that an earlier attempt recorded are checked against their digest and kept; the rest
+	// goes through the save-file copy path (pooled buffers, page cache dropped, holes kept).
+	void CopyFileJournaled(const fs::path& source, const fs::path& target, uint64_t size, const string& key, TransferJournal& journal, CopyStats& stats)
+	{
+		fs::path partial = target;
+		partial += ".partial";
+		Sha256 whole;
+		uint64_t resumeFrom = 0;
+
+		map<uint64_t, string> chunks = journal.Chunks(key);
+		error_code ec;
+		if (!chunks.empty() && fs::is_regular_file(partial, ec))
+		{
+			vector<char> buffer(static_cast<size_t>(min(size, kCopyChunkSize)) + 1);
+			ifstream in(partial, ios::binary);
+			for (uint64_t index = 0; chunks.count(index) && resumeFrom < size; ++index)
+			{
+				size_t length = static_cast<size_t>(min(kCopyChunkSize, size - resumeFrom));
+				in.read(buffer.data(), static_cast<streamsize>(length));
+				if (static_cast<size_t>(in.gcount()) != length) break;
+				Sha256 chunkHash;
+				chunkHash.Update(buffer.data(), length);
+				Sha256::Digest digest = chunkHash.Final();
+				if (ToHex(digest.data(), digest.size()) != chunks[index]) break;
+				whole.Update(buffer.data(), length);
+				resumeFrom += length;
+			}
+		}
+
+		// Blocks arrive once written; each finished chunk is recorded with its digest
+		uint64_t position = resumeFrom;
+		Sha256 chunkHash;
+		ResumeSaveFileCopy(source, partial, size, resumeFrom, [&](const char* data, size_t length)
+			{
+				whole.Update(data, length);
+				while (length > 0)
+				{
+					size_t take = static_cast<size_t>(min<uint64_t>(length, kCopyChunkSize - position % kCopyChunkSize));
+					chunkHash.Update(data, take);
+					position += take;
+					data += take;
+					length -= take;
+					if (size > kCopyChunkSize && (position % kCopyChunkSize == 0 || position == size))
+					{
+						Sha256::Digest digest = chunkHash.Final();
+						journal.ChunkDone(key, (position - 1) / kCopyChunkSize, ToHex(digest.data(), digest.size()));
+						chunkHash = Sha256();
+					}
+				}
+			});
+		if (position < size) ThrowIoError("File changed while copying", source);
+		fs::rename(partial, target);
+
+		// A file that grew since the scan is copied whole and recorded at its new size
+		Sha256::Digest digest = whole.Final();
+		journal.FileDone(key, position, ToHex(digest.data(), digest.size()));
+		stats.filesCopied++;
+		stats.bytesCopied += position - resumeFrom;
+		stats.bytesResumed += resumeFrom;
+	}
+
+	// A file the journal lists as done is kept if its size and digest still match
+	bool IsFileAsJournaled(const fs::path& file, const string& key, const TransferJournal& journal)
+	{
+		TransferJournal::File done;
+		error_code ec;
+		if (!journal.FindFile(key, done) || !fs::is_regular_file(file, ec)) return false;
+		return fs::file_size(file, ec) == done.size && !ec && Sha256FileHex(file) == done.sha256;
+	}
+}
+
+uint64_t StorageBackend::RemovePrefix(const string& prefix)
+{
+	uint64_t removed = 0;
+	for (const auto& object : ListAll(prefix))
+	{
+		Remove(object.key);
+		removed++;
+	}
+	return removed;
+}
+
+CopyStats StorageBackend::PutTree(const TreeScan& scan, const fs::path& from, const string& prefix, TransferJournal* journal)
+{
+	CopyStats stats;
+	for (const auto& entry : scan.entries)
+	{
+		if (entry.type == fs::file_type::directory) continue; // Implied by the keys below it
+		if (entry.type != fs::file_type::regular)
+		{
+			stats.filesSkipped++;
+			continue;
+		}
+		string key = prefix + RelativePathToKey(entry.relativePath);
+		if (journal && IsStoredAsJournaled(key, *journal))
+		{
+			stats.filesResumed++;
+			stats.bytesResumed += entry.size;
+			continue;
+		}
+		PutFile(from / entry.relativePath, key);
+		if (journal) journal->FileDone(key, entry.size, Sha256FileHex(from / entry.relativePath));
+		stats.filesCopied++;
+		stats.bytesCopied += entry.size;
+	}
+	if (journal) journal->TreeDone();
+	return stats;
+}
+
+void StorageBackend::DiscardTransfer(const string& prefix, const TransferJournal& /*journal*/)
+{
+	RemovePrefix(prefix);
+}
+
+bool StorageBackend::IsStoredAsJournaled(const string& key, const TransferJournal& journal)
+{
+	TransferJournal::File done;
+	StorageObject stored;
+	if (!journal.FindFile(key, done) || !Stat(key, stored)) return false;
+	return stored.size == done.size && stored.sha256 == done.sha256;
+}
+
+fs::path StorageBackend::LocalPath(const string& /*key*/) const
+{
+	return {};
+}
+
+vector<StorageObject> StorageBackend::ListAll(const string& prefix)
+{
+	vector<StorageObject> objects;
+	string token;
+	do
+	{
+		StorageListing page = List(prefix, "", token);
+		objects.insert(objects.end(), make_move_iterator(page.objects.begin()), make_move_iterator(page.objects.end()));
+		token = page.nextToken;
+	} while (!token.empty());
+	return objects;
+}
+
+vector<string> StorageBackend::ListPrefixes(const string& prefix)
+{
+	vector<string> prefixes;
+	string token;
+	do
+	{
+		StorageListing page = List(prefix, "/", token);
+		prefixes.insert(prefixes.end(), page.prefixes.begin(), page.prefixes.end());
+		token = page.nextToken;
+	} while (!token.empty());
+	return prefixes;
+}
+
+LocalDirectoryBackend::LocalDirectoryBackend(fs::path root) : m_root(move(root))
+{
+}
+
+fs::path LocalDirectoryBackend::LocalPath(const string& key) const
+{
+	string trimmed = key;
+	while (!trimmed.empty() && trimmed.back() == '/') trimmed.pop_back(); // "<id>/<folder>/" names the folder itself
+	return m_root / KeyToRelativePath(trimmed);
+}
+
+bool LocalDirectoryBackend::PutFile(const fs::path& source, const string& key, bool ifAbsent)
+{
+	fs::path target = LocalPath(key);
+	if (ifAbsent && fs::exists(target)) return false; // Single writer per folder, so check-then-rename is enough
+	CopyFileAtomically(source, target);
+	return true;
+}
+
+bool LocalDirectoryBackend::PutBytes(const string& key, const string& data, bool ifAbsent)
+{
+	fs::path target = LocalPath(key);
+	if (ifAbsent && fs::exists(target)) return false;
+	fs::create_directories(target.parent_path());
+	fs::path partial = target;
+	partial += ".partial";
+	{
+		ofstream out(partial, ios::binary | ios::trunc);
+		if (!out.write(data.data(), static_cast<streamsize>(data.size())).flush()) ThrowIoError("Cannot write file", partial);
+	}
+	fs::rename(partial, target);
+	return true;
+}
+
+string LocalDirectoryBackend::GetBytes(const string& key)
+{
+	fs::path source = LocalPath(key);
+	ifstream in(source, ios::binary);
+	if (!in || !fs::is_regular_file(source)) throw StorageError("No such object: " + key);
+	return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+string LocalDirectoryBackend::Location() const
+{
+	return string(Kind()) + ":" + m_root.u8string();
+}
+
+void LocalDirectoryBackend::GetFile(const string& key, const fs::path& target)
+{
+	fs::path source = LocalPath(key);
+	if (!fs::is_regular_file(source)) throw StorageError("No such object: " + key);
+	CopyFileAtomically(source, target);
+}
+
+bool LocalDirectoryBackend::Exists(const string& key)
+{
+	return fs::is_regular_file(LocalPath(key));
+}
+
+bool LocalDirectoryBackend::Stat(const string& key, StorageObject& object)
+{
+	fs::path file = LocalPath(key);
+	if (!fs::is_regular_file(file)) return false;
+	object.key = key;
+	object.size = fs::file_size(file);
+	object.etag.clear();
+	object.sha256 = Sha256FileHex(file);
+	return true;
+}
+
+StorageListing LocalDirectoryBackend::List(const string& prefix, const string& delimiter, const string& continuationToken, size_t maxKeys)
+{
+	// The prefix may end inside a name ("game/1700-"), so list its folder and filter
+	size_t lastSlash = prefix.rfind('/');
+	string folderKey = lastSlash == string::npos ? "" : prefix.substr(0, lastSlash + 1);
+	fs::path folder = m_root / KeyToRelativePath(folderKey);
+
+	struct Entry { string key; bool isPrefix; uint64_t size; };
+	vector<Entry> entries;
+	error_code ec;
+	if (fs::is_directory(folder, ec))
+	{
+		if (delimiter == "/")
+		{
+			for (const auto& item : fs::directory_iterator(folder))
+			{
+				string key = folderKey + item.path().filename().u8string();
+				if (!StartsWith(key, prefix)) continue;
+				if (item.is_directory()) entries.push_back({ key + "/", true, 0 });
+				else if (item.is_regular_file()) entries.push_back({ key, false, item.file_size() });
+			}
+		}
+		else
+		{
+			for (const auto& item : fs::recursive_directory_iterator(folder))
+			{
+				if (!item.is_regular_file()) continue;
+				string key = RelativePathToKey(item.path().lexically_relative(m_root));
+				if (StartsWith(key, prefix)) entries.push_back({ key, false, item.file_size() });
+			}
+		}
+	}
+	sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+
+	// The token is the last key of the previous page
+	auto begin = continuationToken.empty() ? entries.begin()
+		: upper_bound(entries.begin(), entries.end(), continuationToken, [](const string& token, const Entry& e) { return token < e.key; });
+	StorageListing listing;
+	size_t taken = 0;
+	for (auto it = begin; it != entries.end(); ++it)
+	{
+		if (taken == maxKeys)
+		{
+			listing.nextToken = prev(it)->key;
+			break;
+		}
+		if (it->isPrefix) listing.prefixes.push_back(it->key);
+		else listing.objects.push_back({ it->key, it->size, "", "" });
+		taken++;
+	}
+	return listing;
+}
+
+void LocalDirectoryBackend::Remove(const string& key)
+{
+	fs::remove(LocalPath(key));
+}
+
+uint64_t LocalDirectoryBackend::RemovePrefix(const string& prefix)
+{
+	if (!prefix.empty() && prefix.back() == '/')
+	{
+		// A whole folder; also removes empty sub-folders, which are not counted as objects
+		fs::path folder = LocalPath(prefix);
+		uint64_t files = 0;
+		error_code ec;
+		for (auto it = fs::recursive_directory_iterator(folder, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+		{
+			if (!it->is_directory(ec)) files++;
+		}
+		fs::remove_all(folder);
+		return files;
+	}
+	return StorageBackend::RemovePrefix(prefix);
+}
+
+CopyStats LocalDirectoryBackend::PutTree(const TreeScan& scan, const fs::path& from, const string& prefix, TransferJournal* journal)
+{
+	fs::path target = LocalPath(prefix);
+	fs::create_directories(target.parent_path());
+	if (!journal) return CopyScannedTree(scan, from, target, fs::copy_options::copy_symlinks);
+	CopyStats stats = CopyTreeJournaled(scan, from, target, prefix, *journal);
+	journal->TreeDone();
+	return stats;
+}
+
+CopyStats LocalDirectoryBackend::CopyTreeJournaled(const TreeScan& scan, const fs::path& from, const fs::path& to, const string& prefix, TransferJournal& journal)
+{
+	CopyStats stats;
+	fs::create_directories(to);
+	for (const auto& entry : scan.entries)
+	{
+		fs::path source = from / entry.relativePath;
+		fs::path target = to / entry.relativePath;
+		error_code ec;
+		switch (entry.type)
+		{
+		case fs::file_type::directory:
+			fs::create_directory(target);
+			break;
+		case fs::file_type::regular:
+		{
+			string key = prefix + RelativePathToKey(entry.relativePath);
+			if (IsFileAsJournaled(target, key, journal))
+			{
+				stats.filesResumed++;
+				stats.bytesResumed += entry.size;
+				break;
+			}
+			TraceSpan span("copy_file", "file", entry.size >= GetTracer().FileThreshold());
+			if (span.Active()) span.SetArgs("\"path\": \"" + EscapeJson(entry.relativePath.u8string()) + "\", \"bytes\": " + to_string(entry.size));
+			CopyFileJournaled(source, target, entry.size, key, journal, stats);
+			break;
+		}
+		case fs::file_type::symlink:
+			if (fs::is_symlink(fs::symlink_status(target, ec))) fs::remove(target); // Recreated: links are tiny
+			fs::copy_symlink(source, target);
+			stats.filesCopied++;
+			break;
+		default:
+			stats.filesSkipped++; // Sockets, FIFOs, devices
+			break;
+		}
+	}
+	return stats;
+}
+
+fs::path SyncFolderBackend::StagingPath(const string& prefix) const
+{
+	string flat = prefix;
+	replace(flat.begin(), flat.end(), '/', '_');
+	return m_root / ".staging" / KeyToRelativePath(flat);
+}
+
+CopyStats SyncFolderBackend::PutTree(const TreeScan& scan, const fs::path& from, const string& prefix, TransferJournal* journal)
+{
+	fs::path staging = StagingPath(prefix);
+	fs::path target = LocalPath(prefix);
+
+	error_code ec;
+	if (journal && !journal->Empty() && !fs::exists(staging, ec) && fs::is_directory(target, ec))
+	{
+		// The earlier attempt got as far as the final rename; only its journal was left over
+		journal->TreeDone();
+		CopyStats stats;
+		stats.filesResumed = scan.files;
+		stats.bytesResumed = scan.bytes;
+		return stats;
+	}
+	if (!journal || journal->Empty()) fs::remove_all(staging, ec); // Leftover from an interrupted, unjournaled sync
+	fs::create_directories(staging.parent_path());
+	CopyStats stats;
+	try
+	{
+		stats = journal ? CopyTreeJournaled(scan, from, staging, prefix, *journal) : CopyScannedTree(scan, from, staging, fs::copy_options::copy_symlinks);
+		fs::create_directories(target.parent_path());
+		fs::rename(staging, target); // The sync client sees the folder appear complete
+	}
+	catch (...)
+	{
+		if (!journal) fs::remove_all(staging, ec); // A journaled staging folder is kept for the resume
+		throw;
+	}
+	if (journal) journal->TreeDone();
+	return stats;
+}
+
+void SyncFolderBackend::DiscardTransfer(const string& prefix, const TransferJournal& journal)
+{
+	error_code ec;
+	fs::remove_all(StagingPath(prefix), ec);
+	if (!journal.TreeComplete()) return; // Nothing reached the synced folder before the rename
+	RemovePrefix(prefix);
+}
+
+unique_ptr<StorageBackend> CreateStorageBackend(const GlobalSettings& settings)
+{
+	if (settings.cloudBackend == L"s3")
+	{
+		if (settings.s3Endpoint.empty() || settings.s3Bucket.empty()) return nullptr;
+		S3Options options;
+		options.endpoint = ws2s(settings.s3Endpoint);
+		options.bucket = ws2s(settings.s3Bucket);
+		options.region = ws2s(settings.s3Region);
+		options.accessKey = ws2s(settings.s3AccessKey);
+		options.secretKey = ws2s(settings.s3SecretKey);
+		options.partSize = static_cast<uint64_t>(max(5, settings.s3PartSizeMb)) * 1024 * 1024;
+		options.parallelism = max(1, settings.s3Parallelism);
+		return make_unique<S3Backend>(options);
+	}
+
+	if (settings.googleDrivePath.empty()) return nullptr;
+	fs::path root = ToPath(settings.googleDrivePath) / ToPath(kCloudFolderName);
+	if (settings.cloudBackend == L"local") return make_unique<LocalDirectoryBackend>(root);
+	return make_unique<SyncFolderBackend>(root);
+}
+
+bool UseChunkStore(const GlobalSettings& settings)
+{
+	if (settings.cloudLayout == L"chunks") return true;
+	if (settings.cloudLayout == L"folders") return false;
+	return settings.cloudBackend == L"s3";
+}
+
+uint64_t GetPackThreshold(const GlobalSettings& settings)
+{
+	return static_cast<uint64_t>(max(settings.packSmallFilesKb, 0)) * 1024;
+}
+
+string GetStorageGamePrefix(const GameProfile& profile)
+{
+	if (profile.id.empty()) throw invalid_argument("Game profile has no ID");
+	return ws2s(profile.id) + "/";
+}
+
+vector<string> ListStoredBackups(StorageBackend& backend, const string& gamePrefix)
+{
+	vector<string> backups;
+	for (const auto& prefix : backend.ListPrefixes(gamePrefix))
+	{
+		string name = prefix.substr(gamePrefix.size(), prefix.size() - gamePrefix.size() - 1); // Strip "<id>/" and "/"
+		if (name.size() > 2 && (name.compare(name.size() - 2, 2, "-A") == 0 || name.compare(name.size() - 2, 2, "-M") == 0))
+		{
+			backups.push_back(name);
+		}
+	}
+	sort(backups.rbegin(), backups.rend()); // Epoch prefix: newest first, like ListBackups
+	return backups;
+}
+
+size_t PurgeStoredBackups(StorageBackend& backend, const string& gamePrefix, int autoLimit, int manualLimit, const wstring& locationName, vector<wstring>& logCollector)
+{
+	// Folder-based backends keep the exact behaviour (and metrics) of the local purge
+	fs::path folder = backend.LocalPath(gamePrefix);
+	if (!folder.empty())
+	{
+		size_t before = ListStoredBackups(backend, gamePrefix).size();
+		PurgeBackups(folder, L"", autoLimit, manualLimit, locationName, logCollector);
+		return before - min(before, ListStoredBackups(backend, gamePrefix).size());
+	}
+
+	OperationCounters& counters = GetEngineMetrics().Op(MetricOp::Purge);
+	counters.runs++;
+	StageTimer timer(MetricStage::Purge);
+	TraceSpan span("purge");
+
+	size_t deleted = 0;
+	vector<string> autoSaves, manualSaves;
+	for (const auto& name : ListStoredBackups(backend, gamePrefix))
+	{
+		(name.back() == 'A' ? autoSaves : manualSaves).push_back(name);
+	}
+	sort(autoSaves.begin(), autoSaves.end()); // Oldest first
+	sort(manualSaves.begin(), manualSaves.end());
+
+	auto purge = [&](const vector<string>& saves, int limit, const wstring& kind)
+		{
+			if (limit <= 0 || saves.size() <= static_cast<size_t>(limit)) return;
+
+			int toDelete = static_cast<int>(saves.size()) - limit;
+			wstringstream wss;
+			wss << L"      [PURGE:" << locationName << L"] " << kind << L"-save limit (" << limit << L") exceeded. Deleting " << toDelete << L" oldest...";
+			logCollector.push_back(wss.str());
+
+			for (int i = 0; i < toDelete; ++i)
+			{
+				wstring folderName = s2ws(saves[i]);
+				try {
+					logCollector.push_back(L"         - Deleting: " + folderName);
+					counters.filesDeleted.fetch_add(backend.RemovePrefix(gamePrefix + saves[i] + "/"), memory_order_relaxed);
+					deleted++;
+				}
+				catch (const exception& e) {
+					counters.errors++;
+					logCollector.push_back(L"      [PURGE:" + locationName + L"] FAILED to delete " + kind + L" " + folderName + L": " + s2ws(e.what()));
+				}
+			}
+		};
+
+	purge(autoSaves, autoLimit, L"Auto");
+	purge(manualSaves, manualLimit, L"Manual");
+	return deleted;
+}
+
+CopyStats UploadStoredBackup(StorageBackend& backend, const TreeScan& scan, const fs::path& from, const string& gamePrefix, const wstring& folderName, const fs::path& gameBackupDir, bool chunked, const EncryptionKeys* keys, uint64_t packBelow)
+{
+	TransferJournal journal(GetTransferJournalPath(gameBackupDir, folderName), TransferKind(backend, chunked, keys, packBelow));
+	CopyStats stats = PutStoredBackup(backend, scan, from, gamePrefix, ws2s(folderName), gameBackupDir, chunked, journal, keys, packBelow);
+	journal.Remove();
+	return stats;
+}
+
+size_t ResumeStoredTransfers(StorageBackend& backend, const fs::path& gameBackupDir, const string& gamePrefix, bool chunked, vector<wstring>& logCollector, const EncryptionKeys* keys, uint64_t packBelow)
+{
+	fs::path journals = gameBackupDir / ".transfers";
+	error_code ec;
+	if (!fs::is_directory(journals, ec)) return 0;
+
+	vector<fs::path> pending;
+	for (const auto& entry : fs::directory_iterator(journals, ec))
+	{
+		if (entry.path().extension() == ".journal") pending.push_back(entry.path());
+	}
+	sort(pending.begin(), pending.end()); // Oldest backup first
+
+	size_t completed = 0;
+	for (const auto& file : pending)
+	{
+		wstring folderName = PathToWide(file.stem());
+		string backupPrefix = gamePrefix + ws2s(folderName) + "/";
+		fs::path source = gameBackupDir / file.stem();
+		wstring logPrefix = L"[" + s2ws(GetCurrentDateTime()) + L"] [CLOUD] ";
+		try
+		{
+			TransferJournal journal(file, TransferKind(backend, chunked, keys, packBelow));
+			if (journal.TreeComplete())
+			{
+				journal.Remove(); // Finished; only the cleanup was missed
+				completed++;
+				continue;
+			}
+			if (!fs::is_directory(source, ec))
+			{
+				backend.DiscardTransfer(backupPrefix, journal);
+				journal.Remove();
+				logCollector.push_back(logPrefix + L"Discarded unfinished sync of " + folderName + L" (local backup no longer exists).");
+				continue;
+			}
+
+			StageTimer timer(MetricStage::Sync);
+			TraceSpan span("resume_sync");
+			CopyStats stats = PutStoredBackup(backend, ScanTree(source), source, gamePrefix, ws2s(folderName), gameBackupDir, chunked, journal, keys, packBelow);
+			journal.Remove();
+			OperationCounters& counters = GetEngineMetrics().Op(MetricOp::CloudSync);
+			counters.filesCopied.fetch_add(stats.filesCopied, memory_order_relaxed);
+			counters.bytesCopied.fetch_add(stats.bytesCopied, memory_order_relaxed);
+			counters.bytesResumed.fetch_add(stats.bytesResumed, memory_order_relaxed);
+			counters.bytesDeduplicated.fetch_add(stats.bytesDeduplicated, memory_order_relaxed);
+			wstringstream wss;
+			wss << logPrefix << L"Resumed sync of " << folderName << L": " << stats.filesCopied << L" file(s) sent, "
+				<< stats.filesResumed << L" already uploaded (" << stats.bytesResumed / 1024 << L" KB not re-sent).";
+			logCollector.push_back(wss.str());
+			completed++;
+		}
+		catch (const exception& e)
+		{
+			GetEngineMetrics().Op(MetricOp::CloudSync).errors++;
+			logCollector.push_back(logPrefix + L"Resume of " + folderName + L" FAILED (will retry): " + s2ws(e.what()));
+		}
+	}
+	return completed;
+}
+
+namespace
+{
+	// "<id>/<folder>/" -> "<id>/", the pool a manifest's chunks live in
+	string GamePrefixOf(const string& backupPrefix)
+	{
+		return backupPrefix.substr(0, backupPrefix.find('/') + 1);
+	}
+
+	fs::path SafeObjectPath(const string& relative, const string& key)
+	{
+		fs::path relativePath = KeyToRelativePath(relative).lexically_normal();
+		if (relativePath.empty() || relativePath.is_absolute() || relativePath.has_root_name() || *relativePath.begin() == "..")
+		{
+			throw StorageError("Refusing to restore outside the target folder: " + key);
+		}
+		return relativePath;
+	}
+}
+
+CopyStats DownloadStoredBackup(StorageBackend& backend, const string& backupPrefix, const fs::path& target, const EncryptionKeys* keys, OperationProgress* progress)
+{
+	if (HasStoredManifest(backend, backupPrefix))
+	{
+		return RestoreChunkedBackup(backend, GamePrefixOf(backupPrefix), GetStoredManifest(backend, backupPrefix, keys), target, keys, progress);
+	}
+	if (IsPackedBackup(backend, backupPrefix))
+	{
+		PackIndex index = GetPackIndex(backend, backupPrefix);
+		return RestorePackedBackup(backend, backupPrefix, index, index.manifest, target, progress);
+	}
+
+	vector<StorageObject> objects;
+	uint64_t bytes = 0;
+	for (auto& object : backend.ListAll(backupPrefix))
+	{
+		string relative = object.key.substr(backupPrefix.size());
+		if (relative.empty() || relative.back() == '/') continue; // Folder placeholder objects
+		bytes += object.size;
+		objects.push_back(move(object));
+	}
+	CopyStats stats;
+	fs::create_directories(target);
+	if (progress) progress->Begin(objects.size(), bytes);
+	for (const auto& object : objects)
+	{
+		fs::path relative = SafeObjectPath(object.key.substr(backupPrefix.size()), object.key);
+		if (progress) progress->StartFile(relative);
+		backend.GetFile(object.key, target / relative);
+		if (progress) progress->FinishFile(object.size);
+		stats.filesCopied++;
+		stats.bytesCopied += object.size;
+	}
+	if (progress) progress->Finish();
+	return stats;
+}
+
+BackupManifest GetStoredBackupIndex(StorageBackend& backend, const string& backupPrefix, const EncryptionKeys* keys)
+{
+	if (HasStoredManifest(backend, backupPrefix)) return GetStoredManifest(backend, backupPrefix, keys);
+	if (IsPackedBackup(backend, backupPrefix)) return GetPackIndex(backend, backupPrefix).manifest;
+
+	BackupManifest index;
+	for (const auto& object : backend.ListAll(backupPrefix))
+	{
+		string relative = object.key.substr(backupPrefix.size());
+		if (relative.empty() || relative.back() == '/') continue;
+		ManifestEntry entry;
+		entry.path = relative;
+		entry.size = object.size;
+		index.entries.push_back(move(entry));
+	}
+	return index;
+}
+
+CopyStats DownloadStoredFiles(StorageBackend& backend, const string& backupPrefix, const BackupManifest& selection, const fs::path& target, const EncryptionKeys* keys, OperationProgress* progress)
+{
+	// Chunked: the manifest entries say which chunks to fetch
+	if (HasStoredManifest(backend, backupPrefix)) return RestoreChunkedBackup(backend, GamePrefixOf(backupPrefix), selection, target, keys, progress);
+	if (IsPackedBackup(backend, backupPrefix)) return RestorePackedBackup(backend, backupPrefix, GetPackIndex(backend, backupPrefix), selection, target, progress);
+
+	CopyStats stats;
+	if (progress)
+	{
+		uint64_t files = 0, bytes = 0;
+		for (const auto& entry : selection.entries)
+		{
+			if (entry.type != fs::file_type::regular) continue;
+			files++;
+			bytes += entry.size;
+		}
+		progress->Begin(files, bytes);
+	}
+	for (const auto& entry : selection.entries)
+	{
+		if (entry.type != fs::file_type::regular) continue; // Plain layouts only hold files
+		string key = backupPrefix + entry.path;
+		fs::path relative = SafeObjectPath(entry.path, key);
+		if (progress) progress->StartFile(relative);
+		backend.GetFile(key, target / relative); // Written via ".partial"
+		if (progress) progress->FinishFile(entry.size);
+		stats.filesCopied++;
+		stats.bytesCopied += entry.size;
+	}
+	if (progress) progress->Finish();
+	return stats;
+}
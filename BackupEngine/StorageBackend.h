@@ -0,0 +1,258 @@
+#pragma once
+
+// Destinations for the cloud copy of a backup. Keys are '/'-separated paths relative to the
+// backend root: "<profileId>/<backupFolder>/<relative file path>". The local-directory and
+// sync-folder backends map keys onto files; S3Backend (S3Backend.h) talks to an object store.
+// Tree uploads can be checkpointed in a TransferJournal and resumed after an interruption.
+
+#include "BackupOperations.h"
+#include "Config.h"
+#include "Manifest.h"
+#include "TransferJournal.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class EncryptionKeys;
+
+class StorageError : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+struct StorageObject
+{
+	std::string key;
+	uint64_t size = 0;
+	std::string etag;   // Object stores only
+	std::string sha256; // Hex digest of the content, from Stat() only; empty if the backend cannot tell
+};
+
+// One page of a listing. With a delimiter, keys below the next delimiter are folded into `prefixes`.
+struct StorageListing
+{
+	std::vector<StorageObject> objects;
+	std::vector<std::string> prefixes;
+	std::string nextToken; // Pass to the next List() call; empty on the last page
+};
+
+class StorageBackend
+{
+public:
+	virtual ~StorageBackend() = default;
+
+	// "local", "sync-folder" or "s3"
+	virtual const char* Kind() const = 0;
+
+	// Identifies the destination ("<kind>:<folder>" or "s3:<endpoint>/<bucket>"), so local caches notice a change
+	virtual std::string Location() const = 0;
+
+	// How many requests are worth having in flight at once
+	virtual int Parallelism() const { return 1; }
+
+	/**
+	 * @brief Stores a local file under `key`, replacing any existing object.
+	 * @param ifAbsent Conditional put: store nothing and return false if the key already exists.
+	 * Throws StorageError (or fs::filesystem_error for local files) on failure.
+	 */
+	virtual bool PutFile(const std::filesystem::path& source, const std::string& key, bool ifAbsent = false) = 0;
+
+	/**
+	 * @brief Stores an in-memory object (a chunk or a manifest). Same semantics as PutFile.
+	 */
+	virtual bool PutBytes(const std::string& key, const std::string& data, bool ifAbsent = false) = 0;
+
+	/**
+	 * @brief Downloads an object to a local file (written to a temporary name, then renamed).
+	 */
+	virtual void GetFile(const std::string& key, const std::filesystem::path& target) = 0;
+
+	/**
+	 * @brief Reads a whole (small) object into memory. Throws StorageError if it does not exist.
+	 */
+	virtual std::string GetBytes(const std::string& key) = 0;
+
+	virtual bool Exists(const std::string& key) = 0;
+
+	/**
+	 * @brief Size and SHA-256 of a stored object (file backends hash the file; S3 returns the
+	 * digest recorded at upload). Returns false if the key does not exist.
+	 */
+	virtual bool Stat(const std::string& key, StorageObject& object) = 0;
+
+	/**
+	 * @brief Lists keys starting with `prefix`, in key order, at most `maxKeys` entries per page.
+	 */
+	virtual StorageListing List(const std::string& prefix, const std::string& delimiter, const std::string& continuationToken, size_t maxKeys = 1000) = 0;
+
+	virtual void Remove(const std::string& key) = 0;
+
+	/**
+	 * @brief Removes every object under a prefix. Returns the number of objects removed.
+	 */
+	virtual uint64_t RemovePrefix(const std::string& prefix);
+
+	/**
+	 * @brief Stores the regular files of a scanned tree under `prefix` ("<id>/<folder>/").
+	 * Returns once every file is stored. Object stores have no symlinks or empty folders;
+	 * those entries are counted as skipped.
+	 * @param journal If set, completed files (and chunks or parts of large files) are recorded,
+	 * and whatever an earlier attempt recorded is verified by size and SHA-256 at the
+	 * destination and not sent again. Marked complete (TreeDone) before returning.
+	 */
+	virtual CopyStats PutTree(const TreeScan& scan, const std::filesystem::path& from, const std::string& prefix, TransferJournal* journal = nullptr);
+
+	/**
+	 * @brief Removes what an unfinished, journaled PutTree left behind (stored files, staging
+	 * folders, open multipart uploads), for a transfer that will not be resumed.
+	 */
+	virtual void DiscardTransfer(const std::string& prefix, const TransferJournal& journal);
+
+	/**
+	 * @brief Folder on disk that holds `key`, for backends that store plain files; empty otherwise.
+	 */
+	virtual std::filesystem::path LocalPath(const std::string& key) const;
+
+	// All pages of List(prefix) without a delimiter
+	std::vector<StorageObject> ListAll(const std::string& prefix);
+
+	// All pages of List(prefix, "/"): the "sub-folders" directly under prefix
+	std::vector<std::string> ListPrefixes(const std::string& prefix);
+
+	// The journal says `key` was stored and Stat() confirms its size and SHA-256
+	bool IsStoredAsJournaled(const std::string& key, const TransferJournal& journal);
+};
+
+/**
+ * @brief Plain folder (local disk, NAS mount). Files are written to "<name>.partial" and renamed,
+ * so a key never holds a half-written file.
+ */
+class LocalDirectoryBackend : public StorageBackend
+{
+public:
+	explicit LocalDirectoryBackend(std::filesystem::path root);
+
+	const char* Kind() const override { return "local"; }
+	std::string Location() const override;
+	bool PutFile(const std::filesystem::path& source, const std::string& key, bool ifAbsent = false) override;
+	bool PutBytes(const std::string& key, const std::string& data, bool ifAbsent = false) override;
+	void GetFile(const std::string& key, const std::filesystem::path& target) override;
+	std::string GetBytes(const std::string& key) override;
+	bool Exists(const std::string& key) override;
+	bool Stat(const std::string& key, StorageObject& object) override;
+	StorageListing List(const std::string& prefix, const std::string& delimiter, const std::string& continuationToken, size_t maxKeys = 1000) override;
+	void Remove(const std::string& key) override;
+	uint64_t RemovePrefix(const std::string& prefix) override;
+	CopyStats PutTree(const TreeScan& scan, const std::filesystem::path& from, const std::string& prefix, TransferJournal* journal = nullptr) override;
+	std::filesystem::path LocalPath(const std::string& key) const override;
+
+protected:
+	/**
+	 * @brief Copies a tree into `to`, checkpointing each file (and each chunk of large files)
+	 * in the journal, and skipping files and chunks an earlier attempt completed.
+	 */
+	CopyStats CopyTreeJournaled(const TreeScan& scan, const std::filesystem::path& from, const std::filesystem::path& to, const std::string& prefix, TransferJournal& journal);
+
+	std::filesystem::path m_root;
+};
+
+/**
+ * @brief Folder mirrored by a desktop sync client (Google Drive, OneDrive, Dropbox).
+ * Trees are copied into "<root>/.staging" first and renamed into place, so the client
+ * only ever sees complete backup folders.
+ */
+class SyncFolderBackend : public LocalDirectoryBackend
+{
+public:
+	using LocalDirectoryBackend::LocalDirectoryBackend;
+
+	const char* Kind() const override { return "sync-folder"; }
+	CopyStats PutTree(const TreeScan& scan, const std::filesystem::path& from, const std::string& prefix, TransferJournal* journal = nullptr) override;
+	void DiscardTransfer(const std::string& prefix, const TransferJournal& journal) override;
+
+private:
+	std::filesystem::path StagingPath(const std::string& prefix) const;
+};
+
+/**
+ * @brief Creates the backend selected by [CloudStorage] Backend, or nullptr if it is not configured
+ * (no cloud path for local/sync-folder, no endpoint or bucket for s3).
+ */
+std::unique_ptr<StorageBackend> CreateStorageBackend(const GlobalSettings& settings);
+
+/**
+ * @brief True if cloud backups go to the chunk store (ChunkStore.h) rather than plain folders:
+ * [CloudStorage] Layout=chunks, or Layout=auto with the s3 backend.
+ */
+bool UseChunkStore(const GlobalSettings& settings);
+
+/**
+ * @brief [CloudStorage] PackSmallFilesKB in bytes: plain-folder backups pack files below this
+ * size (0: off).
+ */
+uint64_t GetPackThreshold(const GlobalSettings& settings);
+
+/**
+ * @brief Key prefix of a game's backups: "<profile.id>/".
+ */
+std::string GetStorageGamePrefix(const GameProfile& profile);
+
+/**
+ * @brief Backup folder names ("<epoch>-[...]-A|M") stored under a game prefix, newest first.
+ */
+std::vector<std::string> ListStoredBackups(StorageBackend& backend, const std::string& gamePrefix);
+
+/**
+ * @brief Same retention rules and log lines as PurgeBackups, for backups held by a backend.
+ * @return The number of backups deleted.
+ */
+size_t PurgeStoredBackups(StorageBackend& backend, const std::string& gamePrefix, int autoLimit, int manualLimit, const std::wstring& locationName, std::vector<std::wstring>& logCollector);
+
+/**
+ * @brief Uploads one local backup folder ("<gameBackupDir>/<folderName>") as a plain tree or,
+ * if `chunked`, to the chunk store. Checkpointed in a TransferJournal that is removed on
+ * success and left for ResumeStoredTransfers otherwise.
+ * @param keys If set, the backup is encrypted (requires `chunked`).
+ * @param packBelow Plain trees only: if non-zero, files smaller than this many bytes are stored
+ * in pack files (see PackStore.h).
+ */
+CopyStats UploadStoredBackup(StorageBackend& backend, const TreeScan& scan, const std::filesystem::path& from, const std::string& gamePrefix, const std::wstring& folderName, const std::filesystem::path& gameBackupDir, bool chunked, const EncryptionKeys* keys = nullptr, uint64_t packBelow = 0);
+
+/**
+ * @brief Finishes cloud transfers that an earlier BackupSaveFolder left unfinished (journals in
+ * "<gameBackupDir>/.transfers"). Transfers whose local backup was purged meanwhile are
+ * discarded; ones journaled for another backend kind or layout start over. Adds one log line per transfer.
+ * @return The number of transfers completed.
+ */
+size_t ResumeStoredTransfers(StorageBackend& backend, const std::filesystem::path& gameBackupDir, const std::string& gamePrefix, bool chunked, std::vector<std::wstring>& logCollector, const EncryptionKeys* keys = nullptr, uint64_t packBelow = 0);
+
+/**
+ * @brief Downloads one stored backup ("<id>/<folder>/") into a local folder: rebuilt from its
+ * manifest and chunks if it has one, unpacked from its pack index if packed, otherwise every
+ * object under the prefix. Encrypted
+ * backups need `keys` (EncryptionError otherwise). Reports each file to `progress`; a cancel stops
+ * the download with OperationCancelled and leaves the files completed so far, so download into a
+ * folder that can be discarded (RestoreBackup then swaps it in).
+ */
+CopyStats DownloadStoredBackup(StorageBackend& backend, const std::string& backupPrefix, const std::filesystem::path& target, const EncryptionKeys* keys = nullptr, OperationProgress* progress = nullptr);
+
+/**
+ * @brief File list of one stored backup: its manifest or pack index if it has one, otherwise
+ * built from one listing of its objects (sizes only). Encrypted manifests need `keys`.
+ */
+BackupManifest GetStoredBackupIndex(StorageBackend& backend, const std::string& backupPrefix, const EncryptionKeys* keys = nullptr);
+
+/**
+ * @brief Restores only the given entries of a stored backup (GetStoredBackupIndex(...).Select(paths))
+ * into `target`, replacing those files and nothing else. From a chunked backup only the chunks of
+ * the selected files are fetched, from a packed one only the packs holding them. Each file is written to "<name>.partial" and renamed into place.
+ * Reports each file to `progress`; as with DownloadStoredBackup, a cancel (OperationCancelled) keeps
+ * the files completed so far, so download into a scratch folder and RestoreSelectedFiles from it to
+ * replace save files all-or-nothing.
+ */
+CopyStats DownloadStoredFiles(StorageBackend& backend, const std::string& backupPrefix, const BackupManifest& selection, const std::filesystem::path& target, const EncryptionKeys* keys = nullptr, OperationProgress* progress = nullptr);
@@ -0,0 +1,142 @@
+#include "SystemLoad.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+#ifdef _WIN32
+	uint64_t FileTimeTicks(const FILETIME& time)
+	{
+		return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	}
+
+	// Busy share of all processors over `sample`, or -1
+	double CpuBusyPercent(chrono::milliseconds sample)
+	{
+		FILETIME idle1, kernel1, user1, idle2, kernel2, user2;
+		if (!GetSystemTimes(&idle1, &kernel1, &user1)) return -1;
+		this_thread::sleep_for(sample);
+		if (!GetSystemTimes(&idle2, &kernel2, &user2)) return -1;
+		// Kernel time includes idle time
+		uint64_t total = FileTimeTicks(kernel2) - FileTimeTicks(kernel1) + FileTimeTicks(user2) - FileTimeTicks(user1);
+		uint64_t idle = FileTimeTicks(idle2) - FileTimeTicks(idle1);
+		return total == 0 ? -1 : 100.0 * static_cast<double>(total - min(idle, total)) / static_cast<double>(total);
+	}
+#else
+	// "some avg10=1.23 avg60=..." -> 1.23, or -1 without PSI (kernels before 4.20, or disabled)
+	double ReadPressure(const char* file)
+	{
+		ifstream in(file);
+		string line;
+		while (getline(in, line))
+		{
+			if (line.compare(0, 5, "some ") != 0) continue;
+			size_t avg = line.find("avg10=");
+			if (avg == string::npos) return -1;
+			return strtod(line.c_str() + avg + 6, nullptr);
+		}
+		return -1;
+	}
+#endif
+}
+
+SystemLoad ReadSystemLoad()
+{
+	SystemLoad load;
+#ifdef _WIN32
+	double busy = CpuBusyPercent(chrono::milliseconds(250));
+	if (busy >= 0)
+	{
+		load.cpuPressure = max(0.0, busy - 75) * 4;
+		load.source = "cpu-times";
+	}
+#else
+	double cpu = ReadPressure("/proc/pressure/cpu");
+	if (cpu >= 0)
+	{
+		load.cpuPressure = cpu;
+		load.ioPressure = max(0.0, ReadPressure("/proc/pressure/io"));
+		load.source = "psi";
+		return load;
+	}
+	ifstream in("/proc/loadavg");
+	double oneMinute = 0;
+	if (in >> oneMinute)
+	{
+		// With N runnable tasks on C cores, (N - C) / N of them are waiting
+		double cores = max(1u, thread::hardware_concurrency());
+		load.cpuPressure = oneMinute > cores ? 100.0 * (oneMinute - cores) / oneMinute : 0;
+		load.source = "loadavg";
+	}
+#endif
+	return load;
+}
+
+LoadGateOptions GetLoadGateOptions(const GlobalSettings& settings)
+{
+	LoadGateOptions options;
+	options.maxDelay = chrono::seconds(max(0, settings.loadDeferMaxSeconds));
+	options.cpuLimit = settings.cpuPressureLimit;
+	options.ioLimit = settings.ioPressureLimit;
+	return options;
+}
+
+LoadGate::LoadGate(const LoadGateOptions& options, Sampler sampler)
+	: m_options(options), m_sampler(move(sampler))
+{
+	if (!m_sampler) m_sampler = ReadSystemLoad;
+	m_options.recheck = max(m_options.recheck, chrono::seconds(1));
+}
+
+bool LoadGate::IsBusy(const SystemLoad& load) const
+{
+	return load.cpuPressure > m_options.cpuLimit || load.ioPressure > m_options.ioLimit;
+}
+
+LoadGateDecision LoadGate::Check(Clock::time_point now)
+{
+	DeferralCounters& counters = GetEngineMetrics().Deferrals();
+	LoadGateDecision decision;
+	if (m_options.maxDelay.count() <= 0) return decision; // Deferral turned off: not even a sample
+
+	if (!m_deferring) counters.checks++;
+	decision.load = m_sampler();
+	bool busy = IsBusy(decision.load);
+	auto waited = m_deferring ? now - m_deferredSince : Clock::duration::zero();
+	if (busy && waited < m_options.maxDelay)
+	{
+		if (!m_deferring)
+		{
+			counters.deferred++;
+			m_deferring = true;
+			m_deferredSince = now;
+		}
+		decision.run = false;
+		auto left = chrono::duration_cast<chrono::seconds>(m_options.maxDelay - waited);
+		decision.retryIn = max(chrono::seconds(1), min(m_options.recheck, left));
+		return decision;
+	}
+
+	if (m_deferring)
+	{
+		decision.deferredFor = waited;
+		decision.gaveUp = busy;
+		if (busy) counters.gaveUp++;
+		GetEngineMetrics().Stage(MetricStage::Deferral).Record(waited);
+		m_deferring = false;
+	}
+	return decision;
+}
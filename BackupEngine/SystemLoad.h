@@ -0,0 +1,82 @@
+#pragma once
+
+// System load checks before auto-saves. Even a throttled backup competes with the game for CPU
+// and disk, so a due auto-save first looks at how contended the system is and, while it is
+// busy, waits for a quieter moment, at most `maxDelay`. Manual backups never wait.
+//
+// Load is read as pressure: the share of recent time that some task was stalled waiting for a
+// CPU, or for I/O.
+//   - Linux: /proc/pressure/{cpu,io} ("some avg10"). Without PSI, the CPU figure is estimated
+//     from the 1-minute load average (tasks beyond one per core wait), and I/O is unknown.
+//   - Windows has no such counters: CPU time of all processors over a short sample, counted
+//     from 75% busy (all cores busy = 100), and I/O is unknown.
+
+#include "Config.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+struct SystemLoad
+{
+	double cpuPressure = 0; // Percent of recent time tasks waited for a CPU
+	double ioPressure = 0;  // Percent of recent time tasks waited for I/O
+	std::string source;     // "psi", "loadavg", "cpu-times", or empty if nothing could be read
+};
+
+/**
+ * @brief Samples the current system load (Windows: blocks ~250 ms for the CPU sample).
+ */
+SystemLoad ReadSystemLoad();
+
+struct LoadGateOptions
+{
+	double cpuLimit = 25;                 // Pressure above either limit counts as busy
+	double ioLimit = 25;
+	std::chrono::seconds maxDelay{ 300 }; // Longest an auto-save waits; 0 = never wait
+	std::chrono::seconds recheck{ 15 };   // Time between two looks while waiting
+};
+
+/**
+ * @brief Limits from [Performance] LoadDeferMaxSeconds, CpuPressureLimit and IoPressureLimit.
+ */
+LoadGateOptions GetLoadGateOptions(const GlobalSettings& settings);
+
+struct LoadGateDecision
+{
+	bool run = true;                      // Back up now; otherwise check again after retryIn
+	std::chrono::seconds retryIn{ 0 };
+	std::chrono::nanoseconds deferredFor{ 0 }; // When running: how long the backup waited
+	bool gaveUp = false;                  // Ran at maxDelay with the system still busy
+	SystemLoad load;                      // The last sample taken
+};
+
+class LoadGate
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using Sampler = std::function<SystemLoad()>;
+
+	/**
+	 * @brief `sampler` replaces ReadSystemLoad (for tests).
+	 */
+	explicit LoadGate(const LoadGateOptions& options, Sampler sampler = nullptr);
+
+	/**
+	 * @brief An auto-save is due at `now` (or still waiting): whether to run it. Records the
+	 * deferral metrics (GetEngineMetrics().Deferrals() and the "deferral" stage).
+	 */
+	LoadGateDecision Check(Clock::time_point now);
+
+	// A due backup is waiting for the load to drop
+	bool Deferring() const { return m_deferring; }
+
+private:
+	bool IsBusy(const SystemLoad& load) const;
+
+	LoadGateOptions m_options;
+	Sampler m_sampler;
+	bool m_deferring = false;
+	Clock::time_point m_deferredSince{};
+};
@@ -0,0 +1,117 @@
+#include "Trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+void Tracer::Start(uint64_t fileThresholdBytes)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_events.clear();
+	m_threadNames.clear();
+	m_droppedEvents = 0;
+	m_origin = chrono::steady_clock::now();
+	m_fileThreshold.store(fileThresholdBytes, memory_order_relaxed);
+	m_enabled.store(true, memory_order_release);
+}
+
+uint32_t Tracer::CurrentThreadId()
+{
+	static atomic<uint32_t> nextId{ 1 };
+	thread_local uint32_t id = nextId.fetch_add(1, memory_order_relaxed);
+	return id;
+}
+
+void Tracer::SetThreadName(const string& name)
+{
+	if (!Enabled()) return;
+	lock_guard<mutex> lock(m_mutex);
+	m_threadNames.emplace_back(CurrentThreadId(), name);
+}
+
+void Tracer::AddComplete(const char* name, const char* category, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end, string args)
+{
+	uint32_t tid = CurrentThreadId();
+	lock_guard<mutex> lock(m_mutex);
+	if (!Enabled()) return; // Stopped while the span was open
+	if (m_events.size() >= kMaxEvents)
+	{
+		m_droppedEvents++;
+		return;
+	}
+	m_events.push_back({ name, category,
+		chrono::duration_cast<chrono::microseconds>(start - m_origin).count(),
+		chrono::duration_cast<chrono::microseconds>(end - start).count(),
+		tid, move(args) });
+}
+
+size_t Tracer::EventCount() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_events.size();
+}
+
+bool Tracer::StopAndWrite(const fs::path& file)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_enabled.store(false, memory_order_release);
+
+	error_code ec;
+	if (file.has_parent_path()) fs::create_directories(file.parent_path(), ec);
+	ofstream out(file, ios::binary | ios::trunc);
+	if (!out) return false;
+
+	out << "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": " << m_droppedEvents << "},\n\"traceEvents\": [\n";
+	out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"GameSaveBackupManager\"}}";
+	for (const auto& thread : m_threadNames)
+	{
+		out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread.first
+			<< ", \"args\": {\"name\": \"" << EscapeJson(thread.second) << "\"}}";
+	}
+	for (const auto& event : m_events)
+	{
+		out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"" << event.category << "\", \"ph\": \"X\", \"ts\": " << event.startMicros
+			<< ", \"dur\": " << event.durationMicros << ", \"pid\": 1, \"tid\": " << event.tid;
+		if (!event.args.empty()) out << ", \"args\": {" << event.args << "}";
+		out << "}";
+	}
+	out << "\n]}\n";
+	m_events.clear();
+	m_events.shrink_to_fit();
+	return static_cast<bool>(out.flush());
+}
+
+Tracer& GetTracer()
+{
+	static Tracer tracer;
+	return tracer;
+}
+
+string EscapeJson(const string& text)
+{
+	string escaped;
+	escaped.reserve(text.size());
+	for (unsigned char c : text)
+	{
+		switch (c)
+		{
+		case '"': escaped += "\\\""; break;
+		case '\\': escaped += "\\\\"; break;
+		case '\n': escaped += "\\n"; break;
+		case '\r': escaped += "\\r"; break;
+		case '\t': escaped += "\\t"; break;
+		default:
+			if (c < 0x20)
+			{
+				char buffer[8];
+				snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+				escaped += buffer;
+			}
+			else escaped += static_cast<char>(c);
+		}
+	}
+	return escaped;
+}
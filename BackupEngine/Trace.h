@@ -0,0 +1,106 @@
+#pragma once
+
+// Opt-in Chrome trace-event output ("X" complete events) for the backup pipeline.
+// The resulting JSON loads directly into chrome://tracing or https://ui.perfetto.dev.
+// When tracing is off, a TraceSpan costs one relaxed atomic load.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Tracer
+{
+public:
+	static constexpr size_t kMaxEvents = 500000; // Further events are counted but not kept
+
+	bool Enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Clears any previous events and starts recording.
+	 * @param fileThresholdBytes Files at least this large get their own span while copying.
+	 */
+	void Start(uint64_t fileThresholdBytes = 1024 * 1024);
+
+	/**
+	 * @brief Stops recording and writes the trace as JSON. Returns false if the file could not be written.
+	 */
+	bool StopAndWrite(const std::filesystem::path& file);
+
+	uint64_t FileThreshold() const { return m_fileThreshold.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Names the calling thread in the trace viewer (e.g. "auto-save"). Ignored when disabled.
+	 */
+	void SetThreadName(const std::string& name);
+
+	// Records a finished span; `args` is a JSON object body such as "\"bytes\": 12" (may be empty)
+	void AddComplete(const char* name, const char* category, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, std::string args);
+
+	size_t EventCount() const;
+
+private:
+	struct Event
+	{
+		const char* name;
+		const char* category;
+		int64_t startMicros;
+		int64_t durationMicros;
+		uint32_t tid;
+		std::string args;
+	};
+
+	static uint32_t CurrentThreadId();
+
+	std::atomic<bool> m_enabled{ false };
+	std::atomic<uint64_t> m_fileThreshold{ 1024 * 1024 };
+	std::chrono::steady_clock::time_point m_origin;
+
+	mutable std::mutex m_mutex;
+	std::vector<Event> m_events;
+	std::vector<std::pair<uint32_t, std::string>> m_threadNames;
+	uint64_t m_droppedEvents = 0;
+};
+
+Tracer& GetTracer();
+
+/**
+ * @brief Records its lifetime as one span. Pass active=false (e.g. for a small file) to skip it.
+ */
+class TraceSpan
+{
+public:
+	explicit TraceSpan(const char* name, const char* category = "stage", bool active = true)
+		: m_name(name), m_category(category), m_active(active && GetTracer().Enabled())
+	{
+		if (m_active) m_start = std::chrono::steady_clock::now();
+	}
+
+	~TraceSpan()
+	{
+		if (m_active) GetTracer().AddComplete(m_name, m_category, m_start, std::chrono::steady_clock::now(), std::move(m_args));
+	}
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+	bool Active() const { return m_active; }
+
+	// Attaches arguments shown in the viewer; only call when Active() to keep the disabled path free
+	void SetArgs(std::string args) { m_args = std::move(args); }
+
+private:
+	const char* m_name;
+	const char* m_category;
+	bool m_active;
+	std::chrono::steady_clock::time_point m_start;
+	std::string m_args;
+};
+
+/**
+ * @brief Escapes a UTF-8 string for use inside a JSON string literal.
+ */
+std::string EscapeJson(const std::string& text);
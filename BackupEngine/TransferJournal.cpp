@@ -0,0 +1,193 @@
+#include "TransferJournal.h"
+#include "EngineUtils.h"
+
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const char* const kJournalHeader = "GSBM-TRANSFER 1";
+}
+
+TransferJournal::TransferJournal(const fs::path& file, const string& backendKind) : m_file(file)
+{
+	string header = string(kJournalHeader) + "\t" + backendKind;
+	bool resume = false;
+	{
+		ifstream in(file, ios::binary);
+		string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+		size_t firstNewline = content.find('\n');
+		resume = firstNewline != string::npos && content.substr(0, firstNewline) == header;
+		if (resume)
+		{
+			// Only complete lines count: the last one may have been cut off mid-write
+			size_t start = firstNewline + 1;
+			size_t newline;
+			while ((newline = content.find('\n', start)) != string::npos)
+			{
+				Apply(content.substr(start, newline - start));
+				start = newline + 1;
+			}
+			if (start < content.size()) resume = false; // Rewrite without the torn line
+		}
+	}
+
+	fs::create_directories(file.parent_path());
+	if (resume)
+	{
+		m_out.open(file, ios::binary | ios::app);
+	}
+	else
+	{
+		// New transfer, another backend, or a torn tail: rewrite header and surviving records
+		string records;
+		for (const auto& [key, f] : m_files) records += "F\t" + EscapeTabField(key) + "\t" + to_string(f.size) + "\t" + f.sha256 + "\n";
+		for (const auto& [key, upload] : m_uploads)
+		{
+			records += "U\t" + EscapeTabField(key) + "\t" + upload.uploadId + "\n";
+			for (const auto& [number, part] : upload.parts)
+			{
+				records += "P\t" + EscapeTabField(key) + "\t" + to_string(number) + "\t" + part.etag + "\t" + to_string(part.size) + "\n";
+			}
+		}
+		for (const auto& [key, chunks] : m_chunks)
+		{
+			for (const auto& [index, sha] : chunks) records += "C\t" + EscapeTabField(key) + "\t" + to_string(index) + "\t" + sha + "\n";
+		}
+		if (m_treeComplete) records += "T\n";
+		m_out.open(file, ios::binary | ios::trunc);
+		m_out << header << "\n" << records;
+		m_out.flush();
+	}
+	if (!m_out) throw fs::filesystem_error("Cannot write transfer journal", file, make_error_code(errc::io_error));
+}
+
+void TransferJournal::Apply(const string& line)
+{
+	vector<string> fields = SplitTabFields(line);
+	try
+	{
+		if (fields[0] == "F" && fields.size() == 4)
+		{
+			m_files[UnescapeTabField(fields[1])] = { stoull(fields[2]), fields[3] };
+			m_uploads.erase(UnescapeTabField(fields[1]));
+			m_chunks.erase(UnescapeTabField(fields[1]));
+		}
+		else if (fields[0] == "U" && fields.size() == 3)
+		{
+			m_uploads[UnescapeTabField(fields[1])] = { fields[2], {} };
+		}
+		else if (fields[0] == "P" && fields.size() == 5)
+		{
+			auto upload = m_uploads.find(UnescapeTabField(fields[1]));
+			if (upload != m_uploads.end()) upload->second.parts[stoi(fields[2])] = { fields[3], stoull(fields[4]) };
+		}
+		else if (fields[0] == "C" && fields.size() == 4)
+		{
+			m_chunks[UnescapeTabField(fields[1])][stoull(fields[2])] = fields[3];
+		}
+		else if (fields[0] == "T")
+		{
+			m_treeComplete = true;
+		}
+		else return;
+		m_records++;
+	}
+	catch (const exception&)
+	{
+		// Malformed numbers: ignore the record, the data is simply sent again
+	}
+}
+
+void TransferJournal::Append(const string& line)
+{
+	lock_guard<mutex> lock(m_mutex);
+	Apply(line);
+	m_out << line << "\n";
+	m_out.flush(); // Reaches the OS before the caller moves on, so it survives the process exiting
+}
+
+bool TransferJournal::TreeComplete() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_treeComplete;
+}
+
+bool TransferJournal::Empty() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_records == 0;
+}
+
+bool TransferJournal::FindFile(const string& key, File& file) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_files.find(key);
+	if (it == m_files.end()) return false;
+	file = it->second;
+	return true;
+}
+
+bool TransferJournal::FindUpload(const string& key, Upload& upload) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_uploads.find(key);
+	if (it == m_uploads.end()) return false;
+	upload = it->second;
+	return true;
+}
+
+map<string, TransferJournal::Upload> TransferJournal::Uploads() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_uploads;
+}
+
+map<uint64_t, string> TransferJournal::Chunks(const string& key) const
+{
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_chunks.find(key);
+	return it == m_chunks.end() ? map<uint64_t, string>() : it->second;
+}
+
+void TransferJournal::FileDone(const string& key, uint64_t size, const string& sha256)
+{
+	Append("F\t" + EscapeTabField(key) + "\t" + to_string(size) + "\t" + sha256);
+}
+
+void TransferJournal::UploadStarted(const string& key, const string& uploadId)
+{
+	Append("U\t" + EscapeTabField(key) + "\t" + uploadId);
+}
+
+void TransferJournal::PartDone(const string& key, int partNumber, const string& etag, uint64_t size)
+{
+	Append("P\t" + EscapeTabField(key) + "\t" + to_string(partNumber) + "\t" + etag + "\t" + to_string(size));
+}
+
+void TransferJournal::ChunkDone(const string& key, uint64_t index, const string& sha256)
+{
+	Append("C\t" + EscapeTabField(key) + "\t" + to_string(index) + "\t" + sha256);
+}
+
+void TransferJournal::TreeDone()
+{
+	Append("T");
+}
+
+void TransferJournal::Remove()
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_out.close();
+	error_code ec;
+	fs::remove(m_file, ec);
+	fs::remove(m_file.parent_path(), ec); // Only succeeds once no other transfer is pending
+}
+
+fs::path GetTransferJournalPath(const fs::path& gameBackupDir, const wstring& folderName)
+{
+	return gameBackupDir / ".transfers" / ToPath(folderName + L".journal");
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Checkpoint journal for one cloud transfer (one backup folder to one backend). Every
+// completed file, file chunk and multipart part is appended and flushed as it finishes,
+// so a transfer cut short by a crash, a closed console or a network error can resume
+// where it stopped instead of re-sending data the destination already holds.
+//
+// The journal is a small text file next to the local backups:
+//   <game backup dir>/.transfers/<backup folder>.journal
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+
+class TransferJournal
+{
+public:
+	struct File
+	{
+		uint64_t size = 0;
+		std::string sha256; // Hex digest of the whole file
+	};
+
+	struct Part
+	{
+		std::string etag;
+		uint64_t size = 0;
+	};
+
+	struct Upload
+	{
+		std::string uploadId;
+		std::map<int, Part> parts; // Part number -> completed part
+	};
+
+	/**
+	 * @brief Opens the journal for a transfer, replaying any records an earlier attempt left.
+	 * A journal written for a different backend kind is discarded. A torn last line is ignored.
+	 * Throws fs::filesystem_error if the file cannot be created.
+	 */
+	TransferJournal(const std::filesystem::path& file, const std::string& backendKind);
+
+	TransferJournal(const TransferJournal&) = delete;
+	TransferJournal& operator=(const TransferJournal&) = delete;
+
+	const std::filesystem::path& Path() const { return m_file; }
+
+	// True if an earlier attempt reached the end of the tree (only the cleanup was missed)
+	bool TreeComplete() const;
+
+	// Nothing recorded yet (a fresh transfer)
+	bool Empty() const;
+
+	// Lookups return false / empty if there is no record. Safe to call from several threads.
+	bool FindFile(const std::string& key, File& file) const;
+	bool FindUpload(const std::string& key, Upload& upload) const;
+	std::map<std::string, Upload> Uploads() const; // Multipart uploads started but not finished
+	std::map<uint64_t, std::string> Chunks(const std::string& key) const; // Chunk index -> hex digest
+
+	// Records are appended and flushed before returning. Safe to call from several threads.
+	void FileDone(const std::string& key, uint64_t size, const std::string& sha256);
+	void UploadStarted(const std::string& key, const std::string& uploadId);
+	void PartDone(const std::string& key, int partNumber, const std::string& etag, uint64_t size);
+	void ChunkDone(const std::string& key, uint64_t index, const std::string& sha256);
+	void TreeDone();
+
+	/**
+	 * @brief Deletes the journal file once the transfer is complete (or abandoned).
+	 */
+	void Remove();
+
+private:
+	void Apply(const std::string& line);
+	void Append(const std::string& line);
+
+	std::filesystem::path m_file;
+	mutable std::mutex m_mutex;
+	std::ofstream m_out;
+	std::map<std::string, File> m_files;
+	std::map<std::string, Upload> m_uploads;
+	std::map<std::string, std::map<uint64_t, std::string>> m_chunks;
+	bool m_treeComplete = false;
+	size_t m_records = 0;
+};
+
+/**
+ * @brief Journal path of a backup's cloud transfer: "<gameBackupDir>/.transfers/<folderName>.journal".
+ */
+std::filesystem::path GetTransferJournalPath(const std::filesystem::path& gameBackupDir, const std::wstring& folderName);
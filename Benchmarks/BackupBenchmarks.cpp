@@ -0,0 +1,717 @@
+// Benchmarks for the backup engine: backup, purge, list, quick-restore and full-restore
+// over synthetic save shapes and backup histories, plus loading large profile configs, diffing
+// the indexes of large backups, finding every version of a file across a backup history, the
+// large-file copy path against fs::copy_file (throughput and page cache left behind), copying a
+// sparse disk image (time and disk space), cloud encryption throughput next to a plain memory copy,
+// and the cost of watching for a game's process. Results are printed as JSON so runs can be
+// diffed against a stored baseline.
+//
+// Usage: BackupBenchmarks [--quick] [--iterations N] [--filter text] [--out file.json]
+//                         [--histories 10,1000,100000] [--blob-mb N] [--work-dir dir] [--keep]
+//                         [--profiles 5000] [--diff-files 100000] [--trace trace.json]
+
+#include "BackupIndex.h"
+#include "BackupOperations.h"
+#include "CloudEncryption.h"
+#include "Config.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "ProcessStats.h"
+#include "ProcessWatcher.h"
+#include "SaveShapes.h"
+#include "SearchIndex.h"
+#include "Sha256.h"
+#include "StorageBackend.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	struct BenchOptions
+	{
+		bool quick = false;
+		bool keep = false;
+		int iterations = 3;
+		string filter;
+		string outFile;
+		vector<int> histories = { 10, 1000, 100000 };
+		int profiles = 5000;    // Sections in the GameProfiles.ini load/save benchmark
+		int diffFiles = 100000; // Files per backup in the diff benchmark
+		string traceFile;       // Chrome trace-event output, empty = tracing off
+		uint64_t blobMb = 128;
+		fs::path workDir;
+	};
+
+	struct BenchResult
+	{
+		string name;
+		string shape;
+		uint64_t files = 0;
+		uint64_t bytes = 0; // Payload bytes moved per iteration (0 for metadata-only operations)
+		vector<double> wallMs;
+		uint64_t syscalls = 0; // Per iteration (mean)
+		uint64_t peakRssKb = 0;
+		int64_t pageCacheKb = -1; // Cached KB of the files involved after the run (max), -1 = not measured
+		int64_t diskKb = -1;      // KB the output occupies on disk, -1 = not measured
+	};
+
+	vector<BenchResult> g_results;
+	BenchOptions g_options;
+
+	bool Selected(const string& name, const string& shape)
+	{
+		return g_options.filter.empty() || (name + "/" + shape).find(g_options.filter) != string::npos;
+	}
+
+	/**
+	 * @brief Runs `setup` (untimed) then `op` (timed) for each iteration and records the result.
+	 * `cacheProbe`, if given, reports how much of the files involved is in the page cache after `op`.
+	 */
+	void RunBenchmark(const string& name, const string& shape, int iterations, uint64_t files, uint64_t bytes,
+		const function<void()>& setup, const function<void()>& op, const function<int64_t()>& cacheProbe = nullptr)
+	{
+		if (!Selected(name, shape)) return;
+
+		BenchResult result;
+		result.name = name;
+		result.shape = shape;
+		result.files = files;
+		result.bytes = bytes;
+		uint64_t totalSyscalls = 0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			setup();
+			ResetPeakRss();
+			ProcessStats before = ReadProcessStats();
+			auto start = chrono::steady_clock::now();
+			op();
+			auto end = chrono::steady_clock::now();
+			ProcessStats after = ReadProcessStats();
+
+			result.wallMs.push_back(chrono::duration<double, milli>(end - start).count());
+			totalSyscalls += after.syscalls - before.syscalls;
+			result.peakRssKb = max(result.peakRssKb, after.peakRssKb);
+			if (cacheProbe) result.pageCacheKb = max(result.pageCacheKb, cacheProbe());
+		}
+		result.syscalls = iterations > 0 ? totalSyscalls / static_cast<uint64_t>(iterations) : 0;
+		cerr << "  " << left << setw(24) << name << setw(20) << shape << fixed << setprecision(2)
+			<< *min_element(result.wallMs.begin(), result.wallMs.end()) << " ms (best of " << iterations << ")";
+		if (result.pageCacheKb >= 0) cerr << ", " << result.pageCacheKb / 1024 << " MB left in page cache";
+		cerr << endl;
+		g_results.push_back(result);
+	}
+
+	// Adds the disk space of a run's output to its result, if the run was selected
+	void RecordDiskUsage(const string& name, const string& shape, const fs::path& output)
+	{
+		if (!Selected(name, shape) || g_results.empty()) return;
+		g_results.back().diskKb = fs::is_directory(output) ? TreeDiskUsageKb(output) : DiskUsageKb(output);
+		cerr << "  " << left << setw(24) << name << setw(20) << shape << g_results.back().diskKb << " KB on disk" << endl;
+	}
+
+	double Median(vector<double> values)
+	{
+		sort(values.begin(), values.end());
+		size_t n = values.size();
+		return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+	}
+
+	string ToJson()
+	{
+		ostringstream json;
+		json << fixed << setprecision(3);
+		json << "{\n  \"schema\": 1,\n  \"quick\": " << (g_options.quick ? "true" : "false")
+			<< ",\n  \"timestamp\": \"" << GetCurrentDateTime() << "\",\n  \"results\": [\n";
+		for (size_t i = 0; i < g_results.size(); ++i)
+		{
+			const BenchResult& r = g_results[i];
+			double median = Median(r.wallMs);
+			double mean = accumulate(r.wallMs.begin(), r.wallMs.end(), 0.0) / static_cast<double>(r.wallMs.size());
+			json << "    {\"benchmark\": \"" << r.name << "\", \"shape\": \"" << r.shape << "\""
+				<< ", \"iterations\": " << r.wallMs.size()
+				<< ", \"files\": " << r.files
+				<< ", \"bytes\": " << r.bytes
+				<< ", \"wall_ms\": {\"min\": " << *min_element(r.wallMs.begin(), r.wallMs.end())
+				<< ", \"median\": " << median
+				<< ", \"mean\": " << mean
+				<< ", \"max\": " << *max_element(r.wallMs.begin(), r.wallMs.end()) << "}"
+				<< ", \"mb_per_s\": ";
+			if (r.bytes > 0 && median > 0) json << (static_cast<double>(r.bytes) / (1024.0 * 1024.0)) / (median / 1000.0);
+			else json << "null";
+			json << ", \"io_syscalls\": " << r.syscalls
+				<< ", \"peak_rss_kb\": " << r.peakRssKb
+				<< ", \"page_cache_kb\": ";
+			if (r.pageCacheKb >= 0) json << r.pageCacheKb;
+			else json << "null";
+			json << ", \"disk_kb\": ";
+			if (r.diskKb >= 0) json << r.diskKb;
+			else json << "null";
+			json << "}"
+				<< (i + 1 < g_results.size() ? "," : "") << "\n";
+		}
+		json << "  ]\n}\n";
+		return json.str();
+	}
+
+	// Copies a tree, replacing the destination (setup helper, never timed).
+	void ResetTree(const fs::path& from, const fs::path& to)
+	{
+		fs::remove_all(to);
+		fs::create_directories(to.parent_path());
+		fs::copy(from, to, fs::copy_options::recursive);
+	}
+
+	void RequireBackup(const BackupResult& result)
+	{
+		if (!result.localSuccess || (result.cloudAttempted && !result.cloudSuccess))
+		{
+			for (const auto& line : result.log) cerr << ws2s(line) << endl;
+			throw runtime_error("benchmark backup failed");
+		}
+	}
+
+	/**
+	 * @brief Backup and restore benchmarks for one generated save shape.
+	 */
+	void BenchmarkShape(const string& shape, const function<ShapeStats(const fs::path&)>& generate)
+	{
+		fs::path shapeDir = g_options.workDir / shape;
+		fs::path savePath = shapeDir / "save";
+		fs::path backupsRoot = shapeDir / "Backups";
+		fs::path cloudRoot = shapeDir / "cloud";
+		fs::path restoreTarget = shapeDir / "restore";
+		ShapeStats stats = generate(savePath);
+		cerr << shape << ": " << stats.files << " files, " << stats.bytes / 1024 << " KiB" << endl;
+
+		GameProfile profile{ L"Bench " + s2ws(shape), PathToWide(savePath), 600, false, s2ws(shape) };
+		GlobalSettings localOnly;
+		GlobalSettings withCloud;
+		withCloud.googleDrivePath = PathToWide(cloudRoot);
+		fs::path gameDir = GetLocalGameBackupDir(backupsRoot, profile);
+
+		RunBenchmark("backup", shape, g_options.iterations, stats.files, stats.bytes,
+			[&] { fs::remove_all(backupsRoot); },
+			[&] { RequireBackup(BackupSaveFolder(profile, localOnly, backupsRoot, false)); });
+		RecordDiskUsage("backup", shape, backupsRoot); // One backup
+
+		// A second backup of an unchanged save with the shared content store: every file is linked
+		GlobalSettings withDedup;
+		withDedup.deduplicateBackups = true;
+		RunBenchmark("backup_dedup", shape, g_options.iterations, stats.files, stats.bytes,
+			[&] { fs::remove_all(backupsRoot); RequireBackup(BackupSaveFolder(profile, withDedup, backupsRoot, true)); },
+			[&] { RequireBackup(BackupSaveFolder(profile, withDedup, backupsRoot, false)); });
+		RecordDiskUsage("backup_dedup", shape, backupsRoot);
+
+		GameProfile cloudProfile = profile;
+		cloudProfile.cloudSaveEnabled = true;
+		RunBenchmark("backup_cloud", shape, g_options.iterations, stats.files * 2, stats.bytes * 2,
+			[&] { fs::remove_all(backupsRoot); fs::remove_all(cloudRoot); fs::create_directories(cloudRoot); },
+			[&] { RequireBackup(BackupSaveFolder(cloudProfile, withCloud, backupsRoot, false)); });
+
+		// Small files go into pack files; the sync folder receives a handful of files
+		GlobalSettings withPacks = withCloud;
+		withPacks.packSmallFilesKb = 64;
+		RunBenchmark("backup_cloud_packed", shape, g_options.iterations, stats.files * 2, stats.bytes * 2,
+			[&] { fs::remove_all(backupsRoot); fs::remove_all(cloudRoot); fs::create_directories(cloudRoot); },
+			[&] { RequireBackup(BackupSaveFolder(cloudProfile, withPacks, backupsRoot, false)); });
+
+		GlobalSettings withChunks = withCloud;
+		withChunks.cloudLayout = L"chunks";
+		RunBenchmark("backup_cloud_chunks", shape, g_options.iterations, stats.files * 2, stats.bytes * 2,
+			[&] { fs::remove_all(backupsRoot); fs::remove_all(cloudRoot); fs::create_directories(cloudRoot); },
+			[&] { RequireBackup(BackupSaveFolder(cloudProfile, withChunks, backupsRoot, false)); });
+
+		// Key derivation (PBKDF2) happens once per process in real use, so it is kept out of the timing
+		GameProfile encryptedProfile = cloudProfile;
+		encryptedProfile.encryptionPassphrase = L"benchmark passphrase";
+		unique_ptr<StorageBackend> cloud = CreateStorageBackend(withChunks);
+		RunBenchmark("backup_cloud_encrypted", shape, g_options.iterations, stats.files * 2, stats.bytes * 2,
+			[&] {
+				fs::remove_all(backupsRoot);
+				fs::remove_all(cloudRoot);
+				fs::create_directories(cloudRoot);
+				OpenStoredKeys(*cloud, GetStorageGamePrefix(encryptedProfile), GetProfileSecret(encryptedProfile), true);
+			},
+			[&] { RequireBackup(BackupSaveFolder(encryptedProfile, withChunks, backupsRoot, false)); });
+
+		// Leave exactly one manual backup for the restore benchmarks
+		fs::remove_all(backupsRoot);
+		BackupResult seed = BackupSaveFolder(profile, localOnly, backupsRoot, false);
+		RequireBackup(seed);
+		fs::path backup = gameDir / ToPath(seed.folderName);
+
+		// Restores wipe the target first, so start each iteration from a populated save folder
+		RunBenchmark("full_restore", shape, g_options.iterations, stats.files, stats.bytes,
+			[&] { ResetTree(savePath, restoreTarget); },
+			[&] { RestoreBackup(backup, restoreTarget); });
+
+		RunBenchmark("quick_restore", shape, g_options.iterations, stats.files, stats.bytes,
+			[&] { ResetTree(savePath, restoreTarget); },
+			[&] { RestoreBackup(FindLatestManualBackup(gameDir), restoreTarget); });
+
+		if (!g_options.keep) fs::remove_all(shapeDir);
+	}
+
+	/**
+	 * @brief List, purge and quick-restore benchmarks against a history of `count` existing backups.
+	 */
+	void BenchmarkHistory(int count)
+	{
+		string shape = "history_" + to_string(count);
+		fs::path historyDir = g_options.workDir / shape;
+		fs::path gameDir = historyDir / "Backups" / "Game";
+		fs::path restoreTarget = historyDir / "restore";
+		const int manualEvery = 10;
+
+		cerr << shape << ": generating..." << endl;
+		ShapeStats stats = GenerateBackupHistory(gameDir, count, manualEvery, 42);
+
+		RunBenchmark("list", shape, g_options.iterations, stats.files, 0,
+			[] {},
+			[&] { if (ListBackups(gameDir).size() != static_cast<size_t>(count)) throw runtime_error("list mismatch"); });
+
+		RunBenchmark("quick_restore", shape, g_options.iterations, 1, 256,
+			[&] { fs::remove_all(restoreTarget); },
+			[&] { RestoreBackup(FindLatestManualBackup(gameDir), restoreTarget); });
+
+		// Purge half of the auto-saves; regenerating 100k folders is slow, so run that size once
+		int autoCount = count - (count + manualEvery - 1) / manualEvery;
+		int purgeIterations = count >= 100000 ? 1 : g_options.iterations;
+		bool first = true;
+		RunBenchmark("purge", shape, purgeIterations, static_cast<uint64_t>(autoCount - autoCount / 2), 0,
+			[&] {
+				if (!first)
+				{
+					fs::remove_all(gameDir);
+					GenerateBackupHistory(gameDir, count, manualEvery, 42);
+				}
+				first = false;
+			},
+			[&] {
+				vector<wstring> log;
+				PurgeBackups(gameDir, L"A", max(1, autoCount / 2), 0, L"Local", log);
+			});
+
+		if (!g_options.keep) fs::remove_all(historyDir);
+	}
+
+	/**
+	 * @brief Loading and saving GameProfiles.ini with `count` profiles.
+	 */
+	void BenchmarkProfiles(int count)
+	{
+		string shape = "profiles_" + to_string(count);
+		fs::path profilesFile = g_options.workDir / (shape + ".ini");
+		{
+			ofstream out(profilesFile, ios::binary | ios::trunc);
+			for (int i = 0; i < count; ++i)
+			{
+				out << "[game" << i << "]\nId=game" << i << "\nName=Game " << i << "\nSavePath=/home/user/saves/game" << i
+					<< "\nAutoSaveInterval=600\nCloudSaveEnabled=" << (i % 2) << "\n\n";
+			}
+		}
+		uint64_t bytes = fs::file_size(profilesFile);
+
+		RunBenchmark("config_load", shape, g_options.iterations, 1, bytes,
+			[] {},
+			[&] { if (LoadProfiles(profilesFile).size() != static_cast<size_t>(count)) throw runtime_error("profile count mismatch"); });
+
+		GameProfile edited{ L"Renamed Game", L"/home/user/saves/moved", 300, true, L"game" + to_wstring(count / 2) };
+		RunBenchmark("config_save", shape, g_options.iterations, 1, bytes,
+			[] {},
+			[&] { SaveProfile(profilesFile, edited); });
+
+		if (!g_options.keep) fs::remove(profilesFile);
+	}
+
+	/**
+	 * @brief Loading the indexes of two backups of `count` files and diffing them (1% of the files
+	 * changed, a few added and removed). Only index files exist; no backup file is touched. Paths
+	 * are zero-padded so the entries are in path order, as ManifestFromScan saves them.
+	 */
+	void BenchmarkDiff(int count)
+	{
+		string shape = "index_" + to_string(count);
+		fs::path gameDir = g_options.workDir / shape;
+		fs::path older = gameDir / "100-[x]-A";
+		fs::path newer = gameDir / "200-[x]-A";
+		BackupManifest before, after;
+		for (int i = 0; i < count; ++i)
+		{
+			char folderName[16], fileName[32];
+			snprintf(folderName, sizeof(folderName), "slots/%05d", i / 100);
+			snprintf(fileName, sizeof(fileName), "/save_%07d.sav", i);
+			if (i % 100 == 0)
+			{
+				ManifestEntry folder;
+				folder.path = folderName;
+				folder.type = fs::file_type::directory;
+				before.entries.push_back(folder);
+				after.entries.push_back(folder);
+			}
+			ManifestEntry file;
+			file.path = string(folderName) + fileName;
+			file.size = 4096 + i % 1000;
+			file.mtime = 1700000000000000000LL + i;
+			if (i % 1000 != 1) before.entries.push_back(file); // Added later
+			if (i % 100 == 0) { file.size += 17; file.mtime++; } // Modified
+			if (i % 1000 != 2) after.entries.push_back(file); // Removed later
+		}
+		fs::create_directories(older);
+		fs::create_directories(newer);
+		SaveBackupIndex(older, before);
+		SaveBackupIndex(newer, after);
+
+		uint64_t expected = static_cast<uint64_t>(count / 100 + 2 * (count / 1000));
+		RunBenchmark("diff", shape, g_options.iterations, static_cast<uint64_t>(count) * 2, 0,
+			[] {},
+			[&] {
+				BackupDiff diff = DiffBackups(LoadBackupIndex(older), LoadBackupIndex(newer));
+				if (diff.changes.size() < expected - 2 || diff.changes.size() > expected + 2) throw runtime_error("diff mismatch");
+			});
+
+		if (!g_options.keep) fs::remove_all(gameDir);
+	}
+
+	/**
+	 * @brief All versions of one file across `backups` backups of `files` files each (1% of the
+	 * files change between backups): from the search index, and by reading every backup index
+	 * as a search without it would.
+	 */
+	void BenchmarkSearch(int backups, int files)
+	{
+		string shape = "history_" + to_string(backups) + "x" + to_string(files);
+		fs::path gameDir = g_options.workDir / shape;
+		BackupManifest index;
+		for (int i = 0; i < files; ++i)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "slot_%06d.sav", i);
+			ManifestEntry file;
+			file.path = name;
+			file.size = 4096;
+			file.mtime = 1700000000000000000LL;
+			file.sha256 = Sha256Hex(name);
+			index.entries.push_back(file);
+		}
+		for (int b = 0; b < backups; ++b)
+		{
+			for (int i = b % 100; i < files; i += 100)
+			{
+				index.entries[i].mtime++;
+				index.entries[i].sha256 = Sha256Hex(index.entries[i].path + to_string(b));
+			}
+			fs::path folder = gameDir / (to_string(1000000 + b) + "-[x]-A");
+			fs::create_directories(folder);
+			SaveBackupIndex(folder, index);
+		}
+		LoadBackupSearchIndex(gameDir); // Built once, as backups would have kept it
+
+		const string path = "slot_000042.sav";
+		size_t expected = static_cast<size_t>(backups > 42 ? 1 + (backups - 42 + 99) / 100 : 1); // Changed in backups 42, 142, ...
+		RunBenchmark("search", shape, g_options.iterations, 1, 0,
+			[] {},
+			[&] {
+				BackupSearchIndex search(gameDir);
+				if (search.Versions(path).size() != expected || search.FindPaths("000042").size() != 1) throw runtime_error("search mismatch");
+			});
+		RunBenchmark("search_walk", shape, g_options.iterations, static_cast<uint64_t>(backups), 0,
+			[] {},
+			[&] {
+				set<string> versions;
+				for (const auto& folder : ListBackups(gameDir))
+				{
+					for (const auto& entry : LoadBackupIndex(folder).entries)
+					{
+						if (entry.path == path) versions.insert(entry.sha256);
+					}
+				}
+				if (versions.size() != expected) throw runtime_error("search mismatch");
+			});
+
+		if (!g_options.keep) fs::remove_all(gameDir);
+	}
+
+	/**
+	 * @brief Copying one large file with fs::copy_file and with the large-file path (buffered
+	 * with cache dropping, and direct I/O). The source is evicted from the page cache before
+	 * each run; what the copy leaves cached afterwards is the pollution a game would feel.
+	 * fs::copy_file returns with the copy still dirty in the cache, so it is also timed with
+	 * the sync the large-file path does as it goes.
+	 */
+	void BenchmarkLargeCopy(uint64_t size)
+	{
+		string shape = "file_" + to_string(size / (1024 * 1024)) + "mb";
+		fs::path dir = g_options.workDir / shape;
+		fs::path source = dir / "world.dat";
+		fs::path target = dir / "world-copy.dat";
+		fs::create_directories(dir);
+		{
+			ofstream out(source, ios::binary);
+			string block(1024 * 1024, '\0');
+			for (uint64_t written = 0; written < size; written += block.size())
+			{
+				for (size_t i = 0; i < block.size(); i += 64) block[i] = static_cast<char>(written / block.size() + i);
+				out.write(block.data(), static_cast<streamsize>(min<uint64_t>(block.size(), size - written)));
+			}
+		}
+
+		auto setup = [&] { fs::remove(target); EvictFromPageCache(source); };
+		auto cached = [&]() -> int64_t
+			{
+				int64_t sourceKb = PageCacheKb(source), targetKb = PageCacheKb(target);
+				return sourceKb < 0 || targetKb < 0 ? -1 : sourceKb + targetKb;
+			};
+		LargeFileCopyOptions buffered, direct;
+		direct.directIo = true;
+		RunBenchmark("copy_file_std", shape, g_options.iterations, 1, size, setup, [&] { fs::copy_file(source, target); }, cached);
+		RunBenchmark("copy_file_std_synced", shape, g_options.iterations, 1, size, setup, [&] { fs::copy_file(source, target); SyncFile(target); }, cached);
+		RunBenchmark("copy_file_large", shape, g_options.iterations, 1, size, setup, [&] { CopyLargeFile(source, target, buffered); }, cached);
+		RunBenchmark("copy_file_direct", shape, g_options.iterations, 1, size, setup, [&] { CopyLargeFile(source, target, direct); }, cached);
+
+		if (!g_options.keep) fs::remove_all(dir);
+	}
+
+	/**
+	 * @brief A disk image that is mostly holes: fs::copy_file against the sparse copy, and the
+	 * restore of a copy that lost its holes using the layout a manifest records.
+	 */
+	void BenchmarkSparseCopy(uint64_t size)
+	{
+		const uint64_t stride = 64 * 1024 * 1024; // 1 MB of data every 64 MB
+		string shape = "image_" + to_string(size / (1024 * 1024)) + "mb";
+		fs::path dir = g_options.workDir / shape;
+		fs::path source = dir / "disk.img";
+		fs::path dense = dir / "disk-dense.img";
+		fs::path target = dir / "disk-copy.img";
+		fs::create_directories(dir);
+		{
+			ofstream out(source, ios::binary);
+			string block(1024 * 1024, '\0');
+			for (uint64_t offset = 0; offset < size; offset += stride)
+			{
+				for (size_t i = 0; i < block.size(); i += 64) block[i] = static_cast<char>(offset / stride + i);
+				out.seekp(static_cast<streamoff>(offset));
+				out.write(block.data(), static_cast<streamsize>(min<uint64_t>(block.size(), size - offset)));
+			}
+		}
+		fs::resize_file(source, size);
+		vector<FileExtent> layout = DataExtents(source);
+		uint64_t data = 0;
+		for (const auto& extent : layout) data += extent.length;
+		if (data == size) cerr << "sparse copy: no holes on this file system" << endl;
+
+		auto setup = [&] { fs::remove(target); };
+		RunBenchmark("copy_sparse_std", shape, g_options.iterations, 1, size, setup, [&] { fs::copy_file(source, target); SyncFile(target); });
+		RecordDiskUsage("copy_sparse_std", shape, target);
+		RunBenchmark("copy_sparse", shape, g_options.iterations, 1, data, setup, [&] { CopySparseFile(source, target, layout); SyncFile(target); });
+		RecordDiskUsage("copy_sparse", shape, target);
+		if (Selected("copy_sparse_relayout", shape))
+		{
+			fs::copy_file(source, dense, fs::copy_options::overwrite_existing);
+			SyncFile(dense);
+		}
+		RunBenchmark("copy_sparse_relayout", shape, g_options.iterations, 1, size, setup, [&] { CopySparseFile(dense, target, layout); SyncFile(target); });
+		RecordDiskUsage("copy_sparse_relayout", shape, target);
+
+		if (!g_options.keep) fs::remove_all(dir);
+	}
+
+	/**
+	 * @brief Encrypt and decrypt throughput of one in-memory buffer, against copying it.
+	 */
+	void BenchmarkEncryption(uint64_t size)
+	{
+		string shape = "buffer_" + to_string(size / (1024 * 1024)) + "mb";
+		string data(size, '\0');
+		mt19937_64 random(7);
+		for (auto& c : data) c = static_cast<char>(random());
+		EncryptionKeys keys("benchmark passphrase", "0123456789abcdef", 1);
+		cerr << "encryption: AES-NI " << (AesGcm::CpuSupportsHardware() ? "available" : "not available") << endl;
+
+		string copy, object, plain;
+		RunBenchmark("copy", shape, g_options.iterations, 1, size,
+			[&] { copy.clear(); copy.shrink_to_fit(); },
+			[&] { copy = data; });
+		RunBenchmark("encrypt", shape, g_options.iterations, 1, size,
+			[] {},
+			[&] { object = keys.Encrypt(data); });
+		RunBenchmark("decrypt", shape, g_options.iterations, 1, size,
+			[] {},
+			[&] { plain = keys.Decrypt(object); });
+		if (Selected("decrypt", shape) && plain != data) throw runtime_error("decrypt mismatch");
+
+		// The fallback for CPUs without AES-NI
+		RunBenchmark("encrypt_portable", shape, g_options.iterations, 1, size,
+			[] {},
+			[&] {
+				StreamEncryptor encryptor(keys, false);
+				object = encryptor.Header();
+				for (size_t offset = 0; offset < data.size() || offset == 0; offset += StreamEncryptor::kSegmentSize)
+				{
+					size_t segment = min(StreamEncryptor::kSegmentSize, data.size() - offset);
+					encryptor.Segment(data.data() + offset, segment, offset + segment == data.size(), object);
+				}
+			});
+	}
+
+	/**
+	 * @brief One poll of the game process watcher: the full process list while waiting for the
+	 * game, and the known process while it runs (this benchmark stands in for the game). Also
+	 * prints the share of one CPU each takes at the default poll intervals.
+	 */
+	void BenchmarkProcessWatch()
+	{
+		uint32_t self = 0;
+		wstring exeName;
+		for (uint32_t pid : { FindProcess(L"BackupBenchmarks"), FindProcess(L"BackupBenchmarks.exe") })
+		{
+			if (pid != 0) self = pid;
+		}
+		if (self != 0) exeName = GetProcessExeName(self);
+		string shape = "this_system";
+		ProcessWatchOptions options;
+
+		uint32_t found = 0;
+		RunBenchmark("process_scan", shape, g_options.iterations, 1, 0,
+			[] {},
+			[&] { for (int i = 0; i < 100; ++i) found = FindProcess(L"no-such-game.exe"); });
+		if (Selected("process_scan", shape) && found != 0) throw runtime_error("process_scan found a missing game");
+		if (Selected("process_scan", shape))
+		{
+			double pollMs = *min_element(g_results.back().wallMs.begin(), g_results.back().wallMs.end()) / 100;
+			cerr << "  process_scan: " << pollMs << " ms per poll, " << pollMs / options.waitingPoll.count() * 100 << "% of a CPU every "
+				<< options.waitingPoll.count() << " ms while waiting for the game" << endl;
+		}
+
+		bool running = false;
+		RunBenchmark("process_check", shape, g_options.iterations, 1, 0,
+			[] {},
+			[&] { for (int i = 0; i < 100; ++i) running = IsProcessRunning(self, exeName); });
+		if (Selected("process_check", shape) && !running) throw runtime_error("process_check lost this process");
+		if (Selected("process_check", shape))
+		{
+			double pollMs = *min_element(g_results.back().wallMs.begin(), g_results.back().wallMs.end()) / 100;
+			cerr << "  process_check: " << pollMs << " ms per poll, " << pollMs / options.runningPoll.count() * 100 << "% of a CPU every "
+				<< options.runningPoll.count() << " ms while the game runs" << endl;
+		}
+	}
+
+	vector<int> ParseList(const string& text)
+	{
+		vector<int> values;
+		stringstream ss(text);
+		string item;
+		while (getline(ss, item, ',')) values.push_back(stoi(item));
+		return values;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		auto next = [&]() -> string {
+			if (i + 1 >= argc) throw invalid_argument("missing value for " + arg);
+			return argv[++i];
+			};
+		if (arg == "--quick") g_options.quick = true;
+		else if (arg == "--keep") g_options.keep = true;
+		else if (arg == "--iterations") g_options.iterations = max(1, stoi(next()));
+		else if (arg == "--filter") g_options.filter = next();
+		else if (arg == "--out") g_options.outFile = next();
+		else if (arg == "--histories") g_options.histories = ParseList(next());
+		else if (arg == "--blob-mb") g_options.blobMb = stoull(next());
+		else if (arg == "--work-dir") g_options.workDir = next();
+		else if (arg == "--profiles") g_options.profiles = max(1, stoi(next()));
+		else if (arg == "--diff-files") g_options.diffFiles = max(1, stoi(next()));
+		else if (arg == "--trace") g_options.traceFile = next();
+		else
+		{
+			cerr << "Unknown option: " << arg << endl;
+			return 2;
+		}
+	}
+
+	if (g_options.quick)
+	{
+		// Small enough to run as a smoke test
+		g_options.iterations = 1;
+		g_options.histories = { 10, 100 };
+		g_options.blobMb = 4;
+		g_options.profiles = 500;
+		g_options.diffFiles = 10000;
+	}
+	// Only a work folder we created ourselves is deleted at the end
+	bool ownWorkDir = g_options.workDir.empty();
+	if (ownWorkDir)
+	{
+		g_options.workDir = fs::temp_directory_path() / ("gsbm_bench_" + to_string(random_device{}()));
+	}
+	fs::create_directories(g_options.workDir);
+	if (!g_options.traceFile.empty())
+	{
+		GetTracer().Start();
+		GetTracer().SetThreadName("benchmark");
+	}
+
+	try
+	{
+		int tinyFiles = g_options.quick ? 200 : 5000;
+		int depth = g_options.quick ? 8 : 40;
+		uint64_t blobSize = g_options.blobMb * 1024 * 1024;
+
+		BenchmarkShape("tiny_files", [&](const fs::path& root) { return GenerateTinyFiles(root, tinyFiles, 64, 8 * 1024, 1); });
+		BenchmarkShape("large_blobs", [&](const fs::path& root) { return GenerateLargeBlobs(root, 2, blobSize, 2); });
+		BenchmarkShape("deep_tree", [&](const fs::path& root) { return GenerateDeepTree(root, depth, 3, 2, 4 * 1024, 3); });
+		for (int count : g_options.histories) BenchmarkHistory(count);
+		BenchmarkProfiles(g_options.profiles);
+		BenchmarkDiff(g_options.diffFiles);
+		BenchmarkSearch(g_options.quick ? 20 : 200, g_options.quick ? 500 : 5000);
+		BenchmarkLargeCopy(max<uint64_t>(blobSize, g_options.quick ? 16 * 1024 * 1024 : 512 * 1024 * 1024));
+		BenchmarkSparseCopy(g_options.quick ? 256 * 1024 * 1024 : 4096ull * 1024 * 1024);
+		BenchmarkEncryption(max<uint64_t>(blobSize, 16 * 1024 * 1024));
+		BenchmarkProcessWatch();
+	}
+	catch (const exception& e)
+	{
+		cerr << "Benchmark failed: " << e.what() << endl;
+		if (ownWorkDir && !g_options.keep) fs::remove_all(g_options.workDir);
+		return 1;
+	}
+
+	if (ownWorkDir && !g_options.keep) fs::remove_all(g_options.workDir);
+	if (!g_options.traceFile.empty() && GetTracer().StopAndWrite(g_options.traceFile))
+	{
+		cerr << "Trace written to " << g_options.traceFile << endl;
+	}
+
+	string json = ToJson();
+	if (g_options.outFile.empty())
+	{
+		cout << json;
+	}
+	else
+	{
+		ofstream out(g_options.outFile, ios::trunc);
+		out << json;
+		cerr << "Results written to " << g_options.outFile << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,210 @@
+#include "ProcessStats.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "Psapi.lib")
+#else
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#endif
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+using namespace std;
+
+namespace
+{
+	// Volume and file number, the same for every hard link of a file
+	bool FileIdentity(const std::filesystem::path& file, pair<uint64_t, uint64_t>& identity);
+}
+
+#ifdef _WIN32
+
+ProcessStats ReadProcessStats()
+{
+	ProcessStats stats;
+	IO_COUNTERS io = {};
+	if (GetProcessIoCounters(GetCurrentProcess(), &io))
+	{
+		stats.syscalls = io.ReadOperationCount + io.WriteOperationCount + io.OtherOperationCount;
+	}
+	PROCESS_MEMORY_COUNTERS mem = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &mem, sizeof(mem)))
+	{
+		stats.peakRssKb = mem.PeakWorkingSetSize / 1024;
+	}
+	return stats;
+}
+
+void ResetPeakRss()
+{
+}
+
+int64_t PageCacheKb(const std::filesystem::path&)
+{
+	return -1;
+}
+
+void EvictFromPageCache(const std::filesystem::path&)
+{
+}
+
+int64_t DiskUsageKb(const std::filesystem::path& file)
+{
+	// Allocated size, which is what sparse files save
+	DWORD high = 0;
+	DWORD low = GetCompressedFileSizeW(file.c_str(), &high);
+	if (low == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) return -1;
+	return static_cast<int64_t>((static_cast<uint64_t>(high) << 32 | low) / 1024);
+}
+
+namespace
+{
+	bool FileIdentity(const std::filesystem::path& file, pair<uint64_t, uint64_t>& identity)
+	{
+		HANDLE handle = CreateFileW(file.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) return false;
+		BY_HANDLE_FILE_INFORMATION info = {};
+		bool ok = GetFileInformationByHandle(handle, &info) != 0;
+		CloseHandle(handle);
+		identity = { info.dwVolumeSerialNumber, static_cast<uint64_t>(info.nFileIndexHigh) << 32 | info.nFileIndexLow };
+		return ok;
+	}
+}
+
+void SyncFile(const std::filesystem::path& file)
+{
+	HANDLE handle = CreateFileW(file.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return;
+	FlushFileBuffers(handle);
+	CloseHandle(handle);
+}
+
+#else
+
+ProcessStats ReadProcessStats()
+{
+	ProcessStats stats;
+	ifstream io("/proc/self/io");
+	string key;
+	uint64_t value = 0;
+	while (io >> key >> value)
+	{
+		if (key == "syscr:" || key == "syscw:") stats.syscalls += value;
+	}
+
+	ifstream status("/proc/self/status");
+	string line;
+	while (getline(status, line))
+	{
+		if (line.rfind("VmHWM:", 0) == 0)
+		{
+			stats.peakRssKb = stoull(line.substr(6));
+			break;
+		}
+	}
+	if (stats.peakRssKb == 0) // No procfs: fall back to the lifetime peak
+	{
+		rusage usage{};
+		if (getrusage(RUSAGE_SELF, &usage) == 0) stats.peakRssKb = static_cast<uint64_t>(usage.ru_maxrss);
+	}
+	return stats;
+}
+
+void ResetPeakRss()
+{
+	ofstream clearRefs("/proc/self/clear_refs");
+	if (clearRefs.is_open()) clearRefs << "5";
+}
+
+int64_t PageCacheKb(const std::filesystem::path& file)
+{
+	int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return -1;
+	struct stat info{};
+	int64_t residentKb = -1;
+	if (fstat(fd, &info) == 0 && info.st_size == 0)
+	{
+		residentKb = 0;
+	}
+	else if (info.st_size > 0)
+	{
+		// Mapping the file does not fault its pages in; mincore reports which are cached
+		size_t length = static_cast<size_t>(info.st_size);
+		void* map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		if (map != MAP_FAILED)
+		{
+			long page = sysconf(_SC_PAGESIZE);
+			vector<unsigned char> resident((length + page - 1) / page);
+			if (mincore(map, length, resident.data()) == 0)
+			{
+				residentKb = 0;
+				for (unsigned char bit : resident) residentKb += (bit & 1) ? page / 1024 : 0;
+			}
+			munmap(map, length);
+		}
+	}
+	close(fd);
+	return residentKb;
+}
+
+void EvictFromPageCache(const std::filesystem::path& file)
+{
+	int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return;
+	fdatasync(fd); // Dirty pages cannot be dropped
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+int64_t DiskUsageKb(const std::filesystem::path& file)
+{
+	struct stat info{};
+	if (stat(file.c_str(), &info) != 0) return -1;
+	return static_cast<int64_t>(info.st_blocks) * 512 / 1024;
+}
+
+namespace
+{
+	bool FileIdentity(const std::filesystem::path& file, pair<uint64_t, uint64_t>& identity)
+	{
+		struct stat info{};
+		if (stat(file.c_str(), &info) != 0) return false;
+		identity = { static_cast<uint64_t>(info.st_dev), static_cast<uint64_t>(info.st_ino) };
+		return true;
+	}
+}
+
+void SyncFile(const std::filesystem::path& file)
+{
+	int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return;
+	fdatasync(fd);
+	close(fd);
+}
+
+#endif
+
+int64_t TreeDiskUsageKb(const std::filesystem::path& root)
+{
+	set<pair<uint64_t, uint64_t>> seen;
+	int64_t total = 0;
+	error_code ec;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(root, ec))
+	{
+		pair<uint64_t, uint64_t> identity;
+		if (!entry.is_regular_file() || !FileIdentity(entry.path(), identity) || !seen.insert(identity).second) continue;
+		total += max<int64_t>(DiskUsageKb(entry.path()), 0);
+	}
+	return total;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Per-process resource counters sampled around each benchmark run.
+
+#include <cstdint>
+#include <filesystem>
+
+struct ProcessStats
+{
+	uint64_t syscalls = 0;  // Linux: read+write class syscalls (/proc/self/io). Windows: I/O operation count.
+	uint64_t peakRssKb = 0; // Peak resident set size since the last ResetPeakRss()
+};
+
+/**
+ * @brief Samples the current counters. Fields that are unavailable on this platform stay 0.
+ */
+ProcessStats ReadProcessStats();
+
+/**
+ * @brief Resets the peak-RSS high-water mark so each benchmark reports its own peak.
+ * Linux only (writes "5" to /proc/self/clear_refs); a no-op elsewhere.
+ */
+void ResetPeakRss();
+
+/**
+ * @brief KB of a file currently in the page cache (mincore), or -1 where this cannot be measured
+ * (Windows, or no mmap support).
+ */
+int64_t PageCacheKb(const std::filesystem::path& file);
+
+/**
+ * @brief KB a file occupies on disk (its allocated blocks, less than its size when it has
+ * holes), or -1 if it cannot be read.
+ */
+int64_t DiskUsageKb(const std::filesystem::path& file);
+
+/**
+ * @brief DiskUsageKb summed over the files under `root`, counting hard-linked files once.
+ */
+int64_t TreeDiskUsageKb(const std::filesystem::path& root);
+
+/**
+ * @brief Writes a file back and asks the kernel to drop it from the page cache, so the next
+ * read comes from disk. Best effort; a no-op on Windows.
+ */
+void EvictFromPageCache(const std::filesystem::path& file);
+
+/**
+ * @brief Waits until a file's data is on disk (fdatasync / FlushFileBuffers).
+ */
+void SyncFile(const std::filesystem::path& file);
@@ -0,0 +1,105 @@
+#include "SaveShapes.h"
+#include "EngineUtils.h"
+
+#include <fstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	// SplitMix64: fast, good-enough randomness for filler data
+	uint64_t NextRandom(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+}
+
+void WriteRandomFile(const fs::path& file, uint64_t size, uint64_t seed)
+{
+	if (file.has_parent_path()) fs::create_directories(file.parent_path());
+	ofstream out(file, ios::binary | ios::trunc);
+	vector<uint64_t> buffer(64 * 1024 / sizeof(uint64_t));
+	uint64_t state = seed;
+	uint64_t remaining = size;
+	while (remaining > 0)
+	{
+		for (auto& word : buffer) word = NextRandom(state);
+		size_t chunk = static_cast<size_t>(min<uint64_t>(remaining, buffer.size() * sizeof(uint64_t)));
+		out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<streamsize>(chunk));
+		remaining -= chunk;
+	}
+}
+
+ShapeStats GenerateTinyFiles(const fs::path& root, int fileCount, uint64_t minSize, uint64_t maxSize, uint64_t seed)
+{
+	ShapeStats stats;
+	uint64_t state = seed;
+	for (int i = 0; i < fileCount; ++i)
+	{
+		uint64_t size = minSize + (maxSize > minSize ? NextRandom(state) % (maxSize - minSize + 1) : 0);
+		// 16 sub-folders, like region/chunk layouts
+		fs::path file = root / ("region" + to_string(i % 16)) / ("chunk_" + to_string(i) + ".dat");
+		WriteRandomFile(file, size, NextRandom(state));
+		stats.files++;
+		stats.bytes += size;
+	}
+	return stats;
+}
+
+ShapeStats GenerateLargeBlobs(const fs::path& root, int blobCount, uint64_t blobSize, uint64_t seed)
+{
+	ShapeStats stats;
+	for (int i = 0; i < blobCount; ++i)
+	{
+		WriteRandomFile(root / ("world" + to_string(i) + ".bin"), blobSize, seed + static_cast<uint64_t>(i));
+		stats.files++;
+		stats.bytes += blobSize;
+	}
+	return stats;
+}
+
+ShapeStats GenerateDeepTree(const fs::path& root, int depth, int branches, int filesPerDir, uint64_t fileSize, uint64_t seed)
+{
+	ShapeStats stats;
+	uint64_t state = seed;
+	for (int b = 0; b < branches; ++b)
+	{
+		fs::path dir = root / ("branch" + to_string(b));
+		for (int d = 0; d < depth; ++d)
+		{
+			dir /= "level" + to_string(d);
+			for (int f = 0; f < filesPerDir; ++f)
+			{
+				WriteRandomFile(dir / ("save" + to_string(f) + ".sav"), fileSize, NextRandom(state));
+				stats.files++;
+				stats.bytes += fileSize;
+			}
+		}
+	}
+	return stats;
+}
+
+ShapeStats GenerateBackupHistory(const fs::path& gameBackupDir, int count, int manualEvery, uint64_t seed)
+{
+	ShapeStats stats;
+	fs::create_directories(gameBackupDir);
+	// Start far enough in the past that generated names never collide with real backups
+	time_t start = time(nullptr) - static_cast<time_t>(count) * 60 - 86400;
+	for (int i = 0; i < count; ++i)
+	{
+		time_t t = start + static_cast<time_t>(i) * 60;
+		bool manual = manualEvery > 0 && (i % manualEvery) == 0;
+		wstring name = to_wstring(static_cast<long long>(t)) + L"-[" + FormatFolderDateTime(t) + L"]-" + (manual ? L"M" : L"A");
+		fs::path folder = gameBackupDir / ToPath(name);
+		fs::create_directory(folder);
+		WriteRandomFile(folder / "slot1.sav", 256, seed + static_cast<uint64_t>(i));
+		stats.files++;
+		stats.bytes += 256;
+	}
+	return stats;
+}
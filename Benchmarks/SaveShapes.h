@@ -0,0 +1,41 @@
+#pragma once
+
+// Synthetic save-folder generators used by the benchmarks.
+// All content is pseudo-random (incompressible) and reproducible from the seed.
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Totals for a generated tree
+struct ShapeStats
+{
+	uint64_t files = 0;
+	uint64_t bytes = 0;
+};
+
+/**
+ * @brief Writes `size` pseudo-random bytes to `file`, creating parent folders.
+ */
+void WriteRandomFile(const std::filesystem::path& file, uint64_t size, uint64_t seed);
+
+/**
+ * @brief Many tiny files (e.g. per-level or per-chunk saves) spread over a few folders.
+ */
+ShapeStats GenerateTinyFiles(const std::filesystem::path& root, int fileCount, uint64_t minSize, uint64_t maxSize, uint64_t seed);
+
+/**
+ * @brief A few huge blobs (e.g. sandbox worlds, emulator memory cards).
+ */
+ShapeStats GenerateLargeBlobs(const std::filesystem::path& root, int blobCount, uint64_t blobSize, uint64_t seed);
+
+/**
+ * @brief `branches` independent folder chains, each `depth` levels deep with `filesPerDir` files per level.
+ */
+ShapeStats GenerateDeepTree(const std::filesystem::path& root, int depth, int branches, int filesPerDir, uint64_t fileSize, uint64_t seed);
+
+/**
+ * @brief Fills a game backup folder with `count` existing backups named like the real ones
+ * ("<epoch>-[YYYY-MM-DD_HH-MM-SS]-A|M"), one small file each. Every `manualEvery`-th backup is manual.
+ */
+ShapeStats GenerateBackupHistory(const std::filesystem::path& gameBackupDir, int count, int manualEvery, uint64_t seed);
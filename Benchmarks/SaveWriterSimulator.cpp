@@ -0,0 +1,420 @@
+// Save-writer simulator: a reproducible stand-in for a running game.
+//
+// It writes "saves" to a folder the way real games do and then checks the resulting backups:
+//   rename  - write slotN.sav.tmp, then rename over slotN.sav (atomic per file)
+//   inplace - truncate slotN.sav and rewrite it in chunks (non-atomic)
+//   burst   - several files rewritten in place back-to-back (one save spans all files)
+//   stream  - each file rewritten slowly in chunks over --stream-ms
+//
+// Every file carries a header/trailer with the save generation and a checksum, so a backup can
+// be classified as consistent (all files valid and from the same generation) or torn.
+//
+// Modes of operation:
+//   (default)    runs the engine's auto-save loop in-process beside the writer, then reports
+//   --write-only only writes (for an external monitor such as the console app) and logs each
+//                completed save to <work-dir>/simulator_writes.tsv
+//   --analyze    reads that log plus a game backup folder and reports
+//
+// Report (JSON on stdout): saves written/captured/missed, torn snapshots, and the delay from a
+// save completing to the first backup that contains it (p50/p99/max).
+
+#include "AutoSaveScheduler.h"
+#include "BackupOperations.h"
+#include "EngineUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	using Clock = chrono::system_clock;
+
+	struct SimOptions
+	{
+		string mode = "rename";
+		int files = 0;             // Files per save (0 = mode default)
+		uint64_t fileSize = 64 * 1024;
+		int periodMs = 500;        // Time between the starts of two saves
+		int jitterMs = 0;          // +/- random jitter on the period
+		int streamMs = 400;        // Stream mode: time to write one file
+		int intervalMs = 2000;     // In-process auto-save interval
+		int durationMs = 10000;
+		uint64_t seed = 1;
+		fs::path workDir;
+		bool writeOnly = false;
+		bool analyzeOnly = false;
+		fs::path backupDir;        // --analyze: the game's backup folder
+	};
+
+	struct WriteEvent
+	{
+		uint64_t generation;
+		Clock::time_point completedAt;
+	};
+
+	struct BackupEvent
+	{
+		wstring folderName;
+		Clock::time_point completedAt;
+		bool success;
+	};
+
+	uint64_t Fnv1a(const string& data)
+	{
+		uint64_t hash = 1469598103934665603ULL;
+		for (unsigned char c : data)
+		{
+			hash ^= c;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	string MakePayload(uint64_t generation, int part, uint64_t size)
+	{
+		mt19937_64 rng(generation * 1000003ULL + static_cast<uint64_t>(part));
+		string payload(size, '\0');
+		for (auto& c : payload) c = static_cast<char>('a' + rng() % 26);
+		return payload;
+	}
+
+	/**
+	 * @brief Serialized form of one file of a save: header, payload, trailer with checksum.
+	 */
+	string MakeSaveFile(uint64_t generation, int part, int parts, uint64_t size)
+	{
+		string payload = MakePayload(generation, part, size);
+		ostringstream out;
+		out << "GSBMSIM1 gen=" << generation << " part=" << part << "/" << parts << " size=" << size << "\n";
+		out << payload;
+		out << "\nEND " << generation << " " << hex << Fnv1a(payload) << "\n";
+		return out.str();
+	}
+
+	struct ParsedFile
+	{
+		bool valid = false;
+		uint64_t generation = 0;
+		int part = 0;
+		int parts = 0;
+	};
+
+	ParsedFile ParseSaveFile(const fs::path& file)
+	{
+		ParsedFile parsed;
+		ifstream in(file, ios::binary);
+		string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+		size_t headerEnd = data.find('\n');
+		if (headerEnd == string::npos) return parsed;
+
+		unsigned long long gen = 0, size = 0;
+		int part = 0, parts = 0;
+		if (sscanf(data.substr(0, headerEnd).c_str(), "GSBMSIM1 gen=%llu part=%d/%d size=%llu", &gen, &part, &parts, &size) != 4) return parsed;
+		parsed.generation = gen;
+		parsed.part = part;
+		parsed.parts = parts;
+
+		if (data.size() < headerEnd + 1 + size) return parsed; // Truncated mid-write
+		string payload = data.substr(headerEnd + 1, size);
+		ostringstream trailer;
+		trailer << "\nEND " << gen << " " << hex << Fnv1a(payload) << "\n";
+		parsed.valid = data.compare(headerEnd + 1 + size, string::npos, trailer.str()) == 0;
+		return parsed;
+	}
+
+	// Writes one file according to the mode; stream mode spreads the write over streamMs.
+	void WriteOneFile(const SimOptions& options, const fs::path& file, const string& contents)
+	{
+		if (options.mode == "rename")
+		{
+			fs::path tmp = file;
+			tmp += ".tmp";
+			{
+				ofstream out(tmp, ios::binary | ios::trunc);
+				out.write(contents.data(), static_cast<streamsize>(contents.size()));
+			}
+			fs::rename(tmp, file);
+			return;
+		}
+
+		ofstream out(file, ios::binary | ios::trunc);
+		const size_t chunks = options.mode == "stream" ? 16 : 4;
+		size_t chunkSize = (contents.size() + chunks - 1) / chunks;
+		for (size_t offset = 0; offset < contents.size(); offset += chunkSize)
+		{
+			out.write(contents.data() + offset, static_cast<streamsize>(min(chunkSize, contents.size() - offset)));
+			out.flush(); // Make partial content visible, as a real game's write() calls would
+			if (options.mode == "stream") this_thread::sleep_for(chrono::milliseconds(options.streamMs / static_cast<int>(chunks)));
+		}
+	}
+
+	/**
+	 * @brief Writer loop: one save per period until `stop` is set. Records each completed save.
+	 */
+	void WriterThread(const SimOptions& options, const fs::path& savePath, atomic<bool>& stop, vector<WriteEvent>& events, mutex& eventsMutex)
+	{
+		mt19937 rng(static_cast<unsigned>(options.seed));
+		uniform_int_distribution<int> jitter(-options.jitterMs, options.jitterMs);
+		uint64_t generation = 0;
+		auto next = chrono::steady_clock::now();
+		while (!stop)
+		{
+			++generation;
+			for (int part = 0; part < options.files; ++part)
+			{
+				fs::path file = savePath / ("slot" + to_string(part) + ".sav");
+				WriteOneFile(options, file, MakeSaveFile(generation, part, options.files, options.fileSize));
+			}
+			{
+				lock_guard<mutex> lock(eventsMutex);
+				events.push_back({ generation, Clock::now() });
+			}
+			next += chrono::milliseconds(max(1, options.periodMs + (options.jitterMs > 0 ? jitter(rng) : 0)));
+			while (!stop && chrono::steady_clock::now() < next) this_thread::sleep_for(chrono::milliseconds(5));
+		}
+	}
+
+	struct Report
+	{
+		size_t savesWritten = 0;
+		size_t backups = 0;
+		size_t backupsFailed = 0;
+		size_t tornSnapshots = 0;
+		size_t savesCaptured = 0;
+		vector<double> delaysMs;
+	};
+
+	double Percentile(vector<double> values, double p)
+	{
+		if (values.empty()) return 0.0;
+		sort(values.begin(), values.end());
+		size_t index = static_cast<size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+		return values[min(index, values.size() - 1)];
+	}
+
+	/**
+	 * @brief Classifies every backup and matches captured generations against the write log.
+	 * @param backupTimes Completion time of each backup folder; folders missing from the map
+	 * use the epoch in their name.
+	 */
+	Report Analyze(const SimOptions& options, const fs::path& gameDir, const vector<WriteEvent>& writes, const map<wstring, Clock::time_point>& backupTimes, size_t failedBackups)
+	{
+		Report report;
+		report.savesWritten = writes.size();
+		report.backupsFailed = failedBackups;
+
+		map<uint64_t, Clock::time_point> firstCapture; // generation -> earliest backup containing it
+		for (const auto& backup : ListBackups(gameDir))
+		{
+			report.backups++;
+			wstring name = PathToWide(backup.filename());
+			Clock::time_point when;
+			auto known = backupTimes.find(name);
+			if (known != backupTimes.end()) when = known->second;
+			else when = Clock::from_time_t(static_cast<time_t>(stoll(name.substr(0, name.find(L'-')))));
+
+			bool torn = false;
+			map<int, uint64_t> parts; // part -> generation
+			for (const auto& entry : fs::directory_iterator(backup))
+			{
+				if (!entry.is_regular_file() || entry.path().extension() != ".sav") continue; // Ignore leftover .tmp files
+				ParsedFile parsed = ParseSaveFile(entry.path());
+				if (!parsed.valid) torn = true;
+				parts[parsed.part] = parsed.generation;
+			}
+			uint64_t generation = parts.empty() ? 0 : parts.begin()->second;
+			if (static_cast<int>(parts.size()) != options.files) torn = true;
+			for (const auto& part : parts)
+			{
+				if (part.second != generation) torn = true; // Mixed generations across files
+			}
+
+			if (torn)
+			{
+				report.tornSnapshots++;
+				continue;
+			}
+			auto existing = firstCapture.find(generation);
+			if (existing == firstCapture.end() || when < existing->second) firstCapture[generation] = when;
+		}
+
+		for (const auto& write : writes)
+		{
+			auto capture = firstCapture.find(write.generation);
+			if (capture == firstCapture.end()) continue;
+			report.savesCaptured++;
+			double delay = chrono::duration<double, milli>(capture->second - write.completedAt).count();
+			report.delaysMs.push_back(max(0.0, delay));
+		}
+		return report;
+	}
+
+	void PrintReport(const SimOptions& options, const Report& report)
+	{
+		cout << fixed << setprecision(1);
+		cout << "{\n";
+		cout << "  \"mode\": \"" << options.mode << "\",\n";
+		cout << "  \"files_per_save\": " << options.files << ",\n";
+		cout << "  \"saves_written\": " << report.savesWritten << ",\n";
+		cout << "  \"backups\": " << report.backups << ",\n";
+		cout << "  \"backups_failed\": " << report.backupsFailed << ",\n";
+		cout << "  \"torn_snapshots\": " << report.tornSnapshots << ",\n";
+		cout << "  \"saves_captured\": " << report.savesCaptured << ",\n";
+		cout << "  \"missed_saves\": " << (report.savesWritten - report.savesCaptured) << ",\n";
+		cout << "  \"write_to_backup_ms\": {\"p50\": " << Percentile(report.delaysMs, 0.50)
+			<< ", \"p99\": " << Percentile(report.delaysMs, 0.99)
+			<< ", \"max\": " << (report.delaysMs.empty() ? 0.0 : *max_element(report.delaysMs.begin(), report.delaysMs.end()))
+			<< "}\n";
+		cout << "}\n";
+	}
+
+	fs::path WriteLogPath(const SimOptions& options)
+	{
+		return options.workDir / "simulator_writes.tsv";
+	}
+
+	vector<WriteEvent> ReadWriteLog(const fs::path& file)
+	{
+		vector<WriteEvent> events;
+		ifstream in(file);
+		uint64_t generation = 0;
+		long long epochMs = 0;
+		while (in >> generation >> epochMs)
+		{
+			events.push_back({ generation, Clock::time_point(chrono::milliseconds(epochMs)) });
+		}
+		return events;
+	}
+
+	void WriteWriteLog(const fs::path& file, const vector<WriteEvent>& events)
+	{
+		ofstream out(file, ios::trunc);
+		for (const auto& e : events)
+		{
+			out << e.generation << "\t" << chrono::duration_cast<chrono::milliseconds>(e.completedAt.time_since_epoch()).count() << "\n";
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SimOptions options;
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			string arg = argv[i];
+			auto next = [&]() -> string {
+				if (i + 1 >= argc) throw invalid_argument("missing value for " + arg);
+				return argv[++i];
+				};
+			if (arg == "--mode") options.mode = next();
+			else if (arg == "--files") options.files = stoi(next());
+			else if (arg == "--size") options.fileSize = stoull(next());
+			else if (arg == "--period-ms") options.periodMs = stoi(next());
+			else if (arg == "--rate") options.periodMs = static_cast<int>(60000.0 / stod(next())); // Saves per minute
+			else if (arg == "--jitter-ms") options.jitterMs = stoi(next());
+			else if (arg == "--stream-ms") options.streamMs = stoi(next());
+			else if (arg == "--interval-ms") options.intervalMs = stoi(next());
+			else if (arg == "--duration-ms") options.durationMs = stoi(next());
+			else if (arg == "--seed") options.seed = stoull(next());
+			else if (arg == "--work-dir") options.workDir = next();
+			else if (arg == "--write-only") options.writeOnly = true;
+			else if (arg == "--analyze") options.analyzeOnly = true;
+			else if (arg == "--backup-dir") options.backupDir = next();
+			else throw invalid_argument("unknown option " + arg);
+		}
+		if (options.mode != "rename" && options.mode != "inplace" && options.mode != "burst" && options.mode != "stream")
+			throw invalid_argument("unknown mode " + options.mode);
+	}
+	catch (const exception& e)
+	{
+		cerr << "SaveWriterSimulator: " << e.what() << endl;
+		return 2;
+	}
+	if (options.files <= 0) options.files = options.mode == "burst" ? 8 : 1;
+	// Backup folders are named by epoch second, so two auto-saves must not start in the same second
+	options.intervalMs = max(options.intervalMs, 1000);
+
+	bool ownWorkDir = options.workDir.empty();
+	if (ownWorkDir) options.workDir = fs::temp_directory_path() / ("gsbm_sim_" + to_string(random_device{}()));
+	fs::create_directories(options.workDir);
+	fs::path savePath = options.workDir / "save";
+	fs::create_directories(savePath);
+
+	if (options.analyzeOnly)
+	{
+		if (options.backupDir.empty())
+		{
+			cerr << "SaveWriterSimulator: --analyze needs --backup-dir <game backup folder>" << endl;
+			return 2;
+		}
+		PrintReport(options, Analyze(options, options.backupDir, ReadWriteLog(WriteLogPath(options)), {}, 0));
+		return 0;
+	}
+
+	vector<WriteEvent> writes;
+	mutex writesMutex;
+	atomic<bool> stopWriter{ false };
+
+	vector<BackupEvent> backups;
+	mutex backupsMutex;
+	AutoSaveScheduler scheduler;
+	GameProfile profile{ L"Simulator", PathToWide(savePath), options.intervalMs / 1000, false, L"simulator" };
+	fs::path backupsRoot = options.workDir / "Backups";
+	GlobalSettings settings;
+	settings.localAutoSaveLimit = 0; // Keep everything for the analysis
+
+	if (!options.writeOnly)
+	{
+		scheduler.Start(chrono::milliseconds(options.intervalMs), [&]()
+			{
+				BackupResult result = BackupSaveFolder(profile, settings, backupsRoot, true);
+				lock_guard<mutex> lock(backupsMutex);
+				backups.push_back({ result.folderName, Clock::now(), result.localSuccess });
+			});
+	}
+
+	thread writer(WriterThread, cref(options), cref(savePath), ref(stopWriter), ref(writes), ref(writesMutex));
+	this_thread::sleep_for(chrono::milliseconds(options.durationMs));
+	stopWriter = true;
+	writer.join();
+
+	if (options.writeOnly)
+	{
+		WriteWriteLog(WriteLogPath(options), writes);
+		cerr << "Wrote " << writes.size() << " saves; log: " << WriteLogPath(options).string() << endl;
+		return 0;
+	}
+
+	// One more interval so the final save has a chance to be captured
+	this_thread::sleep_for(chrono::milliseconds(options.intervalMs + 200));
+	scheduler.Stop();
+
+	map<wstring, Clock::time_point> backupTimes;
+	size_t failed = 0;
+	for (const auto& b : backups)
+	{
+		if (b.success) backupTimes[b.folderName] = b.completedAt;
+		else failed++;
+	}
+	PrintReport(options, Analyze(options, GetLocalGameBackupDir(backupsRoot, profile), writes, backupTimes, failed));
+
+	if (ownWorkDir) fs::remove_all(options.workDir);
+	return 0;
+}
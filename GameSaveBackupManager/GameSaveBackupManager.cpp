@@ -30,6 +30,28 @@
 #include <sstream>   // For string splitting
 #include <io.h>
 #include <fcntl.h>
+#include <functional>
+
+#include "AdaptiveAutoSave.h"
+#include "AutoSaveScheduler.h"
+#include "BackupIndex.h"
+#include "BackupOperations.h"
+#include "BatchBackup.h"
+#include "ChunkStore.h"
+#include "CloudEncryption.h"
+#include "Config.h"
+#include "ContentStore.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "PackStore.h"
+#include "ProcessWatcher.h"
+#include "Progress.h"
+#include "SearchIndex.h"
+#include "StorageBackend.h"
+#include "SystemLoad.h"
+#include "Trace.h"
 
 #pragma comment(lib, "Version.lib")
 #pragma comment(lib, "Shell32.lib") // For SHGetKnownFolderPath
@@ -39,48 +61,34 @@ using namespace std;
 using namespace std::chrono_literals;
 
 // --- Global Settings ---
-wstring g_GoogleDrivePath = L"";
-int g_LocalAutoSaveLimit = 20;
-int g_LocalManualSaveLimit = 0; // 0 means keep all
-int g_CloudAutoSaveLimit = 10;
-int g_CloudManualSaveLimit = 25;
-// 0 means keep all
-bool g_GDriveSetupComplete = false; // Tracks if initial GDrive setup prompt was shown
-bool g_FirstGameAdded = false;
-// Tracks if the first game has been added
-
-// Struct to hold all information for a single game profile
-struct GameProfile
-{
-	wstring name;
-	wstring savePath;
-	int autoSaveInterval; // Stored in seconds
-	bool cloudSaveEnabled;
-};
+// Cloud path, retention limits and setup flags (see GlobalSettings in Config.h)
+GlobalSettings g_settings;
 
 // --- Global State ---
 vector<GameProfile> g_profiles;
+ProfileIndex g_profileIndex; // Profile ID -> position in g_profiles, rebuilt by LoadProfiles()
 GameProfile selectedGame;
 // Currently selected game for monitoring/editing
-atomic<bool> g_keepAutoSaving(false); // Flag to control the auto-save thread
-thread g_autoSaveThread;
+AutoSaveScheduler g_autoSaveScheduler; // Runs auto-save backups in the background
+AutoSaveScheduler g_metricsExporter; // Periodically writes Metrics\metrics.json and metrics.prom
+GameProcessWatcher g_processWatcher; // Follows the monitored game's executable, if its profile names one
 // --- Function Prototypes ---
 void ClearScreen();
 wstring GetExePath();
 wstring GetExeFilename();
-wstring s2ws(const string& str);
-string ws2s(const wstring& wstr);
-bool DirectoryExists(const char* path);
+fs::path GetBackupsRoot(); // The local "Backups" folder next to the executable
+bool IsCloudConfigured(); // A cloud backend is selected and has its path/endpoint set
+void WriteMetricsSnapshot(); // Exports engine metrics for local scrapers
+void StopTracing(); // Writes Logs\trace-<epoch>.json if tracing was enabled in Config.ini
+void LogOperation(LogLevel level, const GameProfile& profile, const wchar_t* operation, const wstring& message); // Queues a line for the console and log file
 bool CheckExecutionDirectory(); // Checks if the program is in a dedicated folder
 void CreateRequiredDirectories();
-// Creates Config and Backups folders
-string GetCurrentDateTime();
+// Creates Config, Backups, Metrics and Logs folders
 string GetFileModTime(const string& path);
 void RegisterHotKeys();
 void UnRegisterHotKeys();
 void onSigBreakSignal(int s);
 // Handles Ctrl+C / Console close
-bool IsValidFilename(const wstring& name); // Checks for invalid characters in game names
 
 // --- Config Functions ---
 wstring GetConfigIniPath();
@@ -93,13 +101,13 @@ void SaveGlobalConfig();
 void LoadProfiles();
 // Loads all game profiles from GameProfiles.ini
 void SaveProfile(const GameProfile& profile); // Saves a single profile to GameProfiles.ini
-void DeleteProfileIniEntry(const wstring& profileName);
+void DeleteProfileIniEntry(const wstring& profileId);
 // Deletes only the INI section for a profile
 void DeleteGame(GameProfile& profile); // Handles deleting profile and optionally backups
 void CreateNewGame();
 // Guides user through adding a new game
-GameProfile* GetProfileByName(const wstring& name);
-// Finds a profile in memory by name
+GameProfile* GetProfileById(const wstring& id);
+// Finds a profile in memory by ID (through g_profileIndex, a ProfileIndex)
 
 // --- Menu Functions ---
 void ShowHelpScreen();
@@ -117,6 +125,8 @@ void ShowSetupInstructions();
 void ShowOtherCloudInstructions(); // Shows steps for manually setting other cloud paths
 void ShowRestoreMenu(); // Menu for selecting restore type (Local/Cloud)
 void OpenSavePathFolder(const GameProfile& profile); // Opens game save path folder in Explorer
+void ShowLatencyStats(); // Prints p50/p99/max of hotkey and auto-save latencies (Hotkey: Ctrl+T)
+bool ShowLatencySnapshot(); // The same from the last exported metrics snapshot (--latency-stats)
 
 // --- Auto-Detect Functions ---
 void DetectAndSetGoogleDrivePath();
@@ -127,20 +137,34 @@ bool ValidateGoogleDrivePath(const wstring& path);
 
 // --- Backup & Restore Functions ---
 void BackupSaveFolder(const GameProfile& profile, bool autosave = false);
-// Performs backup and purge
-void PurgeBackups(const wstring& backupDir, const wstring& prefix, int autoLimit, int manualLimit, const wstring& locationName, std::vector<wstring>& logCollector);
-// Deletes old backups
+// Performs backup and purge (see BackupOperations.h), then logs the result
+bool BackupAllGames(); // Backs up every game at once (home menu and --backup-all)
+void RunWithProgress(const function<void(OperationProgress&)>& operation);
+// Shows a live progress line for a long copy; any key cancels it
+wstring ReadHiddenLine();
+// Reads a line without showing it (passphrases)
 void RestoreLastBackup(const GameProfile& profile); // Restores latest MANUAL backup (Hotkey: Ctrl+R)
 void RestoreFromCloud();
 // Menu to select and restore a backup from the cloud folder
 void RestoreFromLocal();
 // Menu to select and restore a backup from the local folder
+bool ChooseRestoreScope(const function<BackupManifest()>& loadIndex, bool& selectedOnly, BackupManifest& selection);
+// Asks whether to restore a whole backup or only chosen files
+void CompareBackups();
+// Lists files added, removed and modified between two local backups, or a backup and the save folder
+void FindFileInBackups();
+// Lists every version of a file across local backups (from the search index) and restores one
 void OpenBackupFolder(const GameProfile& profile);
 // Opens local backup folder in Explorer
 void OpenCloudBackupFolder(const GameProfile& profile); // Opens cloud backup folder in Explorer
 void CreateAutoSaveThread(const GameProfile& profile);
 // Starts the background auto-save thread
-void AutoSaveThreadFunction(GameProfile profile); // The function running in the auto-save thread (passed by value)
+void CreateAdaptiveAutoSaveThread(const GameProfile& profile);
+// Auto-save thread that backs up when the save folder changes (adaptive mode)
+void StartAutoSaves(const GameProfile& profile);
+// Auto-saves for monitoring: right away, or only while the game's executable runs
+chrono::milliseconds DeferAutoSave(const GameProfile& profile, LoadGate& gate);
+// 0 when a due auto-save may start, else how long it waits for the system load to drop
 
 // --- Utility Functions ---
 
@@ -150,19 +174,11 @@ struct LANGANDCODEPAGE {
 	WORD wCodePage;
 };
 
-// Checks if a wide string ends with a specific suffix (case-sensitive)
-bool endsWith(const std::wstring& str, const std::wstring& suffix) {
-	if (str.length() < suffix.length()) {
-		return false;
-	}
-	return str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
-}
-
 // =========================================================================================
 //                              MAIN FUNCTION
 // =========================================================================================
 
-int main()
+int main(int argc, char* argv[])
 {
 	_setmode(_fileno(stdout), _O_U16TEXT);
 	SetConsoleTitle(L"Game Save Backup Manager");
@@ -192,14 +208,49 @@ int main()
 		return 1;
 	}
 
+	// Operation logs go through the async logger (console + Logs\GameSaveBackupManager.log)
+	LoggerOptions logOptions;
+	logOptions.console = &wcout;
+	logOptions.logFile = fs::path(GetExePath()) / L"Logs" / L"GameSaveBackupManager.log";
+	GetLogger().Start(logOptions);
+
+	// Command line: "--latency-stats" prints the latencies a running instance last exported and
+	// exits. Checked before this process starts exporting, which would replace them with its own.
+	if (argc > 1 && string(argv[1]) == "--latency-stats")
+	{
+		return ShowLatencySnapshot() ? 0 : 1;
+	}
+
+	// Export metrics in the background; a final snapshot is written on exit
+	g_metricsExporter.Start(15s, WriteMetricsSnapshot);
+
 	// Load settings and setup progress flags
 	LoadGlobalConfig();
 	LoadProfiles();
 
+	// Opt-in Chrome trace of backup stages ([Diagnostics] TraceEnabled=1 in Config.ini)
+	if (g_settings.traceEnabled)
+	{
+		GetTracer().Start(static_cast<uint64_t>(max(0, g_settings.traceFileThresholdKb)) * 1024);
+		GetTracer().SetThreadName("main");
+	}
+
+	// Command line: "--backup-all" backs up every game and exits (e.g. before a system update)
+	if (argc > 1 && string(argv[1]) == "--backup-all")
+	{
+		bool allBackedUp = BackupAllGames();
+		WaitForContentSweeps(); // Shared-storage sweeps the backups queued
+		g_metricsExporter.Stop();
+		WriteMetricsSnapshot();
+		StopTracing();
+		GetLogger().Stop(); // Writes any queued lines
+		return allBackedUp ? 0 : 1;
+	}
+
 	// --- Handle first-run steps based on flags ---
 
 	// Step 1: Initial Google Drive prompt (if not done before)
-	if (!g_GDriveSetupComplete)
+	if (!g_settings.gdriveSetupComplete)
 	{
 		ClearScreen();
 		wcout << L"   ============================================" << endl;
@@ -223,12 +274,12 @@ int main()
 			// Run the setup menu in "first run" mode
 		}
 		// Mark GDrive setup prompt as complete regardless of choice
-		g_GDriveSetupComplete = true;
+		g_settings.gdriveSetupComplete = true;
 		SaveGlobalConfig(); // Save the flag status
 	}
 
 	// Step 2: Prompt to add the first game (if not done before)
-	if (!g_FirstGameAdded)
+	if (!g_settings.firstGameAdded)
 	{
 		wcout << endl << L"Let's add your first game."
 			<< endl;
@@ -238,7 +289,7 @@ int main()
 		// Reload profiles immediately after adding
 		// Mark first game added as complete *only if a game was actually added*
 		if (!g_profiles.empty()) {
-			g_FirstGameAdded = true;
+			g_settings.firstGameAdded = true;
 			SaveGlobalConfig(); // Save the flag status
 		}
 	}
@@ -259,8 +310,8 @@ int main()
 				break;
 			}
 			// Ensure flag is set if it somehow got missed (e.g., error during first add)
-			if (!g_FirstGameAdded) {
-				g_FirstGameAdded = true;
+			if (!g_settings.firstGameAdded) {
+				g_settings.firstGameAdded = true;
 				SaveGlobalConfig();
 			}
 		}
@@ -297,6 +348,14 @@ int main()
 			continue;
 			// Go back to the main menu
 		}
+		else if (choice == -6) // User chose Back Up All Games
+		{
+			ClearScreen();
+			BackupAllGames();
+			GetLogger().Flush(); // Every line shown before the pause
+			system("pause");
+			continue;
+		}
 
 		// --- A specific game was selected ---
 		selectedGame = g_profiles[choice];
@@ -322,12 +381,11 @@ int main()
 		}
 
 		// Ensure the specific backup directory for this game exists
-		wstring backupPath = GetExePath() + L"\\Backups\\" + selectedGame.name;
-		if (!DirectoryExists(ws2s(backupPath).c_str()))
-			_wmkdir(backupPath.c_str()); // Create if missing
+		error_code mkdirError;
+		fs::create_directories(GetLocalGameBackupDir(GetBackupsRoot(), selectedGame), mkdirError); // Create if missing
 
-		// Start the background auto-save thread
-		CreateAutoSaveThread(selectedGame);
+		// Start the background auto-save thread (or the game process watcher)
+		StartAutoSaves(selectedGame);
 		// Show the monitoring interface
 		DisplayMainInterface(selectedGame);
 		// Register signal handler for console close events
@@ -340,11 +398,19 @@ int main()
 		{
 			if (msg.message == WM_HOTKEY) // Process only hotkey messages
 			{
-				if (msg.wParam == 1) BackupSaveFolder(selectedGame, false);
-				// CTRL+B (Manual Backup)
+				// When the hotkey was received; msg.time is the tick count at which it was posted
+				auto received = chrono::steady_clock::now() - chrono::milliseconds(GetTickCount() - msg.time);
+				if (msg.wParam == 1) // CTRL+B (Manual Backup)
+				{
+					BackupSaveFolder(selectedGame, false);
+					GetEngineMetrics().Latency(LatencyMetric::ManualBackup).Record(chrono::steady_clock::now() - received);
+				}
 				if (msg.wParam == 2) OpenBackupFolder(selectedGame); // CTRL+O (Open Local Backups)
-				if (msg.wParam == 3) RestoreLastBackup(selectedGame);
-				// CTRL+R (Restore Last Manual)
+				if (msg.wParam == 3) // CTRL+R (Restore Last Manual)
+				{
+					RestoreLastBackup(selectedGame);
+					GetEngineMetrics().Latency(LatencyMetric::QuickRestore).Record(chrono::steady_clock::now() - received);
+				}
 				if (msg.wParam == 4) // CTRL+I (Show Help)
 				{
 					ShowHelpScreen();
@@ -353,10 +419,8 @@ int main()
 				}
 				if (msg.wParam == 5) // CTRL+M (Back to Main Menu)
 				{
-					g_keepAutoSaving = false;
-					// Signal auto-save thread to stop
-					if (g_autoSaveThread.joinable())
-						g_autoSaveThread.join(); // Wait for thread to finish
+					g_processWatcher.Stop(); // First, so a game start cannot restart auto-saves
+					g_autoSaveScheduler.Stop(); // Stop the auto-save thread and wait for it
 					UnRegisterHotKeys(); // Deactivate hotkeys
 					PostMessage(NULL, WM_NULL, 0, 0);
 					// Send a null message to break GetMessage loop
@@ -374,6 +438,12 @@ int main()
 					OpenSavePathFolder(selectedGame);
 					// No need to redraw screen, just opens Explorer
 				}
+				if (msg.wParam == 9) ShowLatencyStats(); // CTRL+T (Latency Stats)
+				if (msg.wParam == 10) // CTRL+SHIFT+T (Reset Latency Stats)
+				{
+					GetEngineMetrics().ResetLatencies();
+					LogOperation(LogLevel::Info, selectedGame, L"latency", L"[" + s2ws(GetCurrentDateTime()) + L"] Latency stats reset.");
+				}
 			}
 		}
 		// After breaking the message loop (via Ctrl+M), the outer `while(true)` continues, showing the main menu again.
@@ -381,6 +451,11 @@ int main()
 
 	// Cleanup before exiting the program
 	UnRegisterHotKeys(); // Ensure hotkeys are unregistered if exiting via 'X'
+	WaitForContentSweeps(); // Shared-storage sweeps the backups queued
+	g_metricsExporter.Stop();
+	WriteMetricsSnapshot();
+	StopTracing();
+	GetLogger().Stop(); // Writes any queued lines
 	return 0;
 	// Normal exit
 }
@@ -395,6 +470,7 @@ int main()
  */
 void ClearScreen()
 {
+	GetLogger().Flush(); // Let queued log lines print before the screen is cleared
 	system("cls"); // Simple way to clear console on Windows
 }
 
@@ -426,14 +502,61 @@ void DisplayMainInterface(const GameProfile& profile)
 	wcout << L"    CTRL + O:   Open Local Backup Folder" << endl;
 	wcout << L"    CTRL + G:   Open Cloud Backup Folder" << endl;
 	wcout << L"    CTRL + P:   Open Game Save Path Folder" << endl << endl;
+	wcout << L"    CTRL + T:   Show Latency Stats (CTRL + SHIFT + T: Reset)" << endl;
 	wcout << L"    CTRL + I:   Show Help" << endl;
 	wcout << L"    CTRL + M:   Back to Main Menu" << endl << endl;
-	wcout << L"   Monitoring for auto-save (" << (profile.autoSaveInterval / 60) << " min)..." << endl;
+	ShowLatencyStats();
+	if (profile.adaptiveAutoSave)
+		wcout << L"   Monitoring for auto-save (adaptive, " << max(1, profile.autoSaveFloor / 60) << L"-" << (profile.autoSaveInterval / 60) << " min)..." << endl;
+	else
+		wcout << L"   Monitoring for auto-save (" << (profile.autoSaveInterval / 60) << " min)..." << endl;
 	// Display interval in minutes
+	if (!profile.gameExecutable.empty())
+		wcout << L"   Auto-saves while " << profile.gameExecutable << L" runs, and a backup when it exits." << endl;
 	wcout << L"   ----------------------" << endl;
 	// Backup messages will appear below this line
 }
 
+/**
+ * @brief Prints p50/p99/max latency for CTRL+B, CTRL+R and auto-save start lag.
+ */
+void ShowLatencyStats()
+{
+	GetLogger().Flush(); // Keep pending operation lines above the stats
+	const EngineMetrics& metrics = GetEngineMetrics();
+	wcout << L"   --- Latency (since start or last reset) ---" << endl;
+	wcout << L"    CTRL + B:   " << metrics.Latency(LatencyMetric::ManualBackup).Summary() << endl;
+	wcout << L"    CTRL + R:   " << metrics.Latency(LatencyMetric::QuickRestore).Summary() << endl;
+	wcout << L"    Auto-save:  " << metrics.Latency(LatencyMetric::AutoSaveLag).Summary() << L" late" << endl << endl;
+}
+
+/**
+ * @brief Prints the latencies in Metrics\metrics.json: those of the running instance as of its
+ * last export (every 15 seconds), or of the last session if none runs.
+ * @return False if there is no snapshot to read.
+ */
+bool ShowLatencySnapshot()
+{
+	LatencySnapshots latencies;
+	int64_t timestamp = 0;
+	if (!ReadLatencySnapshot(fs::path(GetExePath()) / L"Metrics" / L"metrics.json", latencies, timestamp))
+	{
+		wcout << L"No latency stats yet: they are exported while the program runs." << endl;
+		return false;
+	}
+	auto summary = [&](LatencyMetric metric)
+		{
+			const LatencySnapshot& latency = latencies[static_cast<size_t>(metric)];
+			return LatencyHistogram::FormatSummary(latency.count, latency.p50Ms, latency.p99Ms, latency.maxMs);
+		};
+	tm exported = LocalTime(static_cast<time_t>(timestamp));
+	wcout << L"   --- Latency (exported " << put_time(&exported, L"%Y-%m-%d %H:%M:%S") << L") ---" << endl;
+	wcout << L"    CTRL + B:   " << summary(LatencyMetric::ManualBackup) << endl;
+	wcout << L"    CTRL + R:   " << summary(LatencyMetric::QuickRestore) << endl;
+	wcout << L"    Auto-save:  " << summary(LatencyMetric::AutoSaveLag) << L" late" << endl;
+	return true;
+}
+
 /**
  * @brief Displays the help screen with instructions and hotkey list.
  */
@@ -465,6 +588,9 @@ void ShowHelpScreen()
 		<< endl << endl;
 	wcout << L"    CTRL + P:   Opens the *game's save path* folder in" << endl; // <-- NEW
 	wcout << L"                Windows Explorer." << endl << endl;            // <-- NEW
+	wcout << L"    CTRL + T:   Shows how long CTRL+B / CTRL+R took to complete" << endl;
+	wcout << L"                and how late auto-saves started (p50/p99/max)." << endl;
+	wcout << L"                CTRL + SHIFT + T resets these stats." << endl << endl;
 	wcout << L"    CTRL + I:   Shows this Help screen again." << endl << endl;    // <-- Minor wording update
 	wcout << L"    CTRL + M:   Stops monitoring and returns to the Home Menu."
 		<< endl << endl;
@@ -664,8 +790,8 @@ int SelectGameMenu()
 		wcout << L"   ===========================================" << endl;
 		wcout << L"                   HOME MENU" << endl;
 		wcout << L"   ===========================================" << endl << endl;
-		// Show warning if cloud path isn't configured
-		if (g_GoogleDrivePath.empty())
+		// Show warning if cloud storage isn't configured
+		if (!IsCloudConfigured())
 		{
 			wcout << L"   [WARNING: Cloud path not set. Cloud sync is disabled.]" << endl;
 			wcout << L"   [Go to 'Backup & Storage Settings' to set it up.]" << endl << endl;
@@ -679,11 +805,12 @@ int SelectGameMenu()
 		}
 		wcout << L"   -------------------------------------------" << endl << endl;
 		wcout << L"    C. Add New Game" << endl;
+		wcout << L"    A. Back Up All Games" << endl;
 		wcout << L"    S. Backup & Storage Settings" << endl;
 		wcout << L"    H. Help and Instructions" << endl;
 		wcout << L"    I. Software Information" << endl;
 		wcout << L"    X. Exit" << endl << endl;
-		wcout << L"   Choose an option (e.g., 1, C, S, H, I, X): ";
+		wcout << L"   Choose an option (e.g., 1, C, A, S, H, I, X): ";
 
 		string choice_str;
 		getline(cin, choice_str);
@@ -695,6 +822,7 @@ int SelectGameMenu()
 		if (choice_str == "c" || choice_str == "C") return -3;
 		if (choice_str == "h" || choice_str == "H") return -4;
 		if (choice_str == "i" || choice_str == "I") return -5;
+		if (choice_str == "a" || choice_str == "A") return -6;
 		// Try to convert input to a number for game selection
 		try
 		{
@@ -734,17 +862,10 @@ int SelectGameMenu()
 						// Store current game details
 						EditGameMenu(); // Open edit menu
 						LoadProfiles(); // Reload profiles immediately after edit
-						// Re-find the profile by name in case it was renamed or deleted
-						bool found = false;
-						for (int k = 0; k < g_profiles.size(); ++k) {
-							if (g_profiles[k].name == selectedGame.name) {
-								profileIndex = k;
-								// Update index if found
-								found = true;
-								break;
-							}
-						}
-						if (!found) break;
+						// Re-find the profile by ID in case the list changed
+						auto found = g_profileIndex.find(selectedGame.id);
+						if (found == g_profileIndex.end()) break;
+						profileIndex = static_cast<int>(found->second);
 						// If profile not found (e.g., deleted), exit sub-menu
 						// Otherwise, loop back to re-display sub-menu with potentially updated index
 					}
@@ -801,13 +922,19 @@ void EditGameMenu()
 		wcout << L"    2. Edit Game Save Path" << endl;
 		wcout << L"    3. Edit Auto-Save Interval (minutes)" << endl;
 		wcout << L"    4. Enable/Disable Cloud Backup" << endl;
-		wcout << L"    5. Back to Game Menu" << endl << endl;
+		wcout << L"    5. Cloud Backup Encryption" << endl;
+		wcout << L"    6. Game Executable (back up on exit)" << endl;
+		wcout << L"    7. Back to Game Menu" << endl << endl;
 		// Go back to the previous menu (sub-menu)
 
 		wcout << L"   Current Name: " << selectedGame.name << endl;
 		wcout << L"   Current Path: " << selectedGame.savePath << endl;
-		wcout << L"   Current Interval: " << (selectedGame.autoSaveInterval / 60) << " minutes" << endl;
+		wcout << L"   Current Interval: " << (selectedGame.autoSaveInterval / 60) << " minutes";
+		if (selectedGame.adaptiveAutoSave) wcout << L" at most (adaptive, at least " << max(1, selectedGame.autoSaveFloor / 60) << L" min apart)";
+		wcout << endl;
 		wcout << L"   Cloud Backup: " << (selectedGame.cloudSaveEnabled ? L"ENABLED" : L"DISABLED") << endl;
+		wcout << L"   Encryption: " << (!selectedGame.encryptionKeyFile.empty() ? L"ON (key file)" : !selectedGame.encryptionPassphrase.empty() ? L"ON (passphrase)" : !selectedGame.unreadablePassphrase.empty() ? L"ON (passphrase unreadable on this PC: set it again)" : L"OFF") << endl;
+		wcout << L"   Game Executable: " << (selectedGame.gameExecutable.empty() ? L"(not set)" : selectedGame.gameExecutable) << endl;
 		wcout << L"   -------------------------------------------" << endl;
 		wcout << L"   Choose an option: ";
 
@@ -817,7 +944,6 @@ void EditGameMenu()
 		if (choice_str == "1") // Edit Game Name
 		{
 			wcout << L"Enter new name (e.g., Elden Ring or leave blank to cancel the process): ";
-			wstring oldName = selectedGame.name; // Store old name for INI deletion
 			wstring newName;
 
 			while (true) // Loop for name validation
@@ -832,11 +958,9 @@ void EditGameMenu()
 
 				if (IsValidFilename(newName)) // Check for invalid characters
 				{
-					DeleteProfileIniEntry(oldName);
-					// Delete the old entry from INI
 					selectedGame.name = newName;    // Update the name in the current struct
 					SaveProfile(selectedGame);
-					// Save the profile with the new name
+					// Only the Name key changes; backups stay in the folder named after the profile ID
 					wcout << L"Name saved." << endl;
 					system("pause");
 					break;
@@ -872,6 +996,16 @@ void EditGameMenu()
 				if (intervalMinutes > 0) // Validate positive number
 				{
 					selectedGame.autoSaveInterval = intervalMinutes * 60; // Convert to seconds
+					// Adaptive mode: the interval becomes the longest wait between backups of a changed save
+					wcout << L"Back up soon after the game saves instead (adaptive)? Enter the shortest time" << endl;
+					wcout << L"between backups in MINUTES, or 0 to back up every interval: ";
+					string floor_str;
+					getline(cin, floor_str);
+					int floorMinutes = 0;
+					try { floorMinutes = stoi(floor_str); }
+					catch (...) {} // Blank or invalid: fixed interval
+					selectedGame.adaptiveAutoSave = floorMinutes > 0;
+					if (floorMinutes > 0) selectedGame.autoSaveFloor = min(floorMinutes, intervalMinutes) * 60;
 					SaveProfile(selectedGame); // Save changes 
 					// to INI
 					wcout << L"Interval saved." << endl;
@@ -889,7 +1023,7 @@ void EditGameMenu()
 		else if (choice_str == "4") // Toggle Cloud Backup
 		{
 			// Prevent enabling if cloud path isn't set globally
-			if (g_GoogleDrivePath.empty() && !selectedGame.cloudSaveEnabled) // Only show warning if trying to ENABLE without path
+			if (!IsCloudConfigured() && !selectedGame.cloudSaveEnabled) // Only show warning if trying to ENABLE without path
 			{
 				wcout << endl << L"   [WARNING] Global Cloud Sync path not set."
 					<< endl;
@@ -908,7 +1042,112 @@ void EditGameMenu()
 				system("pause");
 			}
 		}
-		else if (choice_str == "5") // Back to Game Menu
+		else if (choice_str == "5") // Cloud Backup Encryption
+		{
+			ClearScreen();
+			wcout << L"   --- Cloud Backup Encryption ---" << endl << endl;
+			wcout << L"   Cloud backups of this game are encrypted (AES-256-GCM) before they leave" << endl;
+			wcout << L"   this PC. Restoring them needs the same passphrase or key file, so keep a copy." << endl;
+			wcout << L"   The secret cannot be changed later without deleting this game's cloud backups." << endl << endl;
+			wcout << L"    1. Set Passphrase" << endl;
+			wcout << L"    2. Use Key File" << endl;
+			wcout << L"    3. Turn Off (new cloud backups are not encrypted)" << endl;
+			wcout << L"    4. Cancel" << endl << endl;
+			wcout << L"   Choose an option: ";
+
+			string encryptionChoice;
+			getline(cin, encryptionChoice);
+			if (encryptionChoice == "1")
+			{
+				// Typed twice: a typo here would lock away every encrypted backup
+				wcout << L"Enter passphrase (leave blank to cancel): ";
+				wstring passphrase = ReadHiddenLine();
+				wstring confirmation;
+				if (!passphrase.empty())
+				{
+					wcout << L"Enter it again to confirm: ";
+					confirmation = ReadHiddenLine();
+				}
+				if (!passphrase.empty() && passphrase != confirmation)
+				{
+					wcout << L"   The passphrases do not match. Nothing was changed." << endl;
+				}
+				else if (!IsAcceptedPassphrase(passphrase))
+				{
+					wcout << L"   A passphrase cannot start with \"dpapi:\". Nothing was changed." << endl;
+				}
+				else if (!passphrase.empty())
+				{
+					GameProfile previous = selectedGame;
+					selectedGame.encryptionPassphrase = passphrase;
+					selectedGame.encryptionKeyFile.clear();
+					selectedGame.unreadablePassphrase.clear();
+					try {
+						SaveProfile(selectedGame); // Stored sealed for this Windows user (DPAPI)
+						wcout << L"Encryption enabled." << endl;
+					}
+					catch (const runtime_error& e) {
+						selectedGame = previous;
+						wcout << L"   Could not store the passphrase: " << s2ws(e.what()) << L". Use a key file instead." << endl;
+					}
+				}
+				else {
+					wcout << L"   Edit cancelled." << endl;
+				}
+			}
+			else if (encryptionChoice == "2")
+			{
+				wcout << L"Enter the full path of the key file (leave blank to cancel): ";
+				wstring keyFile;
+				getline(wcin, keyFile);
+				error_code ec;
+				if (keyFile.empty()) {
+					wcout << L"   Edit cancelled." << endl;
+				}
+				else if (!fs::is_regular_file(ToPath(keyFile), ec) || fs::file_size(ToPath(keyFile), ec) == 0) {
+					wcout << L"Key file not found or empty." << endl;
+				}
+				else
+				{
+					selectedGame.encryptionKeyFile = keyFile;
+					selectedGame.encryptionPassphrase.clear();
+					selectedGame.unreadablePassphrase.clear();
+					SaveProfile(selectedGame);
+					wcout << L"Encryption enabled." << endl;
+				}
+			}
+			else if (encryptionChoice == "3")
+			{
+				selectedGame.encryptionPassphrase.clear();
+				selectedGame.encryptionKeyFile.clear();
+				selectedGame.unreadablePassphrase.clear();
+				SaveProfile(selectedGame);
+				wcout << L"Encryption turned off. Encrypted backups still need the old secret to restore." << endl;
+			}
+			system("pause");
+		}
+		else if (choice_str == "6") // Game Executable
+		{
+			// Only the file name is matched, so a reinstall elsewhere keeps working
+			wcout << L"Enter the game's executable file name (e.g., eldenring.exe)," << endl;
+			wcout << L"or '-' to back up on schedule whether the game runs or not: ";
+			wstring exeName;
+			getline(wcin, exeName);
+			if (exeName == L"-")
+			{
+				selectedGame.gameExecutable.clear();
+				SaveProfile(selectedGame);
+				wcout << L"Auto-saves no longer follow the game." << endl;
+			}
+			else if (!exeName.empty())
+			{
+				selectedGame.gameExecutable = PathToWide(ToPath(exeName).filename());
+				SaveProfile(selectedGame);
+				wcout << L"Auto-saves run while " << selectedGame.gameExecutable << L" runs, with a backup when it exits." << endl;
+			}
+			system("pause");
+		}
+		else if (choice_str == "7") // Back to Game Menu
 		{
 			return;
 			// Exit the edit menu function
@@ -975,23 +1214,23 @@ void BackupAndStorageSettings()
 		wcout << L"           BACKUP & STORAGE SETTINGS" << endl;
 		wcout << L"   ===========================================" << endl << endl;
 		wcout << L"   --- Local Storage Settings ---" << endl;
-		wcout << L"    1. Set Local Auto-Save Limit   (Current: " << g_LocalAutoSaveLimit << L")" << endl;
-		wcout << L"    2. Set Local Manual-Save Limit (Current: " << (g_LocalManualSaveLimit == 0 ? L"Keep All" : to_wstring(g_LocalManualSaveLimit)) << L")" << endl << endl;
+		wcout << L"    1. Set Local Auto-Save Limit   (Current: " << g_settings.localAutoSaveLimit << L")" << endl;
+		wcout << L"    2. Set Local Manual-Save Limit (Current: " << (g_settings.localManualSaveLimit == 0 ? L"Keep All" : to_wstring(g_settings.localManualSaveLimit)) << L")" << endl << endl;
 		wcout << L"   --- Cloud Storage Settings ---" << endl;
 		wcout << L"    3. Go to Cloud Sync Setup..." << endl;
-		wcout << L"    4. Set Cloud Auto-Save Limit   (Current: " << g_CloudAutoSaveLimit << L")" << endl;
-		wcout << L"    5. Set Cloud Manual-Save Limit (Current: " << (g_CloudManualSaveLimit == 0 ? L"Keep All" : to_wstring(g_CloudManualSaveLimit)) << L")" << endl << endl;
+		wcout << L"    4. Set Cloud Auto-Save Limit   (Current: " << g_settings.cloudAutoSaveLimit << L")" << endl;
+		wcout << L"    5. Set Cloud Manual-Save Limit (Current: " << (g_settings.cloudManualSaveLimit == 0 ? L"Keep All" : to_wstring(g_settings.cloudManualSaveLimit)) << L")" << endl << endl;
 		wcout << L"   -------------------------------------------" << endl;
 		wcout << L"    6. Back to Home Menu" << endl << endl;
 		wcout << L"   Choose an option: ";
 
 		string choice;
 		getline(cin, choice);
-		if (choice == "1") SetLimitSetting(L"Local Auto-Save Limit", autoSaveReasoning, g_LocalAutoSaveLimit);
-		else if (choice == "2") SetLimitSetting(L"Local Manual-Save Limit", manualSaveReasoning, g_LocalManualSaveLimit);
+		if (choice == "1") SetLimitSetting(L"Local Auto-Save Limit", autoSaveReasoning, g_settings.localAutoSaveLimit);
+		else if (choice == "2") SetLimitSetting(L"Local Manual-Save Limit", manualSaveReasoning, g_settings.localManualSaveLimit);
 		else if (choice == "3") SetupCloudMenu(false); // Open cloud setup (not in first run mode)
-		else if (choice == "4") SetLimitSetting(L"Cloud Auto-Save Limit", autoSaveReasoning, g_CloudAutoSaveLimit);
-		else if (choice == "5") SetLimitSetting(L"Cloud Manual-Save Limit", manualSaveReasoning, g_CloudManualSaveLimit);
+		else if (choice == "4") SetLimitSetting(L"Cloud Auto-Save Limit", autoSaveReasoning, g_settings.cloudAutoSaveLimit);
+		else if (choice == "5") SetLimitSetting(L"Cloud Manual-Save Limit", manualSaveReasoning, g_settings.cloudManualSaveLimit);
 		else if (choice == "6") return;
 		// Exit settings menu
 		// Invalid input loops back
@@ -1019,7 +1258,7 @@ void SetupCloudMenu(bool isFirstRun)
 		wcout << L"         3. Manually paste your desired path when prompted."
 			<< endl << endl;
 		wcout << L"   -------------------------------------------" << endl;
-		wcout << L"   Current Cloud Path: " << (g_GoogleDrivePath.empty() ? L"[Not Set]" : g_GoogleDrivePath) << endl;
+		wcout << L"   Current Cloud Path: " << (g_settings.googleDrivePath.empty() ? L"[Not Set]" : g_settings.googleDrivePath) << endl;
 		wcout << L"   -------------------------------------------" << endl << endl;
 		wcout << L"    1. Set / Change Cloud Sync Path" << endl;
 		wcout << L"    2. View Google Drive Setup Instructions" << endl;
@@ -1045,7 +1284,7 @@ void SetupCloudMenu(bool isFirstRun)
 		else if (choice == "4") // Save/Back action
 		{
 			// If it's the first run and no path was set, warn before continuing
-			if (isFirstRun && g_GoogleDrivePath.empty())
+			if (isFirstRun && g_settings.googleDrivePath.empty())
 			{
 				wcout << endl << L"   [WARNING] You have not set a Cloud Sync path."
 					<< endl;
@@ -1165,6 +1404,8 @@ void ShowRestoreMenu()
 		{
 			wcout << L"       [Cloud Sync is DISABLED for this game. Option unavailable.]" << endl;
 		}
+		wcout << L"    3. Compare Backups (what changed)" << endl;
+		wcout << L"    4. Find a File in Backups (all versions)" << endl;
 		wcout << endl << L"    X. Cancel (Back to Monitoring)" << endl << endl;
 		wcout << L"   Choose an option: ";
 
@@ -1187,6 +1428,14 @@ void ShowRestoreMenu()
 				RestoreFromCloud(); // Call existing function
 			}
 		}
+		else if (choice == "3")
+		{
+			CompareBackups();
+		}
+		else if (choice == "4")
+		{
+			FindFileInBackups();
+		}
 		else if (choice == "x" || choice == "X")
 		{
 			return; // Exit this menu, return to monitoring
@@ -1221,39 +1470,23 @@ wstring GetProfilesIniPath()
  */
 void LoadGlobalConfig()
 {
-	wstring configFile = GetConfigIniPath();
-	// Create Config.ini with default setup flags if it doesn't exist
-	if (!fs::exists(configFile)) {
-		ofstream create_file(configFile);
-		if (create_file.is_open()) {
-			create_file << "[Setup]" << endl;
-			create_file << "GDriveSetupComplete=0" << endl;
-			// Default to 0 (not complete)
-			create_file << "FirstGameAdded=0" << endl;    // Default to 0 (not complete)
-			create_file.close();
-		}
-		else {
-			// This error should ideally be caught by CheckExecutionDirectory/CreateRequiredDirectories
-			wcerr << L"Critical Error: Could not create Config.ini" << endl;
-			throw runtime_error("Failed to create Config.ini"); // Throw to stop execution
-		}
+	try
+	{
+		g_settings = LoadGlobalConfig(ToPath(GetConfigIniPath()));
+	}
+	catch (const runtime_error&)
+	{
+		// This error should ideally be caught by CheckExecutionDirectory/CreateRequiredDirectories
+		wcerr << L"Critical Error: Could not create Config.ini" << endl;
+		throw; // Rethrow to stop execution
 	}
 
-	// Load settings from [GlobalSettings] section
-	wchar_t buffer[MAX_PATH];
-	GetPrivateProfileStringW(L"GlobalSettings", L"GoogleDrivePath", L"", buffer, MAX_PATH, configFile.c_str());
-	g_GoogleDrivePath = buffer; // Load cloud path (empty if not set)
-
-	g_LocalAutoSaveLimit = GetPrivateProfileIntW(L"GlobalSettings", L"LocalAutoSaveLimit", 20, configFile.c_str());
-	// Default 20
-	g_LocalManualSaveLimit = GetPrivateProfileIntW(L"GlobalSettings", L"LocalManualSaveLimit", 0, configFile.c_str()); // Default 0 (keep all)
-	g_CloudAutoSaveLimit = GetPrivateProfileIntW(L"GlobalSettings", L"CloudAutoSaveLimit", 10, configFile.c_str());
-	// Default 10
-	g_CloudManualSaveLimit = GetPrivateProfileIntW(L"GlobalSettings", L"CloudManualSaveLimit", 25, configFile.c_str()); // Default 25
-
-	// Load setup progress flags from [Setup] section
-	g_GDriveSetupComplete = GetPrivateProfileIntW(L"Setup", L"GDriveSetupComplete", 0, configFile.c_str()) == 1;
-	g_FirstGameAdded = GetPrivateProfileIntW(L"Setup", L"FirstGameAdded", 0, configFile.c_str()) == 1;
+	// Large-file copy path ([Performance] in Config.ini)
+	LargeFileCopyOptions copyOptions;
+	copyOptions.threshold = static_cast<uint64_t>(max(1, g_settings.largeFileThresholdMb)) * 1024 * 1024;
+	copyOptions.directIo = g_settings.directIo;
+	copyOptions.dropCache = g_settings.dropPageCache;
+	SetLargeFileCopyOptions(copyOptions);
 }
 
 /**
@@ -1261,100 +1494,46 @@ void LoadGlobalConfig()
  */
 void SaveGlobalConfig()
 {
-	wstring configFile = GetConfigIniPath();
-	// Save settings to [GlobalSettings] section
-	WritePrivateProfileStringW(L"GlobalSettings", L"GoogleDrivePath", g_GoogleDrivePath.c_str(), configFile.c_str());
-	WritePrivateProfileStringW(L"GlobalSettings", L"LocalAutoSaveLimit", to_wstring(g_LocalAutoSaveLimit).c_str(), configFile.c_str());
-	WritePrivateProfileStringW(L"GlobalSettings", L"LocalManualSaveLimit", to_wstring(g_LocalManualSaveLimit).c_str(), configFile.c_str());
-	WritePrivateProfileStringW(L"GlobalSettings", L"CloudAutoSaveLimit", to_wstring(g_CloudAutoSaveLimit).c_str(), configFile.c_str());
-	WritePrivateProfileStringW(L"GlobalSettings", L"CloudManualSaveLimit", to_wstring(g_CloudManualSaveLimit).c_str(), configFile.c_str());
-	// Save setup progress flags to [Setup] section
-	WritePrivateProfileStringW(L"Setup", L"GDriveSetupComplete", (g_GDriveSetupComplete ? L"1" : L"0"), configFile.c_str());
-	WritePrivateProfileStringW(L"Setup", L"FirstGameAdded", (g_FirstGameAdded ? L"1" : L"0"), configFile.c_str());
+	SaveGlobalConfig(ToPath(GetConfigIniPath()), g_settings);
 }
 
 /**
  * @brief Loads all game profiles from GameProfiles.ini into the global g_profiles vector.
- * Creates an empty GameProfiles.ini if it doesn't exist.
+ * Creates an empty GameProfiles.ini if it doesn't exist. Profiles from before profile IDs
+ * existed have their name-based backup folders moved to ID-based ones (once).
  */
 void LoadProfiles()
 {
-	g_profiles.clear(); // Clear existing profiles before loading
-	wstring profilesFile = GetProfilesIniPath();
-	// Create GameProfiles.ini if it doesn't exist
-	if (!fs::exists(profilesFile))
-	{
-		ofstream create_file(profilesFile);
-		create_file.close(); // Create empty file
-		return;
-		// No profiles to load
-	}
-
-	// Read all section names (game names) from the INI file
-	wchar_t sectionNames[8192];
-	// Buffer to hold all section names
-	DWORD bytesRead = GetPrivateProfileSectionNamesW(sectionNames, 8192, profilesFile.c_str());
-	// If file exists but is empty or has no sections, return
-	if (bytesRead == 0 || (bytesRead == 2 && sectionNames[0] == L'\0')) {
-		return;
-	}
-
-	// Iterate through the null-terminated strings in sectionNames buffer
-	wchar_t* pSection = sectionNames;
-	while (*pSection)
+	g_profiles = LoadProfiles(ToPath(GetProfilesIniPath()));
+	bool pending = any_of(g_profiles.begin(), g_profiles.end(), [](const GameProfile& profile) { return !profile.legacyFolder.empty(); });
+	if (pending)
 	{
-		wstring sectionName = pSection;
-		// Current game name
-		GameProfile profile;
-		wchar_t buffer[MAX_PATH]; // Reusable buffer for reading strings
-
-		// Read profile details using the section name
-		GetPrivateProfileStringW(sectionName.c_str(), L"Name", L"", buffer, MAX_PATH, profilesFile.c_str());
-		profile.name = buffer;
-
-		GetPrivateProfileStringW(sectionName.c_str(), L"SavePath", L"", buffer, MAX_PATH, profilesFile.c_str());
-		profile.savePath = buffer;
-
-		profile.autoSaveInterval = GetPrivateProfileIntW(sectionName.c_str(), L"AutoSaveInterval", 600, profilesFile.c_str());
-		// Default 10 min (600s)
-		profile.cloudSaveEnabled = GetPrivateProfileIntW(sectionName.c_str(), L"CloudSaveEnabled", 0, profilesFile.c_str()) == 1;
-		// Default 0 (false)
-
-		// Add profile to vector only if Name and SavePath were successfully read
-		if (!profile.name.empty() && !profile.savePath.empty())
+		vector<wstring> log;
+		if (MigrateLegacyBackupFolders(g_profiles, g_settings, GetBackupsRoot(), log) > 0)
 		{
-			g_profiles.push_back(profile);
+			SaveProfiles(ToPath(GetProfilesIniPath()), g_profiles);
 		}
-
-		// Move to the next section name (strings are double-null terminated)
-		pSection += wcslen(pSection) + 1;
+		for (const auto& line : log) GetLogger().Log(LogLevel::Info, L"", L"migrate", line);
 	}
+	g_profileIndex = BuildProfileIndex(g_profiles);
 }
 
 /**
- * @brief Saves a single game profile's details to GameProfiles.ini under a section matching its name.
+ * @brief Saves a single game profile's details to GameProfiles.ini under a section named after its ID.
  * @param profile The GameProfile struct containing the data to save.
  */
 void SaveProfile(const GameProfile& profile)
 {
-	wstring profilesFile = GetProfilesIniPath();
-	// Write each setting under the [profile.name] section
-	WritePrivateProfileStringW(profile.name.c_str(), L"Name", profile.name.c_str(), profilesFile.c_str());
-	WritePrivateProfileStringW(profile.name.c_str(), L"SavePath", profile.savePath.c_str(), profilesFile.c_str());
-	WritePrivateProfileStringW(profile.name.c_str(), L"AutoSaveInterval", to_wstring(profile.autoSaveInterval).c_str(), profilesFile.c_str());
-	// Save interval in seconds
-	WritePrivateProfileStringW(profile.name.c_str(), L"CloudSaveEnabled", (profile.cloudSaveEnabled ? L"1" : L"0"), profilesFile.c_str());
-	// Save boolean as 1 or 0
+	SaveProfile(ToPath(GetProfilesIniPath()), profile);
 }
 
 /**
  * @brief Deletes a specific game's section from GameProfiles.ini.
- * @param profileName The name of the game profile section to delete.
+ * @param profileId The ID of the game profile section to delete.
  */
-void DeleteProfileIniEntry(const wstring& profileName)
+void DeleteProfileIniEntry(const wstring& profileId)
 {
-	// Passing NULL as key and value deletes the entire section
-	WritePrivateProfileStringW(profileName.c_str(), NULL, NULL, GetProfilesIniPath().c_str());
+	DeleteProfileIniEntry(ToPath(GetProfilesIniPath()), profileId);
 }
 
 /**
@@ -1382,10 +1561,10 @@ void DeleteGame(GameProfile& profile)
 	}
 
 	// Delete the entry from the INI file
-	DeleteProfileIniEntry(profile.name);
+	DeleteProfileIniEntry(profile.id);
 	wcout << L"Game profile deleted." << endl;
 	// Check for and optionally delete local backups
-	wstring localBackupPath = GetExePath() + L"\\Backups\\" + profile.name;
+	fs::path localBackupPath = GetLocalGameBackupDir(GetBackupsRoot(), profile);
 	if (fs::exists(localBackupPath))
 	{
 		wcout << endl << L"   Do you also want to delete all *local* backups for this game?"
@@ -1407,9 +1586,17 @@ void DeleteGame(GameProfile& profile)
 		}
 	}
 
-	// Check for and optionally delete cloud backups (if path is set)
-	wstring cloudBackupPath = g_GoogleDrivePath + L"\\Game Save Backup Manager\\" + profile.name;
-	if (!g_GoogleDrivePath.empty() && fs::exists(cloudBackupPath))
+	// Check for and optionally delete cloud backups (if cloud storage is set up)
+	unique_ptr<StorageBackend> cloud = CreateStorageBackend(g_settings);
+	string gamePrefix = GetStorageGamePrefix(profile);
+	bool hasCloudBackups = false;
+	try {
+		hasCloudBackups = cloud && !cloud->List(gamePrefix, "", "", 1).objects.empty();
+	}
+	catch (const exception& e) {
+		wcout << L"Could not check cloud backups: " << s2ws(e.what()) << endl;
+	}
+	if (hasCloudBackups)
 	{
 		wcout << endl << L"   Do you also want to delete all *cloud* backups for this game?"
 			<< endl;
@@ -1419,10 +1606,10 @@ void DeleteGame(GameProfile& profile)
 		{
 			try
 			{
-				fs::remove_all(cloudBackupPath); // Delete the entire folder recursively
+				cloud->RemovePrefix(gamePrefix); // Every object (or the whole folder) under the game's ID
 				wcout << L"Cloud backups deleted." << endl;
 			}
-			catch (const fs::filesystem_error& e) // Handle potential deletion errors
+			catch (const exception& e) // Handle potential deletion errors
 			{
 				wcout << L"Error deleting cloud backups: " << s2ws(e.what()) << endl;
 			}
@@ -1502,7 +1689,7 @@ void CreateNewGame()
 	}
 
 	// Ask about enabling cloud backup (only if global path is set)
-	if (g_GoogleDrivePath.empty())
+	if (!IsCloudConfigured())
 	{
 		newGame.cloudSaveEnabled = false; // Cannot enable if path isn't set
 		wcout << endl << L"[Cloud sync path not set globally. Cloud backup disabled for this game.]" << endl;
@@ -1516,26 +1703,23 @@ void CreateNewGame()
 		newGame.cloudSaveEnabled = (choice == "y" || choice == "Y");
 	}
 
-	// Save the newly created profile
+	// Save the newly created profile under a fresh ID
+	newGame.id = GenerateProfileId();
 	SaveProfile(newGame);
 	wcout << endl << L"Game saved!" << endl;
 	system("pause");
 }
 
 /**
- * @brief Finds a profile in the global g_profiles vector by its exact name.
- * @param name The name of the game profile to find.
+ * @brief Finds a profile in the global g_profiles vector by its ID (hash lookup).
+ * @param id The ID of the game profile to find.
  * @return A pointer to the found GameProfile, or nullptr if not found.
  */
-GameProfile* GetProfileByName(const wstring& name)
+GameProfile* GetProfileById(const wstring& id)
 {
-	for (auto& profile : g_profiles) // Iterate through the vector
-	{
-		if (profile.name == name) // Case-sensitive comparison
-			return &profile; // Return pointer to the matching profile
-	}
-	return nullptr; // Return null if no match 
-	// found
+	auto found = g_profileIndex.find(id);
+	if (found == g_profileIndex.end()) return nullptr;
+	return &g_profiles[found->second];
 }
 
 
@@ -1544,182 +1728,153 @@ GameProfile* GetProfileByName(const wstring& name)
 // =========================================================================================
 
 /**
- * @brief Creates a backup, logs the action, syncs if enabled, purges old backups,
+ * @brief Creates a backup, syncs if enabled, purges old backups (see BackupOperations.h),
  * and logs results with purges grouped after the summary.
  * @param profile The game profile to back up.
  * @param autosave True if this is an automatic backup, False if manual (Ctrl+B).
  */
 void BackupSaveFolder(const GameProfile& profile, bool autosave)
 {
-	wstring prefix = (autosave ? L"A" : L"M");
-	auto now_time_point = chrono::system_clock::now();
-	long long epochTime = chrono::system_clock::to_time_t(now_time_point);
-	string currentTime = GetCurrentDateTime(); // Consistent timestamp for this operation
-
-	// Convert time_point to tm struct for formatting folder name
-	time_t now_t = chrono::system_clock::to_time_t(now_time_point);
-	tm ltm;
-	localtime_s(&ltm, &now_t);
-	wchar_t timeBuffer[100];
-	wcsftime(timeBuffer, 100, L"%Y-%m-%d_%H-%M-%S", &ltm);
-	wstring safeDateTime = timeBuffer;
-
-	// Construct paths
-	wstring backupPathBase = GetExePath() + L"\\Backups\\" + profile.name;
-	wstring backupFolderName = to_wstring(epochTime) + L"-[" + safeDateTime + L"]-" + prefix;
-	wstring targetBackupPath = backupPathBase + L"\\" + backupFolderName;
-
-	bool localSuccess = false;
-	bool cloudSuccess = false;
-	bool cloudAttempted = false; // Track if cloud was enabled/attempted
-
-	std::vector<wstring> purgeMessages; // Vector to store purge log messages
-
-	// --- 1. Perform Local Backup ---
-	try {
-		fs::copy(profile.savePath, targetBackupPath, fs::copy_options::recursive | fs::copy_options::copy_symlinks);
-		localSuccess = true;
-		// Don't log success yet
-	}
-	catch (const fs::filesystem_error& e) {
-		// Log failure immediately and exit function
-		wcout << L"[" << s2ws(currentTime) << L"] [" << prefix << L"] Local backup FAILED for " << backupFolderName << L": " << s2ws(e.what()) << endl;
-		try { fs::remove_all(targetBackupPath); } // Attempt cleanup
-		catch (...) {}
-		wcout << L"--------------------------------------------------" << endl; // Separator after failure
-		return;
-	}
-
-	// --- 2. Purge Old Local Backups (Collect Messages) ---
-	// This runs only if local backup succeeded
-	PurgeBackups(backupPathBase, prefix, g_LocalAutoSaveLimit, g_LocalManualSaveLimit, L"Local", purgeMessages);
-
-	// --- 3. Perform Cloud Backup (if enabled and path is set) ---
-	if (profile.cloudSaveEnabled && !g_GoogleDrivePath.empty())
-	{
-		cloudAttempted = true;
-		wstring cloudGamePath = g_GoogleDrivePath + L"\\Game Save Backup Manager\\" + profile.name;
-		wstring cloudTargetPath = cloudGamePath + L"\\" + backupFolderName;
-
-		try {
-			fs::create_directories(cloudGamePath);
-			fs::copy(targetBackupPath, cloudTargetPath, fs::copy_options::recursive | fs::copy_options::copy_symlinks);
-			cloudSuccess = true;
-			// Don't log success yet
-
-			// --- 4. Purge Old Cloud Backups (Collect Messages) ---
-			PurgeBackups(cloudGamePath, prefix, g_CloudAutoSaveLimit, g_CloudManualSaveLimit, L"Cloud", purgeMessages);
-		}
-		catch (const fs::filesystem_error& e) {
-			// Log cloud sync failure immediately (as it's part of the operation's status)
-			wcout << L"[" << s2ws(currentTime) << L"] [CLOUD] Sync FAILED for " << backupFolderName << L": " << s2ws(e.what()) << endl;
-			cloudSuccess = false; // Ensure this is false
-		}
-	}
-
-	// --- 5. FINAL Consolidated Logging ---
-	// Print the final summary status line FIRST
-	if (localSuccess && cloudAttempted && cloudSuccess) {
-		wcout << L"[" << s2ws(currentTime) << L"] [" << prefix << L"] Backup " << backupFolderName << L" completed (Local + Cloud Sync)." << endl;
-	}
-	else if (localSuccess && cloudAttempted && !cloudSuccess) {
-		// Cloud failure message was already printed in the catch block
-		wcout << L"[" << s2ws(currentTime) << L"] [" << prefix << L"] Backup " << backupFolderName << L" completed (Local only due to Cloud sync failure)." << endl;
-	}
-	else if (localSuccess) { // Covers Local only (cloud disabled or path not set)
-		wcout << L"[" << s2ws(currentTime) << L"] [" << prefix << L"] Backup " << backupFolderName << L" completed (Local)." << endl;
-	}
-	// else: Local failed case handled earlier with immediate return.
-
-	// Now print all collected purge messages AFTER the summary
-	for (const auto& msg : purgeMessages) {
-		wcout << msg << endl;
-	}
-
-	// --- ADD SEPARATOR LINE ---
-	// Add separator only if the operation didn't completely fail locally (localSuccess should be true here)
-	wcout << L"--------------------------------------------------" << endl;
-
-} // End of BackupSaveFolder function
+	BackupResult result;
+	// Manual backups show their progress and can be cancelled; auto-saves run quietly
+	if (autosave) result = BackupSaveFolder(profile, g_settings, GetBackupsRoot(), true);
+	else RunWithProgress([&](OperationProgress& progress) { result = BackupSaveFolder(profile, g_settings, GetBackupsRoot(), false, &progress); });
+	for (const auto& line : result.log) {
+		// Engine log lines report failures with "FAILED"
+		LogLevel level = line.find(L"FAILED") != wstring::npos ? LogLevel::Error : (result.cancelled ? LogLevel::Warning : LogLevel::Info);
+		LogOperation(level, profile, autosave ? L"autosave" : L"backup", line);
+	}
+	// Separator line after every operation, successful or not
+	GetLogger().Separator();
+}
 
 /**
- * @brief Deletes old backups (auto or manual) if they exceed limits, collecting log messages.
- * @param backupDir Directory containing backups.
- * @param prefix Type of backup just created ("A" or "M") - used internally for consistency check.
- * @param autoLimit Max auto-saves to keep (0=all).
- * @param manualLimit Max manual-saves to keep (0=all).
- * @param locationName "Local" or "Cloud".
- * @param logCollector Vector to store generated log messages.
+ * @brief Runs a long copy (a manual backup, a restore or a cloud download) with a live progress line: files, MB,
+ * MB/s, time left and the current file, drawn once the copy has taken a second. Any key press
+ * cancels it at the next file (see Progress.h); the operation rolls back what it copied.
  */
-void PurgeBackups(const wstring& backupDir, const wstring& prefix, int autoLimit, int manualLimit, const wstring& locationName, std::vector<wstring>& logCollector)
+void RunWithProgress(const function<void(OperationProgress&)>& operation)
 {
-	if (!fs::exists(backupDir)) return; // Don't proceed if the directory doesn't exist
+	const size_t width = 79;
+	GetLogger().Flush(); // Queued lines first, so none breaks into the progress line
+	while (_kbhit()) _getch(); // Keys pressed before the copy do not cancel it
+	bool drawn = false;
+	OperationProgress progress([&](const ProgressEvent& event)
+		{
+			if (_kbhit())
+			{
+				while (_kbhit()) _getch();
+				progress.Cancel();
+			}
+			if (event.finished || event.elapsed < 1s) return; // Quick copies print nothing
+			if (!drawn) wcout << L"    Copying... press any key to cancel." << endl;
+			drawn = true;
+
+			wstringstream wss;
+			uint64_t percent = event.bytesTotal ? event.bytesDone * 100 / event.bytesTotal : 100;
+			wss << L"    [" << setw(3) << percent << L"%] " << event.filesDone << L"/" << event.filesTotal << L" files, "
+				<< fixed << setprecision(1) << event.bytesDone / (1024.0 * 1024.0) << L"/" << event.bytesTotal / (1024.0 * 1024.0) << L" MB, "
+				<< event.bytesPerSecond / (1024.0 * 1024.0) << L" MB/s, ";
+			if (event.eta.count() < 0) wss << L"--:--";
+			else wss << event.eta.count() / 60 << L":" << setw(2) << setfill(L'0') << event.eta.count() % 60;
+			wss << L" left";
+			wstring line = wss.str();
+			wstring file = PathToWide(event.currentFile);
+			if (!file.empty() && line.size() + 8 < width)
+			{
+				size_t room = width - line.size() - 3;
+				if (file.size() > room) file = L"..." + file.substr(file.size() - (room - 3)); // Keep the file name, drop the folders
+				line += L" - " + file;
+			}
+			line.resize(width, L' '); // Covers a longer previous line
+			wcout << L"\r" << line << flush;
+		});
 
-	vector<fs::path> autoSaves;
-	vector<fs::path> manualSaves;
-	// Iterate through the backup directory and categorize folders by suffix
-	for (const auto& entry : fs::directory_iterator(backupDir))
+	auto clearLine = [&]() { if (drawn) wcout << L"\r" << wstring(width, L' ') << L"\r" << flush; };
+	try { operation(progress); }
+	catch (...)
 	{
-		if (entry.is_directory()) // Only consider directories
-		{
-			wstring dirName = entry.path().filename().wstring();
-			if (endsWith(dirName, L"-A")) autoSaves.push_back(entry.path());
-			else if (endsWith(dirName, L"-M")) manualSaves.push_back(entry.path());
-		}
+		clearLine();
+		throw;
 	}
+	clearLine();
+}
 
-	// Sort backups chronologically (oldest first)
-	sort(autoSaves.begin(), autoSaves.end());
-	sort(manualSaves.begin(), manualSaves.end());
-
-	// String stream to build messages before adding to vector
-	wstringstream wss;
-
-	// Purge oldest auto-saves if limit is exceeded
-	if (autoLimit > 0 && autoSaves.size() > autoLimit)
+/**
+ * @brief Reads a line from the console without echoing it (a '*' per character), for passphrases.
+ * Backspace removes the last character; Enter ends the line.
+ */
+wstring ReadHiddenLine()
+{
+	wstring line;
+	while (true)
 	{
-		int toDelete = static_cast<int>(autoSaves.size()) - autoLimit;
-		wss.str(L""); // Clear stream
-		wss << L"      [PURGE:" << locationName << L"] Auto-save limit (" << autoLimit << L") exceeded. Deleting " << toDelete << L" oldest...";
-		logCollector.push_back(wss.str()); // Add summary message to vector
-
-		for (int i = 0; i < toDelete; ++i)
+		wint_t ch = _getwch();
+		if (ch == L'\r' || ch == L'\n') break;
+		if (ch == 0 || ch == 0xE0) { _getwch(); continue; } // Arrow and function keys come as two codes
+		if (ch == L'\b')
 		{
-			try {
-				wss.str(L""); // Clear stream
-				wss << L"         - Deleting: " << autoSaves[i].filename().wstring();
-				logCollector.push_back(wss.str()); // Add deletion detail message to vector
-				fs::remove_all(autoSaves[i]); // Delete the folder recursively
-			}
-			catch (const fs::filesystem_error& e) {
-				// Print failure immediately for visibility
-				wcout << L"      [PURGE:" << locationName << L"] FAILED to delete Auto " << autoSaves[i].filename().wstring() << L": " << s2ws(e.what()) << endl;
+			if (!line.empty())
+			{
+				line.pop_back();
+				wcout << L"\b \b" << flush;
 			}
+			continue;
 		}
+		line += static_cast<wchar_t>(ch);
+		wcout << L'*' << flush;
 	}
+	wcout << endl;
+	return line;
+}
 
-	// Purge oldest manual-saves if limit is exceeded
-	if (manualLimit > 0 && manualSaves.size() > manualLimit)
-	{
-		int toDelete = static_cast<int>(manualSaves.size()) - manualLimit;
-		wss.str(L""); // Clear stream
-		wss << L"      [PURGE:" << locationName << L"] Manual-save limit (" << manualLimit << L") exceeded. Deleting " << toDelete << L" oldest...";
-		logCollector.push_back(wss.str()); // Add summary message to vector
+/**
+ * @brief Queues an operation log line; it is printed and appended to the log file by the logger thread.
+ */
+void LogOperation(LogLevel level, const GameProfile& profile, const wchar_t* operation, const wstring& message)
+{
+	GetLogger().Log(level, profile.name, operation, message);
+}
 
-		for (int i = 0; i < toDelete; ++i)
+/**
+ * @brief Backs up every game as a manual backup, BatchBackupWorkers at a time, logging a
+ * progress line as each one finishes and a summary at the end.
+ * @return True if every game was backed up locally.
+ */
+bool BackupAllGames()
+{
+	auto logBatch = [](LogLevel level, const wstring& message) { GetLogger().Log(level, L"All games", L"batch", message); };
+	int workers = max(1, g_settings.batchBackupWorkers);
+	BatchBackupReport report = BackupAllProfiles(g_profiles, g_settings, GetBackupsRoot(), workers,
+		[&](const BatchBackupProgress& progress)
 		{
-			try {
-				wss.str(L""); // Clear stream
-				wss << L"         - Deleting: " << manualSaves[i].filename().wstring();
-				logCollector.push_back(wss.str()); // Add deletion detail message to vector
-				fs::remove_all(manualSaves[i]); // Delete the folder recursively
+			wstringstream wss;
+			wss << L"[" << s2ws(GetCurrentDateTime()) << L"] [BATCH] " << fixed << setprecision(1);
+			if (!progress.finished)
+			{
+				wss << L"Backing up " << progress.profilesTotal << L" game(s), " << progress.bytesTotal / (1024.0 * 1024.0)
+					<< L" MB, " << min<size_t>(workers, progress.profilesTotal) << L" at a time...";
+				logBatch(LogLevel::Info, wss.str());
+				return;
 			}
-			catch (const fs::filesystem_error& e) {
-				// Print failure immediately for visibility
-				wcout << L"      [PURGE:" << locationName << L"] FAILED to delete Manual " << manualSaves[i].filename().wstring() << L": " << s2ws(e.what()) << endl;
+			const BatchBackupItem& item = *progress.finished;
+			const GameProfile& profile = g_profiles[item.profile];
+			for (const auto& line : item.result.log)
+			{
+				LogOperation(line.find(L"FAILED") != wstring::npos ? LogLevel::Error : LogLevel::Info, profile, L"backup", line);
 			}
-		}
-	}
+			uint64_t percent = progress.bytesTotal ? progress.bytesDone * 100 / progress.bytesTotal : 100;
+			wss << progress.profilesDone << L"/" << progress.profilesTotal << L" games done (" << percent << L"% of the data): "
+				<< profile.name << (item.result.localSuccess ? L" backed up in " : L" FAILED after ") << item.elapsed.count() / 1000.0 << L" s.";
+			logBatch(item.result.localSuccess ? LogLevel::Info : LogLevel::Error, wss.str());
+		});
+
+	wstringstream wss;
+	wss << L"[" << s2ws(GetCurrentDateTime()) << L"] [BATCH] Finished in " << fixed << setprecision(1) << report.elapsed.count() / 1000.0
+		<< L" s: " << report.items.size() - report.failed << L" backed up, " << report.failed << L" failed.";
+	logBatch(report.failed ? LogLevel::Warning : LogLevel::Info, wss.str());
+	GetLogger().Separator();
+	return report.failed == 0;
 }
 
 /**
@@ -1730,75 +1885,134 @@ void PurgeBackups(const wstring& backupDir, const wstring& prefix, int autoLimit
  */
 void RestoreLastBackup(const GameProfile& profile)
 {
-	wstring backupPathBase = GetExePath() + L"\\Backups\\" + profile.name;
+	fs::path backupPathBase = GetLocalGameBackupDir(GetBackupsRoot(), profile);
 	if (!fs::exists(backupPathBase))
 	{
-		wcout << L"No local backups found for this game." << endl;
-		wcout << L"--------------------------------------------------" << endl;
+		LogOperation(LogLevel::Warning, profile, L"restore", L"No local backups found for this game.");
+		GetLogger().Separator();
 		return;
 	}
 
-	fs::path latestManualBackup;
-	fs::file_time_type latestTime = fs::file_time_type::min();
-	// Initialize to earliest possible time
-
 	// Find the most recent directory ending in "-M"
-	for (const auto& entry : fs::directory_iterator(backupPathBase))
-	{
-		if (entry.is_directory() && endsWith(entry.path().filename().wstring(), L"-M"))
-		{
-			try {
-				auto modTime = fs::last_write_time(entry);
-				// Check if this is the first manual save found or if it's newer than the current latest
-				if (latestManualBackup.empty() || modTime > latestTime)
-				{
-					latestTime = modTime;
-					latestManualBackup = entry.path();
-				}
-			}
-			catch (const fs::filesystem_error&) {
-				// Ignore errors reading time for a specific backup folder, skip it
-			}
-		}
-	}
-
-	// If no manual backup was found
+	fs::path latestManualBackup = FindLatestManualBackup(backupPathBase);
 	if (latestManualBackup.empty())
 	{
-		wcout << L"No MANUAL (-M) backups found. CTRL+R only restores the latest manual save." << endl;
-		wcout << L"--------------------------------------------------" << endl;
+		LogOperation(LogLevel::Warning, profile, L"restore", L"No MANUAL (-M) backups found. CTRL+R only restores the latest manual save.");
+		GetLogger().Separator();
 		return;
 	}
 
 	// Proceed with restore (no confirmation)
 	try {
-		// Ensure the target save path exists and is a directory
-		if (!fs::exists(profile.savePath)) {
-			fs::create_directories(profile.savePath);
-			// Create if missing
-		}
-		else if (!fs::is_directory(profile.savePath)) {
-			wcout << L"RESTORE FAILED: Target save path exists but is not a directory: " << profile.savePath << endl;
-			wcout << L"--------------------------------------------------" << endl;
+		bool restored = false;
+		RunWithProgress([&](OperationProgress& progress) { restored = RestoreBackup(latestManualBackup, ToPath(profile.savePath), &progress); });
+		if (!restored) {
+			LogOperation(LogLevel::Error, profile, L"restore", L"RESTORE FAILED: Target save path exists but is not a directory: " + profile.savePath);
+			GetLogger().Separator();
 			return; // Cannot restore if target isn't a directory
 		}
+		LogOperation(LogLevel::Info, profile, L"restore", L"Restored from latest manual backup: " + PathToWide(latestManualBackup.filename()));
+		GetLogger().Separator();
+	}
+	catch (const OperationCancelled&) {
+		LogOperation(LogLevel::Warning, profile, L"restore", L"Restore cancelled; the save files were not changed.");
+		GetLogger().Separator();
+	}
+	catch (const fs::filesystem_error& e) { // Handle potential deletion/copy errors
+		LogOperation(LogLevel::Error, profile, L"restore", L"RESTORE FAILED: " + s2ws(e.what()));
+		LogOperation(LogLevel::Error, profile, L"restore", L"Another program might be using the save files, or permissions may be insufficient.");
+		GetLogger().Separator();
+	}
+}
+
+/**
+ * @brief Asks whether to restore a whole backup or only some of its files. For the latter, lists
+ * the files from `loadIndex` and reads numbers and ranges ("1,3,5-7") or a file or folder path.
+ * @return False (after printing why) if cancelled, nothing was selected, or the list could not be read.
+ */
+bool ChooseRestoreScope(const function<BackupManifest()>& loadIndex, bool& selectedOnly, BackupManifest& selection)
+{
+	wcout << endl << L"    1. Restore the whole backup" << endl;
+	wcout << L"    2. Choose files to restore" << endl;
+	wcout << L"   Choose an option (or 'x' to cancel): ";
+	string scope;
+	getline(cin, scope);
+	if (scope == "1")
+	{
+		selectedOnly = false;
+		return true;
+	}
+	if (scope != "2")
+	{
+		wcout << L"Cancelled." << endl;
+		return false;
+	}
+
+	BackupManifest index;
+	try {
+		index = loadIndex();
+	}
+	catch (const exception& e) {
+		wcout << L"Cannot read the file list of this backup: " << s2ws(e.what()) << endl;
+		return false;
+	}
+	vector<const ManifestEntry*> files;
+	for (const auto& entry : index.entries)
+	{
+		if (entry.type != fs::file_type::directory) files.push_back(&entry);
+	}
+	if (files.empty())
+	{
+		wcout << L"This backup contains no files." << endl;
+		return false;
+	}
+
+	wcout << endl << L"   --- Files in this backup ---" << endl << endl;
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		wcout << L"    " << (i + 1) << L". " << s2ws(files[i]->path) << L"  (" << (files[i]->size + 1023) / 1024 << L" KB)" << endl;
+	}
+	wcout << L"   -------------------------------------------" << endl;
+	wcout << L"   Enter numbers (e.g. 1,3,5-7) or a file or folder path: ";
+	wstring input;
+	getline(wcin, input);
 
-		// Clear the existing save directory contents
-		for (const auto& entry : fs::directory_iterator(profile.savePath))
+	vector<string> paths;
+	if (!input.empty() && input.find_first_not_of(L"0123456789,- ") == wstring::npos)
+	{
+		wstringstream list(input);
+		wstring item;
+		while (getline(list, item, L','))
 		{
-			fs::remove_all(entry.path());
+			if (item.find_first_not_of(L' ') == wstring::npos) continue;
+			try {
+				size_t dash = item.find(L'-');
+				size_t first = stoul(item.substr(0, dash));
+				size_t last = dash == wstring::npos ? first : stoul(item.substr(dash + 1));
+				if (first < 1 || last < first || last > files.size()) throw out_of_range("selection");
+				for (size_t n = first; n <= last; ++n) paths.push_back(files[n - 1]->path);
+			}
+			catch (const exception&) {
+				wcout << L"Invalid selection: " << item << endl;
+				return false;
+			}
 		}
-
-		// Copy the contents of the chosen backup folder to the save directory
-		fs::copy(latestManualBackup, profile.savePath, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
-		wcout << L"Restored from latest manual backup: " << latestManualBackup.filename().wstring() << endl;
-		wcout << L"--------------------------------------------------" << endl;
 	}
-	catch (const fs::filesystem_error& e) { // Handle potential deletion/copy errors
-		wcout << L"RESTORE FAILED: " << s2ws(e.what()) << endl;
-		wcout << L"Another program might be using the save files, or permissions may be insufficient." << endl;
-		wcout << L"--------------------------------------------------" << endl;
+	else if (!input.empty())
+	{
+		string path = ws2s(input);
+		replace(path.begin(), path.end(), '\\', '/');
+		paths.push_back(path);
+	}
+
+	selection = index.Select(paths);
+	if (selection.entries.empty())
+	{
+		wcout << L"Nothing selected." << endl;
+		return false;
 	}
+	selectedOnly = true;
+	return true;
 }
 
 /**
@@ -1808,28 +2022,19 @@ void RestoreLastBackup(const GameProfile& profile)
 void RestoreFromLocal()
 {
 	ClearScreen();
-	wstring localGamePath = GetExePath() + L"\\Backups\\" + selectedGame.name;
+	fs::path localGamePath = GetLocalGameBackupDir(GetBackupsRoot(), selectedGame);
 	// Path to local backups for the current game
 	// Check if the backup directory exists
 	if (!fs::exists(localGamePath) || !fs::is_directory(localGamePath))
 	{
 		wcout << L"Local restore failed: No local backups found for " << selectedGame.name << L" at:" << endl;
-		wcout << localGamePath << endl;
+		wcout << localGamePath.wstring() << endl;
 		system("pause");
 		return;
 	}
 
-	vector<fs::path> backups; // Vector to hold paths of valid backup folders
-	// Populate the vector with backup directories
-	for (const auto& entry : fs::directory_iterator(localGamePath))
-	{
-		if (entry.is_directory()) // Only consider directories
-		{
-			backups.push_back(entry.path());
-		}
-	}
-	// Sort backups by path name (timestamp) in descending order (newest first)
-	sort(backups.rbegin(), backups.rend());
+	// Backup folders sorted by timestamp, newest first
+	vector<fs::path> backups = ListBackups(localGamePath);
 	if (backups.empty()) // Check if any backup folders were found
 	{
 		wcout << L"No backup folders found locally for this game."
@@ -1867,9 +2072,19 @@ void RestoreFromLocal()
 			fs::path backupToRestore = backups[choice_idx];
 			// Get the path of the selected backup
 
+			// Whole backup, or only some files (listed from the backup's index)
+			bool selectedOnly = false;
+			BackupManifest selection;
+			if (!ChooseRestoreScope([&] { return LoadBackupIndex(backupToRestore); }, selectedOnly, selection))
+			{
+				system("pause");
+				return;
+			}
+
 			// Confirm overwrite
 			wcout << endl << L"   ===================== WARNING =====================" << endl;
-			wcout << L"    This will OVERWRITE your current save files with" << endl;
+			if (selectedOnly) wcout << L"    This will OVERWRITE the selected save files with" << endl;
+			else wcout << L"    This will OVERWRITE your current save files with" << endl;
 			wcout << L"    the local backup: " << backupToRestore.filename().wstring() << endl << endl;
 			wcout << L"    ARE YOU SURE? (y/n)" << endl << L"> ";
 
@@ -1878,26 +2093,28 @@ void RestoreFromLocal()
 			if (confirm == "y" || confirm == "Y") // Proceed if confirmed
 			{
 				try {
-					// Ensure the target save path exists and is a directory
-					if (!fs::exists(selectedGame.savePath)) {
-						fs::create_directories(selectedGame.savePath);
+					if (selectedOnly) {
+						// Only the chosen files are replaced; the rest of the save folder stays as it is
+						CopyStats stats;
+						RunWithProgress([&](OperationProgress& progress) { stats = RestoreSelectedFiles(backupToRestore, selection, ToPath(selectedGame.savePath), &progress); });
+						wcout << L"Restored " << stats.filesCopied << L" file(s) from the local backup." << endl;
 					}
-					else if (!fs::is_directory(selectedGame.savePath)) {
-						wcout << L"RESTORE FAILED: Save path exists but is not a directory." << endl;
-						system("pause");
-						return;
-					}
-
-					// Clear the existing save directory contents
-					for (const auto& entry : fs::directory_iterator(selectedGame.savePath))
-					{
-						fs::remove_all(entry.path());
+					else {
+						// Replace the save directory's contents with the backup's
+						bool restored = false;
+						RunWithProgress([&](OperationProgress& progress) { restored = RestoreBackup(backupToRestore, ToPath(selectedGame.savePath), &progress); });
+						if (!restored) {
+							wcout << L"RESTORE FAILED: Save path exists but is not a directory." << endl;
+							system("pause");
+							return;
+						}
 					}
-					// Copy the backup contents to the save directory
-					fs::copy(backupToRestore, selectedGame.savePath, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
 					wcout << L"Restore from local backup complete."
 						<< endl;
 				}
+				catch (const OperationCancelled&) { // A key was pressed during the copy
+					wcout << L"Restore cancelled; the save files were not changed." << endl;
+				}
 				catch (const fs::filesystem_error& e) { // Handle deletion/copy errors
 					wcout << L"RESTORE FAILED: " << s2ws(e.what()) << endl;
 				}
@@ -1925,37 +2142,27 @@ void RestoreFromLocal()
 void RestoreFromCloud()
 {
 	ClearScreen();
-	// Check if cloud path is configured
-	if (g_GoogleDrivePath.empty())
+	// Check if cloud storage is configured
+	unique_ptr<StorageBackend> cloud = CreateStorageBackend(g_settings);
+	if (!cloud)
 	{
-		wcout << L"Cloud restore failed: Cloud Sync path is not set."
+		wcout << L"Cloud restore failed: Cloud storage is not set up."
 			<< endl;
 		system("pause");
 		return;
 	}
 
-	// Construct path to cloud backups for the current game
-	wstring cloudGamePath = g_GoogleDrivePath + L"\\Game Save Backup Manager\\" + selectedGame.name;
-	// Check if the cloud backup directory exists
-	if (!fs::exists(cloudGamePath) || !fs::is_directory(cloudGamePath))
-	{
-		wcout << L"Cloud restore failed: No cloud backups found for " << selectedGame.name << L" at:" << endl;
-		wcout << cloudGamePath << endl;
+	// Backup folder names sorted by timestamp, newest first
+	string gamePrefix = GetStorageGamePrefix(selectedGame);
+	vector<string> backups;
+	try {
+		backups = ListStoredBackups(*cloud, gamePrefix);
+	}
+	catch (const exception& e) {
+		wcout << L"Cloud restore failed: " << s2ws(e.what()) << endl;
 		system("pause");
 		return;
 	}
-
-	vector<fs::path> backups; // Vector to hold paths of valid backup folders
-	// Populate the vector with backup directories from the cloud path
-	for (const auto& entry : fs::directory_iterator(cloudGamePath))
-	{
-		if (entry.is_directory()) // Only consider directories
-		{
-			backups.push_back(entry.path());
-		}
-	}
-	// Sort backups by path name (timestamp) in descending order (newest first)
-	sort(backups.rbegin(), backups.rend());
 	if (backups.empty()) // Check if any backup folders were found
 	{
 		wcout << L"No backup folders found in the cloud for this game."
@@ -1969,7 +2176,7 @@ void RestoreFromCloud()
 	wcout << L"   (Newest first)" << endl << endl;
 	for (size_t i = 0; i < backups.size(); ++i) // Use size_t for index
 	{
-		wcout << L"    " << (i + 1) << L". " << backups[i].filename().wstring() << endl;
+		wcout << L"    " << (i + 1) << L". " << s2ws(backups[i]) << endl;
 		// Display 1-based index
 	}
 	wcout << L"   -------------------------------------------" << endl;
@@ -1990,39 +2197,75 @@ void RestoreFromCloud()
 		// Validate the chosen index
 		if (choice_idx >= 0 && choice_idx < backups.size())
 		{
-			fs::path backupToRestore = backups[choice_idx];
-			// Get the path of the selected backup
+			string backupPrefix = gamePrefix + backups[choice_idx] + "/";
+			// Key prefix of the selected backup
+
+			// Encrypted backups are decrypted (and their tags checked) while downloading
+			shared_ptr<const EncryptionKeys> keys;
+			auto openKeys = [&] {
+				if (!keys && IsEncryptionEnabled(selectedGame)) keys = OpenStoredKeys(*cloud, gamePrefix, GetProfileSecret(selectedGame), false);
+				};
+
+			// Whole backup, or only some files (listed from the backup's manifest)
+			bool selectedOnly = false;
+			BackupManifest selection;
+			if (!ChooseRestoreScope([&] { openKeys(); return GetStoredBackupIndex(*cloud, backupPrefix, keys.get()); }, selectedOnly, selection))
+			{
+				system("pause");
+				return;
+			}
 
 			// Confirm overwrite
 			wcout << endl << L"   ===================== WARNING =====================" << endl;
-			wcout << L"    This will OVERWRITE your current save files with" << endl;
-			wcout << L"    the cloud backup: " << backupToRestore.filename().wstring() << endl << endl;
+			if (selectedOnly) wcout << L"    This will OVERWRITE the selected save files with" << endl;
+			else wcout << L"    This will OVERWRITE your current save files with" << endl;
+			wcout << L"    the cloud backup: " << s2ws(backups[choice_idx]) << endl << endl;
 			wcout << L"    ARE YOU SURE? (y/n)" << endl << L"> ";
 
 			string confirm;
 			getline(cin, confirm);
 			if (confirm == "y" || confirm == "Y") // Proceed if confirmed
 			{
+				// Plain folders restore straight from disk; object stores are downloaded and
+				// chunked or packed backups rebuilt from their manifest or pack index first
+				fs::path backupToRestore = cloud->LocalPath(backupPrefix);
+				fs::path download = GetBackupsRoot() / L".cloud-download";
 				try {
-					// Ensure the target save path exists and is a directory
-					if (!fs::exists(selectedGame.savePath)) {
-						fs::create_directories(selectedGame.savePath);
-					}
-					else if (!fs::is_directory(selectedGame.savePath)) {
-						wcout << L"RESTORE FAILED: Save path exists but is not a directory." << endl;
-						system("pause");
-						return;
+					if (selectedOnly) {
+						// Only the chunks, packs or objects of the chosen files are fetched, into the
+						// download folder; they then replace the save files all at once
+						fs::remove_all(download);
+						RunWithProgress([&](OperationProgress& progress) { DownloadStoredFiles(*cloud, backupPrefix, selection, download, keys.get(), &progress); });
+						BackupManifest downloaded; // Without what the download skipped (symlinks it could not create)
+						for (const auto& entry : selection.entries)
+						{
+							if (fs::exists(fs::symlink_status(download / fs::u8path(entry.path)))) downloaded.entries.push_back(entry);
+						}
+						CopyStats stats;
+						RunWithProgress([&](OperationProgress& progress) { stats = RestoreSelectedFiles(download, downloaded, ToPath(selectedGame.savePath), &progress); });
+						wcout << L"Restored " << stats.filesCopied << L" file(s) from the cloud backup." << endl;
 					}
-
-					// Clear the existing save directory contents
-					for (const auto& entry : fs::directory_iterator(selectedGame.savePath))
-					{
-						fs::remove_all(entry.path());
+					else {
+						if (backupToRestore.empty() || HasStoredManifest(*cloud, backupPrefix) || IsPackedBackup(*cloud, backupPrefix)) {
+							openKeys();
+							fs::remove_all(download);
+							RunWithProgress([&](OperationProgress& progress) { DownloadStoredBackup(*cloud, backupPrefix, download, keys.get(), &progress); });
+							backupToRestore = download;
+						}
+						// Replace the save directory's contents with the backup's
+						bool restored = false;
+						RunWithProgress([&](OperationProgress& progress) { restored = RestoreBackup(backupToRestore, ToPath(selectedGame.savePath), &progress); });
+						if (!restored) {
+							wcout << L"RESTORE FAILED: Save path exists but is not a directory." << endl;
+						}
+						else {
+							wcout << L"Restore from cloud complete."
+								<< endl;
+						}
 					}
-					// Copy the backup contents to the save directory
-					fs::copy(backupToRestore, selectedGame.savePath, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
-					wcout << L"Restore from cloud complete."
-						<< endl;
+				}
+				catch (const OperationCancelled&) { // A key was pressed during the download or the copy
+					wcout << L"Restore cancelled; the save files were not changed." << endl;
 				}
 				catch (const fs::filesystem_error& e) { // Handle deletion/copy errors
 					wcout << L"RESTORE FAILED: " << s2ws(e.what()) << endl;
@@ -2030,6 +2273,11 @@ void RestoreFromCloud()
 					wcout << L"Is the cloud client running and fully synced? Is the folder set to be available offline?"
 						<< endl;
 				}
+				catch (const exception& e) { // Object store and decryption errors
+					wcout << L"RESTORE FAILED: " << s2ws(e.what()) << endl;
+				}
+				error_code ec;
+				fs::remove_all(download, ec);
 			}
 			else // User cancelled overwrite
 			{
@@ -2047,12 +2295,219 @@ void RestoreFromCloud()
 	// Pause after restore attempt or cancellation
 }
 
+/**
+ * @brief Compares two local backups, or one backup with the current save folder, from their
+ * indexes (BackupIndex.h), so no backed-up file is read. The live side is a metadata-only scan.
+ */
+void CompareBackups()
+{
+	ClearScreen();
+	fs::path localGamePath = GetLocalGameBackupDir(GetBackupsRoot(), selectedGame);
+	vector<fs::path> backups = fs::is_directory(localGamePath) ? ListBackups(localGamePath) : vector<fs::path>();
+	if (backups.empty())
+	{
+		wcout << L"No backup folders found locally for this game." << endl;
+		system("pause");
+		return;
+	}
+
+	wcout << L"   --- Local Backups for " << selectedGame.name << L" ---" << endl;
+	wcout << L"   (Newest first)" << endl << endl;
+	for (size_t i = 0; i < backups.size(); ++i)
+	{
+		wcout << L"    " << (i + 1) << L". " << backups[i].filename().wstring() << endl;
+	}
+	wcout << L"   -------------------------------------------" << endl;
+
+	auto pick = [&](const wchar_t* prompt, bool allowLive, size_t& index)
+		{
+			wcout << prompt;
+			string input;
+			getline(cin, input);
+			if (allowLive && (input == "l" || input == "L"))
+			{
+				index = backups.size(); // The save folder
+				return true;
+			}
+			try {
+				index = stoul(input) - 1;
+				if (index < backups.size()) return true;
+			}
+			catch (const exception&) {}
+			wcout << L"Invalid selection." << endl;
+			return false;
+		};
+	size_t older = 0, newer = 0;
+	if (!pick(L"   Backup to compare from (number): ", false, older) ||
+		!pick(L"   Compare with (number, or 'L' for the current save folder): ", true, newer))
+	{
+		system("pause");
+		return;
+	}
+
+	BackupDiff diff;
+	wstring toName = newer == backups.size() ? L"current save folder" : backups[newer].filename().wstring();
+	try {
+		BackupManifest from = LoadBackupIndex(backups[older]);
+		BackupManifest to = newer == backups.size()
+			? ManifestFromScan(ScanTree(ToPath(selectedGame.savePath)), ToPath(selectedGame.savePath))
+			: LoadBackupIndex(backups[newer]);
+		diff = DiffBackups(from, to);
+	}
+	catch (const exception& e) {
+		wcout << L"Compare failed: " << s2ws(e.what()) << endl;
+		system("pause");
+		return;
+	}
+
+	// Listing stops after a screenful or two; the summary always covers everything
+	const size_t kMaxListed = 200;
+	wcout << endl << L"   --- " << backups[older].filename().wstring() << L"  ->  " << toName << L" ---" << endl << endl;
+	for (size_t i = 0; i < diff.changes.size() && i < kMaxListed; ++i)
+	{
+		const FileChange& change = diff.changes[i];
+		wstring path = s2ws(change.path);
+		switch (change.kind)
+		{
+		case FileChange::Kind::Added:
+			wcout << L"    + " << path << L"  (" << (change.newSize + 1023) / 1024 << L" KB)" << endl;
+			break;
+		case FileChange::Kind::Removed:
+			wcout << L"    - " << path << L"  (" << (change.oldSize + 1023) / 1024 << L" KB)" << endl;
+			break;
+		case FileChange::Kind::Modified:
+			int64_t delta = static_cast<int64_t>(change.newSize) - static_cast<int64_t>(change.oldSize);
+			wcout << L"    ~ " << path << L"  (" << (change.oldSize + 1023) / 1024 << L" KB -> " << (change.newSize + 1023) / 1024
+				<< L" KB, " << (delta >= 0 ? L"+" : L"") << delta << L" bytes)" << endl;
+			break;
+		}
+	}
+	if (diff.changes.size() > kMaxListed)
+	{
+		wcout << L"    ... and " << diff.changes.size() - kMaxListed << L" more" << endl;
+	}
+	if (diff.changes.empty())
+	{
+		wcout << L"    No differences." << endl;
+	}
+	wcout << endl << L"   " << diff.added << L" added, " << diff.removed << L" removed, " << diff.modified << L" modified; size change "
+		<< (diff.sizeDelta >= 0 ? L"+" : L"") << diff.sizeDelta << L" bytes" << endl;
+	system("pause");
+}
+
+/**
+ * @brief Asks for part of a file name, then lists the distinct versions of the matching file
+ * across all local backups from the game's search index (SearchIndex.h), so no backup folder
+ * is opened. The chosen version is restored from the newest backup that holds it.
+ */
+void FindFileInBackups()
+{
+	ClearScreen();
+	fs::path localGamePath = GetLocalGameBackupDir(GetBackupsRoot(), selectedGame);
+	BackupSearchIndex search = LoadBackupSearchIndex(localGamePath);
+	if (search.BackupCount() == 0)
+	{
+		wcout << L"No backup folders found locally for this game." << endl;
+		system("pause");
+		return;
+	}
+
+	wcout << L"   Enter part of a file name or path (e.g. slot2.sav): ";
+	wstring input;
+	getline(wcin, input);
+	string fragment = ws2s(input);
+	replace(fragment.begin(), fragment.end(), '\\', '/');
+	vector<string> paths = fragment.empty() ? vector<string>() : search.FindPaths(fragment);
+	if (paths.empty())
+	{
+		wcout << L"No backed-up file matches \"" << input << L"\"." << endl;
+		system("pause");
+		return;
+	}
+
+	string path = paths[0];
+	if (paths.size() > 1)
+	{
+		const size_t kMaxListed = 50;
+		wcout << endl << L"   --- Matching files ---" << endl << endl;
+		for (size_t i = 0; i < paths.size() && i < kMaxListed; ++i)
+		{
+			wcout << L"    " << (i + 1) << L". " << s2ws(paths[i]) << endl;
+		}
+		if (paths.size() > kMaxListed)
+		{
+			wcout << L"    ... and " << paths.size() - kMaxListed << L" more (type more of the name to narrow it down)" << endl;
+		}
+		wcout << L"   Enter a number (or 'x' to cancel): ";
+		string choice;
+		getline(cin, choice);
+		try {
+			size_t index = stoul(choice) - 1;
+			if (index >= paths.size() || index >= kMaxListed) throw out_of_range("selection");
+			path = paths[index];
+		}
+		catch (const exception&) {
+			wcout << L"Cancelled." << endl;
+			system("pause");
+			return;
+		}
+	}
+
+	vector<FileVersion> versions = search.Versions(path);
+	wcout << endl << L"   --- Versions of " << s2ws(path) << L" (newest first) ---" << endl << endl;
+	for (size_t i = 0; i < versions.size(); ++i)
+	{
+		const FileVersion& version = versions[i];
+		wcout << L"    " << (i + 1) << L". modified " << FormatFolderDateTime(static_cast<time_t>(version.mtime / 1000000000))
+			<< L", " << (version.size + 1023) / 1024 << L" KB, in " << version.backups.size() << L" backup(s), newest "
+			<< version.backups.front() << endl;
+	}
+	wcout << L"   -------------------------------------------" << endl;
+	wcout << L"   Enter a number to restore that version (or 'x' to cancel): ";
+	string choice;
+	getline(cin, choice);
+	size_t index = 0;
+	try {
+		index = stoul(choice) - 1;
+		if (index >= versions.size()) throw out_of_range("selection");
+	}
+	catch (const exception&) {
+		wcout << L"Cancelled." << endl;
+		system("pause");
+		return;
+	}
+
+	fs::path backup = localGamePath / ToPath(versions[index].backups.front());
+	wcout << endl << L"   This will OVERWRITE " << s2ws(path) << L" in your save folder with" << endl;
+	wcout << L"   the copy in " << versions[index].backups.front() << L". ARE YOU SURE? (y/n)" << endl << L"> ";
+	string confirm;
+	getline(cin, confirm);
+	if (confirm != "y" && confirm != "Y")
+	{
+		wcout << L"Restore cancelled." << endl;
+		system("pause");
+		return;
+	}
+	try {
+		BackupManifest selection = LoadBackupIndex(backup).Select({ path });
+		RunWithProgress([&](OperationProgress& progress) { RestoreSelectedFiles(backup, selection, ToPath(selectedGame.savePath), &progress); });
+		wcout << L"Restored " << s2ws(path) << L" from " << versions[index].backups.front() << L"." << endl;
+	}
+	catch (const OperationCancelled&) { // A key was pressed during the copy
+		wcout << L"Restore cancelled; the save file was not changed." << endl;
+	}
+	catch (const fs::filesystem_error& e) {
+		wcout << L"RESTORE FAILED: " << s2ws(e.what()) << endl;
+	}
+	system("pause");
+}
+
 /**
  * @brief Opens the local backup folder for the specified game in Windows Explorer.
  */
 void OpenBackupFolder(const GameProfile& profile)
 {
-	wstring path = GetExePath() + L"\\Backups\\" + profile.name;
+	wstring path = GetLocalGameBackupDir(GetBackupsRoot(), profile).wstring();
 	ShellExecuteW(NULL, L"open", path.c_str(), NULL, NULL, SW_SHOWNORMAL);
 	// Use ShellExecuteW for wide paths
 }
@@ -2062,16 +2517,22 @@ void OpenBackupFolder(const GameProfile& profile)
  */
 void OpenCloudBackupFolder(const GameProfile& profile)
 {
-	// Check if cloud path is configured
-	if (g_GoogleDrivePath.empty())
+	// Check if cloud storage is configured
+	unique_ptr<StorageBackend> cloud = CreateStorageBackend(g_settings);
+	if (!cloud)
 	{
-		wcout << L"Cloud Sync path not set." << endl;
+		wcout << L"Cloud storage not set up." << endl;
 		// Message displayed in console
 		return;
 	}
 
-	wstring path = g_GoogleDrivePath + L"\\Game Save Backup Manager\\" + profile.name;
+	wstring path = cloud->LocalPath(GetStorageGamePrefix(profile)).wstring();
 	// Construct the path
+	if (path.empty())
+	{
+		wcout << L"Cloud backups are in an object store (" << s2ws(cloud->Kind()) << L"); there is no folder to open." << endl;
+		return;
+	}
 	// Check if the folder actually exists (might not if no cloud backups made yet)
 	if (!fs::exists(path))
 	{
@@ -2212,7 +2673,7 @@ void DetectAndSetGoogleDrivePath()
 		{
 			if (ValidateGoogleDrivePath(verifiedPath)) // Double-check validity
 			{
-				g_GoogleDrivePath = verifiedPath; // Update global variable
+				g_settings.googleDrivePath = verifiedPath; // Update global variable
 				SaveGlobalConfig();
 				// Save to INI
 				wcout << L"   Path saved!" << endl;
@@ -2242,7 +2703,7 @@ void DetectAndSetGoogleDrivePath()
 			{
 				if (ValidateGoogleDrivePath(guessPath)) // Validate the guessed path
 				{
-					g_GoogleDrivePath = guessPath; // Update global variable
+					g_settings.googleDrivePath = guessPath; // Update global variable
 					SaveGlobalConfig();
 					// Save to INI
 					wcout << L"   Path saved!" << endl;
@@ -2279,7 +2740,7 @@ void DetectAndSetGoogleDrivePath()
 	}
 	else if (ValidateGoogleDrivePath(manualPath)) // Validate user-provided path
 	{
-		g_GoogleDrivePath = manualPath; // Update global variable
+		g_settings.googleDrivePath = manualPath; // Update global variable
 		SaveGlobalConfig();
 		// Save to INI
 		wcout << L"   Path saved!" << endl;
@@ -2295,49 +2756,187 @@ void DetectAndSetGoogleDrivePath()
 
 /**
  * @brief Creates and starts the auto-save background thread.
- * @param profile The game profile to monitor (passed by value to the thread).
+ * @param profile The game profile to monitor (captured by value for the thread).
  */
 void CreateAutoSaveThread(const GameProfile& profile)
 {
-	g_keepAutoSaving = true;
-	// Set the flag to allow the thread loop to run
-	// Create and detach the thread, passing the profile data by value
-	g_autoSaveThread = thread(AutoSaveThreadFunction, profile);
-	// Detach if you don't plan to join it later, but joining on exit is safer.
-	// g_autoSaveThread.detach();
-	// Consider implications if using detach
+	if (profile.adaptiveAutoSave)
+	{
+		CreateAdaptiveAutoSaveThread(profile);
+		return;
+	}
+	// Triggers a backup every interval regardless of modification, until stopped. A due backup
+	// waits while the system is busy (the next interval counts from when it ran).
+	chrono::milliseconds interval = chrono::seconds(profile.autoSaveInterval);
+	auto gate = make_shared<LoadGate>(GetLoadGateOptions(g_settings));
+	g_autoSaveScheduler.StartAdaptive(interval, [profile, interval, gate](chrono::nanoseconds lateBy) -> chrono::milliseconds
+		{
+			thread_local bool named = false; // Each Start() runs on a new thread
+			if (!named) {
+				GetTracer().SetThreadName("auto-save");
+				named = true;
+			}
+			if (!gate->Deferring()) GetEngineMetrics().Latency(LatencyMetric::AutoSaveLag).Record(lateBy);
+			chrono::milliseconds wait = DeferAutoSave(profile, *gate);
+			if (wait.count() > 0) return wait;
+			try
+			{
+				BackupSaveFolder(profile, true); // Perform auto-save backup
+			}
+			catch (const exception& e) // Catch potential errors during backup
+			{
+				LogOperation(LogLevel::Error, profile, L"autosave", L"Auto-save thread backup error: " + s2ws(e.what()));
+			}
+			return interval;
+		});
 }
 
 /**
- * @brief The function executed by the auto-save thread.
- Triggers backups periodically based on the interval.
- * @param profile A copy of the game profile data for this thread.
+ * @brief Starts auto-saves for a monitored game. With a game executable set, they run only
+ * while the game does: the watcher starts them when it starts, and when it exits stops them and
+ * backs up its final save.
+ * @param profile The game profile to monitor (captured by value for the threads).
  */
-void AutoSaveThreadFunction(GameProfile profile) // Takes profile by value
+void StartAutoSaves(const GameProfile& profile)
 {
-	// Loop continues as long as g_keepAutoSaving is true
-	while (g_keepAutoSaving)
+	if (profile.gameExecutable.empty())
 	{
-		// Sleep for the specified interval, checking the stop flag every second
-		for (int i = 0; i < profile.autoSaveInterval; ++i)
+		CreateAutoSaveThread(profile);
+		return;
+	}
+	g_processWatcher.Start(profile.gameExecutable, [profile](bool running)
 		{
-			if (!g_keepAutoSaving) return; // Exit thread immediately if flag is false
-			this_thread::sleep_for(1s); // Sleep for 1 second
-		}
+			thread_local bool named = false;
+			if (!named) {
+				GetTracer().SetThreadName("process-watch");
+				named = true;
+			}
+			if (running)
+			{
+				// The interval (and adaptive baseline) counts from the game's start
+				LogOperation(LogLevel::Info, profile, L"process", L"[" + s2ws(GetCurrentDateTime()) + L"] [PROCESS] " + profile.gameExecutable + L" started. Auto-saves resumed.");
+				CreateAutoSaveThread(profile);
+				return;
+			}
+			g_autoSaveScheduler.Stop(); // Waits for an auto-save in progress
+			LogOperation(LogLevel::Info, profile, L"process", L"[" + s2ws(GetCurrentDateTime()) + L"] [PROCESS] " + profile.gameExecutable + L" exited. Backing up its final save; auto-saves paused until it starts again.");
+			try
+			{
+				BackupSaveFolder(profile, true);
+			}
+			catch (const exception& e)
+			{
+				LogOperation(LogLevel::Error, profile, L"process", L"Exit backup error: " + s2ws(e.what()));
+			}
+		});
+	if (g_processWatcher.IsGameRunning())
+	{
+		CreateAutoSaveThread(profile);
+	}
+	else
+	{
+		LogOperation(LogLevel::Info, profile, L"process", L"[" + s2ws(GetCurrentDateTime()) + L"] [PROCESS] Waiting for " + profile.gameExecutable + L" to start. Auto-saves paused.");
+	}
+}
 
-		if (!g_keepAutoSaving) return; // Check flag again after sleeping interval
+/**
+ * @brief Starts the adaptive auto-save thread: checks the save folder and backs up once a burst
+ * of writes settles (see AdaptiveAutoSave.h). Backups and changes of pace are logged with the
+ * bytes saved compared with a backup every autoSaveInterval.
+ * @param profile The game profile to monitor (captured by value for the thread).
+ */
+void CreateAdaptiveAutoSaveThread(const GameProfile& profile)
+{
+	AdaptiveAutoSaveOptions options;
+	options.floor = chrono::seconds(profile.autoSaveFloor);
+	options.maximum = chrono::seconds(profile.autoSaveInterval);
+	uint64_t fingerprint = 0;
+	try { fingerprint = SaveFolderFingerprint(ScanTree(ToPath(profile.savePath))); }
+	catch (const fs::filesystem_error&) {} // Missing for now: the first check sees it appear
+	auto policy = make_shared<AdaptiveAutoSave>(options, chrono::steady_clock::now(), fingerprint);
+	auto gate = make_shared<LoadGate>(GetLoadGateOptions(g_settings));
+	struct LoopState
+	{
+		chrono::seconds lastCheck{ 0 }; // Delay last logged
+		bool backupDue = false;         // Decided, but waiting for the system load to drop
+	};
+	auto state = make_shared<LoopState>();
 
-		// --- Perform backup regardless of modification ---
-		try
+	g_autoSaveScheduler.StartAdaptive(options.floor, [profile, policy, gate, state, options](chrono::nanoseconds lateBy) -> chrono::milliseconds
 		{
-			BackupSaveFolder(profile, true); // Perform auto-save backup
-		}
-		catch (const exception& e) // Catch potential errors during backup
+			thread_local bool named = false; // Each Start() runs on a new thread
+			if (!named) {
+				GetTracer().SetThreadName("auto-save");
+				named = true;
+			}
+			if (!state->backupDue)
+			{
+				GetEngineMetrics().Latency(LatencyMetric::AutoSaveLag).Record(lateBy);
+				TreeScan scan;
+				try { scan = ScanTree(ToPath(profile.savePath)); }
+				catch (const fs::filesystem_error&) {
+					return options.floor; // Save folder unavailable; the backup would fail too
+				}
+
+				AutoSaveDecision decision = policy->Check(chrono::steady_clock::now(), SaveFolderFingerprint(scan), scan.bytes);
+				const AdaptiveAutoSaveStats& stats = policy->Stats();
+				if (decision.action == AutoSaveAction::Backup || decision.nextCheck != state->lastCheck)
+				{
+					// Decision log: backups and changes of pace only, not every check
+					wstringstream wss;
+					wss << L"[" << s2ws(GetCurrentDateTime()) << L"] [ADAPTIVE] " << (decision.action == AutoSaveAction::Backup ? L"Backing up: " : L"Waiting: ")
+						<< decision.reason << L", next check in " << decision.nextCheck.count() << L" s. " << stats.backups << L" backup(s) vs "
+						<< stats.fixedScheduleBackups << L" on a fixed schedule (" << stats.BytesSaved() / 1024 << L" KB saved).";
+					LogOperation(decision.action == AutoSaveAction::Backup ? LogLevel::Info : LogLevel::Debug, profile, L"autosave", wss.str());
+					state->lastCheck = decision.nextCheck;
+				}
+				if (decision.action != AutoSaveAction::Backup) return decision.nextCheck;
+				state->backupDue = true;
+			}
+
+			chrono::milliseconds wait = DeferAutoSave(profile, *gate);
+			if (wait.count() > 0) return wait;
+			state->backupDue = false;
+			try
+			{
+				BackupSaveFolder(profile, true); // Perform auto-save backup
+			}
+			catch (const exception& e) // Catch potential errors during backup
+			{
+				LogOperation(LogLevel::Error, profile, L"autosave", L"Auto-save thread backup error: " + s2ws(e.what()));
+			}
+			return state->lastCheck; // The pace the policy chose with this backup
+		});
+}
+
+/**
+ * @brief Asks the load gate whether a due auto-save may start, and logs when one starts to wait
+ * and when it finally runs. Manual backups never come here.
+ * @return 0 to back up now, otherwise how long to wait before asking again.
+ */
+chrono::milliseconds DeferAutoSave(const GameProfile& profile, LoadGate& gate)
+{
+	bool waiting = gate.Deferring();
+	LoadGateDecision decision = gate.Check(chrono::steady_clock::now());
+	wstringstream wss;
+	wss << L"[" << s2ws(GetCurrentDateTime()) << L"] [LOAD] " << fixed << setprecision(1);
+	if (!decision.run)
+	{
+		if (!waiting)
 		{
-			wcout << L"Auto-save thread backup error: " << s2ws(e.what()) << endl;
-			// Consider adding a longer sleep here to avoid spamming errors if backup fails repeatedly
+			wss << L"System busy (CPU " << decision.load.cpuPressure << L"%, I/O " << decision.load.ioPressure
+				<< L"% stalled): auto-save waits up to " << GetLoadGateOptions(g_settings).maxDelay.count() << L" s.";
+			LogOperation(LogLevel::Info, profile, L"autosave", wss.str());
 		}
-	} // End while loop
+		return decision.retryIn;
+	}
+	if (waiting)
+	{
+		wss << L"Auto-save starting after waiting " << chrono::duration_cast<chrono::seconds>(decision.deferredFor).count() << L" s"
+			<< (decision.gaveUp ? L" (limit reached, system still busy)." : L".");
+		LogOperation(LogLevel::Info, profile, L"autosave", wss.str());
+	}
+	return chrono::milliseconds(0);
 }
 
 /**
@@ -2374,56 +2973,39 @@ wstring GetExeFilename()
 
 
 /**
- * @brief Converts a standard UTF-8 string to a wide string (wstring).
- * @param str The input UTF-8 string.
- * @return The converted wide string.
+ * @brief Gets the local "Backups" folder next to the executable.
  */
-wstring s2ws(const string& str)
+fs::path GetBackupsRoot()
 {
-	if (str.empty()) return L"";
-	// Handle empty input
-	// Calculate required buffer size
-	int size_needed = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
-	wstring wstrTo(size_needed, 0);
-	// Allocate wstring buffer
-	// Perform conversion
-	MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], size_needed);
-	return wstrTo;
+	return fs::path(GetExePath()) / L"Backups";
 }
 
 /**
- * @brief Converts a wide string (wstring) to a standard UTF-8 string.
- * @param wstr The input wide string.
- * @return The converted UTF-8 string.
+ * @brief True if the backend chosen under [CloudStorage] has what it needs
+ * (a cloud folder for sync-folder/local, an endpoint and bucket for s3).
  */
-string ws2s(const wstring& wstr)
+bool IsCloudConfigured()
 {
-	if (wstr.empty()) return "";
-	// Handle empty input
-	// Calculate required buffer size
-	int size_needed = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
-	string strTo(size_needed, 0); // Allocate string buffer
-	// Perform conversion
-	WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], size_needed, NULL, NULL);
-	return strTo;
+	return CreateStorageBackend(g_settings) != nullptr;
 }
 
 /**
- * @brief Checks if a directory exists using stat (legacy method).
- * @param path Path to check (narrow string).
- * @return True if path exists and is a directory, False otherwise.
+ * @brief Writes the current engine metrics to Metrics\metrics.json and Metrics\metrics.prom.
  */
-bool DirectoryExists(const char* path)
+void WriteMetricsSnapshot()
 {
-	struct stat info;
-	if (stat(path, &info) != 0) // stat returns 0 on success
-		return false;
-	// Path doesn't exist or error occurred
-	else if (info.st_mode & S_IFDIR) // Check if the directory flag is set
-		return true;
-	// It's a directory
-	else
-		return false; // It exists but is not a directory
+	fs::path metricsPath = fs::path(GetExePath()) / L"Metrics";
+	WriteMetricsFiles(GetEngineMetrics(), metricsPath / L"metrics.json", metricsPath / L"metrics.prom");
+}
+
+/**
+ * @brief Writes the trace recorded this session to Logs\trace-<epoch>.json (no-op when tracing is off).
+ */
+void StopTracing()
+{
+	if (!GetTracer().Enabled()) return;
+	long long epochTime = static_cast<long long>(chrono::system_clock::to_time_t(chrono::system_clock::now()));
+	GetTracer().StopAndWrite(fs::path(GetExePath()) / L"Logs" / (L"trace-" + to_wstring(epochTime) + L".json"));
 }
 
 /**
@@ -2440,6 +3022,8 @@ bool CheckExecutionDirectory() {
 	allowedItems.push_back(L"Config");      // Config folder
 	allowedItems.push_back(L"Backups");
 	// Backups folder
+	allowedItems.push_back(L"Metrics");     // Metrics export folder
+	allowedItems.push_back(L"Logs");        // Rotating operation log
 	// Note: Add runtime DLLs here if using dynamic linking and shipping them
 
 	vector<wstring> anomalies;
@@ -2510,41 +3094,25 @@ bool CheckExecutionDirectory() {
 }
 
 /**
- * @brief Creates the required Config and Backups subdirectories if they don't exist.
+ * @brief Creates the required Config, Backups, Metrics and Logs subdirectories if they don't exist.
  * Throws fs::filesystem_error on failure (e.g., lack of permissions).
  */
 void CreateRequiredDirectories()
 {
-	string configPath = ws2s(GetExePath()) + "\\Config";
-	string backupsPath = ws2s(GetExePath()) + "\\Backups";
+	fs::path configPath = fs::path(GetExePath()) / L"Config";
+	fs::path backupsPath = GetBackupsRoot();
+	fs::path metricsPath = fs::path(GetExePath()) / L"Metrics";
+	fs::path logsPath = fs::path(GetExePath()) / L"Logs";
 
 	// Use C++17 filesystem to create directories; throws on error
 	if (!fs::exists(configPath))
 		fs::create_directories(configPath);
 	if (!fs::exists(backupsPath))
 		fs::create_directories(backupsPath);
-}
-
-/**
- * @brief Gets the current date and time formatted as "YYYY-MM-DD HH:MM:SS".
- * @return Formatted date/time string.
- */
-string GetCurrentDateTime()
-{
-	time_t now = time(0); // Get current time_t
-	tm ltm;
-	localtime_s(&ltm, &now);
-	// Convert to local time struct (safe version)
-	// Use stringstream for formatted output
-	stringstream ss;
-	ss << (1900 + ltm.tm_year) << "-" // Year is years since 1900
-		<< setfill('0') << setw(2) << (1 + ltm.tm_mon) << "-" // Month is 0-11
-		<< setfill('0') << setw(2) << ltm.tm_mday << " " // Day of month
-		<< setfill('0') << setw(2) << ltm.tm_hour << ":" // Hour (0-23)
-		<< setfill('0') << setw(2) << ltm.tm_min << ":" // Minute (0-59)
-		<< setfill('0') << setw(2) << ltm.tm_sec;
-	// Second (0-59)
-	return ss.str();
+	if (!fs::exists(metricsPath))
+		fs::create_directories(metricsPath);
+	if (!fs::exists(logsPath))
+		fs::create_directories(logsPath);
 }
 
 /**
@@ -2611,6 +3179,8 @@ void RegisterHotKeys()
 	RegisterHotKey(NULL, 6, MOD_CONTROL, 0x47); // CTRL+G (Open Cloud Folder)
 	RegisterHotKey(NULL, 7, MOD_CONTROL, 0x4C); // CTRL+L (List Restores)
 	RegisterHotKey(NULL, 8, MOD_CONTROL, 0x50); // CTRL+P (Open Save Path)
+	RegisterHotKey(NULL, 9, MOD_CONTROL, 0x54); // CTRL+T (Latency Stats)
+	RegisterHotKey(NULL, 10, MOD_CONTROL | MOD_SHIFT, 0x54); // CTRL+SHIFT+T (Reset Latency Stats)
 }
 
 /**
@@ -2626,6 +3196,8 @@ void UnRegisterHotKeys()
 	UnregisterHotKey(NULL, 6);
 	UnregisterHotKey(NULL, 7);
 	UnregisterHotKey(NULL, 8);
+	UnregisterHotKey(NULL, 9);
+	UnregisterHotKey(NULL, 10);
 }
 
 /**
@@ -2635,55 +3207,14 @@ void UnRegisterHotKeys()
  */
 void onSigBreakSignal(int s)
 {
-	g_keepAutoSaving = false; // Signal thread to stop
-	if (g_autoSaveThread.joinable())
-		g_autoSaveThread.join(); // Wait for thread to exit cleanly
+	g_processWatcher.Stop();
+	g_autoSaveScheduler.Stop(); // Stop the thread and wait for it to exit cleanly
+	WaitForContentSweeps(); // Shared-storage sweeps the backups queued
+	g_metricsExporter.Stop();
+	WriteMetricsSnapshot();
+	StopTracing();
+	GetLogger().Stop(); // Writes any queued lines
 	UnRegisterHotKeys();
 	// Clean up hotkeys
 	exit(1); // Exit program
 }
-
-/**
- * @brief Checks if a given wide string is a valid filename/directory name on Windows,
- * excluding reserved characters and names.
- * @param name The wide string name to check.
- * @return True if valid, False otherwise.
- */
-bool IsValidFilename(const wstring& name)
-{
-	if (name.empty()) // Cannot be empty
-	{
-		return false;
-	}
-	// Check for invalid characters
-	for (wchar_t c : name)
-	{
-		// Characters forbidden in Windows filenames/paths
-		if (c == L'<' || c == L'>' || c == L':' || c == L'"' || c == L'/' || c == L'\\' || c == L'|' || c == L'?' || c == L'*')
-		{
-			return false;
-		}
-		// ASCII Control characters (0-31) are also invalid
-		if (c < 32) return false;
-	}
-	// Check for reserved filenames (case-insensitive)
-	wstring upperName = name;
-	transform(upperName.begin(), upperName.end(), upperName.begin(), ::towupper); // Convert to uppercase for comparison
-	// Standard reserved names
-	if (upperName == L"CON" || upperName == L"PRN" || upperName == L"AUX" || upperName == L"NUL" ||
-		// COM1-COM9
-		(upperName.length() ==
-			4 && upperName.substr(0, 3) == L"COM" && upperName[3] >= L'1' && upperName[3] <= L'9') ||
-		// LPT1-LPT9
-		(upperName.length() == 4 && upperName.substr(0, 3) == L"LPT" && upperName[3] >= L'1' && upperName[3] <= L'9')) {
-		return false;
-	}
-	// Check for trailing spaces or dots, which are problematic
-	if (!name.empty() && (name.back() == L' ' ||
-		name.back() == L'.')) {
-		return false;
-	}
-
-	// If none of the checks failed, the name is valid
-	return true;
-}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "TestHarness.h"
+#include "AdaptiveAutoSave.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	using Clock = AdaptiveAutoSave::Clock;
+
+	AdaptiveAutoSaveOptions Options()
+	{
+		AdaptiveAutoSaveOptions options;
+		options.floor = chrono::seconds(60);
+		options.maximum = chrono::seconds(600);
+		return options;
+	}
+}
+
+TEST_CASE("Save folder fingerprints follow sizes, times and names")
+{
+	TempDir dir;
+	WriteTestFile(dir.path() / "slot1.sav", "one");
+	uint64_t first = SaveFolderFingerprint(ScanTree(dir.path()));
+	CHECK_EQ(SaveFolderFingerprint(ScanTree(dir.path())), first);
+
+	fs::last_write_time(dir.path() / "slot1.sav", fs::last_write_time(dir.path() / "slot1.sav") + chrono::seconds(5));
+	uint64_t touched = SaveFolderFingerprint(ScanTree(dir.path()));
+	CHECK(touched != first);
+	fs::rename(dir.path() / "slot1.sav", dir.path() / "slot2.sav");
+	CHECK(SaveFolderFingerprint(ScanTree(dir.path())) != touched);
+}
+
+TEST_CASE("Adaptive auto-save backs up once a burst settles, never below the floor")
+{
+	Clock::time_point start{};
+	AdaptiveAutoSave policy(Options(), start, 1);
+
+	// Idle: no backup, checks back off toward the maximum
+	AutoSaveDecision decision = policy.Check(start + chrono::seconds(60), 1, 1000);
+	CHECK(decision.action == AutoSaveAction::Wait);
+	CHECK_EQ(decision.nextCheck.count(), 120);
+	decision = policy.Check(start + chrono::seconds(180), 1, 1000);
+	CHECK_EQ(decision.nextCheck.count(), 240);
+	decision = policy.Check(start + chrono::seconds(420), 1, 1000);
+	CHECK_EQ(decision.nextCheck.count(), 480);
+	decision = policy.Check(start + chrono::seconds(900), 1, 1000);
+	CHECK_EQ(decision.nextCheck.count(), 600);
+
+	// The game saves: watched at the floor, backed up at the first quiet check
+	decision = policy.Check(start + chrono::seconds(1500), 2, 1000);
+	CHECK(decision.action == AutoSaveAction::Wait);
+	CHECK_EQ(decision.nextCheck.count(), 60);
+	decision = policy.Check(start + chrono::seconds(1560), 3, 1000);
+	CHECK(decision.action == AutoSaveAction::Wait);
+	decision = policy.Check(start + chrono::seconds(1620), 3, 1000);
+	CHECK(decision.action == AutoSaveAction::Backup);
+	CHECK(decision.reason == L"changes settled");
+	decision = policy.Check(start + chrono::seconds(1740), 3, 1000);
+	CHECK(decision.action == AutoSaveAction::Wait);
+
+	// A quick second save waits for the floor to pass since the last backup
+	AdaptiveAutoSave quick(Options(), start, 1);
+	quick.Check(start + chrono::seconds(60), 2, 10);
+	CHECK(quick.Check(start + chrono::seconds(120), 2, 10).action == AutoSaveAction::Backup);
+	quick.Check(start + chrono::seconds(150), 3, 10);
+	CHECK(quick.Check(start + chrono::seconds(170), 3, 10).action == AutoSaveAction::Wait); // 50 s after the backup
+	CHECK(quick.Check(start + chrono::seconds(180), 3, 10).action == AutoSaveAction::Backup);
+}
+
+TEST_CASE("Adaptive auto-save backs up a folder that never settles at the maximum")
+{
+	Clock::time_point start{};
+	AdaptiveAutoSave policy(Options(), start, 0);
+	int backups = 0;
+	for (int minute = 1; minute <= 30; ++minute)
+	{
+		AutoSaveDecision decision = policy.Check(start + chrono::minutes(minute), static_cast<uint64_t>(minute), 1000);
+		CHECK_EQ(decision.nextCheck.count(), 60);
+		if (decision.action == AutoSaveAction::Backup) backups++;
+	}
+	CHECK_EQ(backups, 2); // 10 minutes after the first change was seen, then every 10 minutes
+	CHECK_EQ(policy.Stats().fixedScheduleBackups, 3u);
+	CHECK_EQ(policy.Stats().BytesSaved(), 1000);
+}
+
+TEST_CASE("Adaptive auto-save learns the gap between bursts and reports the bytes saved")
+{
+	Clock::time_point start{};
+	AdaptiveAutoSaveOptions options = Options();
+	options.maximum = chrono::seconds(3600);
+	AdaptiveAutoSave policy(options, start, 0);
+
+	// The game saves every 8 minutes; checks while idle stay around half that
+	uint64_t fingerprint = 0;
+	chrono::seconds now{ 0 };
+	chrono::seconds next{ 60 };
+	for (int check = 0; check < 60; ++check)
+	{
+		now += next;
+		if (now.count() / 480 != (now - next).count() / 480) fingerprint++; // A save since the last check
+		AutoSaveDecision decision = policy.Check(start + now, fingerprint, 1024 * 1024);
+		next = decision.nextCheck;
+		CHECK(next >= options.floor);
+	}
+	CHECK(policy.LearnedGap() >= chrono::seconds(420));
+	CHECK(policy.LearnedGap() <= chrono::seconds(540));
+	CHECK(next <= chrono::seconds(180));
+
+	// An hourly fixed schedule made fewer backups here. Once the gap was learned, each save got its own backup.
+	const AdaptiveAutoSaveStats& stats = policy.Stats();
+	CHECK(stats.backups + 2 >= fingerprint);
+	CHECK(stats.BytesSaved() < 0);
+	CHECK_EQ(stats.bytesBackedUp, stats.backups * 1024 * 1024);
+}
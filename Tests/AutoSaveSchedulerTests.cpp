@@ -0,0 +1,76 @@
+#include "TestHarness.h"
+#include "AutoSaveScheduler.h"
+
+#include <atomic>
+
+using namespace std;
+
+TEST_CASE("Scheduler runs the task repeatedly at the interval")
+{
+	AutoSaveScheduler scheduler;
+	atomic<int> runs{ 0 };
+	scheduler.Start(chrono::milliseconds(20), [&] { ++runs; });
+	CHECK(scheduler.IsRunning());
+	this_thread::sleep_for(chrono::milliseconds(150));
+	scheduler.Stop();
+	CHECK(!scheduler.IsRunning());
+	int seen = runs;
+	CHECK(seen >= 2);
+	this_thread::sleep_for(chrono::milliseconds(60));
+	CHECK(runs == seen); // Nothing runs after Stop()
+}
+
+TEST_CASE("Scheduler Stop() does not wait for the interval to elapse")
+{
+	AutoSaveScheduler scheduler;
+	atomic<int> runs{ 0 };
+	scheduler.Start(chrono::hours(1), [&] { ++runs; });
+	auto start = chrono::steady_clock::now();
+	scheduler.Stop();
+	CHECK(chrono::steady_clock::now() - start < chrono::seconds(1));
+	CHECK(runs == 0);
+}
+
+TEST_CASE("Scheduler can be restarted")
+{
+	AutoSaveScheduler scheduler;
+	atomic<int> runs{ 0 };
+	scheduler.Start(chrono::hours(1), [&] { ++runs; });
+	scheduler.Start(chrono::milliseconds(10), [&] { runs += 10; });
+	this_thread::sleep_for(chrono::milliseconds(80));
+	scheduler.Stop();
+	CHECK(runs >= 10);
+	CHECK(runs % 10 == 0);
+}
+
+TEST_CASE("StartWithLag reports how late each run started")
+{
+	AutoSaveScheduler scheduler;
+	atomic<int> runs{ 0 };
+	atomic<bool> negative{ false };
+	scheduler.StartWithLag(chrono::milliseconds(10), [&](chrono::nanoseconds lateBy)
+		{
+			if (lateBy < chrono::nanoseconds(0)) negative = true;
+			++runs;
+		});
+	this_thread::sleep_for(chrono::milliseconds(80));
+	scheduler.Stop();
+	CHECK(runs >= 2);
+	CHECK(!negative); // A run never starts before its scheduled time
+}
+
+TEST_CASE("StartAdaptive waits the delay each run returns")
+{
+	AutoSaveScheduler scheduler;
+	atomic<int> runs{ 0 };
+	scheduler.StartAdaptive(chrono::milliseconds(5), [&](chrono::nanoseconds) -> chrono::milliseconds
+		{
+			// Fast twice, then an hour: no further runs before Stop()
+			return ++runs < 2 ? chrono::milliseconds(5) : chrono::milliseconds(chrono::hours(1));
+		});
+	this_thread::sleep_for(chrono::milliseconds(100));
+	auto start = chrono::steady_clock::now();
+	scheduler.Stop();
+	CHECK(chrono::steady_clock::now() - start < chrono::seconds(1));
+	CHECK(runs == 2);
+}
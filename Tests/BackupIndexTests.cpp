@@ -0,0 +1,305 @@
+#include "TestHarness.h"
+#include "BackupIndex.h"
+#include "BackupOperations.h"
+#include "ChunkStore.h"
+#include "EngineUtils.h"
+#include "Sha256.h"
+#include "StorageBackend.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	const ManifestEntry* Find(const BackupManifest& manifest, const string& path)
+	{
+		auto it = find_if(manifest.entries.begin(), manifest.entries.end(), [&](const ManifestEntry& e) { return e.path == path; });
+		return it == manifest.entries.end() ? nullptr : &*it;
+	}
+}
+
+TEST_CASE("A backup writes an index with the save folder's sizes and times")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot1.sav", "first slot");
+	WriteTestFile(save / "profiles" / "p1" / "slot2.sav", "second");
+	auto old = fs::file_time_type::clock::now() - chrono::hours(30);
+	fs::last_write_time(save / "slot1.sav", old);
+
+	GameProfile profile{ L"Indexed", PathToWide(save), 60, false, L"indexed" };
+	BackupResult result = BackupSaveFolder(profile, GlobalSettings{}, dir.path() / "Backups", false);
+	REQUIRE(result.localSuccess);
+	fs::path gameDir = GetLocalGameBackupDir(dir.path() / "Backups", profile);
+	fs::path backup = gameDir / ToPath(result.folderName);
+	REQUIRE(fs::exists(GetBackupIndexPath(gameDir, result.folderName)));
+
+	// The index, not the folder, answers: a file removed from the backup is still listed
+	fs::remove(backup / "slot1.sav");
+	BackupManifest index = LoadBackupIndex(backup);
+	const ManifestEntry* slot1 = Find(index, "slot1.sav");
+	REQUIRE(slot1 != nullptr);
+	CHECK_EQ(slot1->size, 10u);
+	CHECK_EQ(slot1->mtime, FileTimeToUnixNanos(old));
+	REQUIRE(Find(index, "profiles/p1") != nullptr);
+	CHECK(Find(index, "profiles/p1")->type == fs::file_type::directory);
+	CHECK(Find(index, "profiles/p1/slot2.sav") != nullptr);
+
+	// Index folders are not backups
+	CHECK_EQ(ListBackups(gameDir).size(), 1u);
+}
+
+TEST_CASE("Backups without an index get one built on first use")
+{
+	TempDir dir;
+	fs::path backup = dir.path() / "game" / "100-[x]-M";
+	WriteTestFile(backup / "a.sav", "aaa");
+	WriteTestFile(backup / "sub" / "b.sav", "bbbbb");
+
+	BackupManifest index = LoadBackupIndex(backup);
+	CHECK_EQ(index.entries.size(), 3u);
+	CHECK_EQ(index.TotalBytes(), 8u);
+	CHECK(fs::exists(GetBackupIndexPath(dir.path() / "game", L"100-[x]-M")));
+
+	// A damaged index is rebuilt rather than trusted
+	WriteTestFile(GetBackupIndexPath(dir.path() / "game", L"100-[x]-M"), "garbage");
+	CHECK_EQ(LoadBackupIndex(backup).entries.size(), 3u);
+
+	vector<wstring> log;
+	WriteTestFile(dir.path() / "game" / "200-[x]-M" / "a.sav", "newer");
+	PurgeBackups(dir.path() / "game", L"M", 0, 1, L"Local", log);
+	CHECK(!fs::exists(backup));
+	CHECK(!fs::exists(GetBackupIndexPath(dir.path() / "game", L"100-[x]-M")));
+}
+
+TEST_CASE("Select picks files and whole subtrees by path")
+{
+	BackupManifest manifest;
+	for (const char* path : { "a.sav", "sub", "sub/b.sav", "sub/deeper/c.sav", "subway.sav" })
+	{
+		ManifestEntry entry;
+		entry.path = path;
+		manifest.entries.push_back(entry);
+	}
+	CHECK_EQ(manifest.Select({ "sub" }).entries.size(), 3u); // Not "subway.sav"
+	CHECK_EQ(manifest.Select({ "sub/" }).entries.size(), 3u);
+	CHECK_EQ(manifest.Select({ "a.sav", "subway.sav" }).entries.size(), 2u);
+	CHECK_EQ(manifest.Select({ "" }).entries.size(), 5u);
+	CHECK(manifest.Select({ "missing" }).entries.empty());
+	CHECK(manifest.Select({}).entries.empty());
+}
+
+TEST_CASE("RestoreSelectedFiles replaces only the chosen files")
+{
+	TempDir dir;
+	fs::path backup = dir.path() / "game" / "100-[x]-M";
+	fs::path save = dir.path() / "save";
+	WriteTestFile(backup / "slot1.sav", "backup one");
+	WriteTestFile(backup / "slot2.sav", "backup two");
+	WriteTestFile(backup / "sub" / "slot3.sav", "backup three");
+	WriteTestFile(save / "slot1.sav", "live one");
+	WriteTestFile(save / "slot2.sav", "live two");
+	WriteTestFile(save / "new.sav", "made after the backup");
+
+	BackupManifest index = LoadBackupIndex(backup);
+	CopyStats stats = RestoreSelectedFiles(backup, index.Select({ "slot2.sav", "sub" }), save);
+	CHECK_EQ(stats.filesCopied, 2u);
+	CHECK_EQ(ReadTestFile(save / "slot1.sav"), string("live one"));
+	CHECK_EQ(ReadTestFile(save / "slot2.sav"), string("backup two"));
+	CHECK_EQ(ReadTestFile(save / "sub" / "slot3.sav"), string("backup three"));
+	CHECK_EQ(ReadTestFile(save / "new.sav"), string("made after the backup"));
+	CHECK(!fs::exists(save / "slot2.sav.partial"));
+
+	BackupManifest escape;
+	ManifestEntry outside;
+	outside.path = "../escape.sav";
+	escape.entries.push_back(outside);
+	bool threw = false;
+	try { RestoreSelectedFiles(backup, escape, save); }
+	catch (const fs::filesystem_error&) { threw = true; }
+	CHECK(threw);
+
+	// A rename that fails after others went through (a folder in the way of the last file) puts
+	// back the files already replaced and removes the folders it created
+	fs::remove(save / "slot2.sav");
+	WriteTestFile(save / "slot2.sav" / "in-the-way", "x");
+	fs::remove_all(save / "sub");
+	BackupManifest ordered = index.Select({ "sub" });
+	for (const char* path : { "slot1.sav", "slot2.sav" }) ordered.entries.push_back(index.Select({ path }).entries.at(0));
+	threw = false;
+	try { RestoreSelectedFiles(backup, ordered, save); }
+	catch (const fs::filesystem_error&) { threw = true; }
+	CHECK(threw);
+	CHECK_EQ(ReadTestFile(save / "slot1.sav"), string("live one"));
+	CHECK(!fs::exists(save / "slot1.sav.gsbm-previous"));
+	CHECK(!fs::exists(save / "slot2.sav.partial"));
+	CHECK(!fs::exists(save / "sub"));
+	CHECK(fs::exists(save / "slot2.sav" / "in-the-way"));
+}
+
+TEST_CASE("A single file comes back from a chunked cloud backup without the other chunks")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "keep.sav", "the slot we want back");
+	WriteTestFile(save / "other.sav", "a slot we do not need");
+	LocalDirectoryBackend backend(dir.path() / "cloud");
+	ChunkIndex index(GetChunkIndexPath(dir.path() / "Backups"), backend, "game/");
+	PutChunkedBackup(backend, ScanTree(save), save, "game/", "1-first-M", index);
+
+	BackupManifest stored = GetStoredBackupIndex(backend, "game/1-first-M/");
+	REQUIRE(stored.entries.size() == 2);
+	const ManifestEntry* other = Find(stored, "other.sav");
+	REQUIRE(other != nullptr);
+	fs::remove(backend.LocalPath(GetChunkKey("game/", other->chunks[0].id))); // Proves it is never read
+
+	fs::path live = dir.path() / "live";
+	WriteTestFile(live / "other.sav", "live other");
+	CopyStats stats = DownloadStoredFiles(backend, "game/1-first-M/", stored.Select({ "keep.sav" }), live);
+	CHECK_EQ(stats.filesCopied, 1u);
+	CHECK_EQ(ReadTestFile(live / "keep.sav"), string("the slot we want back"));
+	CHECK_EQ(ReadTestFile(live / "other.sav"), string("live other"));
+}
+
+TEST_CASE("Files of a plain cloud backup are listed and restored one by one")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "a.sav", "alpha");
+	WriteTestFile(save / "sub" / "b.sav", "bravo");
+	LocalDirectoryBackend backend(dir.path() / "cloud");
+	backend.PutTree(ScanTree(save), save, "game/1-first-M/");
+
+	BackupManifest stored = GetStoredBackupIndex(backend, "game/1-first-M/");
+	CHECK_EQ(stored.entries.size(), 2u);
+	CHECK_EQ(stored.TotalBytes(), 10u);
+	fs::path live = dir.path() / "live";
+	DownloadStoredFiles(backend, "game/1-first-M/", stored.Select({ "sub" }), live);
+	CHECK_EQ(ReadTestFile(live / "sub" / "b.sav"), string("bravo"));
+	CHECK(!fs::exists(live / "a.sav"));
+}
+
+TEST_CASE("DiffBackups lists added, removed and modified files with their sizes")
+{
+	auto manifestOf = [](initializer_list<tuple<const char*, uint64_t, int64_t>> files)
+		{
+			BackupManifest manifest;
+			ManifestEntry folder;
+			folder.path = "sub";
+			folder.type = fs::file_type::directory;
+			manifest.entries.push_back(folder);
+			for (const auto& [path, size, mtime] : files)
+			{
+				ManifestEntry entry;
+				entry.path = path;
+				entry.size = size;
+				entry.mtime = mtime;
+				manifest.entries.push_back(entry);
+			}
+			return manifest;
+		};
+	// Deliberately out of path order on one side
+	BackupManifest before = manifestOf({ { "sub/b.sav", 10, 1 }, { "a.sav", 5, 1 }, { "gone.sav", 7, 1 }, { "same.sav", 3, 1 }, { "touched.sav", 4, 1 } });
+	BackupManifest after = manifestOf({ { "a.sav", 5, 1 }, { "new.sav", 9, 2 }, { "same.sav", 3, 1 }, { "sub/b.sav", 25, 2 }, { "touched.sav", 4, 2 } });
+
+	BackupDiff diff = DiffBackups(before, after);
+	REQUIRE(diff.changes.size() == 4);
+	CHECK_EQ(diff.added, 1u);
+	CHECK_EQ(diff.removed, 1u);
+	CHECK_EQ(diff.modified, 2u);
+	CHECK_EQ(diff.sizeDelta, int64_t(9 + 15 - 7));
+	CHECK_EQ(diff.changes[0].path, string("gone.sav"));
+	CHECK(diff.changes[0].kind == FileChange::Kind::Removed);
+	CHECK_EQ(diff.changes[0].oldSize, 7u);
+	CHECK_EQ(diff.changes[1].path, string("new.sav"));
+	CHECK(diff.changes[1].kind == FileChange::Kind::Added);
+	CHECK_EQ(diff.changes[2].path, string("sub/b.sav"));
+	CHECK_EQ(diff.changes[2].oldSize, 10u);
+	CHECK_EQ(diff.changes[2].newSize, 25u);
+	CHECK_EQ(diff.changes[3].path, string("touched.sav")); // Same size, newer time
+
+	// Matching digests win over differing times
+	before.entries.back().sha256 = after.entries.back().sha256 = Sha256Hex("same");
+	CHECK_EQ(DiffBackups(before, after).modified, 1u);
+	CHECK(DiffBackups(after, after).changes.empty());
+}
+
+TEST_CASE("A backup compares with the live save folder without reading its files")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot1.sav", "first slot");
+	WriteTestFile(save / "slot2.sav", "second slot");
+	GameProfile profile{ L"Compared", PathToWide(save), 60, false, L"compared" };
+	BackupResult result = BackupSaveFolder(profile, GlobalSettings{}, dir.path() / "Backups", false);
+	REQUIRE(result.localSuccess);
+	fs::path backup = GetLocalGameBackupDir(dir.path() / "Backups", profile) / ToPath(result.folderName);
+
+	CHECK(DiffBackups(LoadBackupIndex(backup), ManifestFromScan(ScanTree(save), save)).changes.empty());
+
+	WriteTestFile(save / "slot1.sav", "first slot, further along");
+	fs::remove(save / "slot2.sav");
+	WriteTestFile(save / "extra" / "slot3.sav", "third");
+	fs::remove_all(backup); // The index alone describes the backup
+	BackupDiff diff = DiffBackups(LoadBackupIndex(backup), ManifestFromScan(ScanTree(save), save));
+	REQUIRE(diff.changes.size() == 3);
+	CHECK_EQ(diff.changes[0].path, string("extra/slot3.sav"));
+	CHECK(diff.changes[1].kind == FileChange::Kind::Modified);
+	CHECK(diff.changes[2].kind == FileChange::Kind::Removed);
+	CHECK_EQ(diff.sizeDelta, int64_t(5 + 15 - 11));
+}
+
+TEST_CASE("Manifests survive a round trip, and malformed ones are rejected")
+{
+	BackupManifest manifest;
+	ManifestEntry folder;
+	folder.path = "tab\there";
+	folder.type = fs::file_type::directory;
+	ManifestEntry file;
+	file.path = "tab\there/save.sav";
+	file.size = 12;
+	file.mtime = -5;
+	file.sha256 = Sha256Hex("x");
+	file.chunks = { { "c1", 4 }, { "c2", 8 } };
+	ManifestEntry link;
+	link.path = "link";
+	link.type = fs::file_type::symlink;
+	link.linkTarget = "tab\there\\save.sav";
+	ManifestEntry image;
+	image.path = "disk.img";
+	image.size = 1 << 20;
+	image.sparse = true;
+	image.extents = { { 0, 4096 }, { 65536, 8192 } };
+	ManifestEntry holes;
+	holes.path = "holes.img";
+	holes.size = 4096;
+	holes.sparse = true;
+	manifest.entries = { folder, file, link, image, holes };
+
+	BackupManifest parsed = BackupManifest::Parse(manifest.Serialize());
+	REQUIRE(parsed.entries.size() == 5);
+	CHECK_EQ(parsed.entries[0].path, folder.path);
+	CHECK(parsed.entries[0].type == fs::file_type::directory);
+	CHECK_EQ(parsed.entries[1].mtime, int64_t(-5));
+	CHECK_EQ(parsed.entries[1].sha256, file.sha256);
+	REQUIRE(parsed.entries[1].chunks.size() == 2);
+	CHECK_EQ(parsed.entries[1].chunks[1].id, string("c2"));
+	CHECK_EQ(parsed.entries[2].linkTarget, link.linkTarget);
+	CHECK(!parsed.entries[1].sparse);
+	CHECK(parsed.entries[3].sparse);
+	CHECK(parsed.entries[3].extents == image.extents);
+	CHECK(parsed.entries[4].sparse);
+	CHECK(parsed.entries[4].extents.empty());
+
+	for (const char* bad : { "F\ta\t1x\t0\t\t", "F\ta\t-1\t0\t\t", "F\ta\t4\t0\t\tc1:3", "F\ta\t4\t0\t\tc1", "X\ta", "D\t", "F\ta\t1\t0\t\t\textra",
+		"F\ta\t8\t0\t\t\t4+8", "F\ta\t8\t0\t\t\t4+2,0+1", "F\ta\t8\t0\t\t\t0+0", "F\ta\t8\t0\t\t\t0+1\tmore" })
+	{
+		bool threw = false;
+		try { BackupManifest::Parse(string("GSBM-MANIFEST 1\n") + bad + "\n"); }
+		catch (const ManifestError&) { threw = true; }
+		CHECK(threw);
+	}
+}
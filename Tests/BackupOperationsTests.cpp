@@ -0,0 +1,182 @@
+#include "TestHarness.h"
+#include "BackupOperations.h"
+#include "EngineUtils.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	// Creates an empty backup folder with the given name inside dir.
+	void MakeBackupFolder(const fs::path& dir, const string& name)
+	{
+		fs::create_directories(dir / name);
+		WriteTestFile(dir / name / "slot1.sav", name);
+	}
+}
+
+TEST_CASE("BackupSaveFolder copies the save tree and names the folder")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot1.sav", "one");
+	WriteTestFile(save / "sub" / "slot2.sav", "two");
+
+	GameProfile profile{ L"Test Game", PathToWide(save), 60, false, L"test-game" };
+	GlobalSettings settings;
+	BackupResult result = BackupSaveFolder(profile, settings, dir.path() / "Backups", false);
+
+	REQUIRE(result.localSuccess);
+	CHECK(!result.cloudAttempted);
+	CHECK(endsWith(result.folderName, L"-M"));
+	REQUIRE(!result.log.empty());
+	CHECK(result.log.back().find(L"completed (Local).") != wstring::npos);
+
+	fs::path backup = dir.path() / "Backups" / "test-game" / ToPath(result.folderName);
+	CHECK(ReadTestFile(backup / "slot1.sav") == "one");
+	CHECK(ReadTestFile(backup / "sub" / "slot2.sav") == "two");
+}
+
+TEST_CASE("BackupSaveFolder syncs to the cloud folder when enabled")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot1.sav", "one");
+	fs::create_directories(dir.path() / "cloud");
+
+	GameProfile profile{ L"Cloudy", PathToWide(save), 60, true, L"cloudy" };
+	GlobalSettings settings;
+	settings.googleDrivePath = PathToWide(dir.path() / "cloud");
+	BackupResult result = BackupSaveFolder(profile, settings, dir.path() / "Backups", true);
+
+	REQUIRE(result.localSuccess);
+	CHECK(result.cloudAttempted);
+	CHECK(result.cloudSuccess);
+	fs::path cloudBackup = GetCloudGameBackupDir(settings.googleDrivePath, profile) / ToPath(result.folderName);
+	CHECK(ReadTestFile(cloudBackup / "slot1.sav") == "one");
+}
+
+TEST_CASE("BackupSaveFolder reports a missing save path")
+{
+	TempDir dir;
+	GameProfile profile{ L"Missing", PathToWide(dir.path() / "nope"), 60, false, L"missing" };
+	BackupResult result = BackupSaveFolder(profile, GlobalSettings{}, dir.path() / "Backups", true);
+	CHECK(!result.localSuccess);
+	REQUIRE(result.log.size() == 1);
+	CHECK(result.log[0].find(L"Local backup FAILED") != wstring::npos);
+}
+
+TEST_CASE("PurgeBackups deletes only the oldest backups of each type")
+{
+	TempDir dir;
+	for (int i = 0; i < 5; ++i) MakeBackupFolder(dir.path(), to_string(1000 + i) + "-[x]-A");
+	for (int i = 0; i < 3; ++i) MakeBackupFolder(dir.path(), to_string(2000 + i) + "-[x]-M");
+
+	vector<wstring> log;
+	PurgeBackups(dir.path(), L"A", 2, 0, L"Local", log);
+
+	CHECK(!fs::exists(dir.path() / "1000-[x]-A"));
+	CHECK(!fs::exists(dir.path() / "1002-[x]-A"));
+	CHECK(fs::exists(dir.path() / "1003-[x]-A"));
+	CHECK(fs::exists(dir.path() / "1004-[x]-A"));
+	CHECK(fs::exists(dir.path() / "2000-[x]-M")); // Manual limit 0 keeps all
+	CHECK(log.size() == 4); // Summary + 3 deletions
+
+	log.clear();
+	PurgeBackups(dir.path(), L"M", 0, 1, L"Cloud", log);
+	CHECK(ListBackups(dir.path()).size() == 3);
+	CHECK(log[0].find(L"[PURGE:Cloud] Manual-save limit (1)") != wstring::npos);
+}
+
+TEST_CASE("ListBackups and FindLatestManualBackup")
+{
+	TempDir dir;
+	CHECK(ListBackups(dir.path() / "missing").empty());
+	CHECK(FindLatestManualBackup(dir.path() / "missing").empty());
+
+	MakeBackupFolder(dir.path(), "100-[x]-M");
+	MakeBackupFolder(dir.path(), "200-[x]-A");
+	MakeBackupFolder(dir.path(), "300-[x]-M");
+	fs::last_write_time(dir.path() / "100-[x]-M", fs::file_time_type::clock::now() - chrono::hours(2));
+	fs::last_write_time(dir.path() / "300-[x]-M", fs::file_time_type::clock::now() - chrono::hours(1));
+
+	vector<fs::path> backups = ListBackups(dir.path());
+	REQUIRE(backups.size() == 3);
+	CHECK(backups[0].filename() == "300-[x]-M"); // Newest first
+	CHECK(FindLatestManualBackup(dir.path()).filename() == "300-[x]-M");
+}
+
+TEST_CASE("RestoreBackup replaces the save folder contents")
+{
+	TempDir dir;
+	fs::path backup = dir.path() / "backup";
+	fs::path save = dir.path() / "save";
+	WriteTestFile(backup / "slot1.sav", "old");
+	WriteTestFile(backup / "sub" / "slot2.sav", "old2");
+	WriteTestFile(save / "slot1.sav", "new");
+	WriteTestFile(save / "stray.tmp", "x");
+
+	CHECK(RestoreBackup(backup, save));
+	CHECK(ReadTestFile(save / "slot1.sav") == "old");
+	CHECK(ReadTestFile(save / "sub" / "slot2.sav") == "old2");
+	CHECK(!fs::exists(save / "stray.tmp"));
+	// The work folders next to the save are gone
+	CHECK(!fs::exists(dir.path() / "save.gsbm-restoring"));
+	CHECK(!fs::exists(dir.path() / "save.gsbm-previous"));
+
+	// Files left aside by an interrupted swap are never deleted: the restore refuses instead
+	WriteTestFile(dir.path() / "save.gsbm-previous" / "slot1.sav", "before");
+	bool refused = false;
+	try { RestoreBackup(backup, save / ""); }
+	catch (const fs::filesystem_error&) { refused = true; }
+	CHECK(refused);
+	CHECK(ReadTestFile(dir.path() / "save.gsbm-previous" / "slot1.sav") == "before");
+	CHECK(ReadTestFile(save / "slot1.sav") == "old");
+	CHECK(!fs::exists(dir.path() / "save.gsbm-restoring"));
+
+	// ...and a scan of a folder holding them skips them
+	TreeScan scan = ScanTree(dir.path());
+	for (const auto& entry : scan.entries) CHECK(entry.relativePath.u8string().find(".gsbm-") == string::npos);
+
+	// A save path that is a file is refused without changes
+	fs::path fileSave = dir.path() / "file";
+	WriteTestFile(fileSave, "keep");
+	CHECK(!RestoreBackup(backup, fileSave));
+	CHECK(ReadTestFile(fileSave) == "keep");
+
+	// A missing save path is created
+	CHECK(RestoreBackup(backup, dir.path() / "fresh"));
+	CHECK(ReadTestFile(dir.path() / "fresh" / "slot1.sav") == "old");
+}
+
+TEST_CASE("MigrateLegacyBackupFolders moves name-based folders to the profile ID")
+{
+	TempDir dir;
+	fs::path backupsRoot = dir.path() / "Backups";
+	fs::path cloudGames = dir.path() / "cloud" / ToPath(kCloudFolderName);
+	WriteTestFile(backupsRoot / "Elden Ring" / "100-[a]-M" / "slot.sav", "local");
+	WriteTestFile(cloudGames / "Elden Ring" / "100-[a]-M" / "slot.sav", "cloud");
+	// An interrupted earlier run already created the ID folder locally
+	WriteTestFile(backupsRoot / "er-id" / "200-[b]-A" / "slot.sav", "newer");
+
+	GlobalSettings settings;
+	settings.googleDrivePath = PathToWide(dir.path() / "cloud");
+	vector<GameProfile> profiles = {
+		{ L"Elden Ring", L"/saves/er", 60, true, L"er-id", L"Elden Ring" },
+		{ L"Hades", L"/saves/hades", 60, false, L"hades-id", L"Hades" } // No backups yet
+	};
+	vector<wstring> log;
+	CHECK_EQ(MigrateLegacyBackupFolders(profiles, settings, backupsRoot, log), 2u);
+	CHECK(profiles[0].legacyFolder.empty());
+	CHECK(profiles[1].legacyFolder.empty());
+
+	CHECK(!fs::exists(backupsRoot / "Elden Ring"));
+	CHECK(!fs::exists(cloudGames / "Elden Ring"));
+	CHECK(ReadTestFile(backupsRoot / "er-id" / "100-[a]-M" / "slot.sav") == "local");
+	CHECK(ReadTestFile(backupsRoot / "er-id" / "200-[b]-A" / "slot.sav") == "newer");
+	CHECK(ReadTestFile(cloudGames / "er-id" / "100-[a]-M" / "slot.sav") == "cloud");
+	CHECK(ListBackups(GetLocalGameBackupDir(backupsRoot, profiles[0])).size() == 2);
+
+	// Running again is a no-op
+	CHECK_EQ(MigrateLegacyBackupFolders(profiles, settings, backupsRoot, log), 0u);
+}
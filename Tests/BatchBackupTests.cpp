@@ -0,0 +1,73 @@
+#include "TestHarness.h"
+#include "BatchBackup.h"
+#include "EngineUtils.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	// A "world" of `kb` KB and four small saves of 1-4 KB
+	vector<GameProfile> MakeProfiles(const fs::path& root, size_t worldKb)
+	{
+		vector<GameProfile> profiles;
+		WriteTestFile(root / "world" / "region.dat", string(worldKb * 1024, 'w'));
+		profiles.push_back({ L"World", PathToWide(root / "world"), 600, false, L"world" });
+		for (int i = 4; i >= 1; --i)
+		{
+			string name = "small" + to_string(i);
+			WriteTestFile(root / name / "slot.sav", string(i * 1024, 's'));
+			profiles.push_back({ s2ws(name), PathToWide(root / name), 600, false, s2ws(name) });
+		}
+		return profiles;
+	}
+}
+
+TEST_CASE("Every profile is backed up, the largest at once and small saves ahead of the rest")
+{
+	TempDir dir;
+	fs::path backupsRoot = dir.path() / "Backups";
+	vector<GameProfile> profiles = MakeProfiles(dir.path(), 512);
+	profiles.push_back({ L"Gone", PathToWide(dir.path() / "missing"), 600, false, L"gone" });
+
+	vector<BatchBackupProgress> events;
+	BatchBackupReport report = BackupAllProfiles(profiles, GlobalSettings(), backupsRoot, 2,
+		[&](const BatchBackupProgress& progress) { events.push_back(progress); });
+
+	REQUIRE(report.items.size() == profiles.size());
+	CHECK_EQ(report.failed, 1u);
+	CHECK(!report.items[5].result.localSuccess);
+	for (size_t i = 0; i < 5; ++i)
+	{
+		const BatchBackupItem& item = report.items[i];
+		CHECK_EQ(item.profile, i);
+		REQUIRE(item.result.localSuccess);
+		CHECK(fs::is_directory(GetLocalGameBackupDir(backupsRoot, profiles[i]) / ToPath(item.result.folderName)));
+	}
+	CHECK_EQ(report.items[0].bytes, 512u * 1024);
+	CHECK(report.items[0].startOrder <= 1); // The world's own worker starts on it right away
+	// The other worker goes from the smallest up: the missing folder, then 1, 2, 3 and 4 KB
+	CHECK(report.items[5].startOrder <= 1);
+	CHECK(report.items[4].startOrder < report.items[3].startOrder);
+	CHECK(report.items[3].startOrder < report.items[2].startOrder);
+	CHECK(report.items[2].startOrder < report.items[1].startOrder);
+
+	REQUIRE(events.size() == profiles.size() + 1);
+	CHECK(events.front().finished == nullptr);
+	CHECK_EQ(events.front().bytesTotal, (512u + 10) * 1024);
+	CHECK_EQ(events.back().profilesDone, profiles.size());
+	CHECK_EQ(events.back().profilesFailed, 1u);
+	CHECK_EQ(events.back().bytesDone, events.back().bytesTotal);
+}
+
+TEST_CASE("A batch with one worker backs up the smallest saves first")
+{
+	TempDir dir;
+	vector<GameProfile> profiles = MakeProfiles(dir.path(), 64);
+	BatchBackupReport report = BackupAllProfiles(profiles, GlobalSettings(), dir.path() / "Backups", 1);
+	CHECK_EQ(report.failed, 0u);
+	CHECK_EQ(report.items[4].startOrder, 0u); // 1 KB
+	CHECK_EQ(report.items[1].startOrder, 3u); // 4 KB
+	CHECK_EQ(report.items[0].startOrder, 4u); // The world
+	CHECK(BackupAllProfiles({}, GlobalSettings(), dir.path() / "Backups", 4).items.empty());
+}
@@ -0,0 +1,343 @@
+#include "TestHarness.h"
+#include "S3StandInServer.h"
+#include "BackupOperations.h"
+#include "Chunker.h"
+#include "ChunkStore.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "Manifest.h"
+#include "S3Backend.h"
+#include "Sha256.h"
+#include "StorageBackend.h"
+
+#include <fstream>
+#include <set>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	S3Options OptionsFor(const S3StandInServer& server)
+	{
+		S3Options options;
+		options.endpoint = server.Endpoint();
+		options.bucket = server.Bucket();
+		options.accessKey = server.AccessKey();
+		options.secretKey = server.SecretKey();
+		options.timeout = chrono::seconds(10);
+		return options;
+	}
+
+	// Incompressible, non-repeating bytes (xorshift), so chunk boundaries come from the content
+	string RandomBytes(size_t size, uint64_t seed)
+	{
+		string data(size, '\0');
+		uint64_t state = seed * 0x9e3779b97f4a7c15ULL + 1;
+		for (auto& c : data)
+		{
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			c = static_cast<char>(state >> 56);
+		}
+		return data;
+	}
+
+	vector<string> ChunkDigests(const fs::path& file)
+	{
+		vector<string> digests;
+		ForEachFileChunk(file, ChunkerParams{}, [&](uint64_t, const char* data, size_t size)
+			{
+				digests.push_back(Sha256Hex(string_view(data, size)));
+			});
+		return digests;
+	}
+}
+
+TEST_CASE("Chunk boundaries follow the content, not the offset")
+{
+	TempDir dir;
+	string data = RandomBytes(12 * 1024 * 1024, 1);
+	WriteTestFile(dir.path() / "a.bin", data);
+	WriteTestFile(dir.path() / "b.bin", "inserted" + data);
+
+	ChunkerParams params;
+	uint64_t total = 0;
+	size_t chunks = 0;
+	ForEachFileChunk(dir.path() / "a.bin", params, [&](uint64_t offset, const char*, size_t size)
+		{
+			CHECK_EQ(offset, total);
+			CHECK(size <= params.maxSize);
+			total += size;
+			chunks++;
+		});
+	CHECK_EQ(total, static_cast<uint64_t>(data.size()));
+	CHECK(chunks >= 4); // About 1 MiB on average
+
+	// Only the chunk holding the inserted bytes differs
+	vector<string> before = ChunkDigests(dir.path() / "a.bin");
+	vector<string> after = ChunkDigests(dir.path() / "b.bin");
+	set<string> original(before.begin(), before.end());
+	size_t changed = 0;
+	for (const auto& digest : after) changed += original.count(digest) ? 0 : 1;
+	CHECK(changed <= 1);
+	CHECK_EQ(after.size(), before.size());
+}
+
+TEST_CASE("Manifests round-trip and reject malformed input")
+{
+	BackupManifest manifest;
+	manifest.entries.push_back({ "sub", fs::file_type::directory });
+	ManifestEntry file;
+	file.path = "sub/odd\tname\n.sav";
+	file.size = 7;
+	file.mtime = -5;
+	file.sha256 = string(64, 'a');
+	file.chunks = { { string(64, 'b'), 3 }, { string(64, 'c'), 4 } };
+	manifest.entries.push_back(file);
+	ManifestEntry empty;
+	empty.path = "empty.sav";
+	empty.sha256 = string(64, 'd');
+	manifest.entries.push_back(empty);
+	ManifestEntry link;
+	link.path = "latest";
+	link.type = fs::file_type::symlink;
+	link.linkTarget = "sub/odd\tname\n.sav";
+	manifest.entries.push_back(link);
+
+	BackupManifest parsed = BackupManifest::Parse(manifest.Serialize());
+	REQUIRE(parsed.entries.size() == 4);
+	CHECK(parsed.entries[0].type == fs::file_type::directory);
+	CHECK(parsed.entries[1].path == file.path);
+	CHECK_EQ(parsed.entries[1].mtime, -5);
+	CHECK_EQ(parsed.entries[1].chunks.size(), 2u);
+	CHECK_EQ(parsed.entries[1].chunks[1].size, 4u);
+	CHECK(parsed.entries[2].chunks.empty());
+	CHECK(parsed.entries[3].linkTarget == link.linkTarget);
+	CHECK_EQ(parsed.TotalBytes(), 7u);
+
+	bool threw = false;
+	try { BackupManifest::Parse("GSBM-MANIFEST 1\nF\tx\t9\t0\tsha\tabc:3\n"); } // Sizes do not add up
+	catch (const ManifestError&) { threw = true; }
+	CHECK(threw);
+	threw = false;
+	try { BackupManifest::Parse("something else\n"); }
+	catch (const ManifestError&) { threw = true; }
+	CHECK(threw);
+}
+
+TEST_CASE("A second backup uploads only the chunks that changed")
+{
+	S3StandInServer server;
+	S3Backend backend(OptionsFor(server));
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	string world = RandomBytes(8 * 1024 * 1024, 2);
+	WriteTestFile(save / "world.sav", world);
+	WriteTestFile(save / "copy" / "world.bak", world); // Same content: stored once
+	WriteTestFile(save / "settings.ini", "fov=90");
+	fs::create_directories(save / "empty");
+	fs::path gameDir = dir.path() / "Backups" / "game";
+
+	CopyStats first;
+	{
+		ChunkIndex index(GetChunkIndexPath(gameDir), backend, "game/");
+		CHECK(index.Rebuilt()); // No index file yet
+		first = PutChunkedBackup(backend, ScanTree(save), save, "game/", "1-first-A", index);
+	}
+	CHECK_EQ(first.filesCopied, 3u);
+	CHECK_EQ(first.bytesCopied, static_cast<uint64_t>(world.size()) + 6);
+	CHECK_EQ(first.bytesDeduplicated, static_cast<uint64_t>(world.size()));
+	CHECK(server.HasObject("game/1-first-A/" + kManifestObjectName));
+	CHECK(fs::exists(GetChunkIndexPath(gameDir)));
+
+	// Edit a few bytes in the middle
+	string edited = world;
+	edited.replace(5 * 1024 * 1024, 16, "saved game state");
+	WriteTestFile(save / "world.sav", edited);
+	int listsBefore = server.Requests("ListObjectsV2");
+	int putsBefore = server.Requests("PutObject");
+	CopyStats second;
+	{
+		ChunkIndex index(GetChunkIndexPath(gameDir), backend, "game/");
+		CHECK(!index.Rebuilt());
+		second = PutChunkedBackup(backend, ScanTree(save), save, "game/", "2-second-A", index);
+	}
+	CHECK_EQ(server.Requests("ListObjectsV2"), listsBefore); // Chunk existence came from the index
+	CHECK(second.bytesCopied <= 2 * ChunkerParams{}.maxSize);
+	CHECK(second.bytesCopied + second.bytesDeduplicated == 2 * world.size() + 6);
+	CHECK(server.Requests("PutObject") - putsBefore <= 3); // Changed chunk(s) plus the manifest
+
+	// Both backups rebuild exactly from their manifests
+	fs::path restored = dir.path() / "restore";
+	CopyStats downloaded = DownloadStoredBackup(backend, "game/1-first-A/", restored / "first");
+	CHECK_EQ(downloaded.filesCopied, 3u);
+	CHECK(ReadTestFile(restored / "first" / "world.sav") == world);
+	CHECK(ReadTestFile(restored / "first" / "copy" / "world.bak") == world);
+	CHECK(fs::is_directory(restored / "first" / "empty"));
+	DownloadStoredBackup(backend, "game/2-second-A/", restored / "second");
+	CHECK(ReadTestFile(restored / "second" / "world.sav") == edited);
+	CHECK_EQ(ReadTestFile(restored / "second" / "settings.ini"), string("fov=90"));
+	CHECK(fs::last_write_time(restored / "second" / "settings.ini") == fs::last_write_time(save / "settings.ini"));
+}
+
+TEST_CASE("A stale chunk index is rebuilt from one listing")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot.sav", RandomBytes(3 * 1024 * 1024, 3));
+	LocalDirectoryBackend backend(dir.path() / "cloud");
+	fs::path indexFile = GetChunkIndexPath(dir.path() / "Backups" / "game");
+	{
+		ChunkIndex index(indexFile, backend, "game/");
+		PutChunkedBackup(backend, ScanTree(save), save, "game/", "1-first-A", index);
+	}
+
+	// The pool was deleted outside the program: the index must not claim those chunks
+	fs::remove_all(dir.path() / "cloud" / "game" / "chunks");
+	ChunkIndex index(indexFile, backend, "game/");
+	CHECK(index.Rebuilt());
+	CHECK_EQ(index.Size(), 0u);
+	CopyStats stats = PutChunkedBackup(backend, ScanTree(save), save, "game/", "2-second-A", index);
+	CHECK_EQ(stats.bytesCopied, 3u * 1024 * 1024);
+
+	// An index written for another destination is not trusted either
+	LocalDirectoryBackend elsewhere(dir.path() / "other");
+	ChunkIndex other(indexFile, elsewhere, "game/");
+	CHECK(other.Rebuilt());
+	CHECK_EQ(other.Size(), 0u);
+}
+
+TEST_CASE("Restore rejects a damaged chunk and leaves no partial file")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot.sav", "precious progress");
+	LocalDirectoryBackend backend(dir.path() / "cloud");
+	ChunkIndex index(GetChunkIndexPath(dir.path() / "Backups"), backend, "game/");
+	PutChunkedBackup(backend, ScanTree(save), save, "game/", "1-first-M", index);
+
+	BackupManifest manifest = GetStoredManifest(backend, "game/1-first-M/");
+	REQUIRE(manifest.entries.size() == 1);
+	REQUIRE(manifest.entries[0].chunks.size() == 1);
+	WriteTestFile(backend.LocalPath(GetChunkKey("game/", manifest.entries[0].chunks[0].id)), "precious pr0gress");
+
+	bool threw = false;
+	try { DownloadStoredBackup(backend, "game/1-first-M/", dir.path() / "restore"); }
+	catch (const StorageError& e) { threw = string(e.what()).find("damaged") != string::npos; }
+	CHECK(threw);
+	CHECK(!fs::exists(dir.path() / "restore" / "slot.sav"));
+	CHECK(!fs::exists(dir.path() / "restore" / "slot.sav.partial"));
+}
+
+TEST_CASE("A sparse file's layout is kept in its manifest and its holes come back on restore")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	fs::path image = save / "vm.img";
+	const uint64_t size = 12 * 1024 * 1024;
+	string data = RandomBytes(64 * 1024, 4);
+	fs::create_directories(save);
+	{
+		ofstream out(image, ios::binary);
+		out.seekp(3 * 1024 * 1024);
+		out << data;
+	}
+	fs::resize_file(image, size);
+	vector<FileExtent> layout = DataExtents(image);
+	if (layout.size() == 1 && layout[0].length == size) return; // No holes on this file system
+
+	LocalDirectoryBackend backend(dir.path() / "cloud");
+	ChunkIndex index(GetChunkIndexPath(dir.path() / "Backups"), backend, "game/");
+	PutChunkedBackup(backend, ScanTree(save), save, "game/", "1-first-M", index);
+	BackupManifest manifest = GetStoredManifest(backend, "game/1-first-M/");
+	REQUIRE(manifest.entries.size() == 1);
+	CHECK(manifest.entries[0].sparse);
+	CHECK(manifest.entries[0].extents == layout);
+
+	fs::path restored = dir.path() / "restore";
+	DownloadStoredBackup(backend, "game/1-first-M/", restored);
+	CHECK(ReadTestFile(restored / "vm.img") == ReadTestFile(image));
+	CHECK(DataExtents(restored / "vm.img") == layout);
+}
+
+TEST_CASE("The sweep removes only chunks no remaining manifest uses")
+{
+	S3StandInServer server;
+	S3Backend backend(OptionsFor(server));
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "shared.sav", "kept by both");
+	WriteTestFile(save / "old.sav", "only in the first");
+	ChunkIndex index(GetChunkIndexPath(dir.path() / "Backups"), backend, "game/");
+	PutChunkedBackup(backend, ScanTree(save), save, "game/", "1-first-A", index);
+	fs::remove(save / "old.sav");
+	WriteTestFile(save / "new.sav", "only in the second");
+	PutChunkedBackup(backend, ScanTree(save), save, "game/", "2-second-A", index);
+	CHECK_EQ(backend.ListAll("game/chunks/").size(), 3u);
+
+	vector<wstring> log;
+	CHECK_EQ(PurgeStoredBackups(backend, "game/", 1, 0, L"Cloud", log), 1u);
+	CHECK_EQ(SweepChunkPool(backend, "game/", index, L"Cloud", log), 1u);
+	CHECK(log.back().find(L"Removed 1 unreferenced chunk(s)") != wstring::npos);
+	CHECK(!index.Contains(Sha256Hex("only in the first")));
+	CHECK(index.Contains(Sha256Hex("kept by both")));
+	CHECK_EQ(backend.ListAll("game/chunks/").size(), 2u);
+
+	DownloadStoredBackup(backend, "game/2-second-A/", dir.path() / "restore");
+	CHECK_EQ(ReadTestFile(dir.path() / "restore" / "shared.sav"), string("kept by both"));
+	CHECK_EQ(ReadTestFile(dir.path() / "restore" / "new.sav"), string("only in the second"));
+}
+
+TEST_CASE("BackupSaveFolder stores s3 backups as chunks and resumes a chunked transfer")
+{
+	S3StandInServer server;
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "a.sav", "alpha");
+	WriteTestFile(save / "b.sav", "bravo");
+
+	GameProfile profile{ L"Chunked", PathToWide(save), 60, true, L"chunked" };
+	GlobalSettings settings;
+	settings.cloudBackend = L"s3";
+	settings.s3Endpoint = s2ws(server.Endpoint());
+	settings.s3Bucket = s2ws(server.Bucket());
+	settings.s3AccessKey = s2ws(server.AccessKey());
+	settings.s3SecretKey = s2ws(server.SecretKey());
+	REQUIRE(UseChunkStore(settings)); // Layout=auto
+
+	BackupResult first = BackupSaveFolder(profile, settings, dir.path() / "Backups", true);
+	string manifestKey = "chunked/" + ws2s(first.folderName) + "/" + kManifestObjectName;
+	string bravoKey = GetChunkKey("chunked/", Sha256Hex("bravo"));
+	CHECK(first.cloudSuccess);
+	CHECK(server.HasObject(manifestKey));
+	CHECK(server.HasObject(bravoKey));
+	CHECK(!server.HasObject("chunked/" + ws2s(first.folderName) + "/a.sav"));
+
+	// Re-upload with one chunk gone and a failing manifest PUT: the chunk is stored again and
+	// journaled, the backup stays invisible until the journal is resumed
+	unique_ptr<StorageBackend> cloud = CreateStorageBackend(settings);
+	fs::path gameDir = GetLocalGameBackupDir(dir.path() / "Backups", profile);
+	fs::path source = gameDir / ToPath(first.folderName);
+	cloud->Remove(manifestKey);
+	cloud->Remove(bravoKey);
+	server.FailPut(manifestKey);
+	bool threw = false;
+	try { UploadStoredBackup(*cloud, ScanTree(source), source, "chunked/", first.folderName, gameDir, true); }
+	catch (const exception&) { threw = true; }
+	CHECK(threw);
+	CHECK(server.HasObject(bravoKey));
+	CHECK(fs::exists(GetTransferJournalPath(gameDir, first.folderName)));
+
+	server.FailPut("");
+	vector<wstring> log;
+	CHECK_EQ(ResumeStoredTransfers(*cloud, gameDir, "chunked/", true, log), 1u);
+	REQUIRE(log.size() == 1);
+	CHECK(log[0].find(L"Resumed sync of " + first.folderName) != wstring::npos);
+	CHECK(server.HasObject(manifestKey));
+	CHECK(!fs::exists(GetTransferJournalPath(gameDir, first.folderName)));
+
+	DownloadStoredBackup(*cloud, "chunked/" + ws2s(first.folderName) + "/", dir.path() / "restore");
+	CHECK_EQ(ReadTestFile(dir.path() / "restore" / "b.sav"), string("bravo"));
+}
@@ -0,0 +1,224 @@
+#include "TestHarness.h"
+#include "AesGcm.h"
+#include "BackupOperations.h"
+#include "ChunkStore.h"
+#include "CloudEncryption.h"
+#include "EngineUtils.h"
+#include "Sha256.h"
+#include "StorageBackend.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	vector<uint8_t> Hex(const string& hex)
+	{
+		vector<uint8_t> bytes;
+		for (size_t i = 0; i + 1 < hex.size(); i += 2) bytes.push_back(static_cast<uint8_t>(stoi(hex.substr(i, 2), nullptr, 16)));
+		return bytes;
+	}
+
+	string HexOf(const vector<uint8_t>& bytes)
+	{
+		return ToHex(bytes.data(), bytes.size());
+	}
+
+	template <typename F>
+	bool ThrowsEncryptionError(F&& f)
+	{
+		try { f(); }
+		catch (const EncryptionError&) { return true; }
+		return false;
+	}
+
+	// Fast key derivation; the default iteration count is for real passphrases
+	constexpr uint32_t kTestIterations = 1000;
+}
+
+TEST_CASE("AES-256-GCM matches the NIST test vectors on every code path")
+{
+	vector<bool> paths = { false };
+	if (AesGcm::CpuSupportsHardware()) paths.push_back(true);
+	for (bool hardware : paths)
+	{
+		// GCM spec test case 16: 256-bit key, AAD, plaintext not a multiple of the block size
+		vector<uint8_t> key = Hex("feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308");
+		vector<uint8_t> nonce = Hex("cafebabefacedbaddecaf888");
+		vector<uint8_t> aad = Hex("feedfacedeadbeeffeedfacedeadbeefabaddad2");
+		vector<uint8_t> plain = Hex("d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39");
+		vector<uint8_t> data = plain;
+		vector<uint8_t> tag(AesGcm::kTagSize);
+		AesGcm aes(key.data(), hardware);
+		CHECK_EQ(aes.Hardware(), static_cast<bool>(hardware));
+		aes.Encrypt(nonce.data(), aad.data(), aad.size(), data.data(), data.size(), tag.data());
+		CHECK_EQ(HexOf(data), string("522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662"));
+		CHECK_EQ(HexOf(tag), string("76fc6ece0f4e1768cddf8853bb2d551b"));
+		CHECK(aes.Decrypt(nonce.data(), aad.data(), aad.size(), data.data(), data.size(), tag.data()));
+		CHECK(data == plain);
+
+		// A flipped AAD bit fails and leaves the data encrypted
+		aes.Encrypt(nonce.data(), aad.data(), aad.size(), data.data(), data.size(), tag.data());
+		aad[0] ^= 1;
+		CHECK(!aes.Decrypt(nonce.data(), aad.data(), aad.size(), data.data(), data.size(), tag.data()));
+		CHECK(data != plain);
+
+		// Test cases 13 and 14: zero key and nonce, empty and one-block plaintext
+		vector<uint8_t> zeroKey(32, 0), zeroNonce(12, 0), block(16, 0);
+		AesGcm zero(zeroKey.data(), hardware);
+		zero.Encrypt(zeroNonce.data(), nullptr, 0, nullptr, 0, tag.data());
+		CHECK_EQ(HexOf(tag), string("530f8afbc74536b9a963b4f1c4cb738b"));
+		zero.Encrypt(zeroNonce.data(), nullptr, 0, block.data(), block.size(), tag.data());
+		CHECK_EQ(HexOf(block), string("cea7403d4d606b6e074ec5d3baf39d18"));
+		CHECK_EQ(HexOf(tag), string("d0d1c8a799996bf0265b98b5d48ab919"));
+	}
+}
+
+TEST_CASE("PBKDF2-HMAC-SHA256 matches the published vectors")
+{
+	string one = Pbkdf2HmacSha256("password", "salt", 1, 32);
+	CHECK_EQ(ToHex(reinterpret_cast<const uint8_t*>(one.data()), one.size()), string("120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b"));
+	string twoBlocks = Pbkdf2HmacSha256("passwd", "salt", 1, 64); // RFC 7914
+	CHECK_EQ(ToHex(reinterpret_cast<const uint8_t*>(twoBlocks.data()), twoBlocks.size()),
+		string("55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783"));
+	string many = Pbkdf2HmacSha256("password", "salt", 4096, 32);
+	CHECK_EQ(ToHex(reinterpret_cast<const uint8_t*>(many.data()), many.size()), string("c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a"));
+}
+
+TEST_CASE("Encrypted objects round-trip and reject altered, reordered or cut-off segments")
+{
+	EncryptionKeys keys("correct horse", "0123456789abcdef", kTestIterations);
+	const size_t segment = StreamEncryptor::kSegmentSize;
+	for (size_t size : { size_t(0), size_t(1), segment - 1, segment, segment + 1, 3 * segment + 17 })
+	{
+		string plain(size, '\0');
+		for (size_t i = 0; i < size; ++i) plain[i] = static_cast<char>(i * 31 + size);
+		string object = keys.Encrypt(plain);
+		CHECK(IsEncryptedObject(object));
+		CHECK_EQ(keys.Decrypt(object), plain);
+		CHECK(keys.Encrypt(plain) != object); // Fresh salt per object
+	}
+
+	string plain(3 * segment, 'p');
+	string object = keys.Encrypt(plain);
+	const size_t stored = segment + AesGcm::kTagSize;
+
+	string altered = object;
+	altered[StreamEncryptor::kHeaderSize + stored + 5] ^= 0x40;
+	CHECK(ThrowsEncryptionError([&] { keys.Decrypt(altered); }));
+
+	// Last segment dropped: the new last one was not encrypted as last
+	string cut = object.substr(0, StreamEncryptor::kHeaderSize + 2 * stored);
+	CHECK(ThrowsEncryptionError([&] { keys.Decrypt(cut); }));
+
+	string swapped = object;
+	swapped.replace(StreamEncryptor::kHeaderSize, stored, object, StreamEncryptor::kHeaderSize + stored, stored);
+	swapped.replace(StreamEncryptor::kHeaderSize + stored, stored, object, StreamEncryptor::kHeaderSize, stored);
+	CHECK(ThrowsEncryptionError([&] { keys.Decrypt(swapped); }));
+
+	EncryptionKeys other("wrong horse", "0123456789abcdef", kTestIterations);
+	CHECK(ThrowsEncryptionError([&] { other.Decrypt(object); }));
+	CHECK(other.ChunkId(Sha256Hex("x")) != keys.ChunkId(Sha256Hex("x")));
+	CHECK(ThrowsEncryptionError([&] { keys.Decrypt("GSBM-MANIFEST 1\n"); }));
+}
+
+TEST_CASE("The key record tells a wrong passphrase apart")
+{
+	TempDir dir;
+	LocalDirectoryBackend backend(dir.path() / "cloud");
+	CHECK(OpenStoredKeys(backend, "game/", "secret", false, kTestIterations) == nullptr);
+	auto created = OpenStoredKeys(backend, "game/", "secret", true, kTestIterations);
+	REQUIRE(created != nullptr);
+	CHECK(ReadTestFile(dir.path() / "cloud" / "game" / ".gsbm-key").find("secret") == string::npos);
+
+	// Reopened with the stored salt and iteration count, whatever the caller asks for
+	auto reopened = OpenStoredKeys(backend, "game/", "secret", false);
+	REQUIRE(reopened != nullptr);
+	CHECK_EQ(reopened->Verifier(), created->Verifier());
+	CHECK(ThrowsEncryptionError([&] { OpenStoredKeys(backend, "game/", "Secret", false); }));
+	CHECK(ListStoredBackups(backend, "game/").empty());
+}
+
+TEST_CASE("A passphrase that could not be unsealed stops cloud backups instead of creating keys")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot1.sav", "locked away");
+	GameProfile profile{ L"Unsealed", PathToWide(save), 60, true, L"unsealed" };
+	profile.unreadablePassphrase = L"dpapi:00ff";
+	CHECK(IsEncryptionEnabled(profile));
+	CHECK(ThrowsEncryptionError([&] { GetProfileSecret(profile); }));
+
+	GlobalSettings settings;
+	settings.googleDrivePath = PathToWide(dir.path() / "cloud");
+	BackupResult result = BackupSaveFolder(profile, settings, dir.path() / "Backups", false);
+	CHECK(result.localSuccess);
+	CHECK(result.cloudAttempted);
+	CHECK(!result.cloudSuccess);
+	unique_ptr<StorageBackend> cloud = CreateStorageBackend(settings);
+	REQUIRE(cloud != nullptr);
+	string gamePrefix = GetStorageGamePrefix(profile);
+	CHECK(!cloud->Exists(gamePrefix + ".gsbm-key"));
+	CHECK(ListStoredBackups(*cloud, gamePrefix).empty());
+}
+
+TEST_CASE("An encrypted profile's cloud backups hold no plaintext and restore with the passphrase")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	const string secretText = "Chapter 3: the dragon is asleep";
+	WriteTestFile(save / "slot1.sav", secretText);
+	WriteTestFile(save / "sub" / "slot2.sav", string(200 * 1024, 'z'));
+
+	GameProfile profile{ L"Sealed", PathToWide(save), 60, true, L"sealed" };
+	profile.encryptionPassphrase = L"open sesame";
+	GlobalSettings settings;
+	settings.googleDrivePath = PathToWide(dir.path() / "cloud");
+	settings.cloudLayout = L"folders"; // Encryption uses the chunk store regardless
+	unique_ptr<StorageBackend> cloud = CreateStorageBackend(settings);
+	REQUIRE(cloud != nullptr);
+	string gamePrefix = GetStorageGamePrefix(profile);
+	OpenStoredKeys(*cloud, gamePrefix, GetProfileSecret(profile), true, kTestIterations);
+
+	BackupResult result = BackupSaveFolder(profile, settings, dir.path() / "Backups", false);
+	REQUIRE(result.cloudSuccess);
+	string backupPrefix = gamePrefix + ws2s(result.folderName) + "/";
+	REQUIRE(HasStoredManifest(*cloud, backupPrefix));
+
+	// Neither contents nor file names reach the destination readable
+	fs::path cloudGame = cloud->LocalPath(gamePrefix);
+	size_t objects = 0;
+	for (const auto& entry : fs::recursive_directory_iterator(cloudGame))
+	{
+		if (!entry.is_regular_file() || entry.path().filename() == ".gsbm-key") continue;
+		string data = ReadTestFile(entry.path());
+		CHECK(IsEncryptedObject(data));
+		CHECK(data.find("dragon") == string::npos);
+		CHECK(data.find("slot1") == string::npos);
+		CHECK(data.find(string(64, 'z')) == string::npos);
+		objects++;
+	}
+	CHECK(objects >= 3); // Two chunks and the manifest
+
+	CHECK(ThrowsEncryptionError([&] { DownloadStoredBackup(*cloud, backupPrefix, dir.path() / "nokeys"); }));
+	auto keys = OpenStoredKeys(*cloud, gamePrefix, GetProfileSecret(profile), false);
+	REQUIRE(keys != nullptr);
+	DownloadStoredBackup(*cloud, backupPrefix, dir.path() / "restore", keys.get());
+	CHECK_EQ(ReadTestFile(dir.path() / "restore" / "slot1.sav"), secretText);
+	CHECK_EQ(ReadTestFile(dir.path() / "restore" / "sub" / "slot2.sav"), string(200 * 1024, 'z'));
+
+	// Tampering with a stored chunk is caught during the restore
+	BackupManifest manifest = GetStoredManifest(*cloud, backupPrefix, keys.get());
+	CHECK(manifest.encrypted);
+	auto slot2 = find_if(manifest.entries.begin(), manifest.entries.end(), [](const ManifestEntry& e) { return e.path == "sub/slot2.sav"; });
+	REQUIRE(slot2 != manifest.entries.end());
+	fs::path chunk = cloud->LocalPath(GetChunkKey(gamePrefix, slot2->chunks[0].id));
+	string data = ReadTestFile(chunk);
+	data[data.size() / 2] ^= 1;
+	WriteTestFile(chunk, data);
+	CHECK(ThrowsEncryptionError([&] { DownloadStoredBackup(*cloud, backupPrefix, dir.path() / "tampered", keys.get()); }));
+	CHECK(!fs::exists(dir.path() / "tampered" / "sub" / "slot2.sav"));
+}
@@ -0,0 +1,294 @@
+#include "TestHarness.h"
+#include "Config.h"
+#include "IniFile.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+TEST_CASE("INI read/write keeps other sections and keys")
+{
+	TempDir dir;
+	fs::path ini = dir.path() / "test.ini";
+	WriteTestFile(ini, "; comment\n[One]\nA=1\nB = two \n\n[Two]\nC=\"quoted\"\n");
+
+	CHECK(ReadIniString(ini, L"one", L"b", L"") == L"two"); // Case-insensitive lookup
+	CHECK(ReadIniString(ini, L"Two", L"C", L"") == L"quoted");
+	CHECK(ReadIniString(ini, L"Two", L"Missing", L"def") == L"def");
+	CHECK(ReadIniInt(ini, L"One", L"A", 0) == 1);
+	CHECK(ReadIniInt(ini, L"One", L"B", 7) == 7); // Not numeric
+
+	CHECK(WriteIniString(ini, L"One", L"A", L"42"));
+	CHECK(WriteIniString(ini, L"One", L"New", L"x"));
+	CHECK(WriteIniString(ini, L"Three", L"D", L"d"));
+	CHECK(ReadIniInt(ini, L"One", L"A", 0) == 42);
+	CHECK(ReadIniString(ini, L"One", L"New", L"") == L"x");
+	CHECK(ReadIniString(ini, L"Two", L"C", L"") == L"quoted");
+	CHECK(ReadTestFile(ini).find("; comment") != string::npos);
+
+	vector<wstring> sections = ReadIniSectionNames(ini);
+	REQUIRE(sections.size() == 3);
+	CHECK(sections[2] == L"Three");
+
+	CHECK(DeleteIniSection(ini, L"two"));
+	CHECK(ReadIniSectionNames(ini).size() == 2);
+	CHECK(ReadIniString(ini, L"Two", L"C", L"gone") == L"gone");
+}
+
+TEST_CASE("INI reader accepts UTF-16LE files written by the Win32 API")
+{
+	TempDir dir;
+	fs::path ini = dir.path() / "utf16.ini";
+	string bytes = "\xFF\xFE";
+	for (char c : string("[Game]\r\nName=Caf"))
+	{
+		bytes.push_back(c);
+		bytes.push_back('\0');
+	}
+	bytes += "\xE9"; bytes.push_back('\0'); // U+00E9
+	WriteTestFile(ini, bytes);
+	CHECK(ReadIniString(ini, L"Game", L"Name", L"") == L"Café");
+}
+
+TEST_CASE("Global config defaults, creation and round-trip")
+{
+	TempDir dir;
+	fs::path configFile = dir.path() / "Config.ini";
+
+	GlobalSettings loaded = LoadGlobalConfig(configFile);
+	CHECK(fs::exists(configFile));
+	CHECK(loaded.localAutoSaveLimit == 20);
+	CHECK(loaded.cloudManualSaveLimit == 25);
+	CHECK(!loaded.gdriveSetupComplete);
+	CHECK(!loaded.traceEnabled);
+	CHECK(loaded.cloudBackend == L"sync-folder");
+	CHECK(loaded.packSmallFilesKb == 0);
+	CHECK(loaded.largeFileThresholdMb == 64);
+	CHECK(!loaded.directIo);
+	CHECK(loaded.dropPageCache);
+	CHECK(!loaded.deduplicateBackups);
+	CHECK(loaded.loadDeferMaxSeconds == 300);
+	CHECK(loaded.cpuPressureLimit == 25);
+	CHECK(loaded.batchBackupWorkers == 4);
+
+	loaded.googleDrivePath = L"/mnt/cloud";
+	loaded.localManualSaveLimit = 3;
+	loaded.gdriveSetupComplete = true;
+	loaded.traceEnabled = true;
+	loaded.traceFileThresholdKb = 64;
+	loaded.cloudBackend = L"s3";
+	loaded.s3Endpoint = L"http://127.0.0.1:9000";
+	loaded.s3Bucket = L"saves";
+	loaded.s3PartSizeMb = 16;
+	loaded.packSmallFilesKb = 128;
+	loaded.largeFileThresholdMb = 256;
+	loaded.directIo = true;
+	loaded.dropPageCache = false;
+	loaded.deduplicateBackups = true;
+	loaded.loadDeferMaxSeconds = 0;
+	loaded.ioPressureLimit = 40;
+	loaded.batchBackupWorkers = 2;
+	SaveGlobalConfig(configFile, loaded);
+
+	GlobalSettings again = LoadGlobalConfig(configFile);
+	CHECK(again.googleDrivePath == L"/mnt/cloud");
+	CHECK(again.localManualSaveLimit == 3);
+	CHECK(again.gdriveSetupComplete);
+	CHECK(!again.firstGameAdded);
+	CHECK(again.traceEnabled);
+	CHECK(again.traceFileThresholdKb == 64);
+	CHECK(again.cloudBackend == L"s3");
+	CHECK(again.s3Endpoint == L"http://127.0.0.1:9000");
+	CHECK(again.s3Bucket == L"saves");
+	CHECK(again.s3Region == L"us-east-1");
+	CHECK(again.s3PartSizeMb == 16);
+	CHECK(again.s3Parallelism == 4);
+	CHECK(again.packSmallFilesKb == 128);
+	CHECK(again.largeFileThresholdMb == 256);
+	CHECK(again.directIo);
+	CHECK(!again.dropPageCache);
+	CHECK(again.deduplicateBackups);
+	CHECK(again.loadDeferMaxSeconds == 0);
+	CHECK(again.cpuPressureLimit == 25);
+	CHECK(again.ioPressureLimit == 40);
+	CHECK(again.batchBackupWorkers == 2);
+}
+
+TEST_CASE("Profiles save, load, rename and delete")
+{
+	TempDir dir;
+	fs::path profilesFile = dir.path() / "GameProfiles.ini";
+	CHECK(LoadProfiles(profilesFile).empty());
+	CHECK(fs::exists(profilesFile));
+
+	GameProfile a{ L"Elden Ring", L"/saves/er", 300, true, GenerateProfileId() };
+	GameProfile b{ L"Hades", L"/saves/hades", 600, false, GenerateProfileId() };
+	b.adaptiveAutoSave = true;
+	b.autoSaveFloor = 90;
+	b.gameExecutable = L"Hades.exe";
+	b.encryptionPassphrase = L"correct horse";
+	CHECK(a.id.size() == 16);
+	CHECK(a.id != b.id);
+	SaveProfile(profilesFile, a);
+	SaveProfile(profilesFile, b);
+
+	vector<GameProfile> profiles = LoadProfiles(profilesFile);
+	REQUIRE(profiles.size() == 2);
+	CHECK(profiles[0].id == a.id);
+	CHECK(profiles[0].name == L"Elden Ring");
+	CHECK(profiles[0].autoSaveInterval == 300);
+	CHECK(profiles[0].cloudSaveEnabled);
+	CHECK(profiles[1].savePath == L"/saves/hades");
+	CHECK(!profiles[0].adaptiveAutoSave);
+	CHECK(profiles[0].autoSaveFloor == 60);
+	CHECK(profiles[1].adaptiveAutoSave);
+	CHECK(profiles[1].autoSaveFloor == 90);
+	CHECK(profiles[0].gameExecutable.empty());
+	CHECK(profiles[1].gameExecutable == L"Hades.exe");
+	CHECK(profiles[0].encryptionPassphrase.empty());
+	CHECK(profiles[1].encryptionPassphrase == L"correct horse");
+#ifdef _WIN32
+	CHECK(ReadTestFile(profilesFile).find("correct horse") == string::npos); // Sealed with DPAPI
+#endif
+
+	// Renaming only rewrites the Name key; the ID and position stay the same
+	a.name = L"Elden Ring NG+";
+	SaveProfile(profilesFile, a);
+	profiles = LoadProfiles(profilesFile);
+	REQUIRE(profiles.size() == 2);
+	CHECK(profiles[0].id == a.id);
+	CHECK(profiles[0].name == L"Elden Ring NG+");
+	CHECK(profiles[1].name == L"Hades");
+
+	ProfileIndex index = BuildProfileIndex(profiles);
+	REQUIRE(index.count(b.id) == 1);
+	CHECK(profiles[index[b.id]].name == L"Hades");
+
+	DeleteProfileIniEntry(profilesFile, a.id);
+	profiles = LoadProfiles(profilesFile);
+	REQUIRE(profiles.size() == 1);
+	CHECK(profiles[0].id == b.id);
+
+	GameProfile noId{ L"No ID", L"/saves/none", 60, false };
+	bool threw = false;
+	try { SaveProfile(profilesFile, noId); }
+	catch (const invalid_argument&) { threw = true; }
+	CHECK(threw);
+}
+
+TEST_CASE("Name-keyed profiles get an ID once and keep it")
+{
+	TempDir dir;
+	fs::path profilesFile = dir.path() / "GameProfiles.ini";
+	WriteTestFile(profilesFile, "[Elden Ring]\nName=Elden Ring\nSavePath=/saves/er\nAutoSaveInterval=300\nCloudSaveEnabled=1\n");
+
+	vector<GameProfile> profiles = LoadProfiles(profilesFile);
+	REQUIRE(profiles.size() == 1);
+	CHECK(profiles[0].id.size() == 16);
+	CHECK(profiles[0].legacyFolder == L"Elden Ring");
+	CHECK(profiles[0].autoSaveInterval == 300);
+
+	// The file was rewritten with the new ID; the migration stays pending until the folders move
+	vector<GameProfile> again = LoadProfiles(profilesFile);
+	REQUIRE(again.size() == 1);
+	CHECK(again[0].id == profiles[0].id);
+	CHECK(again[0].legacyFolder == L"Elden Ring");
+
+	again[0].legacyFolder.clear();
+	SaveProfiles(profilesFile, again);
+	CHECK(LoadProfiles(profilesFile)[0].legacyFolder.empty());
+	CHECK(ReadTestFile(profilesFile).find("LegacyFolder") == string::npos);
+}
+
+TEST_CASE("A sealed passphrase that cannot be opened keeps the game encrypted")
+{
+	TempDir dir;
+	fs::path profilesFile = dir.path() / "GameProfiles.ini";
+	WriteTestFile(profilesFile, "[00000000000000aa]\nId=00000000000000aa\nName=Hades\nSavePath=/saves/hades\nEncryptionPassphrase=dpapi:00ff\n");
+	vector<GameProfile> profiles = LoadProfiles(profilesFile);
+	REQUIRE(profiles.size() == 1);
+	CHECK(profiles[0].encryptionPassphrase.empty()); // The sealed text is never used as the passphrase
+	CHECK(profiles[0].unreadablePassphrase == L"dpapi:00ff");
+	SaveProfiles(profilesFile, profiles);
+	CHECK(ReadTestFile(profilesFile).find("EncryptionPassphrase=dpapi:00ff") != string::npos);
+
+	// Entering a passphrase again replaces it
+	profiles[0].encryptionPassphrase = L"new words";
+	profiles[0].unreadablePassphrase.clear();
+	SaveProfiles(profilesFile, profiles);
+	vector<GameProfile> again = LoadProfiles(profilesFile);
+	CHECK(again[0].encryptionPassphrase == L"new words");
+	CHECK(again[0].unreadablePassphrase.empty());
+}
+
+TEST_CASE("A typed passphrase cannot look like a sealed one")
+{
+	TempDir dir;
+	fs::path profilesFile = dir.path() / "GameProfiles.ini";
+	CHECK(!IsAcceptedPassphrase(L"dpapi:plain words"));
+	CHECK(IsAcceptedPassphrase(L"plain words dpapi:"));
+	GameProfile profile{ L"Hades", L"/saves/hades", 60, true, L"00000000000000aa" };
+	profile.encryptionPassphrase = L"dpapi:plain words";
+	bool threw = false;
+	try { SaveProfile(profilesFile, profile); }
+	catch (const invalid_argument&) { threw = true; }
+	CHECK(threw);
+	CHECK(!fs::exists(profilesFile) || ReadTestFile(profilesFile).find("plain words") == string::npos);
+}
+
+TEST_CASE("IniDocument parses once and edits in memory")
+{
+	TempDir dir;
+	fs::path ini = dir.path() / "doc.ini";
+	WriteTestFile(ini, "; header comment\n[Game]\nName=Old\n; trailing comment\n\n[game]\nName=Duplicate\n[Other]\nX=1\n");
+
+	IniDocument doc = IniDocument::Load(ini);
+	CHECK(doc.GetString(L"GAME", L"name", L"") == L"Old"); // First duplicate wins
+	CHECK(doc.SectionNames().size() == 3);
+
+	doc.SetString(L"Game", L"NAME", L"New");
+	doc.SetString(L"Game", L"SavePath", L"/saves");
+	doc.SetString(L"Added", L"Y", L"2");
+	CHECK(doc.GetString(L"Game", L"Name", L"") == L"New");
+	CHECK(doc.GetInt(L"Added", L"Y", 0) == 2);
+	CHECK(ReadIniString(ini, L"Game", L"Name", L"") == L"Old"); // Nothing written until Save
+
+	CHECK(doc.Save(ini));
+	CHECK(!fs::exists(dir.path() / "doc.ini.tmp"));
+	string text = ReadTestFile(ini);
+	CHECK(text.find("Name=New\nSavePath=/saves\n; trailing comment") != string::npos); // Original spelling, comment kept after keys
+	CHECK(text.find("; header comment") == 0);
+
+	CHECK(doc.RemoveKey(L"game", L"savepath"));
+	CHECK(!doc.RemoveKey(L"Game", L"SavePath"));
+	CHECK(doc.GetString(L"Game", L"Name", L"") == L"New");
+	doc.SetString(L"Game", L"Extra", L"e"); // Still inserted after the last key
+	CHECK(doc.Save(ini));
+	CHECK(ReadTestFile(ini).find("Name=New\nExtra=e\n; trailing comment") != string::npos);
+
+	CHECK(doc.RemoveSection(L"GAME")); // Removes both duplicates
+	CHECK(!doc.RemoveSection(L"Game"));
+	CHECK(!doc.HasSection(L"game"));
+	CHECK(doc.HasSection(L"Other"));
+	CHECK(doc.GetString(L"Other", L"X", L"") == L"1"); // Index rebuilt after removal
+}
+
+TEST_CASE("IniDocument handles thousands of profiles")
+{
+	TempDir dir;
+	fs::path profilesFile = dir.path() / "GameProfiles.ini";
+	const int count = 5000; // Far beyond the old 8192-wchar section name buffer
+	IniDocument doc;
+	for (int i = 0; i < count; ++i)
+	{
+		wstring name = L"Game " + to_wstring(i);
+		doc.SetString(name, L"Id", name);
+		doc.SetString(name, L"Name", name);
+		doc.SetString(name, L"SavePath", L"/saves/" + to_wstring(i) + L"/" + wstring(300, L'p')); // Longer than MAX_PATH
+	}
+	REQUIRE(doc.Save(profilesFile));
+
+	vector<GameProfile> profiles = LoadProfiles(profilesFile);
+	REQUIRE(profiles.size() == static_cast<size_t>(count));
+	CHECK(profiles[count - 1].name == L"Game 4999");
+	CHECK(profiles[count - 1].savePath.size() > 300);
+}
@@ -0,0 +1,161 @@
+#include "TestHarness.h"
+#include "BackupIndex.h"
+#include "BackupOperations.h"
+#include "ContentStore.h"
+#include "EngineUtils.h"
+#include "Sha256.h"
+
+#include <atomic>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	size_t CountStoreFiles(const fs::path& backupsRoot)
+	{
+		size_t count = 0;
+		for (const auto& shard : fs::directory_iterator(backupsRoot / kContentStoreFolder))
+		{
+			if (!shard.is_directory() || shard.path().filename() == "staging") continue;
+			for (const auto& entry : fs::directory_iterator(shard.path())) count += entry.is_regular_file() ? 1 : 0;
+		}
+		return count;
+	}
+}
+
+TEST_CASE("Identical files of different games share one copy")
+{
+	TempDir dir;
+	fs::path backupsRoot = dir.path() / "Backups";
+	WriteTestFile(dir.path() / "a" / "engine.cfg", "shared settings");
+	WriteTestFile(dir.path() / "a" / "slot1.sav", "game a");
+	WriteTestFile(dir.path() / "b" / "engine.cfg", "shared settings");
+	fs::last_write_time(dir.path() / "b" / "engine.cfg", fs::last_write_time(dir.path() / "a" / "engine.cfg") - chrono::hours(1));
+	WriteTestFile(dir.path() / "b" / "slot1.sav", "game b");
+
+	GlobalSettings settings;
+	settings.deduplicateBackups = true;
+	GameProfile first{ L"A", PathToWide(dir.path() / "a"), 60, false, L"game-a" };
+	GameProfile second{ L"B", PathToWide(dir.path() / "b"), 60, false, L"game-b" };
+	BackupResult resultA = BackupSaveFolder(first, settings, backupsRoot, false);
+	BackupResult resultB = BackupSaveFolder(second, settings, backupsRoot, false);
+	REQUIRE(resultA.localSuccess);
+	REQUIRE(resultB.localSuccess);
+
+	fs::path backupA = GetLocalGameBackupDir(backupsRoot, first) / ToPath(resultA.folderName);
+	fs::path backupB = GetLocalGameBackupDir(backupsRoot, second) / ToPath(resultB.folderName);
+	CHECK(fs::equivalent(backupA / "engine.cfg", backupB / "engine.cfg"));
+	CHECK_EQ(fs::hard_link_count(backupA / "engine.cfg"), 3u); // Two backups and the store
+	CHECK(!fs::equivalent(backupA / "slot1.sav", backupB / "slot1.sav"));
+	CHECK_EQ(CountStoreFiles(backupsRoot), 3u);
+	CHECK(ReadTestFile(backupB / "engine.cfg") == "shared settings");
+
+	// Shared by content, whatever the time each game saved it at; the index keeps each one's time
+	CHECK(LoadBackupIndex(backupB).Select({ "engine.cfg" }).entries.at(0).mtime != LoadBackupIndex(backupA).Select({ "engine.cfg" }).entries.at(0).mtime);
+	WriteTestFile(dir.path() / "b" / "engine.cfg", "shared settings");
+	BackupResult later = BackupSaveFolder(second, settings, backupsRoot, true);
+	REQUIRE(later.localSuccess);
+	fs::path backupLater = GetLocalGameBackupDir(backupsRoot, second) / ToPath(later.folderName);
+	CHECK(fs::equivalent(backupLater / "engine.cfg", backupA / "engine.cfg"));
+	CHECK(fs::equivalent(backupLater / "slot1.sav", backupB / "slot1.sav"));
+	CHECK_EQ(CountStoreFiles(backupsRoot), 3u);
+
+	// Restores read the shared copy like any other file, and give it back the time b saved it at
+	fs::remove_all(dir.path() / "b");
+	REQUIRE(RestoreBackup(backupB, dir.path() / "b"));
+	CHECK(ReadTestFile(dir.path() / "b" / "engine.cfg") == "shared settings");
+	CHECK_EQ(fs::hard_link_count(dir.path() / "b" / "engine.cfg"), 1u);
+	int64_t savedAt = LoadBackupIndex(backupB).Select({ "engine.cfg" }).entries.at(0).mtime;
+	CHECK_EQ(FileTimeToUnixNanos(fs::last_write_time(dir.path() / "b" / "engine.cfg")), savedAt);
+	fs::last_write_time(dir.path() / "b" / "engine.cfg", fs::file_time_type::clock::now());
+	RestoreSelectedFiles(backupB, LoadBackupIndex(backupB).Select({ "engine.cfg" }), dir.path() / "b");
+	CHECK_EQ(FileTimeToUnixNanos(fs::last_write_time(dir.path() / "b" / "engine.cfg")), savedAt);
+}
+
+TEST_CASE("A damaged stored file is never linked")
+{
+	TempDir dir;
+	fs::path backupsRoot = dir.path() / "Backups";
+	WriteTestFile(dir.path() / "backup1" / "slot.sav", "original");
+	WriteTestFile(dir.path() / "backup2" / "slot.sav", "original");
+	BackupManifest index;
+	ManifestEntry entry;
+	entry.path = "slot.sav";
+	entry.size = 8;
+	entry.mtime = 1700000000000000000;
+	entry.sha256 = Sha256Hex("original");
+	index.entries.push_back(entry);
+
+	CHECK_EQ(DeduplicateBackup(backupsRoot, dir.path() / "backup1", index).filesAdded, 1u);
+	fs::path shared = GetContentStorePath(backupsRoot, entry);
+	fs::remove(shared);
+	WriteTestFile(shared, "orig"); // Cut short
+	DedupStats stats = DeduplicateBackup(backupsRoot, dir.path() / "backup2", index);
+	CHECK_EQ(stats.filesLinked, 0u);
+	CHECK_EQ(ReadTestFile(dir.path() / "backup2" / "slot.sav"), string("original"));
+	CHECK(!fs::equivalent(shared, dir.path() / "backup2" / "slot.sav"));
+}
+
+TEST_CASE("The collector frees shared copies of purged backups across interrupted sweeps")
+{
+	TempDir dir;
+	fs::path backupsRoot = dir.path() / "Backups";
+	fs::path save = dir.path() / "save";
+	GameProfile profile{ L"Sweep", PathToWide(save), 60, false, L"sweep" };
+	GlobalSettings settings;
+	settings.deduplicateBackups = true;
+	for (int i = 0; i < 20; ++i) WriteTestFile(save / ("file" + to_string(i) + ".sav"), "contents " + to_string(i));
+	BackupResult result = BackupSaveFolder(profile, settings, backupsRoot, false);
+	REQUIRE(result.localSuccess);
+	WaitForContentSweeps(); // The backup's own sweep moved the cursor on
+	fs::remove(backupsRoot / kContentStoreFolder / "sweep-cursor");
+	CHECK_EQ(CountStoreFiles(backupsRoot), 20u);
+
+	// Nothing is freed while a backup still links the files
+	CHECK_EQ(SweepContentStore(backupsRoot).filesRemoved, 0u);
+
+	// A leftover staging link from an interrupted backup goes at the end of a pass
+	WriteTestFile(backupsRoot / kContentStoreFolder / "staging" / "leftover", "x");
+	fs::remove_all(GetLocalGameBackupDir(backupsRoot, profile) / ToPath(result.folderName));
+
+	// Stopped after a few shards: the next sweep starts where it left off
+	uint64_t removed = 0;
+	ContentSweepStats step = SweepContentStore(backupsRoot, 100);
+	CHECK_EQ(step.shardsSwept, 100u);
+	CHECK(!step.passCompleted);
+	removed += step.filesRemoved;
+	step = SweepContentStore(backupsRoot, 156);
+	CHECK(step.passCompleted);
+	removed += step.filesRemoved;
+	CHECK_EQ(removed, 20u);
+	CHECK_EQ(CountStoreFiles(backupsRoot), 0u);
+	CHECK(fs::is_empty(backupsRoot / kContentStoreFolder / "staging"));
+}
+
+TEST_CASE("Backups leave the collector to a background sweep")
+{
+	TempDir dir;
+	fs::path backupsRoot = dir.path() / "Backups";
+	fs::path save = dir.path() / "save";
+	GameProfile profile{ L"Background", PathToWide(save), 60, false, L"background" };
+	GlobalSettings settings;
+	settings.deduplicateBackups = true;
+	for (int i = 0; i < 20; ++i) WriteTestFile(save / ("file" + to_string(i) + ".sav"), "contents " + to_string(i));
+	BackupResult result = BackupSaveFolder(profile, settings, backupsRoot, false);
+	REQUIRE(result.localSuccess);
+	WaitForContentSweeps();
+	fs::remove_all(GetLocalGameBackupDir(backupsRoot, profile) / ToPath(result.folderName));
+
+	atomic<int> sweeps{ 0 };
+	atomic<uint64_t> removed{ 0 };
+	ScheduleContentSweep(backupsRoot, kContentStoreShards, [&](const ContentSweepStats& stats)
+		{
+			sweeps++;
+			removed += stats.filesRemoved;
+		});
+	WaitForContentSweeps();
+	CHECK_EQ(sweeps.load(), 1);
+	CHECK_EQ(removed.load(), 20u);
+	CHECK_EQ(CountStoreFiles(backupsRoot), 0u);
+}
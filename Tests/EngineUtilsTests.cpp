@@ -0,0 +1,57 @@
+#include "TestHarness.h"
+#include "EngineUtils.h"
+
+using namespace std;
+
+TEST_CASE("s2ws/ws2s round-trip ASCII and non-ASCII text")
+{
+	CHECK(s2ws("Elden Ring") == L"Elden Ring");
+	CHECK(ws2s(L"Elden Ring") == "Elden Ring");
+
+	string utf8 = "caf\xC3\xA9 \xE6\x97\xA5\xE6\x9C\xAC \xF0\x9F\x8E\xAE"; // "café 日本 🎮"
+	wstring wide = s2ws(utf8);
+	CHECK(ws2s(wide) == utf8);
+	CHECK(wide.substr(0, 4) == L"café");
+}
+
+TEST_CASE("s2ws replaces invalid UTF-8 instead of failing")
+{
+	wstring wide = s2ws("ok\xFF" "end\xE6");
+	CHECK(wide.substr(0, 2) == L"ok");
+	CHECK(wide.find(L"end") != wstring::npos);
+	CHECK(wide.back() == L'\xFFFD');
+}
+
+TEST_CASE("ToPath/PathToWide keep non-ASCII names intact")
+{
+	wstring name = L"Niño Save 日本";
+	CHECK(PathToWide(ToPath(name)) == name);
+}
+
+TEST_CASE("endsWith")
+{
+	CHECK(endsWith(L"1700000000-[2023-11-14_22-13-20]-A", L"-A"));
+	CHECK(!endsWith(L"1700000000-[2023-11-14_22-13-20]-M", L"-A"));
+	CHECK(!endsWith(L"A", L"-A"));
+}
+
+TEST_CASE("IsValidFilename rejects reserved characters and names")
+{
+	CHECK(IsValidFilename(L"Elden Ring"));
+	CHECK(!IsValidFilename(L""));
+	CHECK(!IsValidFilename(L"a/b"));
+	CHECK(!IsValidFilename(L"what?"));
+	CHECK(!IsValidFilename(L"con"));
+	CHECK(!IsValidFilename(L"COM3"));
+	CHECK(IsValidFilename(L"COM10"));
+	CHECK(!IsValidFilename(L"trailing."));
+	CHECK(!IsValidFilename(L"trailing "));
+}
+
+TEST_CASE("FormatFolderDateTime produces a folder-safe timestamp")
+{
+	wstring stamp = FormatFolderDateTime(time(nullptr));
+	CHECK(stamp.size() == 19); // YYYY-MM-DD_HH-MM-SS
+	CHECK(stamp.find(L':') == wstring::npos);
+	CHECK(GetCurrentDateTime().size() == 19);
+}
@@ -0,0 +1,311 @@
+#include "TestHarness.h"
+#include "BackupIndex.h"
+#include "BackupOperations.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "Sha256.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	// Sends every file through the large-file path while alive
+	struct ForceLargeCopies
+	{
+		LargeFileCopyOptions saved = GetLargeFileCopyOptions();
+		explicit ForceLargeCopies(bool directIo = false)
+		{
+			LargeFileCopyOptions options = saved;
+			options.threshold = 0;
+			options.directIo = directIo;
+			SetLargeFileCopyOptions(options);
+		}
+		~ForceLargeCopies() { SetLargeFileCopyOptions(saved); }
+	};
+
+	// A file of `size` bytes with 4 KB of data at each offset and holes elsewhere
+	void WriteSparseFile(const fs::path& file, uint64_t size, const vector<uint64_t>& offsets)
+	{
+		fs::create_directories(file.parent_path());
+		{
+			ofstream out(file, ios::binary | ios::trunc);
+			for (uint64_t offset : offsets)
+			{
+				out.seekp(static_cast<streamoff>(offset));
+				out << TestPattern(4096);
+			}
+		}
+		fs::resize_file(file, size);
+	}
+
+	uint64_t DataBytes(const fs::path& file)
+	{
+		uint64_t total = 0;
+		for (const auto& extent : DataExtents(file)) total += extent.length;
+		return total;
+	}
+}
+
+TEST_CASE("Large-file copies match the source at block and buffer boundaries")
+{
+	TempDir dir;
+	const size_t buffer = AlignedBufferPool::kBufferSize;
+	for (bool directIo : { false, true }) // Direct I/O falls back to buffered on file systems without it
+	{
+		for (size_t size : { size_t(0), size_t(1), size_t(4095), size_t(4096), buffer, buffer + 4097 })
+		{
+			fs::path source = dir.path() / ("source_" + to_string(size));
+			fs::path target = dir.path() / "out" / ("copy_" + to_string(size) + (directIo ? "_direct" : ""));
+			WriteTestFile(source, TestPattern(size));
+			fs::create_directories(target.parent_path());
+			LargeFileCopyOptions options;
+			options.directIo = directIo;
+			CopyLargeFile(source, target, options);
+			CHECK_EQ(fs::file_size(target), static_cast<uintmax_t>(size));
+			CHECK(ReadTestFile(target) == TestPattern(size));
+		}
+	}
+
+	// Existing targets are truncated, and permissions follow the source
+	fs::path source = dir.path() / "source_1";
+	fs::path target = dir.path() / "out" / "copy_4095";
+	fs::permissions(source, fs::perms::owner_read | fs::perms::owner_write);
+	CopyLargeFile(source, target, LargeFileCopyOptions{});
+	CHECK_EQ(fs::file_size(target), 1u);
+	CHECK(fs::status(target).permissions() == fs::status(source).permissions());
+
+	bool threw = false;
+	try { CopyLargeFile(dir.path() / "missing", target, LargeFileCopyOptions{}); }
+	catch (const fs::filesystem_error&) { threw = true; }
+	CHECK(threw);
+}
+
+TEST_CASE("CopySaveFile follows fs::copy_file's rules for existing targets")
+{
+	TempDir dir;
+	ForceLargeCopies force;
+	fs::path source = dir.path() / "new.sav";
+	fs::path target = dir.path() / "old.sav";
+	WriteTestFile(source, "new contents");
+	WriteTestFile(target, "old");
+
+	bool threw = false;
+	try { CopySaveFile(source, target, 12); }
+	catch (const fs::filesystem_error&) { threw = true; }
+	CHECK(threw);
+	CHECK(!CopySaveFile(source, target, 12, fs::copy_options::skip_existing));
+	CHECK_EQ(ReadTestFile(target), string("old"));
+
+	fs::last_write_time(target, fs::last_write_time(source) + chrono::hours(1));
+	CHECK(!CopySaveFile(source, target, 12, fs::copy_options::update_existing));
+	fs::last_write_time(target, fs::last_write_time(source) - chrono::hours(1));
+	CHECK(CopySaveFile(source, target, 12, fs::copy_options::update_existing));
+	CHECK_EQ(ReadTestFile(target), string("new contents"));
+
+	WriteTestFile(target, "old");
+	CHECK(CopySaveFile(source, target, 12, fs::copy_options::overwrite_existing));
+	CHECK_EQ(ReadTestFile(target), string("new contents"));
+}
+
+TEST_CASE("Copy buffers are aligned and reused across files")
+{
+	AlignedBufferPool pool(2);
+	{
+		AlignedBufferPool::Lease first = pool.Acquire();
+		AlignedBufferPool::Lease second = pool.Acquire();
+		CHECK_EQ(reinterpret_cast<uintptr_t>(first.Data()) % AlignedBufferPool::kAlignment, 0u);
+		CHECK_EQ(reinterpret_cast<uintptr_t>(second.Data()) % AlignedBufferPool::kAlignment, 0u);
+		CHECK(first.Data() != second.Data());
+	}
+	for (int i = 0; i < 5; ++i) pool.Acquire();
+	CHECK_EQ(pool.Allocations(), 2u);
+
+	// A backup with several large files allocates no more than one buffer
+	TempDir dir;
+	ForceLargeCopies force;
+	for (int i = 0; i < 4; ++i) WriteTestFile(dir.path() / "save" / ("world" + to_string(i) + ".dat"), TestPattern(100000 + i));
+	size_t before = AlignedBufferPool::Shared().Allocations();
+	CopyScannedTree(ScanTree(dir.path() / "save"), dir.path() / "save", dir.path() / "backup", fs::copy_options::none);
+	CHECK(AlignedBufferPool::Shared().Allocations() <= before + 1);
+	CHECK(ReadTestFile(dir.path() / "backup" / "world3.dat") == TestPattern(100003));
+}
+
+TEST_CASE("Sparse files are copied region by region and keep their holes")
+{
+	TempDir dir;
+	const uint64_t size = 16 * 1024 * 1024;
+	fs::path source = dir.path() / "disk.img";
+	WriteSparseFile(source, size, { 0, 5 * 1024 * 1024, size - 4096 });
+	if (DataBytes(source) == size) return; // No holes on this file system: nothing to check
+
+	vector<FileExtent> layout = DataExtents(source);
+	REQUIRE(layout.size() == 3);
+	CHECK((layout[1] == FileExtent{ 5 * 1024 * 1024, 4096 }));
+	REQUIRE(FindSparseLayout(source, size).has_value());
+	CHECK(!FindSparseLayout(dir.path() / "missing.img", size).has_value());
+
+	fs::path target = dir.path() / "copy" / "disk.img";
+	fs::create_directories(target.parent_path());
+	CHECK(CopySaveFile(source, target, size));
+	CHECK(ReadTestFile(target) == ReadTestFile(source));
+	CHECK(DataExtents(target) == layout);
+
+	// A copy that lost its holes gets them back from the recorded layout
+	fs::path dense = dir.path() / "dense.img";
+	WriteTestFile(dense, ReadTestFile(source));
+	CHECK_EQ(DataBytes(dense), size);
+	fs::path restored = dir.path() / "restored.img";
+	CHECK(CopySaveFile(dense, restored, size, fs::copy_options::none, &layout));
+	CHECK(ReadTestFile(restored) == ReadTestFile(source));
+	CHECK(DataExtents(restored) == layout);
+}
+
+TEST_CASE("Copies hash the contents as they read them")
+{
+	TempDir dir;
+	auto copyHex = [&](const fs::path& source, const vector<FileExtent>* layout)
+		{
+			Sha256 digest;
+			fs::path target = dir.path() / "copies" / source.filename();
+			fs::create_directories(target.parent_path());
+			REQUIRE(CopySaveFile(source, target, fs::file_size(source), fs::copy_options::overwrite_existing, layout, nullptr, &digest));
+			CHECK(ReadTestFile(target) == ReadTestFile(source));
+			Sha256::Digest value = digest.Final();
+			return ToHex(value.data(), value.size());
+		};
+
+	fs::path small = dir.path() / "slot.sav";
+	WriteTestFile(small, TestPattern(100000));
+	CHECK_EQ(copyHex(small, nullptr), Sha256FileHex(small));
+	fs::path empty = dir.path() / "empty.sav";
+	WriteTestFile(empty, "");
+	CHECK_EQ(copyHex(empty, nullptr), Sha256FileHex(empty));
+	{
+		ForceLargeCopies large;
+		fs::path big = dir.path() / "world.dat";
+		WriteTestFile(big, TestPattern(AlignedBufferPool::kBufferSize + 12345, 7));
+		CHECK_EQ(copyHex(big, nullptr), Sha256FileHex(big));
+	}
+	// Holes count as the zeros they read as, before, between and after the data
+	fs::path image = dir.path() / "disk.img";
+	const uint64_t size = 4 * 1024 * 1024;
+	WriteSparseFile(image, size, { 1024 * 1024, 2 * 1024 * 1024 });
+	vector<FileExtent> layout = { { 1024 * 1024, 4096 }, { 2 * 1024 * 1024, 4096 } };
+	CHECK_EQ(copyHex(image, &layout), Sha256FileHex(image));
+}
+
+TEST_CASE("A resumed copy keeps the written part and reports the rest once written")
+{
+	TempDir dir;
+	const uint64_t resumeFrom = 4 * 1024 * 1024;
+	auto resume = [&](const fs::path& source, const fs::path& partial)
+		{
+			// An earlier attempt got the first 4 MiB right and wrote junk after them
+			string start = ReadTestFile(source).substr(0, static_cast<size_t>(resumeFrom));
+			WriteTestFile(partial, start + string(3 * 1024 * 1024, 'x'));
+			Sha256 rest;
+			uint64_t reported = 0;
+			ResumeSaveFileCopy(source, partial, fs::file_size(source), resumeFrom, [&](const char* data, size_t length)
+				{
+					CHECK_EQ(fs::file_size(partial), fs::file_size(source)); // Reported once written
+					rest.Update(data, length);
+					reported += length;
+				});
+			CHECK(ReadTestFile(partial) == ReadTestFile(source));
+			CHECK_EQ(reported, fs::file_size(source) - resumeFrom);
+			Sha256 expected;
+			string tail = ReadTestFile(source).substr(static_cast<size_t>(resumeFrom));
+			expected.Update(tail.data(), tail.size());
+			CHECK(rest.Final() == expected.Final());
+		};
+
+	fs::path world = dir.path() / "world.dat";
+	WriteTestFile(world, TestPattern(AlignedBufferPool::kBufferSize + 12345, 3));
+	resume(world, dir.path() / "world.partial");
+	{
+		ForceLargeCopies large;
+		resume(world, dir.path() / "world-large.partial");
+	}
+
+	// Holes after the resume point stay holes, and reach the callback as zeros
+	const uint64_t size = 16 * 1024 * 1024;
+	fs::path image = dir.path() / "disk.img";
+	WriteSparseFile(image, size, { 0, 6 * 1024 * 1024, size - 4096 });
+	fs::path partial = dir.path() / "disk.partial";
+	resume(image, partial);
+	auto after = [&](const fs::path& file)
+		{
+			vector<FileExtent> extents = DataExtents(file);
+			extents.erase(remove_if(extents.begin(), extents.end(), [&](const FileExtent& e) { return e.offset < resumeFrom; }), extents.end());
+			return extents;
+		};
+	if (DataBytes(image) < size) CHECK(after(partial) == after(image));
+
+	bool threw = false;
+	try { ResumeSaveFileCopy(world, dir.path() / "odd.partial", fs::file_size(world), 100, nullptr); }
+	catch (const invalid_argument&) { threw = true; }
+	CHECK(threw);
+}
+
+TEST_CASE("Data in a hole of a stale layout is still written")
+{
+	string data(16384, '\0');
+	data[100] = 'a';   // In a hole: its block is written
+	data[13000] = 'b'; // Same, two blocks on; the zero block between stays a hole
+	vector<FileExtent> layout = { { 4096, 4096 } };
+
+	vector<pair<uint64_t, size_t>> runs;
+	ForEachDataRun(layout, 0, data.data(), data.size(), [&](uint64_t offset, const char* run, size_t length)
+		{
+			CHECK(run == data.data() + offset);
+			runs.emplace_back(offset, length);
+		});
+	CHECK((runs == vector<pair<uint64_t, size_t>>{ { 0, 8192 }, { 12288, 4096 } }));
+
+	// Offsets carry over between calls; an all-zero hole is skipped entirely
+	runs.clear();
+	string zeros(8192, '\0');
+	ForEachDataRun(layout, 8192, zeros.data(), zeros.size(), [&](uint64_t offset, const char*, size_t length) { runs.emplace_back(offset, length); });
+	CHECK(runs.empty());
+	ForEachDataRun(layout, 2048, zeros.data(), zeros.size(), [&](uint64_t offset, const char*, size_t length) { runs.emplace_back(offset, length); });
+	CHECK((runs == vector<pair<uint64_t, size_t>>{ { 4096, 4096 } }));
+}
+
+TEST_CASE("Backups record sparse layouts and restores recreate the holes")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	const uint64_t size = 8 * 1024 * 1024;
+	WriteSparseFile(save / "memcard.ps2", size, { 1024 * 1024 });
+	WriteTestFile(save / "small.sav", "small");
+	if (DataBytes(save / "memcard.ps2") == size) return;
+
+	GameProfile profile{ L"Sparse", PathToWide(save), 60, false, L"sparse" };
+	BackupResult result = BackupSaveFolder(profile, GlobalSettings{}, dir.path() / "Backups", false);
+	REQUIRE(result.localSuccess);
+	fs::path backup = GetLocalGameBackupDir(dir.path() / "Backups", profile) / ToPath(result.folderName);
+	CHECK_EQ(DataBytes(backup / "memcard.ps2"), 4096u);
+	BackupManifest index = LoadBackupIndex(backup);
+	REQUIRE(index.entries.size() == 2);
+	CHECK(index.entries[0].sparse);
+	CHECK((index.entries[0].extents == vector<FileExtent>{ { 1024 * 1024, 4096 } }));
+	CHECK(!index.entries[1].sparse);
+	CHECK_EQ(index.entries[0].sha256, Sha256FileHex(save / "memcard.ps2")); // Hashed during the copy
+	CHECK_EQ(index.entries[1].sha256, Sha256FileHex(save / "small.sav"));
+
+	// The backup drive lost the holes (copied without sparse support): the index has them
+	WriteTestFile(backup / "memcard.ps2", ReadTestFile(save / "memcard.ps2"));
+	REQUIRE(RestoreBackup(backup, save));
+	CHECK_EQ(DataBytes(save / "memcard.ps2"), 4096u);
+	CHECK_EQ(ReadTestFile(save / "small.sav"), string("small"));
+
+	fs::remove(save / "memcard.ps2");
+	RestoreSelectedFiles(backup, index.Select({ "memcard.ps2" }), save);
+	CHECK_EQ(DataBytes(save / "memcard.ps2"), 4096u);
+	CHECK(ReadTestFile(save / "memcard.ps2") == ReadTestFile(backup / "memcard.ps2"));
+}
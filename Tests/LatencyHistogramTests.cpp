@@ -0,0 +1,56 @@
+#include "TestHarness.h"
+#include "LatencyHistogram.h"
+
+using namespace std;
+
+TEST_CASE("LatencyHistogram is exact for small values")
+{
+	LatencyHistogram histogram;
+	for (int i = 1; i <= 100; ++i) histogram.Record(chrono::microseconds(i));
+
+	CHECK_EQ(histogram.Count(), 100u);
+	CHECK_EQ(histogram.PercentileMicros(0.50), 50u);
+	CHECK_EQ(histogram.PercentileMicros(0.99), 99u);
+	CHECK_EQ(histogram.MaxMicros(), 100u);
+}
+
+TEST_CASE("LatencyHistogram keeps relative error small across the range")
+{
+	const uint64_t values[] = { 1000, 12345, 250000, 3000000, 600000000, 3600000000ULL };
+	for (uint64_t value : values)
+	{
+		LatencyHistogram histogram;
+		histogram.Record(chrono::microseconds(value));
+		histogram.Record(chrono::microseconds(value * 2)); // Max is exact; p50 is the bucket bound
+		uint64_t p50 = histogram.PercentileMicros(0.5);
+		CHECK(p50 >= value);
+		CHECK(static_cast<double>(p50 - value) <= static_cast<double>(value) * 0.02);
+		CHECK_EQ(histogram.MaxMicros(), value * 2);
+	}
+}
+
+TEST_CASE("LatencyHistogram percentiles follow the distribution")
+{
+	LatencyHistogram histogram;
+	for (int i = 0; i < 990; ++i) histogram.Record(chrono::milliseconds(10));
+	for (int i = 0; i < 10; ++i) histogram.Record(chrono::seconds(2));
+
+	CHECK(histogram.PercentileMicros(0.50) >= 10000 && histogram.PercentileMicros(0.50) < 10200);
+	CHECK(histogram.PercentileMicros(0.99) < 10200);   // 990th sample is still 10 ms
+	CHECK(histogram.PercentileMicros(0.999) >= 2000000);
+	CHECK_EQ(histogram.MaxMicros(), 2000000u);
+}
+
+TEST_CASE("LatencyHistogram Reset clears samples and Summary reflects them")
+{
+	LatencyHistogram histogram;
+	CHECK(histogram.Summary() == L"no samples");
+	histogram.Record(chrono::milliseconds(12));
+	CHECK(histogram.Summary().find(L"(n=1)") != wstring::npos);
+	CHECK(histogram.Summary().find(L"max 12.0 ms") != wstring::npos);
+
+	histogram.Reset();
+	CHECK_EQ(histogram.Count(), 0u);
+	CHECK_EQ(histogram.PercentileMicros(0.5), 0u);
+	CHECK_EQ(histogram.MaxMicros(), 0u);
+}
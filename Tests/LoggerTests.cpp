@@ -0,0 +1,129 @@
+#include "TestHarness.h"
+#include "Logger.h"
+#include "EngineUtils.h"
+
+#include <set>
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	size_t CountLines(const string& text)
+	{
+		size_t lines = 0;
+		for (char c : text) lines += (c == '\n');
+		return lines;
+	}
+}
+
+TEST_CASE("Logger writes records from many threads without losing or mixing lines")
+{
+	wostringstream console;
+	Logger logger;
+	logger.Start({ &console, {} });
+
+	const int threads = 4, perThread = 2000; // More than the queue holds at once
+	vector<thread> producers;
+	for (int t = 0; t < threads; ++t)
+	{
+		producers.emplace_back([&, t]
+			{
+				for (int i = 0; i < perThread; ++i)
+				{
+					wstring message = L"t" + to_wstring(t) + L"-" + to_wstring(i);
+					while (!logger.Log(LogLevel::Info, L"Game", L"backup", message)) this_thread::yield();
+				}
+			});
+	}
+	for (auto& producer : producers) producer.join();
+	logger.Stop();
+
+	set<wstring> seen;
+	wistringstream lines(console.str());
+	wstring line;
+	while (getline(lines, line)) seen.insert(line);
+	CHECK_EQ(seen.size(), static_cast<size_t>(threads * perThread));
+	CHECK(seen.count(L"t3-1999") == 1);
+}
+
+TEST_CASE("Logger keeps records queued before Start and Flush waits for them")
+{
+	wostringstream console;
+	Logger logger;
+	logger.Log(LogLevel::Info, L"", L"", L"early");
+	logger.Start({ &console, {} });
+	logger.Log(LogLevel::Warning, L"", L"", L"late");
+	logger.Separator();
+	logger.Flush();
+	CHECK(console.str() == L"early\nlate\n--------------------------------------------------\n");
+	logger.Stop();
+}
+
+TEST_CASE("Logger writes structured lines to the log file and skips separators")
+{
+	TempDir dir;
+	fs::path logFile = dir.path() / "Logs" / "test.log";
+	Logger logger;
+	logger.Start({ nullptr, logFile });
+	logger.Log(LogLevel::Error, L"Elden Ring", L"restore", L"RESTORE FAILED: locked");
+	logger.Separator();
+	logger.Log(LogLevel::Info, L"", L"", L"no game");
+	logger.Stop();
+
+	string text = ReadTestFile(logFile);
+	CHECK_EQ(CountLines(text), 2u);
+	CHECK(text.find(" ERROR [Elden Ring] [restore] RESTORE FAILED: locked") != string::npos);
+	CHECK(text.find(" INFO  [-] [-] no game") != string::npos);
+	CHECK(text.find("----") == string::npos);
+}
+
+TEST_CASE("Logger rotates the log file at the size limit")
+{
+	TempDir dir;
+	fs::path logFile = dir.path() / "rotate.log";
+	LoggerOptions options;
+	options.logFile = logFile;
+	options.maxFileBytes = 400;
+	options.maxFiles = 3;
+
+	Logger logger;
+	logger.Start(options);
+	for (int i = 0; i < 40; ++i) logger.Log(LogLevel::Info, L"Game", L"backup", L"line " + to_wstring(i));
+	logger.Stop();
+
+	CHECK(fs::exists(logFile));
+	CHECK(fs::exists(dir.path() / "rotate.log.1"));
+	CHECK(fs::exists(dir.path() / "rotate.log.2"));
+	CHECK(!fs::exists(dir.path() / "rotate.log.3"));
+	CHECK(fs::file_size(logFile) <= 400);
+	CHECK(ReadTestFile(logFile).find("line 39") != string::npos);
+}
+
+TEST_CASE("Logger truncates long names and spills long messages over several records")
+{
+	TempDir dir;
+	fs::path logFile = dir.path() / "spill.log";
+	wostringstream console;
+	Logger logger;
+	logger.Start({ &console, logFile });
+	wstring message;
+	for (int i = 0; message.size() < 1000; ++i) message += L"part " + to_wstring(i) + L" ";
+	logger.Log(LogLevel::Info, wstring(500, L'g'), L"operation-name-too-long", message);
+	logger.Log(LogLevel::Info, L"Game", L"backup", L"after");
+	logger.Log(LogLevel::Info, L"Game", L"backup", wstring(LogRecord::kMaxMessage * Logger::kMaxSpill, L'x'));
+	logger.Stop();
+
+	// Whole and on one line, with nothing in between
+	wstring lines = console.str();
+	CHECK(lines.compare(0, message.size() + 7, message + L"\nafter\n") == 0);
+	const size_t kept = (LogRecord::kMaxMessage - 1) * Logger::kMaxSpill;
+	wstring last = lines.substr(message.size() + 7);
+	CHECK_EQ(last.size(), kept + 1); // Cut where the records run out, plus newline
+	CHECK(last.compare(kept - 3, 3, L"...") == 0);
+
+	string text = ReadTestFile(logFile);
+	CHECK_EQ(CountLines(text), 3u);
+	CHECK(text.find("[" + string(LogRecord::kMaxGame - 4, 'g') + "...] [operation-na...] " + ws2s(message)) != string::npos);
+}
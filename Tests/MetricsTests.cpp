@@ -0,0 +1,152 @@
+#include "TestHarness.h"
+#include "BackupOperations.h"
+#include "EngineUtils.h"
+#include "Metrics.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+TEST_CASE("DurationHistogram places samples in the first bucket that fits")
+{
+	DurationHistogram histogram;
+	histogram.Record(chrono::microseconds(500));  // <= 1ms
+	histogram.Record(chrono::milliseconds(1));    // Bounds are inclusive
+	histogram.Record(chrono::milliseconds(70));   // <= 100ms
+	histogram.Record(chrono::seconds(1000));      // +Inf
+
+	CHECK_EQ(histogram.Count(), 4u);
+	CHECK_EQ(histogram.BucketCount(0), 2u);
+	CHECK_EQ(histogram.BucketCount(4), 1u);
+	CHECK_EQ(histogram.BucketCount(DurationHistogram::kBoundsSeconds.size()), 1u);
+	CHECK(histogram.SumSeconds() > 1000.0);
+
+	histogram.Reset();
+	CHECK_EQ(histogram.Count(), 0u);
+	CHECK_EQ(histogram.BucketCount(0), 0u);
+}
+
+TEST_CASE("Backup, purge, sync and restore update the engine metrics")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot1.sav", "12345");
+	WriteTestFile(save / "sub" / "slot2.sav", "123");
+	fs::create_directories(dir.path() / "cloud");
+
+	EngineMetrics& metrics = GetEngineMetrics();
+	metrics.Reset();
+
+	GameProfile profile{ L"Metrics", PathToWide(save), 60, true, L"metrics" };
+	GlobalSettings settings;
+	settings.googleDrivePath = PathToWide(dir.path() / "cloud");
+	BackupResult result = BackupSaveFolder(profile, settings, dir.path() / "Backups", false);
+	REQUIRE(result.localSuccess);
+	REQUIRE(result.cloudSuccess);
+
+	CHECK_EQ(metrics.Op(MetricOp::Backup).runs.load(), 1u);
+	CHECK_EQ(metrics.Op(MetricOp::Backup).filesCopied.load(), 2u);
+	CHECK_EQ(metrics.Op(MetricOp::Backup).bytesCopied.load(), 8u);
+	CHECK_EQ(metrics.Op(MetricOp::CloudSync).runs.load(), 1u);
+	CHECK_EQ(metrics.Op(MetricOp::CloudSync).bytesCopied.load(), 8u);
+	CHECK_EQ(metrics.Op(MetricOp::Purge).runs.load(), 2u); // Local and cloud
+	CHECK_EQ(metrics.Stage(MetricStage::Scan).Count(), 1u);
+	CHECK_EQ(metrics.Stage(MetricStage::Copy).Count(), 1u);
+	CHECK_EQ(metrics.Stage(MetricStage::Sync).Count(), 1u);
+
+	WriteTestFile(save / "extra.sav", "x");
+	fs::path backup = GetLocalGameBackupDir(dir.path() / "Backups", profile) / ToPath(result.folderName);
+	REQUIRE(RestoreBackup(backup, save));
+	CHECK_EQ(metrics.Op(MetricOp::Restore).runs.load(), 1u);
+	CHECK_EQ(metrics.Op(MetricOp::Restore).filesDeleted.load(), 4u); // slot1, sub, sub/slot2, extra
+	CHECK_EQ(metrics.Op(MetricOp::Restore).filesCopied.load(), 2u);
+	CHECK_EQ(metrics.Stage(MetricStage::Restore).Count(), 1u);
+
+	GameProfile missing{ L"Missing", PathToWide(dir.path() / "nope"), 60, false, L"missing" };
+	CHECK(!BackupSaveFolder(missing, settings, dir.path() / "Backups", true).localSuccess);
+	CHECK_EQ(metrics.Op(MetricOp::Backup).errors.load(), 1u);
+}
+
+TEST_CASE("Purge counts deleted entries")
+{
+	TempDir dir;
+	for (int i = 1; i <= 3; ++i)
+	{
+		WriteTestFile(dir.path() / (to_string(i) + "-[x]-A") / "slot1.sav", "data");
+	}
+	EngineMetrics& metrics = GetEngineMetrics();
+	metrics.Reset();
+
+	vector<wstring> log;
+	PurgeBackups(dir.path(), L"A", 1, 0, L"Local", log);
+	CHECK_EQ(metrics.Op(MetricOp::Purge).runs.load(), 1u);
+	CHECK_EQ(metrics.Op(MetricOp::Purge).filesDeleted.load(), 4u); // Two folders with one file each
+	CHECK_EQ(metrics.Stage(MetricStage::Purge).Count(), 1u);
+}
+
+TEST_CASE("WriteMetricsFiles writes JSON and Prometheus text")
+{
+	TempDir dir;
+	EngineMetrics metrics;
+	metrics.Op(MetricOp::Backup).runs = 3;
+	metrics.Op(MetricOp::Restore).errors = 1;
+	metrics.Stage(MetricStage::Copy).Record(chrono::milliseconds(20));
+	metrics.Deferrals().deferred = 2;
+
+	REQUIRE(WriteMetricsFiles(metrics, dir.path() / "metrics.json", dir.path() / "metrics.prom"));
+	CHECK(!fs::exists(dir.path() / "metrics.json.tmp"));
+
+	string json = ReadTestFile(dir.path() / "metrics.json");
+	CHECK(json.find("\"backup\": {\"runs\": 3") != string::npos);
+	CHECK(json.find("\"copy\": {\"count\": 1") != string::npos);
+	CHECK(json.find("\"deferrals\": {\"checks\": 0, \"deferred\": 2") != string::npos);
+
+	string prom = ReadTestFile(dir.path() / "metrics.prom");
+	CHECK(prom.find("# TYPE gsbm_operations_total counter") != string::npos);
+	CHECK(prom.find("gsbm_operations_total{op=\"backup\"} 3") != string::npos);
+	CHECK(prom.find("gsbm_operation_errors_total{op=\"restore\"} 1") != string::npos);
+	CHECK(prom.find("gsbm_stage_duration_seconds_bucket{stage=\"copy\",le=\"0.01\"} 0") != string::npos);
+	CHECK(prom.find("gsbm_stage_duration_seconds_bucket{stage=\"copy\",le=\"0.05\"} 1") != string::npos);
+	CHECK(prom.find("gsbm_stage_duration_seconds_bucket{stage=\"copy\",le=\"+Inf\"} 1") != string::npos);
+	CHECK(prom.find("gsbm_stage_duration_seconds_count{stage=\"copy\"} 1") != string::npos);
+	CHECK(prom.find("gsbm_autosave_deferrals_total 2") != string::npos);
+}
+
+TEST_CASE("Latencies are exported and can be reset on their own")
+{
+	EngineMetrics metrics;
+	metrics.Op(MetricOp::Backup).runs = 1;
+	metrics.Latency(LatencyMetric::ManualBackup).Record(chrono::milliseconds(5));
+
+	CHECK(metrics.ToJson().find("\"manual_backup\": {\"count\": 1") != string::npos);
+	CHECK(metrics.ToPrometheusText().find("gsbm_latency_seconds_count{kind=\"manual_backup\"} 1") != string::npos);
+
+	metrics.ResetLatencies();
+	CHECK_EQ(metrics.Latency(LatencyMetric::ManualBackup).Count(), 0u);
+	CHECK_EQ(metrics.Op(MetricOp::Backup).runs.load(), 1u); // Counters are untouched
+}
+
+TEST_CASE("A snapshot's latencies can be read back by another process")
+{
+	TempDir dir;
+	EngineMetrics metrics;
+	metrics.Latency(LatencyMetric::ManualBackup).Record(chrono::milliseconds(5));
+	metrics.Latency(LatencyMetric::ManualBackup).Record(chrono::milliseconds(40));
+	metrics.Latency(LatencyMetric::AutoSaveLag).Record(chrono::seconds(2));
+	REQUIRE(WriteMetricsFiles(metrics, dir.path() / "metrics.json", dir.path() / "metrics.prom"));
+
+	LatencySnapshots latencies;
+	int64_t timestamp = 0;
+	REQUIRE(ReadLatencySnapshot(dir.path() / "metrics.json", latencies, timestamp));
+	CHECK(timestamp > 0);
+	for (LatencyMetric metric : { LatencyMetric::ManualBackup, LatencyMetric::QuickRestore, LatencyMetric::AutoSaveLag })
+	{
+		const LatencyHistogram& recorded = metrics.Latency(metric);
+		const LatencySnapshot& read = latencies[static_cast<size_t>(metric)];
+		CHECK_EQ(read.count, recorded.Count());
+		CHECK(LatencyHistogram::FormatSummary(read.count, read.p50Ms, read.p99Ms, read.maxMs) == recorded.Summary());
+	}
+
+	CHECK(!ReadLatencySnapshot(dir.path() / "missing.json", latencies, timestamp));
+	WriteTestFile(dir.path() / "old.json", "{\n  \"timestamp\": 5,\n  \"operations\": {}\n}\n");
+	CHECK(!ReadLatencySnapshot(dir.path() / "old.json", latencies, timestamp));
+}
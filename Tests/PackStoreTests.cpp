@@ -0,0 +1,116 @@
+#include "TestHarness.h"
+#include "BackupOperations.h"
+#include "EngineUtils.h"
+#include "PackStore.h"
+#include "StorageBackend.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	size_t CountFiles(const fs::path& root)
+	{
+		size_t count = 0;
+		for (const auto& entry : fs::recursive_directory_iterator(root))
+		{
+			if (entry.is_regular_file()) count++;
+		}
+		return count;
+	}
+}
+
+TEST_CASE("Pack indexes round-trip and reject malformed lines")
+{
+	PackIndex index;
+	ManifestEntry folder;
+	folder.path = "maps";
+	folder.type = fs::file_type::directory;
+	ManifestEntry packed;
+	packed.path = "maps/level\t1.dat";
+	packed.size = 12;
+	packed.mtime = 1700000000123456789;
+	packed.sha256 = string(64, 'a');
+	ManifestEntry standalone;
+	standalone.path = "world.dat";
+	standalone.size = 1 << 20;
+	standalone.mtime = 1700000000000000000;
+	index.manifest.entries = { folder, packed, standalone };
+	index.slots[packed.path] = { 2, 4096 };
+
+	PackIndex parsed = PackIndex::Parse(index.Serialize());
+	REQUIRE(parsed.manifest.entries.size() == 3);
+	CHECK(parsed.manifest.entries[0].type == fs::file_type::directory);
+	CHECK(parsed.manifest.entries[1].path == packed.path);
+	CHECK_EQ(parsed.manifest.entries[1].mtime, packed.mtime);
+	CHECK(parsed.manifest.entries[1].sha256 == packed.sha256);
+	CHECK_EQ(parsed.manifest.entries[2].size, standalone.size);
+	REQUIRE(parsed.slots.size() == 1);
+	CHECK_EQ(parsed.slots.at(packed.path).pack, 2u);
+	CHECK_EQ(parsed.slots.at(packed.path).offset, 4096u);
+
+	for (const char* bad : { "GSBM-PACKS 2\n", "GSBM-PACKS 1\nF\ta\t1\t2\n", "GSBM-PACKS 1\nF\ta\tx\t2\tsha\n",
+		"GSBM-PACKS 1\nF\ta\t1\t2\tsha\t3\n", "GSBM-PACKS 1\nF\ta\t1\t2\t\t0:0\n", "GSBM-PACKS 1\nX\ta\n" })
+	{
+		bool threw = false;
+		try { PackIndex::Parse(bad); }
+		catch (const ManifestError&) { threw = true; }
+		CHECK(threw);
+	}
+}
+
+TEST_CASE("Packed cloud backups store few files and restore transparently")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	for (int i = 0; i < 200; ++i) WriteTestFile(save / "chunks" / ("c" + to_string(i) + ".dat"), "chunk " + to_string(i));
+	string world(100 * 1024, 'w');
+	WriteTestFile(save / "world.dat", world);
+	fs::create_directories(save / "screenshots");
+	fs::last_write_time(save / "chunks" / "c7.dat", fs::last_write_time(save / "world.dat") - chrono::hours(24));
+	fs::create_directories(dir.path() / "cloud");
+
+	GameProfile profile{ L"Packed", PathToWide(save), 60, true, L"packed" };
+	GlobalSettings settings;
+	settings.googleDrivePath = PathToWide(dir.path() / "cloud");
+	settings.packSmallFilesKb = 64;
+	BackupResult result = BackupSaveFolder(profile, settings, dir.path() / "Backups", true);
+	REQUIRE(result.cloudSuccess);
+
+	// The sync folder holds the large file, one pack and the index
+	fs::path cloudBackup = GetCloudGameBackupDir(settings.googleDrivePath, profile) / ToPath(result.folderName);
+	CHECK_EQ(CountFiles(cloudBackup), 3u);
+	CHECK(ReadTestFile(cloudBackup / "world.dat") == world);
+	CHECK(!fs::exists(GetLocalGameBackupDir(dir.path() / "Backups", profile) / ".packing"));
+
+	unique_ptr<StorageBackend> cloud = CreateStorageBackend(settings);
+	string backupPrefix = GetStorageGamePrefix(profile) + ws2s(result.folderName) + "/";
+	REQUIRE(IsPackedBackup(*cloud, backupPrefix));
+	BackupManifest index = GetStoredBackupIndex(*cloud, backupPrefix);
+	CHECK_EQ(index.entries.size(), 203u); // 201 files and 2 folders
+
+	fs::path restored = dir.path() / "restored";
+	CopyStats stats = DownloadStoredBackup(*cloud, backupPrefix, restored);
+	CHECK_EQ(stats.filesCopied, 201u);
+	CHECK(ReadTestFile(restored / "chunks" / "c42.dat") == "chunk 42");
+	CHECK(ReadTestFile(restored / "world.dat") == world);
+	CHECK(fs::is_directory(restored / "screenshots"));
+	CHECK(fs::last_write_time(restored / "chunks" / "c7.dat") == fs::last_write_time(save / "chunks" / "c7.dat"));
+
+	// Selected files come from their pack or their own object
+	fs::path partial = dir.path() / "partial";
+	stats = DownloadStoredFiles(*cloud, backupPrefix, index.Select({ "chunks/c3.dat", "world.dat" }), partial);
+	CHECK_EQ(stats.filesCopied, 2u);
+	CHECK_EQ(CountFiles(partial), 2u);
+	CHECK(ReadTestFile(partial / "chunks" / "c3.dat") == "chunk 3");
+
+	// A damaged pack is refused rather than restored
+	fs::path pack = cloudBackup / ".gsbm-packs" / "pack-0000";
+	string data = ReadTestFile(pack);
+	data[0] ^= 1;
+	WriteTestFile(pack, data);
+	bool threw = false;
+	try { DownloadStoredBackup(*cloud, backupPrefix, dir.path() / "damaged"); }
+	catch (const StorageError&) { threw = true; }
+	CHECK(threw);
+}
@@ -0,0 +1,126 @@
+#include "TestHarness.h"
+#include "ProcessWatcher.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	uint32_t OwnProcessId()
+	{
+#ifdef _WIN32
+		return GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(getpid());
+#endif
+	}
+
+	wstring OwnExeName()
+	{
+#ifdef _WIN32
+		wchar_t path[MAX_PATH];
+		GetModuleFileNameW(NULL, path, MAX_PATH);
+		return fs::path(path).filename().wstring();
+#else
+		return fs::read_symlink("/proc/self/exe").filename().wstring();
+#endif
+	}
+
+	wstring Upper(wstring text)
+	{
+		for (auto& c : text) c = static_cast<wchar_t>(towupper(c));
+		return text;
+	}
+}
+
+TEST_CASE("This test program is found by its executable name")
+{
+	// "ProcessWatcherTests" is longer than a Linux process name, so the command line decides
+	wstring name = OwnExeName();
+	REQUIRE(!name.empty());
+	CHECK(GetProcessExeName(OwnProcessId()) == name);
+	CHECK(IsProcessRunning(OwnProcessId(), name));
+	CHECK(IsProcessRunning(OwnProcessId(), Upper(name))); // Executable names compare without case
+	CHECK(!IsProcessRunning(OwnProcessId(), L"some-other-game.exe"));
+	CHECK(IsProcessRunning(FindProcess(name), name));
+	CHECK_EQ(FindProcess(L"no-such-game-7f3a.exe"), 0u);
+	CHECK_EQ(FindProcess(L""), 0u);
+}
+
+TEST_CASE("The watcher reports the game starting, exiting and restarting")
+{
+	atomic<uint32_t> gamePid{ 0 };
+	GameProcessWatcher watcher([&](const wstring&, uint32_t) { return gamePid.load(); });
+	mutex eventsMutex;
+	vector<bool> events;
+	auto waitForEvents = [&](size_t count)
+		{
+			for (int i = 0; i < 200; ++i)
+			{
+				{
+					lock_guard<mutex> lock(eventsMutex);
+					if (events.size() >= count) return true;
+				}
+				this_thread::sleep_for(chrono::milliseconds(5));
+			}
+			return false;
+		};
+	ProcessWatchOptions options;
+	options.runningPoll = chrono::milliseconds(5);
+	options.waitingPoll = chrono::milliseconds(5);
+	watcher.Start(L"game.exe", [&](bool running)
+		{
+			lock_guard<mutex> lock(eventsMutex);
+			events.push_back(running);
+		}, options);
+	CHECK(!watcher.IsGameRunning()); // Known from the first look, without an event
+
+	gamePid = 100;
+	REQUIRE(waitForEvents(1));
+	CHECK(watcher.IsGameRunning());
+	gamePid = 0;
+	REQUIRE(waitForEvents(2));
+	CHECK(!watcher.IsGameRunning());
+
+	// Closed and started again between two polls: an exit and a start all the same
+	gamePid = 100;
+	REQUIRE(waitForEvents(3));
+	gamePid = 200;
+	REQUIRE(waitForEvents(5));
+	watcher.Stop();
+	lock_guard<mutex> lock(eventsMutex);
+	CHECK(events == vector<bool>({ true, false, true, false, true }));
+	CHECK(watcher.Polls() >= 5u);
+}
+
+TEST_CASE("A watcher started while the game runs polls only for its exit")
+{
+	atomic<int> scans{ 0 };
+	GameProcessWatcher watcher([&](const wstring&, uint32_t knownPid)
+		{
+			if (knownPid != 0) return knownPid; // The cheap check of the known process
+			++scans;
+			return 42u;
+		});
+	ProcessWatchOptions options;
+	options.runningPoll = chrono::milliseconds(5);
+	watcher.Start(L"game.exe", nullptr, options);
+	CHECK(watcher.IsGameRunning());
+	this_thread::sleep_for(chrono::milliseconds(60));
+	watcher.Stop();
+	CHECK(watcher.Polls() > 2u);
+	CHECK_EQ(scans.load(), 1);
+}
@@ -0,0 +1,160 @@
+#include "TestHarness.h"
+#include "BackupIndex.h"
+#include "BackupOperations.h"
+#include "ChunkStore.h"
+#include "EngineUtils.h"
+#include "FileCopy.h"
+#include "Progress.h"
+#include "StorageBackend.h"
+
+#include <set>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	// Sends every file through the large-file path while alive
+	struct ForceLargeCopies
+	{
+		LargeFileCopyOptions saved = GetLargeFileCopyOptions();
+		ForceLargeCopies()
+		{
+			LargeFileCopyOptions options = saved;
+			options.threshold = 0;
+			SetLargeFileCopyOptions(options);
+		}
+		~ForceLargeCopies() { SetLargeFileCopyOptions(saved); }
+	};
+
+	// Three 1 KB slots and a file just over one copy buffer
+	void WriteSave(const fs::path& save, char fill)
+	{
+		for (int i = 1; i <= 3; ++i) WriteTestFile(save / ("slot" + to_string(i) + ".sav"), string(1024, fill));
+		WriteTestFile(save / "world" / "region.dat", string(AlignedBufferPool::kBufferSize + 4096, fill));
+	}
+
+	const uint64_t kSaveBytes = 3 * 1024 + AlignedBufferPool::kBufferSize + 4096;
+}
+
+TEST_CASE("A backup reports its totals up front, then each file and block as it goes")
+{
+	TempDir dir;
+	ForceLargeCopies large;
+	fs::path save = dir.path() / "save";
+	WriteSave(save, 'a');
+	GameProfile profile{ L"Game", PathToWide(save), 600, false, L"game" };
+
+	vector<ProgressEvent> events;
+	OperationProgress progress([&](const ProgressEvent& event) { events.push_back(event); }, chrono::milliseconds(0));
+	BackupResult result = BackupSaveFolder(profile, GlobalSettings(), dir.path() / "Backups", false, &progress);
+	REQUIRE(result.localSuccess);
+	CHECK(!result.cancelled);
+
+	REQUIRE(events.size() > 2);
+	CHECK_EQ(events.front().filesTotal, 4u);
+	CHECK_EQ(events.front().bytesTotal, kSaveBytes);
+	CHECK_EQ(events.front().bytesDone, 0u);
+	CHECK(!events.front().finished);
+	// The large file shows up as it starts and again after each buffer but the last
+	set<uint64_t> largeFileDone;
+	for (const auto& event : events)
+	{
+		if (event.currentFile == fs::path("world") / "region.dat") largeFileDone.insert(event.bytesDone);
+		CHECK(event.bytesDone <= event.bytesTotal);
+	}
+	REQUIRE(largeFileDone.size() == 3);
+	CHECK_EQ(*largeFileDone.rbegin() - *largeFileDone.begin(), static_cast<uint64_t>(AlignedBufferPool::kBufferSize) + 4096);
+
+	const ProgressEvent& last = events.back();
+	CHECK(last.finished);
+	CHECK_EQ(last.filesDone, 4u);
+	CHECK_EQ(last.bytesDone, kSaveBytes);
+	CHECK(last.currentFile.empty());
+	CHECK(last.eta == chrono::seconds(0));
+	CHECK(last.bytesPerSecond >= 0);
+}
+
+TEST_CASE("A cancelled backup stops at the next file and leaves no backup behind")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteSave(save, 'a');
+	GameProfile profile{ L"Game", PathToWide(save), 600, false, L"game" };
+
+	// The callback may cancel, as the console's key check does
+	OperationProgress progress([&](const ProgressEvent& event) { if (event.filesDone == 1) progress.Cancel(); }, chrono::milliseconds(0));
+	BackupResult result = BackupSaveFolder(profile, GlobalSettings(), dir.path() / "Backups", false, &progress);
+	CHECK(result.cancelled);
+	CHECK(!result.localSuccess);
+	CHECK_EQ(progress.Last().filesDone, 1u); // No file was started after the cancel
+	REQUIRE(result.log.size() == 1);
+	CHECK(result.log[0].find(L"cancelled") != wstring::npos);
+	CHECK(ListBackups(GetLocalGameBackupDir(dir.path() / "Backups", profile)).empty());
+}
+
+TEST_CASE("A cancelled restore leaves the save as it was")
+{
+	TempDir dir;
+	fs::path backup = dir.path() / "game" / "100-[x]-M";
+	fs::path save = dir.path() / "save";
+	WriteSave(backup, 'b');
+	WriteSave(save, 'a');
+	WriteTestFile(save / "stray.tmp", "x");
+
+	OperationProgress progress(nullptr);
+	progress.Cancel();
+	bool cancelled = false;
+	try { RestoreBackup(backup, save, &progress); }
+	catch (const OperationCancelled&) { cancelled = true; }
+	CHECK(cancelled);
+	CHECK_EQ(ReadTestFile(save / "slot1.sav"), string(1024, 'a'));
+	CHECK(fs::exists(save / "stray.tmp"));
+	CHECK_EQ(static_cast<size_t>(distance(fs::directory_iterator(save), fs::directory_iterator())), 5u); // Three slots, world, stray
+
+	// Selected files are only renamed into place once all are copied
+	BackupManifest index = LoadBackupIndex(backup);
+	cancelled = false;
+	OperationProgress selected([&](const ProgressEvent& event) { if (event.filesDone == 1) selected.Cancel(); }, chrono::milliseconds(0));
+	try { RestoreSelectedFiles(backup, index.Select({ "slot1.sav", "slot2.sav" }), save, &selected); }
+	catch (const OperationCancelled&) { cancelled = true; }
+	CHECK(cancelled);
+	CHECK_EQ(ReadTestFile(save / "slot1.sav"), string(1024, 'a'));
+	CHECK(!fs::exists(save / "slot1.sav.partial"));
+
+	// Without a cancel, the restore goes through the staging folder next to the save and takes its place
+	OperationProgress full(nullptr);
+	REQUIRE(RestoreBackup(backup, save, &full));
+	CHECK(full.Last().finished);
+	CHECK_EQ(ReadTestFile(save / "slot1.sav"), string(1024, 'b'));
+	CHECK(!fs::exists(save / "stray.tmp"));
+	CHECK_EQ(static_cast<size_t>(distance(fs::directory_iterator(save), fs::directory_iterator())), 4u);
+}
+
+TEST_CASE("A cloud download reports each file and stops at a cancel")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteSave(save, 'a');
+	LocalDirectoryBackend backend(dir.path() / "cloud");
+	backend.PutTree(ScanTree(save), save, "game/1-plain-M/");
+	ChunkIndex chunks(GetChunkIndexPath(dir.path() / "Backups"), backend, "game/");
+	PutChunkedBackup(backend, ScanTree(save), save, "game/", "2-chunked-M", chunks);
+
+	OperationProgress plain(nullptr);
+	DownloadStoredBackup(backend, "game/1-plain-M/", dir.path() / "plain", nullptr, &plain);
+	CHECK(plain.Last().finished);
+	CHECK_EQ(plain.Last().filesTotal, 4u);
+	CHECK_EQ(plain.Last().filesDone, 4u);
+	CHECK_EQ(plain.Last().bytesDone, kSaveBytes);
+
+	// The chunked download stops before its next file, and leaves no partial file behind
+	fs::path target = dir.path() / "chunked";
+	OperationProgress progress([&](const ProgressEvent& event) { if (event.filesDone == 1) progress.Cancel(); }, chrono::milliseconds(0));
+	bool cancelled = false;
+	try { DownloadStoredFiles(backend, "game/2-chunked-M/", GetStoredBackupIndex(backend, "game/2-chunked-M/"), target, nullptr, &progress); }
+	catch (const OperationCancelled&) { cancelled = true; }
+	CHECK(cancelled);
+	CHECK_EQ(progress.Last().filesDone, 1u); // One file at a time from a local folder
+	for (const auto& entry : fs::recursive_directory_iterator(target)) CHECK(entry.path().extension() != ".partial");
+}
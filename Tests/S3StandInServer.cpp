@@ -0,0 +1,433 @@
+#include "S3StandInServer.h"
+#include "S3Backend.h"
+#include "Sha256.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace
+{
+	string PercentDecode(const string& text)
+	{
+		string out;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			if (text[i] == '%' && i + 2 < text.size())
+			{
+				out += static_cast<char>(stoi(text.substr(i + 1, 2), nullptr, 16));
+				i += 2;
+			}
+			else out += text[i];
+		}
+		return out;
+	}
+
+	string XmlEscape(const string& text)
+	{
+		string out;
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case '&': out += "&amp;"; break;
+			case '<': out += "&lt;"; break;
+			case '>': out += "&gt;"; break;
+			case '"': out += "&quot;"; break;
+			default: out += c;
+			}
+		}
+		return out;
+	}
+
+	string ETagOf(const string& data)
+	{
+		return "\"" + Sha256Hex(data).substr(0, 32) + "\"";
+	}
+
+	string StatusText(int status)
+	{
+		switch (status)
+		{
+		case 200: return "OK";
+		case 204: return "No Content";
+		case 206: return "Partial Content";
+		case 400: return "Bad Request";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 412: return "Precondition Failed";
+		case 416: return "Range Not Satisfiable";
+		default: return "Error";
+		}
+	}
+}
+
+S3StandInServer::S3StandInServer(string bucket, string accessKey, string secretKey, string region)
+	: m_bucket(move(bucket)), m_accessKey(move(accessKey)), m_secretKey(move(secretKey)), m_region(move(region))
+{
+	m_listener = TcpSocket::ListenLoopback();
+	m_port = m_listener.LocalPort();
+	m_acceptThread = thread(&S3StandInServer::AcceptLoop, this);
+}
+
+S3StandInServer::~S3StandInServer()
+{
+	m_stopping.store(true);
+	try { TcpSocket::Connect("127.0.0.1", m_port, chrono::seconds(1)); } // Wake the blocked accept()
+	catch (...) {}
+	m_acceptThread.join();
+	lock_guard<mutex> lock(m_connectionsMutex);
+	for (auto& connection : m_connections) connection.join();
+}
+
+string S3StandInServer::Endpoint() const
+{
+	return "http://127.0.0.1:" + to_string(m_port);
+}
+
+void S3StandInServer::AcceptLoop()
+{
+	while (!m_stopping.load())
+	{
+		TcpSocket socket;
+		try { socket = m_listener.Accept(); }
+		catch (...) { continue; }
+		if (m_stopping.load()) break;
+		lock_guard<mutex> lock(m_connectionsMutex);
+		m_connections.emplace_back(&S3StandInServer::HandleConnection, this, move(socket));
+	}
+}
+
+void S3StandInServer::HandleConnection(TcpSocket socket)
+{
+	try
+	{
+		string requestLine, body;
+		map<string, string> headers;
+		if (!ReadHttpMessage(socket, true, requestLine, headers, body)) return;
+		size_t first = requestLine.find(' '), second = requestLine.find(' ', first + 1);
+		string method = requestLine.substr(0, first);
+		string target = requestLine.substr(first + 1, second - first - 1);
+
+		Reply reply = SignatureMatches(method, target, headers, body) ? Handle(method, target, headers, body) : Error(403, "SignatureDoesNotMatch");
+		bool hasLength = any_of(reply.headers.begin(), reply.headers.end(), [](const auto& h) { return h.first == "Content-Length"; });
+		string head = "HTTP/1.1 " + to_string(reply.status) + " " + StatusText(reply.status) + "\r\n";
+		for (const auto& header : reply.headers) head += header.first + ": " + header.second + "\r\n";
+		if (!hasLength) head += "Content-Length: " + to_string(reply.body.size()) + "\r\n";
+		head += "Connection: close\r\n\r\n";
+		socket.SendAll(head.data(), head.size());
+		if (method != "HEAD") socket.SendAll(reply.body.data(), reply.body.size());
+	}
+	catch (...)
+	{
+		// Client went away; nothing to report
+	}
+}
+
+bool S3StandInServer::SignatureMatches(const string& method, const string& target, const map<string, string>& headers, const string& body)
+{
+	auto header = [&](const string& name) { auto it = headers.find(name); return it == headers.end() ? string() : it->second; };
+	string authorization = header("authorization");
+	string payloadHash = header("x-amz-content-sha256");
+	if (authorization.empty() || payloadHash != Sha256Hex(body)) return false;
+
+	// Re-sign the request as received, using the headers the client said it signed
+	size_t signedStart = authorization.find("SignedHeaders=");
+	if (signedStart == string::npos) return false;
+	signedStart += 14;
+	string signedHeaders = authorization.substr(signedStart, authorization.find(',', signedStart) - signedStart);
+
+	HttpRequest request;
+	request.method = method;
+	request.target = target;
+	request.body = body;
+	string host = header("host");
+	size_t colon = host.rfind(':');
+	request.host = colon == string::npos ? host : host.substr(0, colon);
+	request.port = colon == string::npos ? 80 : static_cast<uint16_t>(stoi(host.substr(colon + 1)));
+	size_t start = 0;
+	while (start <= signedHeaders.size())
+	{
+		size_t semicolon = signedHeaders.find(';', start);
+		string name = signedHeaders.substr(start, semicolon == string::npos ? string::npos : semicolon - start);
+		if (name != "host" && name != "x-amz-date") request.headers.emplace_back(name, header(name));
+		if (semicolon == string::npos) break;
+		start = semicolon + 1;
+	}
+	SignAwsV4(request, m_accessKey, m_secretKey, m_region, "s3", header("x-amz-date"));
+	return request.headers.back().second == authorization;
+}
+
+void S3StandInServer::Count(const string& operation)
+{
+	m_requestCounts[operation]++; // Caller holds m_mutex
+}
+
+S3StandInServer::Reply S3StandInServer::Error(int status, const string& code)
+{
+	Reply reply;
+	reply.status = status;
+	reply.body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<Error><Code>" + code + "</Code><Message>" + code + "</Message></Error>";
+	return reply;
+}
+
+S3StandInServer::Reply S3StandInServer::Handle(const string& method, const string& target, const map<string, string>& headers, const string& body)
+{
+	size_t question = target.find('?');
+	string path = PercentDecode(target.substr(0, question));
+	map<string, string> query;
+	if (question != string::npos)
+	{
+		string rest = target.substr(question + 1);
+		size_t start = 0;
+		while (start <= rest.size())
+		{
+			size_t amp = rest.find('&', start);
+			string parameter = rest.substr(start, amp == string::npos ? string::npos : amp - start);
+			size_t eq = parameter.find('=');
+			query[PercentDecode(parameter.substr(0, eq))] = eq == string::npos ? "" : PercentDecode(parameter.substr(eq + 1));
+			if (amp == string::npos) break;
+			start = amp + 1;
+		}
+	}
+
+	string bucketPrefix = "/" + m_bucket;
+	if (path.compare(0, bucketPrefix.size(), bucketPrefix) != 0) return Error(404, "NoSuchBucket");
+	string key = path.size() > bucketPrefix.size() + 1 ? path.substr(bucketPrefix.size() + 1) : "";
+	auto header = [&](const string& name) { auto it = headers.find(name); return it == headers.end() ? string() : it->second; };
+	bool ifNoneMatch = header("if-none-match") == "*";
+
+	if (method == "PUT" && query.count("uploadId"))
+	{
+		int partNumber = stoi(query["partNumber"]);
+		{
+			// Each part is held until two have been in flight together, so parallel parts always
+			// overlap however the threads are scheduled. A sequential upload stops the holding
+			// after one timeout.
+			unique_lock<mutex> lock(m_partsMutex);
+			int active = ++m_activeParts;
+			if (active > m_maxConcurrentParts.load()) m_maxConcurrentParts.store(active);
+			m_partArrived.notify_all();
+			if (!m_partsSequential && !m_partArrived.wait_for(lock, chrono::seconds(5), [this] { return m_maxConcurrentParts.load() > 1; }))
+			{
+				m_partsSequential = true;
+			}
+			--m_activeParts;
+		}
+
+		lock_guard<mutex> lock(m_mutex);
+		Count("UploadPart");
+		if (m_failPart.load() == partNumber) return Error(500, "InternalError");
+		auto upload = m_uploads.find(query["uploadId"]);
+		if (upload == m_uploads.end()) return Error(404, "NoSuchUpload");
+		upload->second[partNumber] = body;
+		Reply reply;
+		reply.headers.emplace_back("ETag", ETagOf(body));
+		return reply;
+	}
+
+	lock_guard<mutex> lock(m_mutex);
+	if (method == "GET" && key.empty())
+	{
+		Count("ListObjectsV2");
+		string prefix = query["prefix"], delimiter = query["delimiter"], token = query["continuation-token"];
+		size_t maxKeys = query.count("max-keys") ? stoul(query["max-keys"]) : 1000;
+
+		vector<pair<string, bool>> entries; // Key or common prefix, in order
+		string lastPrefix;
+		for (auto it = m_objects.lower_bound(prefix); it != m_objects.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+		{
+			size_t cut = delimiter.empty() ? string::npos : it->first.find(delimiter, prefix.size());
+			if (cut == string::npos) entries.emplace_back(it->first, false);
+			else
+			{
+				string common = it->first.substr(0, cut + delimiter.size());
+				if (common != lastPrefix) entries.emplace_back(common, true);
+				lastPrefix = common;
+			}
+		}
+		auto begin = entries.begin();
+		if (!token.empty()) begin = find_if(entries.begin(), entries.end(), [&](const auto& e) { return e.first > token; });
+
+		string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<ListBucketResult><Name>" + m_bucket + "</Name><Prefix>" + XmlEscape(prefix) + "</Prefix>";
+		size_t taken = 0;
+		string contents, prefixes, last;
+		auto it = begin;
+		for (; it != entries.end() && taken < maxKeys; ++it, ++taken)
+		{
+			if (it->second) prefixes += "<CommonPrefixes><Prefix>" + XmlEscape(it->first) + "</Prefix></CommonPrefixes>";
+			else
+			{
+				const string& data = m_objects[it->first];
+				contents += "<Contents><Key>" + XmlEscape(it->first) + "</Key><Size>" + to_string(data.size()) + "</Size><ETag>" + XmlEscape(ETagOf(data)) + "</ETag></Contents>";
+			}
+			last = it->first;
+		}
+		bool truncated = it != entries.end();
+		xml += "<KeyCount>" + to_string(taken) + "</KeyCount><MaxKeys>" + to_string(maxKeys) + "</MaxKeys><IsTruncated>" + (truncated ? "true" : "false") + "</IsTruncated>";
+		if (truncated) xml += "<NextContinuationToken>" + XmlEscape(last) + "</NextContinuationToken>";
+		xml += contents + prefixes + "</ListBucketResult>";
+		Reply reply;
+		reply.body = xml;
+		return reply;
+	}
+	if (method == "PUT")
+	{
+		Count("PutObject");
+		if (!m_failPut.empty() && key == m_failPut) return Error(500, "InternalError");
+		if (ifNoneMatch && m_objects.count(key)) return Error(412, "PreconditionFailed");
+		m_objects[key] = body;
+		m_objectSha256[key] = header("x-amz-meta-sha256");
+		Reply reply;
+		reply.headers.emplace_back("ETag", ETagOf(body));
+		return reply;
+	}
+	if (method == "POST" && query.count("uploads"))
+	{
+		Count("CreateMultipartUpload");
+		string uploadId = "upload-" + to_string(m_nextUploadId++);
+		m_uploads[uploadId];
+		m_uploadSha256[uploadId] = header("x-amz-meta-sha256");
+		Reply reply;
+		reply.body = "<InitiateMultipartUploadResult><Bucket>" + m_bucket + "</Bucket><Key>" + XmlEscape(key) + "</Key><UploadId>" + uploadId + "</UploadId></InitiateMultipartUploadResult>";
+		return reply;
+	}
+	if (method == "POST" && query.count("uploadId"))
+	{
+		Count("CompleteMultipartUpload");
+		auto upload = m_uploads.find(query["uploadId"]);
+		if (upload == m_uploads.end()) return Error(404, "NoSuchUpload");
+		if (ifNoneMatch && m_objects.count(key)) return Error(412, "PreconditionFailed");
+
+		string assembled;
+		int expected = 1;
+		size_t pos = 0;
+		while ((pos = body.find("<PartNumber>", pos)) != string::npos)
+		{
+			int number = stoi(body.substr(pos + 12));
+			size_t etagStart = body.find("<ETag>", pos) + 6;
+			string etag = body.substr(etagStart, body.find("</ETag>", etagStart) - etagStart);
+			auto part = upload->second.find(number);
+			if (number != expected++ || part == upload->second.end() || ETagOf(part->second) != etag) return Error(400, "InvalidPart");
+			bool lastPart = body.find("<PartNumber>", etagStart) == string::npos;
+			if (!lastPart && part->second.size() < 5 * 1024 * 1024) return Error(400, "EntityTooSmall");
+			assembled += part->second;
+			pos = etagStart;
+		}
+		m_objects[key] = move(assembled);
+		m_objectSha256[key] = m_uploadSha256[upload->first];
+		m_uploadSha256.erase(upload->first);
+		m_uploads.erase(upload);
+		Reply reply;
+		reply.body = "<CompleteMultipartUploadResult><Key>" + XmlEscape(key) + "</Key><ETag>" + XmlEscape(ETagOf(m_objects[key])) + "</ETag></CompleteMultipartUploadResult>";
+		return reply;
+	}
+	if (method == "GET" && query.count("uploadId"))
+	{
+		Count("ListParts");
+		auto upload = m_uploads.find(query["uploadId"]);
+		if (upload == m_uploads.end()) return Error(404, "NoSuchUpload");
+		int marker = query.count("part-number-marker") ? stoi(query["part-number-marker"]) : 0;
+		const int maxParts = 2; // Small pages, so clients must follow NextPartNumberMarker
+		string parts, last;
+		int taken = 0;
+		auto it = upload->second.upper_bound(marker);
+		for (; it != upload->second.end() && taken < maxParts; ++it, ++taken)
+		{
+			parts += "<Part><PartNumber>" + to_string(it->first) + "</PartNumber><ETag>" + XmlEscape(ETagOf(it->second)) + "</ETag><Size>" + to_string(it->second.size()) + "</Size></Part>";
+			last = to_string(it->first);
+		}
+		bool truncated = it != upload->second.end();
+		Reply reply;
+		reply.body = "<ListPartsResult><UploadId>" + upload->first + "</UploadId><IsTruncated>" + (truncated ? "true" : "false") + "</IsTruncated>"
+			+ (truncated ? "<NextPartNumberMarker>" + last + "</NextPartNumberMarker>" : "") + parts + "</ListPartsResult>";
+		return reply;
+	}
+	if (method == "DELETE" && query.count("uploadId"))
+	{
+		Count("AbortMultipartUpload");
+		m_uploads.erase(query["uploadId"]);
+		m_uploadSha256.erase(query["uploadId"]);
+		Reply reply;
+		reply.status = 204;
+		return reply;
+	}
+
+	auto object = m_objects.find(key);
+	if (method == "DELETE")
+	{
+		Count("DeleteObject");
+		if (object != m_objects.end()) m_objects.erase(object);
+		m_objectSha256.erase(key);
+		Reply reply;
+		reply.status = 204;
+		return reply;
+	}
+	if (object == m_objects.end()) return Error(404, "NoSuchKey");
+	if (method == "HEAD")
+	{
+		Count("HeadObject");
+		Reply reply;
+		reply.headers.emplace_back("Content-Length", to_string(object->second.size()));
+		reply.headers.emplace_back("ETag", ETagOf(object->second));
+		if (!m_objectSha256[key].empty()) reply.headers.emplace_back("x-amz-meta-sha256", m_objectSha256[key]);
+		return reply;
+	}
+	if (method == "GET")
+	{
+		Count("GetObject");
+		Reply reply;
+		string range = header("range");
+		if (range.compare(0, 6, "bytes=") == 0)
+		{
+			size_t dash = range.find('-');
+			uint64_t first = stoull(range.substr(6, dash - 6));
+			uint64_t last = min<uint64_t>(stoull(range.substr(dash + 1)), object->second.size() - 1);
+			if (object->second.empty() || first >= object->second.size()) return Error(416, "InvalidRange");
+			reply.status = 206;
+			reply.body = object->second.substr(first, last - first + 1);
+			reply.headers.emplace_back("Content-Range", "bytes " + to_string(first) + "-" + to_string(last) + "/" + to_string(object->second.size()));
+		}
+		else reply.body = object->second;
+		return reply;
+	}
+	return Error(400, "UnsupportedOperation");
+}
+
+bool S3StandInServer::HasObject(const string& key)
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_objects.count(key) > 0;
+}
+
+string S3StandInServer::Object(const string& key)
+{
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_objects.find(key);
+	return it == m_objects.end() ? string() : it->second;
+}
+
+size_t S3StandInServer::ObjectCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_objects.size();
+}
+
+int S3StandInServer::Requests(const string& operation)
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_requestCounts[operation];
+}
+
+size_t S3StandInServer::OpenUploads()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_uploads.size();
+}
+
+void S3StandInServer::FailPut(const string& key)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_failPut = key;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// In-process stand-in for an S3-compatible object store, listening on 127.0.0.1 only.
+// Implements the subset S3Backend uses (PUT/GET/HEAD/DELETE object, ranged GET, conditional
+// PUT, ListObjectsV2 with delimiter and continuation tokens, multipart upload) and checks
+// every request's Signature Version 4 and payload hash, so tests need no real network.
+
+#include "HttpClient.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class S3StandInServer
+{
+public:
+	S3StandInServer(std::string bucket = "backups", std::string accessKey = "test-access", std::string secretKey = "test-secret", std::string region = "us-east-1");
+	~S3StandInServer();
+
+	std::string Endpoint() const;
+	const std::string& Bucket() const { return m_bucket; }
+	const std::string& AccessKey() const { return m_accessKey; }
+	const std::string& SecretKey() const { return m_secretKey; }
+
+	bool HasObject(const std::string& key);
+	std::string Object(const std::string& key);
+	size_t ObjectCount();
+
+	int Requests(const std::string& operation); // "PutObject", "UploadPart", "ListObjectsV2", ...
+	int MaxConcurrentParts() const { return m_maxConcurrentParts.load(); }
+	size_t OpenUploads();
+
+	// Makes the UploadPart request for this part number fail with HTTP 500 (0 = none)
+	void FailPart(int partNumber) { m_failPart.store(partNumber); }
+
+	// Makes PUT of this key fail with HTTP 500 (empty = none)
+	void FailPut(const std::string& key);
+
+private:
+	struct Reply
+	{
+		int status = 200;
+		std::vector<std::pair<std::string, std::string>> headers;
+		std::string body;
+	};
+
+	void AcceptLoop();
+	void HandleConnection(TcpSocket socket);
+	Reply Handle(const std::string& method, const std::string& target, const std::map<std::string, std::string>& headers, const std::string& body);
+	Reply Error(int status, const std::string& code);
+	bool SignatureMatches(const std::string& method, const std::string& target, const std::map<std::string, std::string>& headers, const std::string& body);
+	void Count(const std::string& operation);
+
+	std::string m_bucket, m_accessKey, m_secretKey, m_region;
+	TcpSocket m_listener;
+	uint16_t m_port = 0;
+	std::atomic<bool> m_stopping{ false };
+	std::thread m_acceptThread;
+	std::mutex m_connectionsMutex;
+	std::vector<std::thread> m_connections;
+
+	std::mutex m_mutex;
+	std::map<std::string, std::string> m_objects;                 // Key -> data
+	std::map<std::string, std::string> m_objectSha256;            // Key -> x-amz-meta-sha256
+	std::map<std::string, std::map<int, std::string>> m_uploads;  // Upload ID -> part number -> data
+	std::map<std::string, std::string> m_uploadSha256;            // Upload ID -> x-amz-meta-sha256
+	std::map<std::string, int> m_requestCounts;
+	int m_nextUploadId = 1;
+	std::string m_failPut;
+
+	std::mutex m_partsMutex;
+	std::condition_variable m_partArrived;
+	bool m_partsSequential = false; // A part waited in vain for another: stop holding them
+	std::atomic<int> m_activeParts{ 0 };
+	std::atomic<int> m_maxConcurrentParts{ 0 };
+	std::atomic<int> m_failPart{ 0 };
+};
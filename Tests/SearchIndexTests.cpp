@@ -0,0 +1,177 @@
+#include "TestHarness.h"
+#include "BackupIndex.h"
+#include "BackupOperations.h"
+#include "EngineUtils.h"
+#include "SearchIndex.h"
+#include "Sha256.h"
+
+#include <atomic>
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	// What BackupSaveFolder does for the local copy, with a fixed folder name
+	void AddTestBackup(const fs::path& gameDir, const wstring& folderName, const fs::path& save)
+	{
+		fs::path backup = gameDir / ToPath(folderName);
+		fs::create_directories(backup);
+		fs::copy(save, backup, fs::copy_options::recursive);
+		BackupSearchIndex search(gameDir);
+		BackupManifest index = ManifestFromScan(ScanTree(save), save);
+		search.FillDigests(index, backup);
+		SaveBackupIndex(backup, index);
+		search.AddBackup(folderName, index);
+		REQUIRE(search.Save());
+	}
+}
+
+TEST_CASE("A backup records digests in its index and in the game's search index")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "slot1.sav", "first slot");
+	WriteTestFile(save / "sub" / "slot2.sav", "second slot");
+	GameProfile profile{ L"Searched", PathToWide(save), 60, false, L"searched" };
+	BackupResult result = BackupSaveFolder(profile, GlobalSettings{}, dir.path() / "Backups", false);
+	REQUIRE(result.localSuccess);
+	fs::path gameDir = GetLocalGameBackupDir(dir.path() / "Backups", profile);
+
+	BackupManifest index = LoadBackupIndex(gameDir / ToPath(result.folderName));
+	for (const auto& entry : index.entries)
+	{
+		if (entry.type == fs::file_type::regular) CHECK_EQ(entry.sha256, Sha256FileHex(save / fs::u8path(entry.path)));
+	}
+	REQUIRE(fs::exists(GetSearchIndexPath(gameDir)));
+	BackupSearchIndex search(gameDir);
+	CHECK(search.Covers(result.folderName));
+	vector<FileVersion> versions = search.Versions("sub/slot2.sav");
+	REQUIRE(versions.size() == 1);
+	CHECK_EQ(versions[0].sha256, Sha256Hex("second slot"));
+	CHECK_EQ(versions[0].size, 11u);
+	CHECK(versions[0].backups == vector<wstring>{ result.folderName });
+}
+
+TEST_CASE("Distinct versions of a file are listed newest first with the backups holding them")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	fs::path gameDir = dir.path() / "game";
+	WriteTestFile(save / "slot2.sav", "before the boss");
+	WriteTestFile(save / "options.ini", "volume=5");
+	AddTestBackup(gameDir, L"100-[x]-M", save);
+	AddTestBackup(gameDir, L"200-[x]-A", save);
+	WriteTestFile(save / "slot2.sav", "after the boss!");
+	AddTestBackup(gameDir, L"300-[x]-A", save);
+	WriteTestFile(save / "copy-of-slot2.sav", "before the boss");
+	AddTestBackup(gameDir, L"400-[x]-M", save);
+
+	BackupSearchIndex search(gameDir);
+	CHECK_EQ(search.BackupCount(), 4u);
+	vector<FileVersion> versions = search.Versions("slot2.sav");
+	REQUIRE(versions.size() == 2);
+	CHECK_EQ(versions[0].sha256, Sha256Hex("after the boss!"));
+	CHECK((versions[0].backups == vector<wstring>{ L"400-[x]-M", L"300-[x]-A" }));
+	CHECK_EQ(versions[1].sha256, Sha256Hex("before the boss"));
+	CHECK((versions[1].backups == vector<wstring>{ L"200-[x]-A", L"100-[x]-M" }));
+	CHECK_EQ(search.Versions("options.ini").size(), 1u);
+	CHECK(search.Versions("missing.sav").empty());
+
+	// The copy is found by content under its own name
+	vector<FileVersion> sameContent = search.WithDigest(Sha256Hex("before the boss"));
+	REQUIRE(sameContent.size() == 2);
+	CHECK_EQ(sameContent[0].path, string("copy-of-slot2.sav"));
+	CHECK_EQ(sameContent[1].path, string("slot2.sav"));
+	CHECK((search.FindPaths("SLOT2") == vector<string>{ "copy-of-slot2.sav", "slot2.sav" }));
+}
+
+TEST_CASE("Files already indexed at the same size and time are not hashed again")
+{
+	TempDir dir;
+	fs::path gameDir = dir.path() / "game";
+	BackupManifest index;
+	ManifestEntry entry;
+	entry.path = "slot.sav";
+	entry.size = 4;
+	entry.mtime = 1234;
+	entry.sha256 = Sha256Hex("four");
+	index.entries.push_back(entry);
+	BackupSearchIndex search(gameDir);
+	search.AddBackup(L"100-[x]-M", index);
+
+	// The backup folder does not even exist: the digest can only come from the index
+	BackupManifest next = index;
+	next.entries[0].sha256.clear();
+	CHECK_EQ(search.FillDigests(next, gameDir / "200-[x]-M"), 0u);
+	CHECK_EQ(next.entries[0].sha256, Sha256Hex("four"));
+
+	WriteTestFile(gameDir / "200-[x]-M" / "slot.sav", "five!");
+	next.entries[0].sha256.clear();
+	next.entries[0].size = 5;
+	CHECK_EQ(search.FillDigests(next, gameDir / "200-[x]-M"), 1u);
+	CHECK_EQ(next.entries[0].sha256, Sha256Hex("five!"));
+}
+
+TEST_CASE("Reconcile drops purged backups and rebuilds a lost index from the backup indexes")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	fs::path gameDir = dir.path() / "game";
+	WriteTestFile(save / "slot.sav", "one");
+	AddTestBackup(gameDir, L"100-[x]-M", save);
+	WriteTestFile(save / "slot.sav", "two");
+	AddTestBackup(gameDir, L"200-[x]-M", save);
+
+	vector<wstring> log;
+	PurgeBackups(gameDir, L"M", 0, 1, L"Local", log);
+	BackupSearchIndex stale(gameDir);
+	CHECK_EQ(stale.Versions("slot.sav").size(), 2u);
+	CHECK(stale.Reconcile());
+	REQUIRE(stale.Versions("slot.sav").size() == 1);
+	CHECK_EQ(stale.Versions("slot.sav")[0].sha256, Sha256Hex("two"));
+	CHECK(!stale.Reconcile());
+
+	// Damaged or deleted: rebuilt with the digests the backup indexes kept
+	WriteTestFile(GetSearchIndexPath(gameDir), "GSBM-SEARCH 1\nV\tslot.sav\tabc\t3\t0\t7\n");
+	CHECK_EQ(BackupSearchIndex(gameDir).BackupCount(), 0u);
+	BackupSearchIndex rebuilt = LoadBackupSearchIndex(gameDir);
+	REQUIRE(rebuilt.Versions("slot.sav").size() == 1);
+	CHECK_EQ(rebuilt.Versions("slot.sav")[0].sha256, Sha256Hex("two"));
+	CHECK(BackupSearchIndex(gameDir).Covers(L"200-[x]-M"));
+	fs::remove(GetSearchIndexPath(gameDir));
+	CHECK_EQ(LoadBackupSearchIndex(gameDir).VersionCount(), 1u);
+}
+
+TEST_CASE("Indexes saved at the same time each write their own temporary file")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	fs::path gameDir = dir.path() / "game";
+	WriteTestFile(save / "slot.sav", "shared");
+	AddTestBackup(gameDir, L"100-[x]-M", save);
+
+	atomic<int> failed{ 0 };
+	vector<thread> writers;
+	for (int writer = 0; writer < 4; ++writer)
+	{
+		writers.emplace_back([&gameDir, &failed]
+			{
+				BackupSearchIndex search(gameDir);
+				for (int round = 0; round < 20; ++round)
+				{
+					if (!search.Save()) failed++;
+				}
+			});
+	}
+	for (auto& writer : writers) writer.join();
+
+	CHECK_EQ(failed.load(), 0);
+	CHECK(BackupSearchIndex(gameDir).Covers(L"100-[x]-M"));
+	CHECK_EQ(BackupSearchIndex(gameDir).Versions("slot.sav").size(), 1u);
+	for (const auto& entry : fs::directory_iterator(GetSearchIndexPath(gameDir).parent_path()))
+	{
+		CHECK(entry.path().extension() != ".tmp");
+	}
+}
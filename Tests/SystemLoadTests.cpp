@@ -0,0 +1,110 @@
+#include "TestHarness.h"
+#include "Metrics.h"
+#include "SystemLoad.h"
+
+using namespace std;
+
+namespace
+{
+	using Clock = LoadGate::Clock;
+
+	LoadGateOptions Options()
+	{
+		LoadGateOptions options;
+		options.cpuLimit = 25;
+		options.ioLimit = 25;
+		options.maxDelay = chrono::seconds(300);
+		options.recheck = chrono::seconds(15);
+		return options;
+	}
+
+	SystemLoad Load(double cpu, double io)
+	{
+		SystemLoad load;
+		load.cpuPressure = cpu;
+		load.ioPressure = io;
+		load.source = "test";
+		return load;
+	}
+}
+
+TEST_CASE("The system load can be read")
+{
+	SystemLoad load = ReadSystemLoad();
+#ifndef _WIN32
+	CHECK(load.source == "psi" || load.source == "loadavg");
+#endif
+	CHECK(load.cpuPressure >= 0);
+	CHECK(load.cpuPressure <= 100);
+	CHECK(load.ioPressure >= 0);
+	CHECK(load.ioPressure <= 100);
+}
+
+TEST_CASE("An auto-save waits while the system is busy and runs once it quiets down")
+{
+	GetEngineMetrics().Reset();
+	SystemLoad current = Load(5, 5);
+	LoadGate gate(Options(), [&] { return current; });
+	Clock::time_point start{};
+
+	LoadGateDecision decision = gate.Check(start);
+	CHECK(decision.run);
+	CHECK(decision.deferredFor.count() == 0);
+
+	current = Load(10, 60); // Busy disk
+	decision = gate.Check(start + chrono::seconds(600));
+	CHECK(!decision.run);
+	CHECK(decision.retryIn == chrono::seconds(15));
+	CHECK(gate.Deferring());
+	current = Load(80, 0); // Busy CPU
+	decision = gate.Check(start + chrono::seconds(615));
+	CHECK(!decision.run);
+
+	current = Load(3, 2);
+	decision = gate.Check(start + chrono::seconds(630));
+	CHECK(decision.run);
+	CHECK(!decision.gaveUp);
+	CHECK(decision.deferredFor == chrono::seconds(30));
+	CHECK(!gate.Deferring());
+
+	const EngineMetrics& metrics = GetEngineMetrics();
+	CHECK_EQ(metrics.Deferrals().checks.load(), 2u);
+	CHECK_EQ(metrics.Deferrals().deferred.load(), 1u);
+	CHECK_EQ(metrics.Deferrals().gaveUp.load(), 0u);
+	CHECK_EQ(metrics.Stage(MetricStage::Deferral).Count(), 1u);
+	CHECK(metrics.Stage(MetricStage::Deferral).SumSeconds() == 30.0);
+}
+
+TEST_CASE("An auto-save never waits longer than the limit")
+{
+	GetEngineMetrics().Reset();
+	LoadGate gate(Options(), [] { return Load(100, 100); });
+	Clock::time_point start{};
+	chrono::seconds now{ 0 };
+	LoadGateDecision decision;
+	int looks = 0;
+	while (!(decision = gate.Check(start + now)).run)
+	{
+		CHECK(decision.retryIn >= chrono::seconds(1));
+		now += decision.retryIn;
+		REQUIRE(++looks < 100);
+	}
+	CHECK(now == chrono::seconds(300)); // Checks land on the limit, not past it
+	CHECK(decision.gaveUp);
+	CHECK(decision.deferredFor == chrono::seconds(300));
+	CHECK_EQ(GetEngineMetrics().Deferrals().gaveUp.load(), 1u);
+
+	// The next due auto-save starts a new wait
+	CHECK(!gate.Check(start + chrono::seconds(900)).run);
+	CHECK_EQ(GetEngineMetrics().Deferrals().deferred.load(), 2u);
+}
+
+TEST_CASE("A zero limit turns the load check off")
+{
+	LoadGateOptions options = Options();
+	options.maxDelay = chrono::seconds(0);
+	int samples = 0;
+	LoadGate gate(options, [&] { ++samples; return Load(100, 100); });
+	CHECK(gate.Check(Clock::time_point{}).run);
+	CHECK_EQ(samples, 0);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Minimal self-contained test harness so the engine tests build without extra dependencies.
+// Each test file registers cases with TEST_CASE and links against TestMain.cpp.
+
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct TestCase
+{
+	const char* name;
+	std::function<void()> body;
+};
+
+std::vector<TestCase>& GetTestRegistry();
+void ReportFailure(const char* file, int line, const std::string& message);
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, std::function<void()> body)
+	{
+		GetTestRegistry().push_back({ name, std::move(body) });
+	}
+};
+
+// Thrown by REQUIRE to abort the current test case
+struct TestAbort {};
+
+#define TEST_CONCAT_INNER(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_INNER(a, b)
+
+#define TEST_CASE(name)                                                                        \
+	static void TEST_CONCAT(TestFunc_, __LINE__)();                                            \
+	static TestRegistrar TEST_CONCAT(TestReg_, __LINE__)(name, &TEST_CONCAT(TestFunc_, __LINE__)); \
+	static void TEST_CONCAT(TestFunc_, __LINE__)()
+
+#define CHECK(expr)                                                \
+	do {                                                           \
+		if (!(expr)) ReportFailure(__FILE__, __LINE__, #expr);     \
+	} while (0)
+
+#define REQUIRE(expr)                                              \
+	do {                                                           \
+		if (!(expr)) {                                             \
+			ReportFailure(__FILE__, __LINE__, #expr);              \
+			throw TestAbort{};                                     \
+		}                                                          \
+	} while (0)
+
+#define CHECK_EQ(a, b)                                                             \
+	do {                                                                           \
+		auto&& _va = (a);                                                          \
+		auto&& _vb = (b);                                                          \
+		if (!(_va == _vb)) {                                                       \
+			std::ostringstream _oss;                                               \
+			_oss << #a << " == " << #b << " (" << _va << " vs " << _vb << ")";     \
+			ReportFailure(__FILE__, __LINE__, _oss.str());                         \
+		}                                                                          \
+	} while (0)
+
+/**
+ * @brief Creates a unique scratch directory under the system temp folder and deletes it on scope exit.
+ */
+class TempDir
+{
+public:
+	TempDir();
+	~TempDir();
+	TempDir(const TempDir&) = delete;
+	TempDir& operator=(const TempDir&) = delete;
+
+	const std::filesystem::path& path() const { return m_path; }
+
+private:
+	std::filesystem::path m_path;
+};
+
+// Writes a file (creating parent folders) with the given contents.
+void WriteTestFile(const std::filesystem::path& file, const std::string& contents);
+
+// Reads a whole file into a string (empty if missing).
+std::string ReadTestFile(const std::filesystem::path& file);
+
+// File contents whose bytes differ by position (and `seed`), so a misplaced block, part or range shows up.
+std::string TestPattern(size_t size, int seed = 0);
@@ -0,0 +1,87 @@
+#include "TestHarness.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	int g_failures = 0;
+}
+
+vector<TestCase>& GetTestRegistry()
+{
+	static vector<TestCase> registry;
+	return registry;
+}
+
+void ReportFailure(const char* file, int line, const string& message)
+{
+	++g_failures;
+	cerr << "  " << file << ":" << line << ": CHECK failed: " << message << endl;
+}
+
+TempDir::TempDir()
+{
+	static atomic<int> counter{ 0 };
+	random_device rd;
+	auto stamp = chrono::steady_clock::now().time_since_epoch().count();
+	m_path = fs::temp_directory_path() / ("gsbm_test_" + to_string(rd()) + "_" + to_string(stamp) + "_" + to_string(counter++));
+	fs::create_directories(m_path);
+}
+
+TempDir::~TempDir()
+{
+	error_code ec;
+	fs::remove_all(m_path, ec);
+}
+
+void WriteTestFile(const fs::path& file, const string& contents)
+{
+	if (file.has_parent_path()) fs::create_directories(file.parent_path());
+	ofstream out(file, ios::binary | ios::trunc);
+	out << contents;
+}
+
+string ReadTestFile(const fs::path& file)
+{
+	ifstream in(file, ios::binary);
+	return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+string TestPattern(size_t size, int seed)
+{
+	string data(size, '\0');
+	for (size_t i = 0; i < size; ++i) data[i] = static_cast<char>((i * 131 + i / 4096 + seed) & 0xFF);
+	return data;
+}
+
+int main()
+{
+	int failedCases = 0;
+	for (const auto& test : GetTestRegistry())
+	{
+		int before = g_failures;
+		try
+		{
+			test.body();
+		}
+		catch (const TestAbort&)
+		{
+		}
+		catch (const exception& e)
+		{
+			ReportFailure(test.name, 0, string("unexpected exception: ") + e.what());
+		}
+		bool passed = g_failures == before;
+		if (!passed) ++failedCases;
+		cout << (passed ? "[PASS] " : "[FAIL] ") << test.name << endl;
+	}
+	cout << GetTestRegistry().size() - failedCases << "/" << GetTestRegistry().size() << " test cases passed" << endl;
+	return failedCases == 0 ? 0 : 1;
+}
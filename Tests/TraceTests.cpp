@@ -0,0 +1,80 @@
+#include "TestHarness.h"
+#include "BackupOperations.h"
+#include "EngineUtils.h"
+#include "Trace.h"
+
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	size_t Count(const string& text, const string& needle)
+	{
+		size_t count = 0;
+		for (size_t pos = text.find(needle); pos != string::npos; pos = text.find(needle, pos + 1)) count++;
+		return count;
+	}
+}
+
+TEST_CASE("Spans are not recorded while tracing is off")
+{
+	Tracer& tracer = GetTracer();
+	CHECK(!tracer.Enabled());
+	{
+		TraceSpan span("idle");
+		CHECK(!span.Active());
+	}
+	CHECK_EQ(tracer.EventCount(), 0u);
+}
+
+TEST_CASE("A traced backup emits stage spans and spans for large files only")
+{
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "small.sav", "tiny");
+	WriteTestFile(save / "big \"world\".sav", string(4096, 'w'));
+	fs::create_directories(dir.path() / "cloud");
+
+	Tracer& tracer = GetTracer();
+	tracer.Start(1024);
+	tracer.SetThreadName("test-main");
+
+	GameProfile profile{ L"Traced", PathToWide(save), 60, true, L"traced" };
+	GlobalSettings settings;
+	settings.googleDrivePath = PathToWide(dir.path() / "cloud");
+	REQUIRE(BackupSaveFolder(profile, settings, dir.path() / "Backups", false).cloudSuccess);
+	thread worker([] { TraceSpan span("worker"); });
+	worker.join();
+
+	fs::path traceFile = dir.path() / "trace.json";
+	REQUIRE(tracer.StopAndWrite(traceFile));
+	CHECK(!tracer.Enabled());
+
+	string json = ReadTestFile(traceFile);
+	CHECK(json.rfind("{\"displayTimeUnit\"", 0) == 0);
+	CHECK(json.find("\"traceEvents\": [") != string::npos);
+	for (const char* stage : { "\"backup\"", "\"scan\"", "\"copy\"", "\"sync\"", "\"purge\"" })
+	{
+		CHECK(json.find(string("{\"name\": ") + stage) != string::npos);
+	}
+	CHECK_EQ(Count(json, "\"name\": \"copy_file\""), 2u); // Big file, local and cloud copy
+	CHECK(json.find("big \\\"world\\\".sav") != string::npos);
+	CHECK(json.find("small.sav") == string::npos);
+	CHECK(json.find("\"args\": {\"name\": \"test-main\"}") != string::npos);
+	CHECK(json.find("\"game\": \"Traced\"") != string::npos);
+
+	// The worker thread gets its own tid
+	size_t workerPos = json.find("\"name\": \"worker\"");
+	size_t scanPos = json.find("\"name\": \"scan\"");
+	REQUIRE(workerPos != string::npos);
+	string workerTid = json.substr(json.find("\"tid\": ", workerPos), 10);
+	string scanTid = json.substr(json.find("\"tid\": ", scanPos), 10);
+	CHECK(workerTid != scanTid);
+}
+
+TEST_CASE("EscapeJson escapes quotes, backslashes and control characters")
+{
+	CHECK(EscapeJson("C:\\Saves\\\"slot\"\n\x01") == "C:\\\\Saves\\\\\\\"slot\\\"\\n\\u0001");
+}
@@ -0,0 +1,248 @@
+#include "TestHarness.h"
+#include "S3StandInServer.h"
+#include "BackupOperations.h"
+#include "EngineUtils.h"
+#include "S3Backend.h"
+#include "StorageBackend.h"
+#include "TransferJournal.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+namespace
+{
+	S3Options OptionsFor(const S3StandInServer& server)
+	{
+		S3Options options;
+		options.endpoint = server.Endpoint();
+		options.bucket = server.Bucket();
+		options.accessKey = server.AccessKey();
+		options.secretKey = server.SecretKey();
+		options.partSize = 5 * 1024 * 1024;
+		options.multipartThreshold = 6 * 1024 * 1024;
+		options.parallelism = 3;
+		options.timeout = chrono::seconds(10);
+		return options;
+	}
+
+	// Scan in path order, so the file that fails is known to come last
+	TreeScan SortedScan(const fs::path& root)
+	{
+		TreeScan scan = ScanTree(root);
+		sort(scan.entries.begin(), scan.entries.end(), [](const ScannedEntry& a, const ScannedEntry& b) { return a.relativePath < b.relativePath; });
+		return scan;
+	}
+
+	bool Throws(const function<void()>& work)
+	{
+		try { work(); }
+		catch (const exception&) { return true; }
+		return false;
+	}
+}
+
+TEST_CASE("The journal replays its records and ignores a torn last line")
+{
+	TempDir dir;
+	fs::path file = dir.path() / ".transfers" / "1-A.journal";
+	{
+		TransferJournal journal(file, "s3");
+		CHECK(journal.Empty());
+		journal.FileDone("id/1-A/tab\tname.sav", 12, "aa");
+		journal.UploadStarted("id/1-A/big.bin", "upload-7");
+		journal.PartDone("id/1-A/big.bin", 2, "\"e2\"", 5);
+		journal.ChunkDone("id/1-A/huge.bin", 0, "c0");
+	}
+	{
+		ofstream torn(file, ios::binary | ios::app);
+		torn << "F\tid/1-A/half";
+	}
+
+	TransferJournal journal(file, "s3");
+	CHECK(!journal.Empty());
+	CHECK(!journal.TreeComplete());
+	TransferJournal::File done;
+	REQUIRE(journal.FindFile("id/1-A/tab\tname.sav", done));
+	CHECK_EQ(done.size, 12u);
+	CHECK(!journal.FindFile("id/1-A/half", done));
+	TransferJournal::Upload upload;
+	REQUIRE(journal.FindUpload("id/1-A/big.bin", upload));
+	CHECK_EQ(upload.uploadId, string("upload-7"));
+	CHECK_EQ(upload.parts[2].etag, string("\"e2\""));
+	CHECK_EQ(journal.Chunks("id/1-A/huge.bin").at(0), string("c0"));
+
+	// Finishing a file drops its upload and chunk state
+	journal.FileDone("id/1-A/big.bin", 10, "bb");
+	CHECK(journal.Uploads().empty());
+	journal.TreeDone();
+	CHECK(TransferJournal(file, "s3").TreeComplete());
+
+	// A journal from another backend kind does not apply
+	CHECK(TransferJournal(file, "local").Empty());
+	TransferJournal other(file, "local");
+	other.Remove();
+	CHECK(!fs::exists(file));
+	CHECK(!fs::exists(file.parent_path()));
+}
+
+TEST_CASE("An interrupted sync-folder transfer resumes without copying finished files again")
+{
+	TempDir dir;
+	fs::path source = dir.path() / "backup";
+	WriteTestFile(source / "a.sav", "alpha");
+	WriteTestFile(source / "b" / "c.sav", "charlie");
+	WriteTestFile(source / "z.sav", "zulu");
+	TreeScan scan = SortedScan(source);
+	fs::remove(source / "z.sav"); // Copying the last file fails
+
+	SyncFolderBackend backend(dir.path() / "cloud");
+	fs::path journalFile = dir.path() / "journal";
+	{
+		TransferJournal journal(journalFile, backend.Kind());
+		CHECK(Throws([&] { backend.PutTree(scan, source, "id/1-A/", &journal); }));
+	}
+	CHECK(!fs::exists(dir.path() / "cloud" / "id" / "1-A")); // Still staged, invisible to the sync client
+
+	WriteTestFile(source / "z.sav", "zulu");
+	TransferJournal journal(journalFile, backend.Kind());
+	CopyStats stats = backend.PutTree(scan, source, "id/1-A/", &journal);
+	CHECK_EQ(stats.filesResumed, 2u);
+	CHECK_EQ(stats.filesCopied, 1u);
+	CHECK_EQ(stats.bytesCopied, 4u);
+	CHECK(journal.TreeComplete());
+	CHECK_EQ(ReadTestFile(dir.path() / "cloud" / "id" / "1-A" / "b" / "c.sav"), string("charlie"));
+	CHECK_EQ(ReadTestFile(dir.path() / "cloud" / "id" / "1-A" / "z.sav"), string("zulu"));
+}
+
+TEST_CASE("A large file resumes from its last verified chunk")
+{
+	TempDir dir;
+	fs::path source = dir.path() / "backup";
+	string data = TestPattern(9 * 1024 * 1024 + 77);
+	WriteTestFile(source / "world.bin", data);
+	TreeScan scan = ScanTree(source);
+	fs::resize_file(source / "world.bin", 5 * 1024 * 1024); // Cut short after the first 4 MiB chunk
+
+	LocalDirectoryBackend backend(dir.path() / "store");
+	fs::path journalFile = dir.path() / "journal";
+	{
+		TransferJournal journal(journalFile, backend.Kind());
+		CHECK(Throws([&] { backend.PutTree(scan, source, "id/1-A/", &journal); }));
+		CHECK_EQ(journal.Chunks("id/1-A/world.bin").size(), 1u);
+	}
+
+	WriteTestFile(source / "world.bin", data);
+	{
+		TransferJournal journal(journalFile, backend.Kind());
+		CopyStats stats = backend.PutTree(scan, source, "id/1-A/", &journal);
+		CHECK_EQ(stats.bytesResumed, 4u * 1024 * 1024);
+		CHECK_EQ(stats.bytesCopied, data.size() - 4 * 1024 * 1024);
+	}
+	CHECK(ReadTestFile(dir.path() / "store" / "id" / "1-A" / "world.bin") == data);
+	StorageObject stored;
+	REQUIRE(backend.Stat("id/1-A/world.bin", stored));
+	CHECK_EQ(stored.size, data.size());
+
+	// A finished file whose content no longer matches the journal is copied again
+	WriteTestFile(dir.path() / "store" / "id" / "1-A" / "world.bin", "damaged");
+	TransferJournal journal(journalFile, backend.Kind());
+	CopyStats again = backend.PutTree(scan, source, "id/1-A/", &journal);
+	CHECK_EQ(again.filesResumed, 0u);
+	CHECK_EQ(again.bytesCopied, data.size());
+	CHECK(ReadTestFile(dir.path() / "store" / "id" / "1-A" / "world.bin") == data);
+}
+
+TEST_CASE("An interrupted multipart upload continues under its upload ID")
+{
+	S3StandInServer server;
+	S3Backend backend(OptionsFor(server));
+	TempDir dir;
+	fs::path source = dir.path() / "backup";
+	string data = TestPattern(12 * 1024 * 1024 + 5, 3);
+	WriteTestFile(source / "world.bin", data);
+	WriteTestFile(source / "slot.sav", "small");
+	TreeScan scan = ScanTree(source);
+	fs::path journalFile = dir.path() / "journal";
+
+	server.FailPart(2);
+	{
+		TransferJournal journal(journalFile, backend.Kind());
+		CHECK(Throws([&] { backend.PutTree(scan, source, "id/1-A/", &journal); }));
+	}
+	CHECK_EQ(server.OpenUploads(), 1u); // Kept open for the resume
+	CHECK_EQ(server.Requests("AbortMultipartUpload"), 0);
+	int partsSent = server.Requests("UploadPart") - 1; // Minus the failed one
+	int putsBefore = server.Requests("PutObject");
+
+	server.FailPart(0);
+	TransferJournal journal(journalFile, backend.Kind());
+	CopyStats stats = backend.PutTree(scan, source, "id/1-A/", &journal);
+	CHECK_EQ(server.Requests("CreateMultipartUpload"), 1);
+	CHECK_EQ(server.Requests("UploadPart") - partsSent - 1, 3 - partsSent);
+	CHECK(server.Requests("ListParts") >= 1);
+	CHECK_EQ(server.Requests("PutObject"), putsBefore); // The small file was verified, not re-sent
+	CHECK_EQ(stats.filesResumed, 1u);
+	CHECK(stats.bytesResumed > 5u);
+	CHECK_EQ(stats.bytesResumed + stats.bytesCopied, data.size() + 5);
+	CHECK(server.Object("id/1-A/world.bin") == data);
+	CHECK_EQ(server.OpenUploads(), 0u);
+
+	StorageObject stored;
+	REQUIRE(backend.Stat("id/1-A/world.bin", stored));
+	CHECK_EQ(stored.size, data.size());
+	CHECK_EQ(stored.sha256.size(), 64u);
+}
+
+TEST_CASE("BackupSaveFolder leaves a journal that the next run resumes or discards")
+{
+	S3StandInServer server;
+	TempDir dir;
+	fs::path save = dir.path() / "save";
+	WriteTestFile(save / "a.sav", "alpha");
+	WriteTestFile(save / "b.sav", "bravo");
+
+	GameProfile profile{ L"Resumed", PathToWide(save), 60, true, L"resumed" };
+	GlobalSettings settings;
+	settings.cloudBackend = L"s3";
+	settings.s3Endpoint = s2ws(server.Endpoint());
+	settings.s3Bucket = s2ws(server.Bucket());
+	settings.s3AccessKey = s2ws(server.AccessKey());
+	settings.s3SecretKey = s2ws(server.SecretKey());
+	settings.cloudLayout = L"folders"; // One object per file
+
+	BackupResult first = BackupSaveFolder(profile, settings, dir.path() / "Backups", true);
+	string prefix = "resumed/" + ws2s(first.folderName) + "/";
+	REQUIRE(first.cloudSuccess);
+	fs::path gameDir = GetLocalGameBackupDir(dir.path() / "Backups", profile);
+	CHECK(!fs::exists(gameDir / ".transfers")); // Removed after a complete sync
+
+	// Simulate a sync that stopped after a.sav: journal it and drop b.sav from the bucket
+	unique_ptr<StorageBackend> cloud = CreateStorageBackend(settings);
+	{
+		TransferJournal journal(GetTransferJournalPath(gameDir, first.folderName), cloud->Kind());
+		journal.FileDone(prefix + "a.sav", 5, "8ed3f6ad685b959ead7022518e1af76cd816f8e8ec7ccdda1ed4018e8f2223f8"); // SHA-256 of "alpha"
+		cloud->Remove(prefix + "b.sav");
+	}
+	vector<wstring> log;
+	CHECK_EQ(ResumeStoredTransfers(*cloud, gameDir, "resumed/", false, log), 1u);
+	REQUIRE(log.size() == 1);
+	CHECK(log[0].find(L"Resumed sync of " + first.folderName + L": 1 file(s) sent, 1 already uploaded") != wstring::npos);
+	CHECK_EQ(server.Object(prefix + "b.sav"), string("bravo"));
+	CHECK(!fs::exists(gameDir / ".transfers"));
+
+	// The local backup was purged before the resume: the partial cloud copy is discarded
+	{
+		TransferJournal journal(GetTransferJournalPath(gameDir, first.folderName), cloud->Kind());
+		journal.FileDone(prefix + "a.sav", 5, "00");
+	}
+	fs::remove_all(gameDir / ToPath(first.folderName));
+	log.clear();
+	CHECK_EQ(ResumeStoredTransfers(*cloud, gameDir, "resumed/", false, log), 0u);
+	REQUIRE(log.size() == 1);
+	CHECK(log[0].find(L"Discarded") != wstring::npos);
+	CHECK(!server.HasObject(prefix + "a.sav"));
+	CHECK(!fs::exists(gameDir / ".transfers"));
+}